@@ -432,7 +432,7 @@ void Application::Start() {
     aec_mode_ = interrupteMode == 0 ? kAecOff : kAecOnDeviceSide;
 #ifdef CONFIG_USE_MUSIC_PLAYER
     if (ota.GetSupportAirMusicPlayer() && (Board::GetInstance().GetBoardType() != "ml307")){
-        MusicPlayer::GetInstance().Initialize(codec, &audio_service_);
+        MusicPlayer::GetInstance().Initialize(codec, &audio_service_, CONFIG_MUSIC_LOCAL_LIBRARY_PATH);
     } 
 #endif
     // Initialize the protocol
@@ -707,14 +707,13 @@ void Application::MainEventLoop() {
 }
 
 void Application::OnWakeWordDetected() {
-#ifdef CONFIG_USE_MUSIC_PLAYER
-    MusicPlayer::GetInstance().InterruptPlay();
-#endif
-
     if (!protocol_) {
         return;
     }
 
+    // Music keeps playing under the conversation, quieter until the reply starts
+    audio_service_.DuckMusic(true);
+
     if (device_state_ == kDeviceStateIdle) {
         audio_service_.EncodeWakeWord();
 
@@ -789,6 +788,7 @@ void Application::SetDeviceState(DeviceState state) {
         case kDeviceStateIdle:
             display->SetStatus(Lang::Strings::STANDBY);
             display->SetEmotion("neutral");
+            audio_service_.DuckMusic(false);
             audio_service_.EnableVoiceProcessing(false);
             audio_service_.EnableWakeWordDetection(true);
             break;
@@ -811,6 +811,8 @@ void Application::SetDeviceState(DeviceState state) {
             break;
         case kDeviceStateSpeaking:
             display->SetStatus(Lang::Strings::SPEAKING);
+            // The reply ducks the music by itself from here on
+            audio_service_.DuckMusic(false);
 
             if (listening_mode_ != kListeningModeRealtime) {
                 audio_service_.EnableVoiceProcessing(false);
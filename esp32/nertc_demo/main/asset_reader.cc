@@ -0,0 +1,73 @@
+#include "asset_reader.h"
+
+#include <esp_log.h>
+#include <lz4frame.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "AssetReader"
+
+std::unique_ptr<AssetReader> AssetReader::Open(const uint8_t* data, size_t data_size, bool compressed) {
+    if (!compressed) {
+        return std::unique_ptr<AssetReader>(new AssetReader(data, data_size, data_size, nullptr));
+    }
+
+    LZ4F_dctx* dctx = nullptr;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) {
+        ESP_LOGE(TAG, "Failed to create LZ4 decompression context");
+        return nullptr;
+    }
+
+    LZ4F_frameInfo_t frame_info;
+    size_t header_size = data_size;
+    size_t ret = LZ4F_getFrameInfo(dctx, &frame_info, data, &header_size);
+    if (LZ4F_isError(ret) || frame_info.contentSize == 0) {
+        ESP_LOGE(TAG, "No valid LZ4 frame header");
+        LZ4F_freeDecompressionContext(dctx);
+        return nullptr;
+    }
+
+    auto reader = new AssetReader(data, data_size, frame_info.contentSize, dctx);
+    reader->data_offset_ = header_size;
+    return std::unique_ptr<AssetReader>(reader);
+}
+
+AssetReader::AssetReader(const uint8_t* data, size_t data_size, size_t size, LZ4F_dctx_s* dctx)
+    : data_(data), data_size_(data_size), size_(size), dctx_(dctx) {
+}
+
+AssetReader::~AssetReader() {
+    if (dctx_ != nullptr) {
+        LZ4F_freeDecompressionContext(dctx_);
+    }
+}
+
+int AssetReader::Read(void* buffer, size_t length) {
+    if (dctx_ == nullptr) {
+        size_t count = std::min(length, data_size_ - data_offset_);
+        memcpy(buffer, data_ + data_offset_, count);
+        data_offset_ += count;
+        return count;
+    }
+
+    size_t total = 0;
+    while (total < length && data_offset_ < data_size_) {
+        size_t dst_size = length - total;
+        size_t src_size = data_size_ - data_offset_;
+        size_t ret = LZ4F_decompress(dctx_, static_cast<uint8_t*>(buffer) + total, &dst_size,
+            data_ + data_offset_, &src_size, nullptr);
+        if (LZ4F_isError(ret)) {
+            ESP_LOGE(TAG, "LZ4 decompression failed: %s", LZ4F_getErrorName(ret));
+            return -1;
+        }
+        data_offset_ += src_size;
+        total += dst_size;
+        if (ret == 0) {
+            // End of frame
+            data_offset_ = data_size_;
+        } else if (dst_size == 0 && src_size == 0) {
+            break;
+        }
+    }
+    return total;
+}
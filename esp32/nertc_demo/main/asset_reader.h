@@ -0,0 +1,36 @@
+#ifndef ASSET_READER_H
+#define ASSET_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct LZ4F_dctx_s;
+
+// Sequential reader over a stored asset, either raw or an LZ4 frame that
+// carries its decompressed size. Assets uses it to fill the PSRAM copy of a
+// compressed asset, since fonts and emoji are parsed in place.
+class AssetReader {
+public:
+    // Returns nullptr if a compressed asset has no valid LZ4 frame header
+    static std::unique_ptr<AssetReader> Open(const uint8_t* data, size_t data_size, bool compressed);
+    ~AssetReader();
+
+    // Returns the number of bytes read, 0 at the end of the asset and -1 on error
+    int Read(void* buffer, size_t length);
+    inline size_t size() const { return size_; }
+    inline bool compressed() const { return dctx_ != nullptr; }
+
+private:
+    AssetReader(const uint8_t* data, size_t data_size, size_t size, LZ4F_dctx_s* dctx);
+    AssetReader(const AssetReader&) = delete;
+    AssetReader& operator=(const AssetReader&) = delete;
+
+    const uint8_t* data_;
+    size_t data_size_;
+    size_t data_offset_ = 0;
+    size_t size_;
+    LZ4F_dctx_s* dctx_;
+};
+
+#endif // ASSET_READER_H
@@ -1,17 +1,15 @@
 #include "assets.h"
+#include "asset_reader.h"
 #include "board.h"
-#include "display.h"
-#include "application.h"
-#include "lvgl_theme.h"
-#include "emote_display.h"
-#ifdef HAVE_LVGL
-#include "display/lcd_display.h"
-#endif
 
 #include <esp_log.h>
 #include <spi_flash_mmap.h>
 #include <esp_timer.h>
-#include <cbin_font.h>
+#include <esp_rom_crc.h>
+#include <esp_heap_caps.h>
+#include <mbedtls/sha256.h>
+#include <cstring>
+#include <algorithm>
 
 
 #define TAG "Assets"
@@ -24,6 +22,52 @@ struct mmap_assets_table {
     uint16_t asset_height;        /*!< Height of the asset */
 };
 
+// Version 2 packs start with this header instead of the legacy
+// {files, 16-bit checksum, length} triple, the magic can never be
+// mistaken for a legacy file count.
+#define ASSETS_V2_MAGIC     0x50545341  /* "ASTP" */
+#define ASSETS_V2_VERSION   2
+
+struct mmap_assets_header_v2 {
+    uint32_t magic;               /*!< ASSETS_V2_MAGIC */
+    uint16_t version;             /*!< Format version of the pack */
+    uint16_t header_size;         /*!< Size of this header, the table follows it */
+    uint32_t asset_count;         /*!< Number of entries in the table */
+    uint32_t data_length;         /*!< Length of the table and asset data */
+    uint32_t table_crc32;         /*!< CRC32 of the table */
+    uint8_t sha256[32];           /*!< SHA-256 of the table and asset data */
+};
+
+struct mmap_assets_table_v2 {
+    char asset_name[32];          /*!< Name of the asset */
+    uint32_t asset_size;          /*!< Size of the asset */
+    uint32_t asset_offset;        /*!< Offset of the asset */
+    uint16_t asset_width;         /*!< Width of the asset */
+    uint16_t asset_height;        /*!< Height of the asset */
+    uint32_t asset_crc32;         /*!< CRC32 of the asset data, without the magic */
+};
+
+// A delta pack (scripts/build_assets_delta.py) rewrites only the flash ranges
+// that differ between the installed v2 pack and the target one. It is made of
+// this header followed by record_count {offset, length, data[length]} records,
+// each starting on a flash sector boundary.
+#define ASSETS_DELTA_MAGIC  0x44545341  /* "ASTD" */
+
+struct mmap_assets_delta_header {
+    uint32_t magic;               /*!< ASSETS_DELTA_MAGIC */
+    uint16_t version;             /*!< Format version of the delta */
+    uint16_t header_size;         /*!< Size of this header, the first record follows it */
+    uint8_t base_sha256[32];      /*!< SHA-256 of the pack the delta applies to */
+    uint8_t target_sha256[32];    /*!< SHA-256 of the pack after the delta is applied */
+    uint32_t target_length;       /*!< Length of the target pack */
+    uint32_t record_count;        /*!< Number of records following the header */
+};
+
+struct mmap_assets_delta_record {
+    uint32_t offset;              /*!< Partition offset, sector aligned */
+    uint32_t length;              /*!< Number of data bytes following */
+};
+
 
 Assets::Assets() {
     // Initialize the partition
@@ -31,23 +75,55 @@ Assets::Assets() {
 }
 
 Assets::~Assets() {
+    ClearAssets();
     if (mmap_handle_ != 0) {
         esp_partition_munmap(mmap_handle_);
     }
 }
 
 uint32_t Assets::CalculateChecksum(const char* data, uint32_t length) {
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
     uint32_t checksum = 0;
-    for (uint32_t i = 0; i < length; i++) {
-        checksum += data[i];
+    while (length > 0 && (reinterpret_cast<uintptr_t>(bytes) & 3) != 0) {
+        checksum += *bytes++;
+        length--;
+    }
+
+    // Sum four bytes per load into two 16-bit lanes, folding before a lane can overflow
+    auto words = reinterpret_cast<const uint32_t*>(bytes);
+    uint32_t word_count = length / 4;
+    while (word_count > 0) {
+        uint32_t batch = word_count < 128 ? word_count : 128;
+        uint32_t lanes = 0;
+        for (uint32_t i = 0; i < batch; i++) {
+            uint32_t word = words[i];
+            lanes += (word & 0x00FF00FF) + ((word >> 8) & 0x00FF00FF);
+        }
+        checksum += (lanes & 0xFFFF) + (lanes >> 16);
+        words += batch;
+        word_count -= batch;
+    }
+
+    bytes = reinterpret_cast<const uint8_t*>(words);
+    for (uint32_t i = 0; i < (length & 3); i++) {
+        checksum += bytes[i];
     }
     return checksum & 0xFFFF;
 }
 
+void Assets::ClearAssets() {
+    for (auto& [name, asset] : assets_) {
+        if (asset.decompressed != nullptr) {
+            heap_caps_free(asset.decompressed);
+        }
+    }
+    assets_.clear();
+}
+
 bool Assets::InitializePartition() {
     partition_valid_ = false;
     checksum_valid_ = false;
-    assets_.clear();
+    ClearAssets();
 
     partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, "assets");
     if (partition_ == nullptr) {
@@ -71,6 +147,15 @@ bool Assets::InitializePartition() {
     }
 
     partition_valid_ = true;
+    checksum_valid_ = LoadAssetTable();
+    return checksum_valid_;
+}
+
+bool Assets::LoadAssetTable() {
+    has_digest_ = false;
+    if (*(const uint32_t*)mmap_root_ == ASSETS_V2_MAGIC) {
+        return LoadAssetTableV2();
+    }
 
     uint32_t stored_files = *(uint32_t*)(mmap_root_ + 0);
     uint32_t stored_chksum = *(uint32_t*)(mmap_root_ + 4);
@@ -91,8 +176,6 @@ bool Assets::InitializePartition() {
         return false;
     }
 
-    checksum_valid_ = true;
-
     for (uint32_t i = 0; i < stored_files; i++) {
         auto item = (const mmap_assets_table*)(mmap_root_ + 12 + i * sizeof(mmap_assets_table));
         auto asset = Asset{
@@ -101,289 +184,111 @@ bool Assets::InitializePartition() {
         };
         assets_[item->asset_name] = asset;
     }
-    return checksum_valid_;
+    return true;
 }
 
-bool Assets::Apply() {
-    void* ptr = nullptr;
-    size_t size = 0;
-    if (!GetAssetData("index.json", ptr, size)) {
-        ESP_LOGE(TAG, "The index.json file is not found");
+/*
+ * Only the table is checked at boot. Each asset carries its own CRC32 that is
+ * verified on first access in GetAssetData(), and the SHA-256 of the whole pack
+ * is checked by VerifyDigest() after a download, so boot time no longer grows
+ * with the size of the pack.
+ */
+bool Assets::LoadAssetTableV2() {
+    auto header = (const mmap_assets_header_v2*)mmap_root_;
+    if (header->version != ASSETS_V2_VERSION || header->header_size < sizeof(mmap_assets_header_v2)) {
+        ESP_LOGE(TAG, "The assets format version %u is not supported", header->version);
         return false;
     }
 
-    cJSON* root = cJSON_ParseWithLength(static_cast<char*>(ptr), size);
-    if (root == nullptr) {
-        ESP_LOGE(TAG, "The index.json file is not valid");
+    if (header->data_length > partition_->size - header->header_size) {
+        ESP_LOGE(TAG, "The data length (0x%lx) exceeds the partition size (0x%lx)", header->data_length, partition_->size);
         return false;
     }
 
-    cJSON* version = cJSON_GetObjectItem(root, "version");
-    if (cJSON_IsNumber(version)) {
-        if (version->valuedouble > 1) {
-            ESP_LOGE(TAG, "The assets version %d is not supported, please upgrade the firmware", version->valueint);
-            return false;
-        }
-    }
-    
-    cJSON* srmodels = cJSON_GetObjectItem(root, "srmodels");
-    if (cJSON_IsString(srmodels)) {
-        std::string srmodels_file = srmodels->valuestring;
-        if (GetAssetData(srmodels_file, ptr, size)) {
-            if (models_list_ != nullptr) {
-                esp_srmodel_deinit(models_list_);
-                models_list_ = nullptr;
-            }
-            models_list_ = srmodel_load(static_cast<uint8_t*>(ptr));
-            if (models_list_ != nullptr) {
-                auto& app = Application::GetInstance();
-                app.GetAudioService().SetModelsList(models_list_);
-            } else {
-                ESP_LOGE(TAG, "Failed to load srmodels.bin");
-            }
-        } else {
-            ESP_LOGE(TAG, "The srmodels file %s is not found", srmodels_file.c_str());
-        }
-    }
-
-#ifdef HAVE_LVGL
-    auto& theme_manager = LvglThemeManager::GetInstance();
-    auto light_theme = theme_manager.GetTheme("light");
-    auto dark_theme = theme_manager.GetTheme("dark");
-
-    cJSON* font = cJSON_GetObjectItem(root, "text_font");
-    if (cJSON_IsString(font)) {
-        std::string fonts_text_file = font->valuestring;
-        if (GetAssetData(fonts_text_file, ptr, size)) {
-            auto text_font = std::make_shared<LvglCBinFont>(ptr);
-            if (text_font->font() == nullptr) {
-                ESP_LOGE(TAG, "Failed to load fonts.bin");
-                return false;
-            }
-            if (light_theme != nullptr) {
-                light_theme->set_text_font(text_font);
-            }
-            if (dark_theme != nullptr) {
-                dark_theme->set_text_font(text_font);
-            }
-        } else {
-            ESP_LOGE(TAG, "The font file %s is not found", fonts_text_file.c_str());
-        }
+    uint32_t table_size = header->asset_count * sizeof(mmap_assets_table_v2);
+    if (header->asset_count > header->data_length / sizeof(mmap_assets_table_v2)) {
+        ESP_LOGE(TAG, "The asset count %lu exceeds the data length", header->asset_count);
+        return false;
     }
 
-    cJSON* emoji_collection = cJSON_GetObjectItem(root, "emoji_collection");
-    if (cJSON_IsArray(emoji_collection)) {
-        auto custom_emoji_collection = std::make_shared<EmojiCollection>();
-        int emoji_count = cJSON_GetArraySize(emoji_collection);
-        for (int i = 0; i < emoji_count; i++) {
-            cJSON* emoji = cJSON_GetArrayItem(emoji_collection, i);
-            if (cJSON_IsObject(emoji)) {
-                cJSON* name = cJSON_GetObjectItem(emoji, "name");
-                cJSON* file = cJSON_GetObjectItem(emoji, "file");
-                cJSON* eaf = cJSON_GetObjectItem(emoji, "eaf");
-                if (cJSON_IsString(name) && cJSON_IsString(file) && (NULL== eaf)) {
-                    if (!GetAssetData(file->valuestring, ptr, size)) {
-                        ESP_LOGE(TAG, "Emoji %s image file %s is not found", name->valuestring, file->valuestring);
-                        continue;
-                    }
-                    custom_emoji_collection->AddEmoji(name->valuestring, new LvglRawImage(ptr, size));
-                }
-            }
-        }
-        if (light_theme != nullptr) {
-            light_theme->set_emoji_collection(custom_emoji_collection);
-        }
-        if (dark_theme != nullptr) {
-            dark_theme->set_emoji_collection(custom_emoji_collection);
-        }
+    auto table = (const mmap_assets_table_v2*)(mmap_root_ + header->header_size);
+    uint32_t table_crc32 = esp_rom_crc32_le(0, (const uint8_t*)table, table_size);
+    if (table_crc32 != header->table_crc32) {
+        ESP_LOGE(TAG, "The table CRC32 (0x%08lx) does not match the stored one (0x%08lx)", table_crc32, header->table_crc32);
+        return false;
     }
 
-    cJSON* skin = cJSON_GetObjectItem(root, "skin");
-    if (cJSON_IsObject(skin)) {
-        cJSON* light_skin = cJSON_GetObjectItem(skin, "light");
-        if (cJSON_IsObject(light_skin) && light_theme != nullptr) {
-            cJSON* text_color = cJSON_GetObjectItem(light_skin, "text_color");
-            cJSON* background_color = cJSON_GetObjectItem(light_skin, "background_color");
-            cJSON* background_image = cJSON_GetObjectItem(light_skin, "background_image");
-            if (cJSON_IsString(text_color)) {
-                light_theme->set_text_color(LvglTheme::ParseColor(text_color->valuestring));
-            }
-            if (cJSON_IsString(background_color)) {
-                light_theme->set_background_color(LvglTheme::ParseColor(background_color->valuestring));
-                light_theme->set_chat_background_color(LvglTheme::ParseColor(background_color->valuestring));
-            }
-            if (cJSON_IsString(background_image)) {
-                if (!GetAssetData(background_image->valuestring, ptr, size)) {
-                    ESP_LOGE(TAG, "The background image file %s is not found", background_image->valuestring);
-                    return false;
-                }
-                auto background_image = std::make_shared<LvglCBinImage>(ptr);
-                light_theme->set_background_image(background_image);
-            }
-        }
-        cJSON* dark_skin = cJSON_GetObjectItem(skin, "dark");
-        if (cJSON_IsObject(dark_skin) && dark_theme != nullptr) {
-            cJSON* text_color = cJSON_GetObjectItem(dark_skin, "text_color");
-            cJSON* background_color = cJSON_GetObjectItem(dark_skin, "background_color");
-            cJSON* background_image = cJSON_GetObjectItem(dark_skin, "background_image");
-            if (cJSON_IsString(text_color)) {
-                dark_theme->set_text_color(LvglTheme::ParseColor(text_color->valuestring));
-            }
-            if (cJSON_IsString(background_color)) {
-                dark_theme->set_background_color(LvglTheme::ParseColor(background_color->valuestring));
-                dark_theme->set_chat_background_color(LvglTheme::ParseColor(background_color->valuestring));
-            }
-            if (cJSON_IsString(background_image)) {
-                if (!GetAssetData(background_image->valuestring, ptr, size)) {
-                    ESP_LOGE(TAG, "The background image file %s is not found", background_image->valuestring);
-                    return false;
-                }
-                auto background_image = std::make_shared<LvglCBinImage>(ptr);
-                dark_theme->set_background_image(background_image);
-            }
+    size_t data_offset = header->header_size + table_size;
+    for (uint32_t i = 0; i < header->asset_count; i++) {
+        auto item = &table[i];
+        // Each asset is prefixed with the 2-byte "ZZ" magic
+        if ((uint64_t)item->asset_offset + item->asset_size + 2 > header->data_length - table_size) {
+            ESP_LOGE(TAG, "The asset %.32s is out of range", item->asset_name);
+            return false;
         }
+        auto asset = Asset{
+            .size = static_cast<size_t>(item->asset_size),
+            .offset = data_offset + item->asset_offset,
+            .crc32 = item->asset_crc32,
+        };
+        assets_[std::string(item->asset_name, strnlen(item->asset_name, sizeof(item->asset_name)))] = asset;
     }
+    has_digest_ = true;
+    return true;
+}
 
-    auto display = Board::GetInstance().GetDisplay();
-    ESP_LOGI(TAG, "Refreshing display theme...");
-
-    auto current_theme = display->GetTheme();
-    if (current_theme != nullptr) {
-        display->SetTheme(current_theme);
-    }
-
-    // Parse hide_subtitle configuration
-    cJSON* hide_subtitle = cJSON_GetObjectItem(root, "hide_subtitle");
-    if (cJSON_IsBool(hide_subtitle)) {
-        bool hide = cJSON_IsTrue(hide_subtitle);
-        auto lcd_display = dynamic_cast<LcdDisplay*>(display);
-        if (lcd_display != nullptr) {
-            lcd_display->SetHideSubtitle(hide);
-            ESP_LOGI(TAG, "Set hide_subtitle to %s", hide ? "true" : "false");
-        }
+bool Assets::VerifyDigest() {
+    if (!checksum_valid_) {
+        return false;
     }
-
-#elif defined(CONFIG_USE_EMOTE_MESSAGE_STYLE)
-    auto &board = Board::GetInstance();
-    auto display = board.GetDisplay();
-    auto emote_display = dynamic_cast<emote::EmoteDisplay*>(display);
-
-    cJSON* font = cJSON_GetObjectItem(root, "text_font");
-    if (cJSON_IsString(font)) {
-        std::string fonts_text_file = font->valuestring;
-        if (GetAssetData(fonts_text_file, ptr, size)) {
-            auto text_font = std::make_shared<LvglCBinFont>(ptr);
-            if (text_font->font() == nullptr) {
-                ESP_LOGE(TAG, "Failed to load fonts.bin");
-                return false;
-            }
-
-            if (emote_display) {
-                emote_display->AddTextFont(text_font);
-            }
-        } else {
-            ESP_LOGE(TAG, "The font file %s is not found", fonts_text_file.c_str());
-        }
+    if (!has_digest_) {
+        // Legacy packs are fully summed when the table is loaded
+        return true;
     }
 
-    cJSON* emoji_collection = cJSON_GetObjectItem(root, "emoji_collection");
-    if (cJSON_IsArray(emoji_collection)) {
-        int emoji_count = cJSON_GetArraySize(emoji_collection);
-        if (emote_display) {
-            for (int i = 0; i < emoji_count; i++) {
-                cJSON* icon = cJSON_GetArrayItem(emoji_collection, i);
-                if (cJSON_IsObject(icon)) {
-                    cJSON* name = cJSON_GetObjectItem(icon, "name");
-                    cJSON* file = cJSON_GetObjectItem(icon, "file");
-
-                    if (cJSON_IsString(name) && cJSON_IsString(file)) {
-                        if (GetAssetData(file->valuestring, ptr, size)) {
-                            cJSON* eaf = cJSON_GetObjectItem(icon, "eaf");
-                            bool lack_value = false;
-                            bool loop_value = false;
-                            int fps_value = 0;
-
-                            if (cJSON_IsObject(eaf)) {
-                                cJSON* lack = cJSON_GetObjectItem(eaf, "lack");
-                                cJSON* loop = cJSON_GetObjectItem(eaf, "loop");
-                                cJSON* fps = cJSON_GetObjectItem(eaf, "fps");
-
-                                lack_value = lack ? cJSON_IsTrue(lack) : false;
-                                loop_value = loop ? cJSON_IsTrue(loop) : false;
-                                fps_value = fps ? fps->valueint : 0;
-
-                                emote_display->AddEmojiData(name->valuestring, ptr, size,
-                                                          static_cast<uint8_t>(fps_value),
-                                                          loop_value, lack_value);
-                            }
-
-                        } else {
-                            ESP_LOGE(TAG, "Emoji \"%10s\" image file %s is not found", name->valuestring, file->valuestring);
-                        }
-                    }
-                }
-            }
-        }
+    auto header = (const mmap_assets_header_v2*)mmap_root_;
+    uint8_t digest[32];
+    auto start_time = esp_timer_get_time();
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, (const unsigned char*)mmap_root_ + header->header_size, header->data_length);
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    int elapsed_ms = int((esp_timer_get_time() - start_time) / 1000);
+    ESP_LOGI(TAG, "The SHA-256 of %lu KB took %d ms", header->data_length / 1024, elapsed_ms);
+
+    if (memcmp(digest, header->sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "The SHA-256 of the assets does not match");
+        return false;
     }
+    return true;
+}
 
-    cJSON* icon_collection = cJSON_GetObjectItem(root, "icon_collection");
-    if (cJSON_IsArray(icon_collection)) {
-        if (emote_display) {
-            int icon_count = cJSON_GetArraySize(icon_collection);
-            for (int i = 0; i < icon_count; i++) {
-                cJSON* icon = cJSON_GetArrayItem(icon_collection, i);
-                if (cJSON_IsObject(icon)) {
-                    cJSON* name = cJSON_GetObjectItem(icon, "name");
-                    cJSON* file = cJSON_GetObjectItem(icon, "file");
-
-                    if (cJSON_IsString(name) && cJSON_IsString(file)) {
-                        if (GetAssetData(file->valuestring, ptr, size)) {
-                            emote_display->AddIconData(name->valuestring, ptr, size);
-                        } else {
-                            ESP_LOGE(TAG, "Icon \"%10s\" image file %s is not found", name->valuestring, file->valuestring);
-                        }
-                    }
-                }
-            }
+static int ReadFully(Http* http, void* buffer, size_t length) {
+    size_t total = 0;
+    while (total < length) {
+        int ret = http->Read(static_cast<char*>(buffer) + total, length - total);
+        if (ret < 0) {
+            return ret;
         }
-    }
-
-    cJSON* layout_json = cJSON_GetObjectItem(root, "layout");
-    if (cJSON_IsArray(layout_json)) {
-        int layout_count = cJSON_GetArraySize(layout_json);
-
-        for (int i = 0; i < layout_count; i++) {
-            cJSON* layout_item = cJSON_GetArrayItem(layout_json, i);
-            if (cJSON_IsObject(layout_item)) {
-                cJSON* name = cJSON_GetObjectItem(layout_item, "name");
-                cJSON* align = cJSON_GetObjectItem(layout_item, "align");
-                cJSON* x = cJSON_GetObjectItem(layout_item, "x");
-                cJSON* y = cJSON_GetObjectItem(layout_item, "y");
-                cJSON* width = cJSON_GetObjectItem(layout_item, "width");
-                cJSON* height = cJSON_GetObjectItem(layout_item, "height");
-
-                if (cJSON_IsString(name) && cJSON_IsString(align) && cJSON_IsNumber(x) && cJSON_IsNumber(y)) {
-                    int width_val = cJSON_IsNumber(width) ? width->valueint : 0;
-                    int height_val = cJSON_IsNumber(height) ? height->valueint : 0;
-
-                    if (emote_display) {
-                        emote_display->AddLayoutData(name->valuestring, align->valuestring,
-                                                     x->valueint, y->valueint, width_val, height_val);
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Invalid layout item %d: missing required fields", i);
-                }
-            }
+        if (ret == 0) {
+            break;
         }
+        total += ret;
     }
-#endif
-
-    cJSON_Delete(root);
-    return true;
+    return total;
 }
 
 bool Assets::Download(std::string url, std::function<void(int progress, size_t speed)> progress_callback) {
     ESP_LOGI(TAG, "Downloading new version of assets from %s", url.c_str());
+
+    // Remember which pack is installed, a delta only applies on top of it
+    uint8_t installed_sha256[32] = {0};
+    bool has_installed_digest = checksum_valid_ && has_digest_;
+    if (has_installed_digest) {
+        memcpy(installed_sha256, ((const mmap_assets_header_v2*)mmap_root_)->sha256, sizeof(installed_sha256));
+    }
     
     // 取消当前资源分区的内存映射
     if (mmap_handle_ != 0) {
@@ -392,7 +297,7 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
         mmap_root_ = nullptr;
     }
     checksum_valid_ = false;
-    assets_.clear();
+    ClearAssets();
 
     // 下载新的资源文件
     auto network = Board::GetInstance().GetNetwork();
@@ -419,6 +324,40 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
         return false;
     }
 
+    // Sniff the first bytes to tell a delta from a full pack
+    char buffer[512];
+    int head_length = ReadFully(http.get(), buffer, sizeof(mmap_assets_delta_header));
+    if (head_length < 0) {
+        ESP_LOGE(TAG, "Failed to read HTTP data: %s", esp_err_to_name(head_length));
+        return false;
+    }
+
+    if (head_length == sizeof(mmap_assets_delta_header) && *(const uint32_t*)buffer == ASSETS_DELTA_MAGIC) {
+        mmap_assets_delta_header header;
+        memcpy(&header, buffer, sizeof(header));
+        if (!has_installed_digest || memcmp(header.base_sha256, installed_sha256, sizeof(installed_sha256)) != 0) {
+            ESP_LOGE(TAG, "The delta does not apply to the installed assets");
+            http->Close();
+            InitializePartition();
+            return false;
+        }
+        bool success = ApplyDelta(http.get(), header, content_length, progress_callback);
+        http->Close();
+        if (!success || !InitializePartition() || !VerifyDigest()) {
+            ESP_LOGE(TAG, "Failed to apply assets delta");
+            checksum_valid_ = false;
+            ClearAssets();
+            return false;
+        }
+        if (memcmp(((const mmap_assets_header_v2*)mmap_root_)->sha256, header.target_sha256, sizeof(header.target_sha256)) != 0) {
+            ESP_LOGE(TAG, "The patched assets do not match the delta target");
+            checksum_valid_ = false;
+            ClearAssets();
+            return false;
+        }
+        return true;
+    }
+
     // 定义扇区大小为4KB（ESP32的标准扇区大小）
     const size_t SECTOR_SIZE = esp_partition_get_main_flash_sector_size();
     
@@ -430,14 +369,17 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
              SECTOR_SIZE, content_length, sectors_to_erase, total_erase_size);
     
     // 写入新的资源文件到分区，一边erase一边写入
-    char buffer[512];
     size_t total_written = 0;
     size_t recent_written = 0;
     size_t current_sector = 0;
     auto last_calc_time = esp_timer_get_time();
     
     while (true) {
-        int ret = http->Read(buffer, sizeof(buffer));
+        // The sniffed bytes are the start of the full pack
+        int ret = head_length;
+        if (total_written > 0 || head_length == 0) {
+            ret = http->Read(buffer, sizeof(buffer));
+        }
         if (ret < 0) {
             ESP_LOGE(TAG, "Failed to read HTTP data: %s", esp_err_to_name(ret));
             return false;
@@ -512,21 +454,166 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
         return false;
     }
 
+    if (!VerifyDigest()) {
+        checksum_valid_ = false;
+        ClearAssets();
+        return false;
+    }
+
     return true;
 }
 
-bool Assets::GetAssetData(const std::string& name, void*& ptr, size_t& size) {
-    auto asset = assets_.find(name);
-    if (asset == assets_.end()) {
+bool Assets::ApplyDelta(Http* http, const mmap_assets_delta_header& header, size_t content_length,
+    std::function<void(int progress, size_t speed)> progress_callback) {
+    if (header.header_size < sizeof(header) || header.target_length > partition_->size) {
+        ESP_LOGE(TAG, "Invalid assets delta header");
         return false;
     }
-    auto data = (const char*)(mmap_root_ + asset->second.offset);
-    if (data[0] != 'Z' || data[1] != 'Z') {
+    // Skip any header fields newer than this firmware knows about
+    char buffer[512];
+    size_t skip = header.header_size - sizeof(header);
+    while (skip > 0) {
+        int ret = ReadFully(http, buffer, std::min(skip, sizeof(buffer)));
+        if (ret <= 0) {
+            return false;
+        }
+        skip -= ret;
+    }
+
+    const size_t SECTOR_SIZE = esp_partition_get_main_flash_sector_size();
+    ESP_LOGI(TAG, "Applying assets delta, %lu records, target length %lu", header.record_count, header.target_length);
+
+    size_t total_read = header.header_size;
+    size_t recent_read = 0;
+    size_t total_patched = 0;
+    auto last_calc_time = esp_timer_get_time();
+    for (uint32_t i = 0; i < header.record_count; i++) {
+        mmap_assets_delta_record record;
+        if (ReadFully(http, &record, sizeof(record)) != sizeof(record)) {
+            ESP_LOGE(TAG, "Failed to read delta record %lu", i);
+            return false;
+        }
+        total_read += sizeof(record);
+        if (record.offset % SECTOR_SIZE != 0 || (uint64_t)record.offset + record.length > partition_->size) {
+            ESP_LOGE(TAG, "Invalid delta record at 0x%lx, length %lu", record.offset, record.length);
+            return false;
+        }
+
+        size_t erase_size = (record.length + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        esp_err_t err = esp_partition_erase_range(partition_, record.offset, erase_size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase 0x%lx: %s", record.offset, esp_err_to_name(err));
+            return false;
+        }
+
+        size_t remaining = record.length;
+        size_t write_offset = record.offset;
+        while (remaining > 0) {
+            int ret = ReadFully(http, buffer, std::min(remaining, sizeof(buffer)));
+            if (ret <= 0) {
+                ESP_LOGE(TAG, "Delta truncated at record %lu", i);
+                return false;
+            }
+            err = esp_partition_write(partition_, write_offset, buffer, ret);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write to assets partition at offset %u: %s", write_offset, esp_err_to_name(err));
+                return false;
+            }
+            write_offset += ret;
+            remaining -= ret;
+            total_read += ret;
+            recent_read += ret;
+
+            if (esp_timer_get_time() - last_calc_time >= 1000000) {
+                size_t progress = total_read * 100 / content_length;
+                ESP_LOGI(TAG, "Progress: %u%% (%u/%u), Speed: %u B/s", progress, total_read, content_length, recent_read);
+                if (progress_callback) {
+                    progress_callback(progress, recent_read);
+                }
+                last_calc_time = esp_timer_get_time();
+                recent_read = 0;
+            }
+        }
+        total_patched += erase_size;
+    }
+
+    if (progress_callback) {
+        progress_callback(100, recent_read);
+    }
+    ESP_LOGI(TAG, "Assets delta applied, %u KB rewritten for a %lu KB pack", total_patched / 1024, header.target_length / 1024);
+    return true;
+}
+
+/*
+ * Every asset is stored behind a 2-byte magic: "ZZ" for raw data and "Z4" for
+ * an LZ4 frame that carries its decompressed size.
+ */
+const uint8_t* Assets::GetStoredData(const std::string& name, Asset*& asset, bool& compressed) {
+    auto it = assets_.find(name);
+    if (it == assets_.end()) {
+        return nullptr;
+    }
+    asset = &it->second;
+    auto data = (const uint8_t*)(mmap_root_ + asset->offset);
+    if (data[0] != 'Z' || (data[1] != 'Z' && data[1] != '4')) {
         ESP_LOGE(TAG, "The asset %s is not valid with magic %02x%02x", name.c_str(), data[0], data[1]);
+        return nullptr;
+    }
+    compressed = data[1] == '4';
+
+    if (asset->crc32 != 0 && !asset->verified) {
+        uint32_t crc32 = esp_rom_crc32_le(0, data + 2, asset->size);
+        if (crc32 != asset->crc32) {
+            ESP_LOGE(TAG, "The asset %s is corrupted, CRC32 0x%08lx != 0x%08lx", name.c_str(), crc32, asset->crc32);
+            return nullptr;
+        }
+        asset->verified = true;
+    }
+    return data + 2;
+}
+
+bool Assets::GetAssetData(const std::string& name, void*& ptr, size_t& size) {
+    Asset* asset = nullptr;
+    bool compressed = false;
+    auto data = GetStoredData(name, asset, compressed);
+    if (data == nullptr) {
         return false;
     }
 
-    ptr = static_cast<void*>(const_cast<char*>(data + 2));
-    size = asset->second.size;
+    if (!compressed) {
+        ptr = static_cast<void*>(const_cast<uint8_t*>(data));
+        size = asset->size;
+        return true;
+    }
+
+    // Consumers keep pointing into the asset, so decompress once and keep the copy
+    if (asset->decompressed == nullptr) {
+        auto reader = AssetReader::Open(data, asset->size, true);
+        if (!reader) {
+            return false;
+        }
+        auto start_time = esp_timer_get_time();
+        void* buffer = heap_caps_malloc(reader->size(), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (buffer == nullptr) {
+            buffer = heap_caps_malloc(reader->size(), MALLOC_CAP_8BIT);
+        }
+        if (buffer == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes for asset %s", reader->size(), name.c_str());
+            return false;
+        }
+        int ret = reader->Read(buffer, reader->size());
+        if (ret != (int)reader->size()) {
+            ESP_LOGE(TAG, "Failed to decompress asset %s", name.c_str());
+            heap_caps_free(buffer);
+            return false;
+        }
+        asset->decompressed = buffer;
+        asset->decompressed_size = reader->size();
+        ESP_LOGI(TAG, "Decompressed %s (%u -> %u bytes) in %d ms", name.c_str(), asset->size,
+            asset->decompressed_size, int((esp_timer_get_time() - start_time) / 1000));
+    }
+
+    ptr = asset->decompressed;
+    size = asset->decompressed_size;
     return true;
 }
@@ -6,13 +6,20 @@
 #include <functional>
 
 #include <cJSON.h>
+#include <http.h>
 #include <esp_partition.h>
 #include <model_path.h>
 
 
+struct mmap_assets_delta_header;
+
 struct Asset {
     size_t size;
     size_t offset;
+    uint32_t crc32 = 0;         // Per-asset CRC32, 0 for legacy packs without one
+    bool verified = false;      // Set once the CRC32 has been checked on first access
+    void* decompressed = nullptr;   // Cached copy of an LZ4-frame compressed asset
+    size_t decompressed_size = 0;
 };
 
 class Assets {
@@ -26,6 +33,7 @@ public:
     bool Download(std::string url, std::function<void(int progress, size_t speed)> progress_callback);
     bool Apply();
     bool GetAssetData(const std::string& name, void*& ptr, size_t& size);
+    bool VerifyDigest();
 
     inline bool partition_valid() const { return partition_valid_; }
     inline bool checksum_valid() const { return checksum_valid_; }
@@ -37,6 +45,12 @@ private:
     Assets& operator=(const Assets&) = delete;
 
     bool InitializePartition();
+    void ClearAssets();
+    const uint8_t* GetStoredData(const std::string& name, Asset*& asset, bool& compressed);
+    bool LoadAssetTable();
+    bool LoadAssetTableV2();
+    bool ApplyDelta(Http* http, const mmap_assets_delta_header& header, size_t content_length,
+        std::function<void(int progress, size_t speed)> progress_callback);
     uint32_t CalculateChecksum(const char* data, uint32_t length);
 
     const esp_partition_t* partition_ = nullptr;
@@ -44,6 +58,7 @@ private:
     const char* mmap_root_ = nullptr;
     bool partition_valid_ = false;
     bool checksum_valid_ = false;
+    bool has_digest_ = false;
     std::string default_assets_url_;
     srmodel_list_t* models_list_ = nullptr;
     std::map<std::string, Asset> assets_;
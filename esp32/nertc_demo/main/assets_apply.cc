@@ -0,0 +1,303 @@
+#include "assets.h"
+#include "board.h"
+#include "display.h"
+#include "application.h"
+#include "lvgl_theme.h"
+#include "emote_display.h"
+#ifdef HAVE_LVGL
+#include "display/lcd_display.h"
+#endif
+
+#include <esp_log.h>
+#include <cbin_font.h>
+#include <cstring>
+
+#define TAG "Assets"
+
+/*
+ * Applying a pack configures the display, fonts and wake word models from its
+ * index.json. It lives apart from the partition and download code in
+ * assets.cc, which has no display dependencies.
+ */
+bool Assets::Apply() {
+    void* ptr = nullptr;
+    size_t size = 0;
+    if (!GetAssetData("index.json", ptr, size)) {
+        ESP_LOGE(TAG, "The index.json file is not found");
+        return false;
+    }
+
+    cJSON* root = cJSON_ParseWithLength(static_cast<char*>(ptr), size);
+    if (root == nullptr) {
+        ESP_LOGE(TAG, "The index.json file is not valid");
+        return false;
+    }
+
+    cJSON* version = cJSON_GetObjectItem(root, "version");
+    if (cJSON_IsNumber(version)) {
+        if (version->valuedouble > 1) {
+            ESP_LOGE(TAG, "The assets version %d is not supported, please upgrade the firmware", version->valueint);
+            return false;
+        }
+    }
+    
+    cJSON* srmodels = cJSON_GetObjectItem(root, "srmodels");
+    if (cJSON_IsString(srmodels)) {
+        std::string srmodels_file = srmodels->valuestring;
+        if (GetAssetData(srmodels_file, ptr, size)) {
+            if (models_list_ != nullptr) {
+                esp_srmodel_deinit(models_list_);
+                models_list_ = nullptr;
+            }
+            models_list_ = srmodel_load(static_cast<uint8_t*>(ptr));
+            if (models_list_ != nullptr) {
+                auto& app = Application::GetInstance();
+                app.GetAudioService().SetModelsList(models_list_);
+            } else {
+                ESP_LOGE(TAG, "Failed to load srmodels.bin");
+            }
+        } else {
+            ESP_LOGE(TAG, "The srmodels file %s is not found", srmodels_file.c_str());
+        }
+    }
+
+#ifdef HAVE_LVGL
+    auto& theme_manager = LvglThemeManager::GetInstance();
+    auto light_theme = theme_manager.GetTheme("light");
+    auto dark_theme = theme_manager.GetTheme("dark");
+
+    cJSON* font = cJSON_GetObjectItem(root, "text_font");
+    if (cJSON_IsString(font)) {
+        std::string fonts_text_file = font->valuestring;
+        if (GetAssetData(fonts_text_file, ptr, size)) {
+            auto text_font = std::make_shared<LvglCBinFont>(ptr);
+            if (text_font->font() == nullptr) {
+                ESP_LOGE(TAG, "Failed to load fonts.bin");
+                return false;
+            }
+            if (light_theme != nullptr) {
+                light_theme->set_text_font(text_font);
+            }
+            if (dark_theme != nullptr) {
+                dark_theme->set_text_font(text_font);
+            }
+        } else {
+            ESP_LOGE(TAG, "The font file %s is not found", fonts_text_file.c_str());
+        }
+    }
+
+    cJSON* emoji_collection = cJSON_GetObjectItem(root, "emoji_collection");
+    if (cJSON_IsArray(emoji_collection)) {
+        auto custom_emoji_collection = std::make_shared<EmojiCollection>();
+        int emoji_count = cJSON_GetArraySize(emoji_collection);
+        for (int i = 0; i < emoji_count; i++) {
+            cJSON* emoji = cJSON_GetArrayItem(emoji_collection, i);
+            if (cJSON_IsObject(emoji)) {
+                cJSON* name = cJSON_GetObjectItem(emoji, "name");
+                cJSON* file = cJSON_GetObjectItem(emoji, "file");
+                cJSON* eaf = cJSON_GetObjectItem(emoji, "eaf");
+                if (cJSON_IsString(name) && cJSON_IsString(file) && (NULL== eaf)) {
+                    if (!GetAssetData(file->valuestring, ptr, size)) {
+                        ESP_LOGE(TAG, "Emoji %s image file %s is not found", name->valuestring, file->valuestring);
+                        continue;
+                    }
+                    custom_emoji_collection->AddEmoji(name->valuestring, new LvglRawImage(ptr, size));
+                }
+            }
+        }
+        // The display caches GIF decoders by image, drop them before the old images are freed
+        auto lcd_display = dynamic_cast<LcdDisplay*>(Board::GetInstance().GetDisplay());
+        if (lcd_display != nullptr) {
+            lcd_display->ClearGifCache();
+        }
+        if (light_theme != nullptr) {
+            light_theme->set_emoji_collection(custom_emoji_collection);
+        }
+        if (dark_theme != nullptr) {
+            dark_theme->set_emoji_collection(custom_emoji_collection);
+        }
+    }
+
+    cJSON* skin = cJSON_GetObjectItem(root, "skin");
+    if (cJSON_IsObject(skin)) {
+        cJSON* light_skin = cJSON_GetObjectItem(skin, "light");
+        if (cJSON_IsObject(light_skin) && light_theme != nullptr) {
+            cJSON* text_color = cJSON_GetObjectItem(light_skin, "text_color");
+            cJSON* background_color = cJSON_GetObjectItem(light_skin, "background_color");
+            cJSON* background_image = cJSON_GetObjectItem(light_skin, "background_image");
+            if (cJSON_IsString(text_color)) {
+                light_theme->set_text_color(LvglTheme::ParseColor(text_color->valuestring));
+            }
+            if (cJSON_IsString(background_color)) {
+                light_theme->set_background_color(LvglTheme::ParseColor(background_color->valuestring));
+                light_theme->set_chat_background_color(LvglTheme::ParseColor(background_color->valuestring));
+            }
+            if (cJSON_IsString(background_image)) {
+                if (!GetAssetData(background_image->valuestring, ptr, size)) {
+                    ESP_LOGE(TAG, "The background image file %s is not found", background_image->valuestring);
+                    return false;
+                }
+                auto background_image = std::make_shared<LvglCBinImage>(ptr);
+                light_theme->set_background_image(background_image);
+            }
+        }
+        cJSON* dark_skin = cJSON_GetObjectItem(skin, "dark");
+        if (cJSON_IsObject(dark_skin) && dark_theme != nullptr) {
+            cJSON* text_color = cJSON_GetObjectItem(dark_skin, "text_color");
+            cJSON* background_color = cJSON_GetObjectItem(dark_skin, "background_color");
+            cJSON* background_image = cJSON_GetObjectItem(dark_skin, "background_image");
+            if (cJSON_IsString(text_color)) {
+                dark_theme->set_text_color(LvglTheme::ParseColor(text_color->valuestring));
+            }
+            if (cJSON_IsString(background_color)) {
+                dark_theme->set_background_color(LvglTheme::ParseColor(background_color->valuestring));
+                dark_theme->set_chat_background_color(LvglTheme::ParseColor(background_color->valuestring));
+            }
+            if (cJSON_IsString(background_image)) {
+                if (!GetAssetData(background_image->valuestring, ptr, size)) {
+                    ESP_LOGE(TAG, "The background image file %s is not found", background_image->valuestring);
+                    return false;
+                }
+                auto background_image = std::make_shared<LvglCBinImage>(ptr);
+                dark_theme->set_background_image(background_image);
+            }
+        }
+    }
+
+    auto display = Board::GetInstance().GetDisplay();
+    ESP_LOGI(TAG, "Refreshing display theme...");
+
+    auto current_theme = display->GetTheme();
+    if (current_theme != nullptr) {
+        display->SetTheme(current_theme);
+    }
+
+    // Parse hide_subtitle configuration
+    cJSON* hide_subtitle = cJSON_GetObjectItem(root, "hide_subtitle");
+    if (cJSON_IsBool(hide_subtitle)) {
+        bool hide = cJSON_IsTrue(hide_subtitle);
+        auto lcd_display = dynamic_cast<LcdDisplay*>(display);
+        if (lcd_display != nullptr) {
+            lcd_display->SetHideSubtitle(hide);
+            ESP_LOGI(TAG, "Set hide_subtitle to %s", hide ? "true" : "false");
+        }
+    }
+
+#elif defined(CONFIG_USE_EMOTE_MESSAGE_STYLE)
+    auto &board = Board::GetInstance();
+    auto display = board.GetDisplay();
+    auto emote_display = dynamic_cast<emote::EmoteDisplay*>(display);
+
+    cJSON* font = cJSON_GetObjectItem(root, "text_font");
+    if (cJSON_IsString(font)) {
+        std::string fonts_text_file = font->valuestring;
+        if (GetAssetData(fonts_text_file, ptr, size)) {
+            auto text_font = std::make_shared<LvglCBinFont>(ptr);
+            if (text_font->font() == nullptr) {
+                ESP_LOGE(TAG, "Failed to load fonts.bin");
+                return false;
+            }
+
+            if (emote_display) {
+                emote_display->AddTextFont(text_font);
+            }
+        } else {
+            ESP_LOGE(TAG, "The font file %s is not found", fonts_text_file.c_str());
+        }
+    }
+
+    cJSON* emoji_collection = cJSON_GetObjectItem(root, "emoji_collection");
+    if (cJSON_IsArray(emoji_collection)) {
+        int emoji_count = cJSON_GetArraySize(emoji_collection);
+        if (emote_display) {
+            for (int i = 0; i < emoji_count; i++) {
+                cJSON* icon = cJSON_GetArrayItem(emoji_collection, i);
+                if (cJSON_IsObject(icon)) {
+                    cJSON* name = cJSON_GetObjectItem(icon, "name");
+                    cJSON* file = cJSON_GetObjectItem(icon, "file");
+
+                    if (cJSON_IsString(name) && cJSON_IsString(file)) {
+                        if (GetAssetData(file->valuestring, ptr, size)) {
+                            cJSON* eaf = cJSON_GetObjectItem(icon, "eaf");
+                            bool lack_value = false;
+                            bool loop_value = false;
+                            int fps_value = 0;
+
+                            if (cJSON_IsObject(eaf)) {
+                                cJSON* lack = cJSON_GetObjectItem(eaf, "lack");
+                                cJSON* loop = cJSON_GetObjectItem(eaf, "loop");
+                                cJSON* fps = cJSON_GetObjectItem(eaf, "fps");
+
+                                lack_value = lack ? cJSON_IsTrue(lack) : false;
+                                loop_value = loop ? cJSON_IsTrue(loop) : false;
+                                fps_value = fps ? fps->valueint : 0;
+
+                                emote_display->AddEmojiData(name->valuestring, ptr, size,
+                                                          static_cast<uint8_t>(fps_value),
+                                                          loop_value, lack_value);
+                            }
+
+                        } else {
+                            ESP_LOGE(TAG, "Emoji \"%10s\" image file %s is not found", name->valuestring, file->valuestring);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    cJSON* icon_collection = cJSON_GetObjectItem(root, "icon_collection");
+    if (cJSON_IsArray(icon_collection)) {
+        if (emote_display) {
+            int icon_count = cJSON_GetArraySize(icon_collection);
+            for (int i = 0; i < icon_count; i++) {
+                cJSON* icon = cJSON_GetArrayItem(icon_collection, i);
+                if (cJSON_IsObject(icon)) {
+                    cJSON* name = cJSON_GetObjectItem(icon, "name");
+                    cJSON* file = cJSON_GetObjectItem(icon, "file");
+
+                    if (cJSON_IsString(name) && cJSON_IsString(file)) {
+                        if (GetAssetData(file->valuestring, ptr, size)) {
+                            emote_display->AddIconData(name->valuestring, ptr, size);
+                        } else {
+                            ESP_LOGE(TAG, "Icon \"%10s\" image file %s is not found", name->valuestring, file->valuestring);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    cJSON* layout_json = cJSON_GetObjectItem(root, "layout");
+    if (cJSON_IsArray(layout_json)) {
+        int layout_count = cJSON_GetArraySize(layout_json);
+
+        for (int i = 0; i < layout_count; i++) {
+            cJSON* layout_item = cJSON_GetArrayItem(layout_json, i);
+            if (cJSON_IsObject(layout_item)) {
+                cJSON* name = cJSON_GetObjectItem(layout_item, "name");
+                cJSON* align = cJSON_GetObjectItem(layout_item, "align");
+                cJSON* x = cJSON_GetObjectItem(layout_item, "x");
+                cJSON* y = cJSON_GetObjectItem(layout_item, "y");
+                cJSON* width = cJSON_GetObjectItem(layout_item, "width");
+                cJSON* height = cJSON_GetObjectItem(layout_item, "height");
+
+                if (cJSON_IsString(name) && cJSON_IsString(align) && cJSON_IsNumber(x) && cJSON_IsNumber(y)) {
+                    int width_val = cJSON_IsNumber(width) ? width->valueint : 0;
+                    int height_val = cJSON_IsNumber(height) ? height->valueint : 0;
+
+                    if (emote_display) {
+                        emote_display->AddLayoutData(name->valuestring, align->valuestring,
+                                                     x->valueint, y->valueint, width_val, height_val);
+                    }
+                } else {
+                    ESP_LOGW(TAG, "Invalid layout item %d: missing required fields", i);
+                }
+            }
+        }
+    }
+#endif
+
+    cJSON_Delete(root);
+    return true;
+}
@@ -0,0 +1,114 @@
+#include "audio_mixer.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "AudioMixer"
+
+#define MIXER_UNITY_GAIN (1 << 30)
+
+void AudioMixer::Configure(int sample_rate, int channels, int buffer_ms) {
+    sample_rate_ = sample_rate;
+    channels_ = std::max(channels, 1);
+    size_t capacity = (size_t)sample_rate_ * buffer_ms / 1000 * channels_;
+    for (auto& source : sources_) {
+        source.buffer.assign(capacity, 0);
+        source.head = 0;
+        source.size = 0;
+        source.gain = MIXER_UNITY_GAIN;
+        source.hold = 0;
+        source.held = false;
+    }
+    accumulator_.reserve(capacity);
+    SetDucking(0.25f, 80, 600, 400);
+}
+
+void AudioMixer::SetDucking(float duck_gain, int attack_ms, int release_ms, int hold_ms) {
+    duck_gain_ = (int32_t)(std::clamp(duck_gain, 0.0f, 1.0f) * MIXER_UNITY_GAIN);
+    int32_t range = MIXER_UNITY_GAIN - duck_gain_;
+    attack_step_ = std::max<int32_t>(range / std::max(sample_rate_ * attack_ms / 1000, 1), 1);
+    release_step_ = std::max<int32_t>(range / std::max(sample_rate_ * release_ms / 1000, 1), 1);
+    hold_samples_ = (size_t)sample_rate_ * hold_ms / 1000 * channels_;
+    ESP_LOGI(TAG, "Ducking to %d%%, attack %d ms, release %d ms, hold %d ms", (int)(duck_gain * 100),
+        attack_ms, release_ms, hold_ms);
+}
+
+bool AudioMixer::IsDucking(AudioMixerSource source) const {
+    for (int i = 0; i < source; i++) {
+        if (sources_[i].hold > 0 || sources_[i].held) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AudioMixer::SetHold(AudioMixerSource source, bool hold) {
+    sources_[source].held = hold;
+}
+
+size_t AudioMixer::Write(AudioMixerSource source, const int16_t* data, size_t samples) {
+    Source& s = sources_[source];
+    size_t capacity = s.buffer.size();
+    samples = std::min(samples, capacity - s.size);
+    size_t tail = (s.head + s.size) % capacity;
+    size_t first = std::min(samples, capacity - tail);
+    memcpy(&s.buffer[tail], data, first * sizeof(int16_t));
+    memcpy(&s.buffer[0], data + first, (samples - first) * sizeof(int16_t));
+    s.size += samples;
+    return samples;
+}
+
+void AudioMixer::Clear(AudioMixerSource source) {
+    sources_[source].head = 0;
+    sources_[source].size = 0;
+}
+
+void AudioMixer::MixSource(Source& source, int32_t target, int32_t* accumulator, size_t samples) {
+    size_t capacity = source.buffer.size();
+    size_t count = std::min(source.size, samples) / channels_ * channels_;
+    int32_t gain = source.gain;
+
+    for (size_t i = 0; i < count; i += channels_) {
+        if (gain > target) {
+            gain = std::max(gain - attack_step_, target);
+        } else if (gain < target) {
+            gain = std::min(gain + release_step_, target);
+        }
+        int32_t g = gain >> 15;
+        for (int c = 0; c < channels_; c++) {
+            accumulator[i + c] += (source.buffer[source.head] * g) >> 15;
+            if (++source.head == capacity) {
+                source.head = 0;
+            }
+        }
+    }
+    source.size -= count;
+
+    // Keep the ramp moving through the silent part of the block
+    int32_t frames = (samples - count) / channels_;
+    if (gain > target) {
+        gain = std::max<int32_t>(gain - std::min<int64_t>((int64_t)attack_step_ * frames, MIXER_UNITY_GAIN), target);
+    } else if (gain < target) {
+        gain = std::min<int32_t>(gain + std::min<int64_t>((int64_t)release_step_ * frames, MIXER_UNITY_GAIN), target);
+    }
+    source.gain = gain;
+
+    if (count > 0) {
+        source.hold = hold_samples_;
+    } else {
+        source.hold = source.hold > samples ? source.hold - samples : 0;
+    }
+}
+
+void AudioMixer::Mix(int16_t* output, size_t samples) {
+    accumulator_.assign(samples, 0);
+    bool ducked = false;
+    for (auto& source : sources_) {
+        MixSource(source, ducked ? duck_gain_ : MIXER_UNITY_GAIN, accumulator_.data(), samples);
+        ducked = ducked || source.hold > 0 || source.held;
+    }
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = (int16_t)std::clamp(accumulator_[i], (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Sources in priority order, an active source ducks every source after it
+enum AudioMixerSource {
+    kAudioMixerSourceVoice,     // Assistant speech and prompt sounds
+    kAudioMixerSourceMusic,
+    kAudioMixerSourceCount,
+};
+
+/*
+ * Mixes buffered PCM from several sources in the codec's rate and channel layout.
+ *
+ * Every source has its own FIFO. While a source has produced audio within the
+ * hold time, or is held, lower priority sources fade down to the duck gain over the attack
+ * time and fade back up over the release time once it stops. Gains move per
+ * sample, so there are no steps at block boundaries.
+ *
+ * Not thread safe, AudioService calls it under its queue mutex.
+ */
+class AudioMixer {
+public:
+    void Configure(int sample_rate, int channels, int buffer_ms);
+    void SetDucking(float duck_gain, int attack_ms, int release_ms, int hold_ms);
+
+    inline size_t Available(AudioMixerSource source) const { return sources_[source].size; }
+    inline size_t Space(AudioMixerSource source) const { return sources_[source].buffer.size() - sources_[source].size; }
+    bool IsDucking(AudioMixerSource source) const;
+    // While held, a source ducks lower priority sources even when it has nothing to play
+    void SetHold(AudioMixerSource source, bool hold);
+
+    // Returns the number of samples accepted
+    size_t Write(AudioMixerSource source, const int16_t* data, size_t samples);
+    void Clear(AudioMixerSource source);
+    // Fills output with the mix, sources that run short contribute silence
+    void Mix(int16_t* output, size_t samples);
+
+private:
+    struct Source {
+        std::vector<int16_t> buffer;
+        size_t head = 0;
+        size_t size = 0;
+        int32_t gain = 1 << 30;     // Q30
+        size_t hold = 0;            // Samples left before this source stops ducking others
+        bool held = false;
+    };
+
+    void MixSource(Source& source, int32_t target, int32_t* accumulator, size_t samples);
+
+    Source sources_[kAudioMixerSourceCount];
+    std::vector<int32_t> accumulator_;
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+    int32_t duck_gain_ = 1 << 28;   // Q30, -12 dB
+    int32_t attack_step_ = 0;       // Q30 gain change per sample
+    int32_t release_step_ = 0;
+    size_t hold_samples_ = 0;
+};
+
+#endif // AUDIO_MIXER_H
@@ -1,6 +1,8 @@
 #include "audio_service.h"
+#include "ogg_demuxer.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -78,6 +80,8 @@ void AudioService::Initialize(AudioCodec* codec) {
     opus_encoder_->SetComplexity(0);
 #endif
 
+    audio_mixer_.Configure(codec->output_sample_rate(), codec->output_channels(), AUDIO_MIXER_BUFFER_MS);
+
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -190,8 +194,12 @@ void AudioService::Stop() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     audio_encode_queue_.clear();
     audio_decode_queue_.clear();
+    audio_sound_queue_.clear();
     audio_playback_queue_.clear();
     audio_testing_queue_.clear();
+    audio_mixer_.Clear(kAudioMixerSourceVoice);
+    audio_mixer_.Clear(kAudioMixerSourceMusic);
+    music_clear_count_++;
     audio_queue_cv_.notify_all();
 }
 #ifdef CONFIG_USE_AUDIO_CODEC_ENCODE_OPUS
@@ -398,15 +406,34 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
+    std::vector<int16_t> pcm;
+    size_t music_frame = codec_->output_sample_rate() * AUDIO_MIXER_MUSIC_FRAME_MS / 1000 * codec_->output_channels();
     while (true) {
         std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
+        audio_queue_cv_.wait(lock, [this]() {
+            return !audio_playback_queue_.empty() || audio_mixer_.Available(kAudioMixerSourceMusic) > 0 ||
+                service_stopped_;
+        });
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
+        /* Speech sets the pace, music alone is played in short frames so it stays responsive to speech */
+        uint32_t timestamp = 0;
+        if (!audio_playback_queue_.empty()) {
+            auto task = std::move(audio_playback_queue_.front());
+            audio_playback_queue_.pop_front();
+            timestamp = task->timestamp;
+            size_t written = audio_mixer_.Write(kAudioMixerSourceVoice, task->pcm.data(), task->pcm.size());
+            if (written < task->pcm.size()) {
+                ESP_LOGW(TAG, "Playback frame too large for the mixer, dropping %u samples", task->pcm.size() - written);
+            }
+            pcm = std::move(task->pcm);
+            pcm.resize(written);
+        } else {
+            pcm.resize(std::min(audio_mixer_.Available(kAudioMixerSourceMusic), music_frame));
+        }
+        audio_mixer_.Mix(pcm.data(), pcm.size());
         audio_queue_cv_.notify_all();
         lock.unlock();
 
@@ -415,11 +442,12 @@ void AudioService::AudioOutputTask() {
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
         }
-        codec_->OutputData(task->pcm);
+        codec_->OutputData(pcm);
+        /* The mix is what reaches the speaker, so it is also the echo reference */
         auto uxNow = xEventGroupGetBits(event_group_);
         if(uxNow & AS_EVENT_AUDIO_PROCESSOR_RUNNING)
         {
-            audio_processor_->InputReferenceAudio(task->pcm);
+            audio_processor_->InputReferenceAudio(pcm);
         }
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
@@ -427,9 +455,9 @@ void AudioService::AudioOutputTask() {
 
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
+        if (timestamp > 0) {
             lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+            timestamp_queue_.push_back(timestamp);
         }
 #endif
     }
@@ -443,14 +471,66 @@ void AudioService::OpusCodecTask() {
         audio_queue_cv_.wait(lock, [this]() {
             return service_stopped_ ||
                 (!audio_encode_queue_.empty() && audio_send_queue_.size() < max_send_packets_size_) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
+                ((!audio_decode_queue_.empty() || !audio_sound_queue_.empty()) &&
+                    audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
         });
         if (service_stopped_) {
             break;
         }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
+        /* Cached prompt sounds skip the decoder but respect the same queue limit, one frame per task */
+        if (!audio_sound_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE &&
+            audio_sound_queue_.front().cached) {
+            auto& sound = audio_sound_queue_.front();
+            const auto& pcm = sound.cached->pcm;
+            size_t frame_samples = sound.cached->sample_rate * OPUS_FRAME_DURATION_MS / 1000;
+            size_t samples = std::min(frame_samples, pcm.size() - sound.cached_offset);
+            auto task = std::make_unique<AudioTask>();
+            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+            task->timestamp = 0;
+            task->pcm.assign(pcm.begin() + sound.cached_offset, pcm.begin() + sound.cached_offset + samples);
+            sound.cached_offset += samples;
+            if (sound.cached_offset >= pcm.size()) {
+                audio_sound_queue_.pop_front();
+            }
+            audio_playback_queue_.push_back(std::move(task));
+            audio_queue_cv_.notify_all();
+        } else if (!audio_sound_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
+            /* Decode prompt sounds first, collecting the PCM of the ones being cached */
+            auto sound = std::move(audio_sound_queue_.front());
+            audio_sound_queue_.pop_front();
+            audio_queue_cv_.notify_all();
+            lock.unlock();
+
+            auto task = std::make_unique<AudioTask>();
+            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+            task->timestamp = 0;
+            if (DecodePacket(sound_decoder_, sound_resampler_, *sound.packet, task->pcm)) {
+                if (sound.capture) {
+                    sound.capture->pcm.insert(sound.capture->pcm.end(), task->pcm.begin(), task->pcm.end());
+                    if (sound.last) {
+                        AddCachedSound(std::move(sound.capture));
+                    }
+                }
+                lock.lock();
+                audio_playback_queue_.push_back(std::move(task));
+                audio_queue_cv_.notify_all();
+            } else {
+                ESP_LOGE(TAG, "Failed to decode sound packet");
+                // Never cache a sound with a missing frame
+                lock.lock();
+                for (auto& pending : audio_sound_queue_) {
+                    if (pending.capture == sound.capture) {
+                        pending.capture.reset();
+                    }
+                }
+            }
+            debug_statistics_.decode_count++;
+        }
+
+        /* Decode the audio from decode queue, after any prompt sound so the two do not interleave */
+        if (!audio_decode_queue_.empty() && audio_sound_queue_.empty() &&
+            audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
             auto packet = std::move(audio_decode_queue_.front());
             audio_decode_queue_.pop_front();
             audio_queue_cv_.notify_all();
@@ -460,17 +540,8 @@ void AudioService::OpusCodecTask() {
             task->type = kAudioTaskTypeDecodeToPlaybackQueue;
             task->timestamp = packet->timestamp;
 
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
             int payload_size = packet->payload.size();
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
-
+            if (DecodePacket(opus_decoder_, output_resampler_, *packet, task->pcm)) {
                 lock.lock();
                 audio_playback_queue_.push_back(std::move(task));
                 audio_queue_cv_.notify_all();
@@ -521,18 +592,35 @@ void AudioService::OpusCodecTask() {
     ESP_LOGW(TAG, "Opus codec task stopped");
 }
 
-void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
-    if (opus_decoder_->sample_rate() == sample_rate && opus_decoder_->duration_ms() == frame_duration) {
+bool AudioService::DecodePacket(std::unique_ptr<OpusDecoderWrapper>& decoder, OpusResampler& resampler,
+    AudioStreamPacket& packet, std::vector<int16_t>& pcm) {
+    SetDecodeSampleRate(decoder, resampler, packet.sample_rate, packet.frame_duration);
+    if (!decoder->Decode(std::move(packet.payload), pcm)) {
+        return false;
+    }
+    // Resample if the sample rate is different
+    if (decoder->sample_rate() != codec_->output_sample_rate()) {
+        int target_size = resampler.GetOutputSamples(pcm.size());
+        std::vector<int16_t> resampled(target_size);
+        resampler.Process(pcm.data(), pcm.size(), resampled.data());
+        pcm = std::move(resampled);
+    }
+    return true;
+}
+
+void AudioService::SetDecodeSampleRate(std::unique_ptr<OpusDecoderWrapper>& decoder, OpusResampler& resampler,
+    int sample_rate, int frame_duration) {
+    if (decoder && decoder->sample_rate() == sample_rate && decoder->duration_ms() == frame_duration) {
         return;
     }
 
-    opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    decoder.reset();
+    decoder = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
 
     auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+    if (decoder->sample_rate() != codec->output_sample_rate()) {
+        ESP_LOGI(TAG, "Resampling audio from %d to %d", decoder->sample_rate(), codec->output_sample_rate());
+        resampler.Configure(decoder->sample_rate(), codec->output_sample_rate());
     }
 }
 
@@ -692,108 +780,117 @@ void AudioService::PlaySound(const std::string_view& ogg) {
         codec_->EnableOutput(true);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
+    if (PlayCachedSound(ogg)) {
+        return;
+    }
 
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+    std::shared_ptr<CachedSound> capture;
+    if (CONFIG_AUDIO_SOUND_CACHE_SIZE_KB > 0) {
+        capture = std::make_shared<CachedSound>();
+        capture->key = ogg.data();
+        capture->ogg_size = ogg.size();
+        capture->sample_rate = codec_->output_sample_rate();
+    }
+
+    OggDemuxer demuxer;
+    std::deque<SoundPacket> packets;
+    demuxer.OnPacket([&](const uint8_t* data, size_t size) {
+        SoundPacket sound;
+        sound.packet = std::make_unique<AudioStreamPacket>();
+        sound.packet->sample_rate = demuxer.sample_rate();
+        sound.packet->frame_duration = 60;
+        sound.packet->payload.assign(data, data + size);
+        sound.capture = capture;
+        packets.push_back(std::move(sound));
+    });
+    demuxer.Process(reinterpret_cast<const uint8_t*>(ogg.data()), ogg.size());
+    if (demuxer.crc_errors() > 0 || demuxer.lost_pages() > 0) {
+        ESP_LOGW(TAG, "Sound has %lu corrupted and %lu lost pages, not caching it",
+            demuxer.crc_errors(), demuxer.lost_pages());
+        for (auto& sound : packets) {
+            sound.capture.reset();
         }
-        return static_cast<size_t>(-1);
-    };
+    }
+    if (packets.empty()) {
+        return;
+    }
+    packets.back().last = true;
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
+    // Prompt sounds are short, queue them whole instead of blocking the caller until they drain
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    for (auto& sound : packets) {
+        audio_sound_queue_.push_back(std::move(sound));
+    }
+    audio_queue_cv_.notify_all();
+}
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
+bool AudioService::PlayCachedSound(const std::string_view& ogg) {
+    std::shared_ptr<CachedSound> sound;
+    {
+        std::lock_guard<std::mutex> lock(sound_cache_mutex_);
+        for (auto it = sound_cache_.begin(); it != sound_cache_.end(); ++it) {
+            if ((*it)->key == ogg.data() && (*it)->ogg_size == ogg.size()) {
+                sound = *it;
+                sound_cache_.splice(sound_cache_.begin(), sound_cache_, it);
+                break;
             }
-
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
         }
+    }
+    if (!sound || sound->sample_rate != codec_->output_sample_rate()) {
+        return false;
+    }
+
+    // The codec task moves it to the playback queue without decoding, in order with other sounds
+    SoundPacket packet;
+    packet.cached = std::move(sound);
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    audio_sound_queue_.push_back(std::move(packet));
+    audio_queue_cv_.notify_all();
+    return true;
+}
+
+void AudioService::AddCachedSound(std::shared_ptr<CachedSound> sound) {
+    const size_t budget = CONFIG_AUDIO_SOUND_CACHE_SIZE_KB * 1024;
+    size_t bytes = sound->pcm.size() * sizeof(int16_t);
+    if (bytes == 0 || bytes > budget) {
+        return;
+    }
+    sound->pcm.shrink_to_fit();
 
-        offset = body_off + body_size;
+    std::lock_guard<std::mutex> lock(sound_cache_mutex_);
+    for (auto it = sound_cache_.begin(); it != sound_cache_.end(); ++it) {
+        if ((*it)->key == sound->key && (*it)->ogg_size == sound->ogg_size) {
+            // Replace an entry decoded for another output rate
+            sound_cache_bytes_ -= (*it)->pcm.size() * sizeof(int16_t);
+            sound_cache_.erase(it);
+            break;
+        }
+    }
+    sound_cache_.push_front(sound);
+    sound_cache_bytes_ += bytes;
+    while (sound_cache_bytes_ > budget) {
+        sound_cache_bytes_ -= sound_cache_.back()->pcm.size() * sizeof(int16_t);
+        sound_cache_.pop_back();
     }
+    ESP_LOGI(TAG, "Cached sound of %u bytes, %u sounds use %u/%u bytes",
+        bytes, sound_cache_.size(), sound_cache_bytes_, budget);
 }
 
 bool AudioService::IsIdle() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_sound_queue_.empty() &&
+        audio_playback_queue_.empty() && audio_testing_queue_.empty();
 }
 
 void AudioService::ResetDecoder() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     opus_decoder_->ResetState();
+    if (sound_decoder_) {
+        sound_decoder_->ResetState();
+    }
     timestamp_queue_.clear();
     audio_decode_queue_.clear();
+    audio_sound_queue_.clear();
     audio_playback_queue_.clear();
     audio_testing_queue_.clear();
     audio_queue_cv_.notify_all();
@@ -846,6 +943,38 @@ void AudioService::UpdateLastOutputTime(){
     last_output_time_ =  std::chrono::steady_clock::now();
 }
 
+bool AudioService::WriteMusicData(const int16_t* data, size_t samples) {
+    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    uint32_t clear_count = music_clear_count_;
+    while (samples > 0) {
+        audio_queue_cv_.wait(lock, [this, clear_count]() {
+            return service_stopped_ || music_clear_count_ != clear_count ||
+                   audio_mixer_.Space(kAudioMixerSourceMusic) > 0;
+        });
+        // A clear means the player was stopped, so drop the rest instead of writing it
+        if (service_stopped_ || music_clear_count_ != clear_count) {
+            return false;
+        }
+        size_t written = audio_mixer_.Write(kAudioMixerSourceMusic, data, samples);
+        data += written;
+        samples -= written;
+        audio_queue_cv_.notify_all();
+    }
+    return true;
+}
+
+void AudioService::ClearMusicData() {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    audio_mixer_.Clear(kAudioMixerSourceMusic);
+    music_clear_count_++;
+    audio_queue_cv_.notify_all();
+}
+
+void AudioService::DuckMusic(bool duck) {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    audio_mixer_.SetHold(kAudioMixerSourceVoice, duck);
+}
+
 bool AudioService::IsAfeWakeWord() {
 #if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
     return wake_word_ != nullptr && dynamic_cast<AfeWakeWord*>(wake_word_.get()) != nullptr;
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <deque>
+#include <list>
 #include <condition_variable>
 #include <chrono>
 #include <mutex>
@@ -18,6 +19,7 @@
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "audio_mixer.h"
 #include "audio_processor.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
@@ -26,7 +28,8 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> [Mixer] -> (Speaker)
+ *                                                             (Music) -> ^
  *
  * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
  * 
@@ -43,6 +46,8 @@
 // #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 // #define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+#define AUDIO_MIXER_BUFFER_MS 240
+#define AUDIO_MIXER_MUSIC_FRAME_MS 20
 #define MAX_TIMESTAMPS_IN_QUEUE 3
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
@@ -74,6 +79,22 @@ struct AudioTask {
     uint32_t timestamp;
 };
 
+// Decoded PCM of a prompt sound, keyed by the address of its embedded Ogg data
+struct CachedSound {
+    const char* key = nullptr;
+    size_t ogg_size = 0;
+    int sample_rate = 0;
+    std::vector<int16_t> pcm;
+};
+
+struct SoundPacket {
+    std::unique_ptr<AudioStreamPacket> packet;
+    std::shared_ptr<CachedSound> capture;   // Collects the decoded PCM, nullptr if not cached
+    bool last = false;
+    std::shared_ptr<const CachedSound> cached;  // Played from the cache instead of packet
+    size_t cached_offset = 0;                   // Next sample of cached to queue
+};
+
 struct DebugStatistics {
     uint32_t input_count = 0;
     uint32_t decode_count = 0;
@@ -111,6 +132,12 @@ public:
     void PlaySound(const std::string_view& sound);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void UpdateLastOutputTime();
+    // Queues music PCM in the codec's layout, blocks while the music buffer is full.
+    // Returns false if the service stops or ClearMusicData is called while waiting.
+    bool WriteMusicData(const int16_t* data, size_t samples);
+    void ClearMusicData();
+    // Keeps music ducked as if speech were playing, e.g. while the user talks after the wake word
+    void DuckMusic(bool duck);
 #ifdef CONFIG_USE_AUDIO_CODEC_ENCODE_OPUS
     bool ReadAudioData(std::vector<uint8_t>& data, int sample_rate, int samples);
     void OnAudioInputDecodeForWakeWord();
@@ -129,12 +156,15 @@ private:
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    // Prompt sounds have their own decoder so they neither reset nor share state with the speech stream
+    std::unique_ptr<OpusDecoderWrapper> sound_decoder_;
 #ifdef CONFIG_USE_AUDIO_CODEC_ENCODE_OPUS
     std::unique_ptr<OpusDecoderWrapper> opus_decoder2_;
 #endif
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
+    OpusResampler sound_resampler_;
     DebugStatistics debug_statistics_;
     srmodel_list_t* models_list_ = nullptr;
 
@@ -152,12 +182,20 @@ private:
     std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
     std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
     std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    std::deque<SoundPacket> audio_sound_queue_;
+    AudioMixer audio_mixer_;
+    uint32_t music_clear_count_ = 0;
     std::mutex wake_audio_queue_mutex_;
     std::condition_variable wake_audio_queue_cv_;
     std::deque<std::vector<uint8_t>> wake_word_opus_queue_;
     std::vector<uint16_t> wake_pcm_buffer_;
     std::mutex wake_wake_pcm_buffer_mutex_;
 
+    // Prompt sounds decoded once and replayed from PCM, most recently used first
+    std::mutex sound_cache_mutex_;
+    std::list<std::shared_ptr<CachedSound>> sound_cache_;
+    size_t sound_cache_bytes_ = 0;
+
     // For server AEC
     std::deque<uint32_t> timestamp_queue_;
 
@@ -178,7 +216,12 @@ private:
     void WakeOpusCodecTask();
 #endif
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
-    void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    void SetDecodeSampleRate(std::unique_ptr<OpusDecoderWrapper>& decoder, OpusResampler& resampler,
+        int sample_rate, int frame_duration);
+    bool DecodePacket(std::unique_ptr<OpusDecoderWrapper>& decoder, OpusResampler& resampler,
+        AudioStreamPacket& packet, std::vector<int16_t>& pcm);
+    bool PlayCachedSound(const std::string_view& ogg);
+    void AddCachedSound(std::shared_ptr<CachedSound> sound);
     void CheckAndUpdateAudioPowerState();
 
     int opus_frame_duration_ = 60;
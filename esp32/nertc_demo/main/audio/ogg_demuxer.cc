@@ -0,0 +1,197 @@
+#include "ogg_demuxer.h"
+
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "OggDemuxer"
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_FLAG_CONTINUED 0x01
+#define OGG_FLAG_EOS 0x04
+
+static uint32_t ogg_crc_table[256];
+
+// Ogg uses the non-reflected CRC-32 with polynomial 0x04c11db7 and zero init
+static void InitCrcTable() {
+    if (ogg_crc_table[1] != 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+        ogg_crc_table[i] = crc;
+    }
+}
+
+static uint32_t PageCrc(const uint8_t* page, size_t size) {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        // The checksum field itself is computed as zero
+        uint8_t byte = (i >= 22 && i < 26) ? 0 : page[i];
+        crc = (crc << 8) ^ ogg_crc_table[((crc >> 24) ^ byte) & 0xff];
+    }
+    return crc;
+}
+
+static inline uint32_t ReadLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+OggDemuxer::OggDemuxer() {
+    InitCrcTable();
+}
+
+void OggDemuxer::OnPacket(std::function<void(const uint8_t* data, size_t size)> callback) {
+    on_packet_ = callback;
+}
+
+void OggDemuxer::Reset() {
+    buffer_.clear();
+    packet_.clear();
+    seen_head_ = false;
+    seen_tags_ = false;
+    has_sequence_ = false;
+    sample_rate_ = 16000;
+    channels_ = 1;
+    pre_skip_ = 0;
+    granule_position_ = -1;
+    end_of_stream_ = false;
+    crc_errors_ = 0;
+    lost_pages_ = 0;
+}
+
+void OggDemuxer::Process(const uint8_t* data, size_t size) {
+    if (buffer_.empty()) {
+        size_t used = ParsePages(data, size);
+        buffer_.assign(data + used, data + size);
+        return;
+    }
+
+    buffer_.insert(buffer_.end(), data, data + size);
+    size_t used = ParsePages(buffer_.data(), buffer_.size());
+    buffer_.erase(buffer_.begin(), buffer_.begin() + used);
+}
+
+size_t OggDemuxer::ParsePages(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (true) {
+        // Sync on the capture pattern, keeping a possible partial one at the end
+        while (offset + 4 <= size && memcmp(data + offset, "OggS", 4) != 0) {
+            offset++;
+        }
+        if (offset + OGG_PAGE_HEADER_SIZE > size) {
+            return offset;
+        }
+
+        const uint8_t* page = data + offset;
+        size_t header_size = OGG_PAGE_HEADER_SIZE + page[26];
+        if (offset + header_size > size) {
+            return offset;
+        }
+        size_t body_size = 0;
+        for (size_t i = OGG_PAGE_HEADER_SIZE; i < header_size; i++) {
+            body_size += page[i];
+        }
+        if (offset + header_size + body_size > size) {
+            return offset;
+        }
+
+        if (page[4] != 0 || PageCrc(page, header_size + body_size) != ReadLe32(page + 22)) {
+            // Not a real page, or a corrupted one: resync after this capture pattern
+            crc_errors_++;
+            packet_.clear();
+            offset++;
+            continue;
+        }
+
+        ParsePage(page, header_size);
+        offset += header_size + body_size;
+    }
+}
+
+void OggDemuxer::ParsePage(const uint8_t* page, size_t header_size) {
+    uint32_t sequence = ReadLe32(page + 18);
+    bool lost = has_sequence_ && sequence != sequence_ + 1;
+    has_sequence_ = true;
+    sequence_ = sequence;
+    if (lost) {
+        lost_pages_++;
+        packet_.clear();
+    }
+    granule_position_ = (int64_t)(ReadLe32(page + 6) | ((uint64_t)ReadLe32(page + 10) << 32));
+    end_of_stream_ = page[5] & OGG_FLAG_EOS;
+
+    const uint8_t* lacing = page + OGG_PAGE_HEADER_SIZE;
+    size_t segments = header_size - OGG_PAGE_HEADER_SIZE;
+    const uint8_t* body = page + header_size;
+    size_t seg = 0;
+
+    // A continued packet whose start we never saw is dropped
+    bool skip = (page[5] & OGG_FLAG_CONTINUED) && packet_.empty();
+    if (!(page[5] & OGG_FLAG_CONTINUED)) {
+        packet_.clear();
+    }
+
+    while (seg < segments) {
+        const uint8_t* start = body;
+        size_t length = 0;
+        bool complete = false;
+        while (seg < segments) {
+            uint8_t value = lacing[seg++];
+            length += value;
+            if (value < 255) {
+                complete = true;
+                break;
+            }
+        }
+        body += length;
+
+        if (skip) {
+            skip = !complete;
+            continue;
+        }
+        if (!complete) {
+            packet_.insert(packet_.end(), start, start + length);
+            break;
+        }
+        if (packet_.empty()) {
+            EmitPacket(start, length);
+        } else {
+            packet_.insert(packet_.end(), start, start + length);
+            EmitPacket(packet_.data(), packet_.size());
+            packet_.clear();
+        }
+    }
+}
+
+void OggDemuxer::EmitPacket(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    if (!seen_head_) {
+        // OpusHead: magic[8], version, channels, pre_skip[2], input_sample_rate[4], gain[2], mapping
+        if (size >= 19 && memcmp(data, "OpusHead", 8) == 0) {
+            seen_head_ = true;
+            channels_ = data[9];
+            pre_skip_ = data[10] | (data[11] << 8);
+            sample_rate_ = ReadLe32(data + 12);
+            ESP_LOGD(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", data[8], channels_, sample_rate_);
+        }
+        return;
+    }
+    if (!seen_tags_) {
+        if (size >= 8 && memcmp(data, "OpusTags", 8) == 0) {
+            seen_tags_ = true;
+            return;
+        }
+        // Tolerate streams without a tags packet
+        seen_tags_ = true;
+    }
+
+    if (on_packet_) {
+        on_packet_(data, size);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef OGG_DEMUXER_H
+#define OGG_DEMUXER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+/*
+ * Incremental Ogg/Opus demuxer.
+ *
+ * Bytes can be fed in chunks of any size. Each page is checked against its CRC
+ * and sequence number, packets spanning pages are reassembled, and the OpusHead
+ * and OpusTags headers are consumed so only audio packets reach the callback.
+ * The granule position and EOS flag of the page a packet ends on are exposed
+ * for the callback, so that decoders can apply the end trimming of RFC 7845.
+ * Complete pages found in the input are parsed in place without copying.
+ */
+class OggDemuxer {
+public:
+    OggDemuxer();
+
+    void OnPacket(std::function<void(const uint8_t* data, size_t size)> callback);
+    void Process(const uint8_t* data, size_t size);
+    void Reset();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int channels() const { return channels_; }
+    inline int pre_skip() const { return pre_skip_; }
+    inline bool has_head() const { return seen_head_; }
+    // Granule position of the page the current packet ends on, valid inside the callback
+    inline int64_t granule_position() const { return granule_position_; }
+    inline bool end_of_stream() const { return end_of_stream_; }
+    inline uint32_t crc_errors() const { return crc_errors_; }
+    inline uint32_t lost_pages() const { return lost_pages_; }
+
+private:
+    size_t ParsePages(const uint8_t* data, size_t size);
+    void ParsePage(const uint8_t* page, size_t header_size);
+    void EmitPacket(const uint8_t* data, size_t size);
+
+    std::function<void(const uint8_t* data, size_t size)> on_packet_;
+    std::vector<uint8_t> buffer_;   // Partial page carried over to the next Process()
+    std::vector<uint8_t> packet_;   // Packet continued on the next page
+    bool seen_head_ = false;
+    bool seen_tags_ = false;
+    bool has_sequence_ = false;
+    uint32_t sequence_ = 0;
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+    int pre_skip_ = 0;
+    int64_t granule_position_ = -1;
+    bool end_of_stream_ = false;
+    uint32_t crc_errors_ = 0;
+    uint32_t lost_pages_ = 0;
+};
+
+#endif // OGG_DEMUXER_H
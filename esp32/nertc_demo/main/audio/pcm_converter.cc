@@ -0,0 +1,62 @@
+#include "pcm_converter.h"
+
+#include <algorithm>
+
+void PcmConverter::Configure(int input_sample_rate, int input_channels, int output_sample_rate, int output_channels,
+    ResamplerQuality quality) {
+    input_channels_ = std::max(input_channels, 1);
+    output_channels_ = std::max(output_channels, 1);
+    int channels = input_channels_ == output_channels_ ? input_channels_ : 1;
+    resampler_.Configure(input_sample_rate, output_sample_rate, channels, quality);
+}
+
+bool PcmConverter::IsConfigured(int input_sample_rate, int input_channels, int output_sample_rate,
+    int output_channels) const {
+    return resampler_.input_sample_rate() == input_sample_rate && input_channels_ == input_channels &&
+        resampler_.output_sample_rate() == output_sample_rate && output_channels_ == output_channels;
+}
+
+void PcmConverter::Reset() {
+    resampler_.Reset();
+}
+
+std::vector<int16_t>& PcmConverter::Convert(const int16_t* input, int input_samples) {
+    int frames = input_samples / input_channels_;
+    const int16_t* source = input;
+    int source_samples = frames * input_channels_;
+
+    if (input_channels_ != output_channels_ && input_channels_ > 1) {
+        scratch_.resize(frames);
+        if (input_channels_ == 2) {
+            for (int i = 0; i < frames; i++) {
+                scratch_[i] = (int16_t)(((int32_t)input[i * 2] + input[i * 2 + 1]) >> 1);
+            }
+        } else {
+            for (int i = 0; i < frames; i++) {
+                int32_t sum = 0;
+                for (int c = 0; c < input_channels_; c++) {
+                    sum += input[i * input_channels_ + c];
+                }
+                scratch_[i] = (int16_t)(sum / input_channels_);
+            }
+        }
+        source = scratch_.data();
+        source_samples = frames;
+    }
+
+    int expand = input_channels_ == output_channels_ ? 1 : output_channels_;
+    output_.resize(resampler_.GetOutputSamples(source_samples) * expand);
+    int samples = resampler_.Process(source, source_samples, output_.data());
+
+    // Mono to N channels, backwards so every frame is read before it is overwritten
+    if (expand > 1) {
+        for (int i = samples - 1; i >= 0; i--) {
+            int16_t sample = output_[i];
+            for (int c = 0; c < expand; c++) {
+                output_[i * expand + c] = sample;
+            }
+        }
+    }
+    output_.resize(samples * expand);
+    return output_;
+}
@@ -0,0 +1,36 @@
+#ifndef PCM_CONVERTER_H
+#define PCM_CONVERTER_H
+
+#include "polyphase_resampler.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Converts interleaved 16-bit PCM from one rate and channel layout to another.
+ *
+ * Matching layouts are resampled with all channels kept, so stereo music stays
+ * stereo on a stereo codec. Extra input channels are averaged before the
+ * resampler and mono is duplicated in place after it, so the filter always
+ * runs on the smaller layout. The scratch and output buffers are kept between
+ * calls and only grow, so steady-state conversion does not allocate.
+ */
+class PcmConverter {
+public:
+    void Configure(int input_sample_rate, int input_channels, int output_sample_rate, int output_channels,
+        ResamplerQuality quality = ResamplerQuality::kMedium);
+    bool IsConfigured(int input_sample_rate, int input_channels, int output_sample_rate, int output_channels) const;
+    void Reset();
+
+    // Returns the converted samples, valid until the next call
+    std::vector<int16_t>& Convert(const int16_t* input, int input_samples);
+
+private:
+    PolyphaseResampler resampler_;
+    int input_channels_ = 1;
+    int output_channels_ = 1;
+    std::vector<int16_t> scratch_;  // Downmixed input
+    std::vector<int16_t> output_;
+};
+
+#endif // PCM_CONVERTER_H
@@ -0,0 +1,173 @@
+#include "polyphase_resampler.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#define TAG "PolyphaseResampler"
+
+// Zeroth order modified Bessel function, used by the Kaiser window
+static double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x / 2.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+void PolyphaseResampler::Configure(int input_sample_rate, int output_sample_rate, int channels,
+    ResamplerQuality quality) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    channels_ = std::max(channels, 1);
+    quality_ = quality;
+
+    if (input_sample_rate <= 0 || output_sample_rate <= 0) {
+        ESP_LOGE(TAG, "Invalid sample rate %d -> %d", input_sample_rate, output_sample_rate);
+        input_sample_rate_ = output_sample_rate_ = 0;
+    }
+    int gcd = std::gcd(input_sample_rate_, output_sample_rate_);
+    up_ = gcd > 0 ? output_sample_rate_ / gcd : 1;
+    down_ = gcd > 0 ? input_sample_rate_ / gcd : 1;
+    step_frames_ = down_ / up_;
+    step_phase_ = down_ % up_;
+
+    if (up_ == down_) {
+        taps_ = 1;
+        coefficients_.clear();
+    } else {
+        switch (quality_) {
+        case ResamplerQuality::kLow: taps_ = 8; break;
+        case ResamplerQuality::kHigh: taps_ = 32; break;
+        default: taps_ = 16; break;
+        }
+        // Decimating lowers the cutoff by M/L, so each phase must span that many more input
+        // frames to keep the transition band as narrow, relative to the output rate
+        if (down_ > up_) {
+            taps_ *= (down_ + up_ - 1) / up_;
+        }
+        BuildFilter();
+    }
+    Reset();
+    ESP_LOGI(TAG, "Resampling %d -> %d Hz, %d channels, %d/%d x %d taps", input_sample_rate_,
+        output_sample_rate_, channels_, up_, down_, taps_);
+}
+
+void PolyphaseResampler::BuildFilter() {
+    double rolloff;
+    double beta;
+    switch (quality_) {
+    case ResamplerQuality::kLow: rolloff = 0.80; beta = 5.0; break;
+    case ResamplerQuality::kHigh: rolloff = 0.94; beta = 9.0; break;
+    default: rolloff = 0.90; beta = 7.0; break;
+    }
+
+    // Prototype runs at the upsampled rate, cut off below the lower Nyquist of the two rates
+    int length = up_ * taps_;
+    double cutoff = 0.5 / std::max(up_, down_) * rolloff;
+    double center = (length - 1) / 2.0;
+    double window_scale = 1.0 / BesselI0(beta);
+    std::vector<double> prototype(length);
+    for (int n = 0; n < length; n++) {
+        double x = n - center;
+        double sinc = x == 0 ? 1.0 : std::sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+        double r = x / (center + 0.5);
+        double window = BesselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) * window_scale;
+        prototype[n] = sinc * window;
+    }
+
+    // Phase p uses prototype taps p, p + L, ... stored in reverse so they line up with the input
+    coefficients_.assign(length, 0);
+    std::vector<double> taps(taps_);
+    for (int p = 0; p < up_; p++) {
+        double sum = 0;
+        for (int t = 0; t < taps_; t++) {
+            taps[t] = prototype[p + (taps_ - 1 - t) * up_];
+            sum += taps[t];
+        }
+        // Unity DC gain on every phase, rounding error goes to the largest tap
+        int16_t* phase = &coefficients_[p * taps_];
+        int total = 0;
+        int largest = 0;
+        for (int t = 0; t < taps_; t++) {
+            long q = std::lround(taps[t] / sum * 32768.0);
+            phase[t] = (int16_t)std::clamp(q, -32768L, 32767L);
+            total += phase[t];
+            if (std::abs(phase[t]) > std::abs(phase[largest])) {
+                largest = t;
+            }
+        }
+        phase[largest] = (int16_t)std::clamp(phase[largest] + 32768 - total, -32768, 32767);
+    }
+}
+
+void PolyphaseResampler::Reset() {
+    buffer_.assign((taps_ - 1) * channels_, 0);
+    index_ = 0;
+    phase_ = 0;
+}
+
+int PolyphaseResampler::GetOutputSamples(int input_samples) const {
+    int frames = input_samples / channels_;
+    if (up_ == down_) {
+        return frames * channels_;
+    }
+    // Outputs k = 0, 1, ... while their window starts inside this block
+    int64_t span = (int64_t)frames * up_ - ((int64_t)index_ * up_ + phase_);
+    if (span <= 0) {
+        return 0;
+    }
+    return (int)((span + down_ - 1) / down_) * channels_;
+}
+
+int PolyphaseResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    int frames = input_samples / channels_;
+    if (frames <= 0) {
+        return 0;
+    }
+    if (up_ == down_) {
+        memcpy(output, input, frames * channels_ * sizeof(int16_t));
+        return frames * channels_;
+    }
+
+    int history = (taps_ - 1) * channels_;
+    buffer_.resize(history + frames * channels_);
+    memcpy(buffer_.data() + history, input, frames * channels_ * sizeof(int16_t));
+
+    const int16_t* src = buffer_.data();
+    int16_t* dst = output;
+    int index = index_;
+    int phase = phase_;
+    while (index < frames) {
+        const int16_t* taps = &coefficients_[phase * taps_];
+        const int16_t* window = src + index * channels_;
+        for (int c = 0; c < channels_; c++) {
+            int32_t acc = 1 << 14;
+            const int16_t* s = window + c;
+            for (int t = 0; t < taps_; t++) {
+                acc += (int32_t)taps[t] * s[t * channels_];
+            }
+            *dst++ = (int16_t)std::clamp(acc >> 15, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+        }
+        index += step_frames_;
+        phase += step_phase_;
+        if (phase >= up_) {
+            phase -= up_;
+            index++;
+        }
+    }
+
+    // Keep the last taps_ - 1 frames as history for the next block
+    memmove(buffer_.data(), buffer_.data() + frames * channels_, history * sizeof(int16_t));
+    index_ = index - frames;
+    phase_ = phase;
+    return dst - output;
+}
@@ -0,0 +1,61 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <cstdint>
+#include <vector>
+
+// Taps per phase when upsampling, multiplied by ceil(M/L) when decimating
+enum class ResamplerQuality {
+    kLow,       // 8 taps per phase
+    kMedium,    // 16 taps per phase
+    kHigh,      // 32 taps per phase
+};
+
+/*
+ * Streaming fixed-point polyphase resampler for interleaved 16-bit PCM.
+ *
+ * The rate ratio is reduced to L/M and a Kaiser windowed-sinc prototype is
+ * split into L phases of Q15 taps when Configure() is called. The filter
+ * history and the fractional read position are kept between Process() calls,
+ * so a stream can be fed in blocks of any size without clicks at the block
+ * boundaries. Configure/GetOutputSamples/Process follow OpusResampler, so
+ * existing call sites can switch to it without changes.
+ */
+class PolyphaseResampler {
+public:
+    void Configure(int input_sample_rate, int output_sample_rate, int channels = 1,
+        ResamplerQuality quality = ResamplerQuality::kMedium);
+    // Clears the history so the next block starts a new stream
+    void Reset();
+
+    // Exact number of samples the next Process() with input_samples will write
+    int GetOutputSamples(int input_samples) const;
+    // Returns the number of samples written to output
+    int Process(const int16_t* input, int input_samples, int16_t* output);
+
+    inline int input_sample_rate() const { return input_sample_rate_; }
+    inline int output_sample_rate() const { return output_sample_rate_; }
+    inline int channels() const { return channels_; }
+    inline ResamplerQuality quality() const { return quality_; }
+
+private:
+    void BuildFilter();
+
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int channels_ = 1;
+    ResamplerQuality quality_ = ResamplerQuality::kMedium;
+
+    int up_ = 1;            // L, number of phases
+    int down_ = 1;          // M, input step per output in 1/L frames
+    int taps_ = 1;          // Taps per phase
+    int step_frames_ = 0;   // down_ / up_
+    int step_phase_ = 0;    // down_ % up_
+
+    std::vector<int16_t> coefficients_;   // up_ phases of taps_ Q15 taps
+    std::vector<int16_t> buffer_;         // History followed by the current block
+    int index_ = 0;         // First frame of the next output window in buffer_
+    int phase_ = 0;
+};
+
+#endif // POLYPHASE_RESAMPLER_H
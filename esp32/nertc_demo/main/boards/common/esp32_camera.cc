@@ -19,6 +19,7 @@
 #include "esp_jpeg_common.h"
 #include "jpg/image_to_jpeg.h"
 #include "jpg/jpeg_to_image.h"
+#include "jpg/pixel_convert.h"
 #include "lvgl_display.h"
 #include "mcp_server.h"
 #include "system_info.h"
@@ -437,14 +438,7 @@ bool Esp32Camera::Capture() {
                 case V4L2_PIX_FMT_JPEG:
 #endif  // CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                {
-                    auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                    auto dst16 = (uint16_t*)frame_.data;
-                    size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                    for (size_t i = 0; i < count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
-                }
+                    pixel_swap16(mmap_buffers_[buf.index].start, frame_.data, mmap_buffers_[buf.index].length / 2);
 #else
                     memcpy(frame_.data, mmap_buffers_[buf.index].start,
                            MIN(mmap_buffers_[buf.index].length, frame_.len));
@@ -455,14 +449,7 @@ bool Esp32Camera::Capture() {
                     // 这个格式是 422 YUYV，不是 planer
                     frame_.format = V4L2_PIX_FMT_YUYV;
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
-                    {
-                        auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                        auto dst16 = (uint16_t*)frame_.data;
-                        size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                        for (size_t i = 0; i < count; i++) {
-                            dst16[i] = __builtin_bswap16(src16[i]);
-                        }
-                    }
+                    pixel_swap16(mmap_buffers_[buf.index].start, frame_.data, mmap_buffers_[buf.index].length / 2);
 #else
                     memcpy(frame_.data, mmap_buffers_[buf.index].start,
                            MIN(mmap_buffers_[buf.index].length, frame_.len));
@@ -472,12 +459,7 @@ bool Esp32Camera::Capture() {
                 case V4L2_PIX_FMT_RGB565X: {
                     // 大端序的 RGB565 需要转换为小端序
                     // 目前 esp_video 的大小端都会返回格式为 RGB565，不会返回格式为 RGB565X，此 case 用于未来版本兼容
-                    auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
-                    auto dst16 = (uint16_t*)frame_.data;
-                    size_t pixel_count = (size_t)frame_.width * (size_t)frame_.height;
-                    for (size_t i = 0; i < pixel_count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
+                    pixel_swap16(mmap_buffers_[buf.index].start, frame_.data, (size_t)frame_.width * (size_t)frame_.height);
                     frame_.format = V4L2_PIX_FMT_RGB565;
                     break;
                 }
@@ -744,6 +726,15 @@ bool Esp32Camera::Capture() {
         switch (frame_.format) {
             // LVGL 显示 YUV 系的图像似乎都有问题，暂时转换为 RGB565 显示
             case V4L2_PIX_FMT_YUYV:
+                data = (uint8_t*)heap_caps_malloc(w * h * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                if (data == nullptr) {
+                    ESP_LOGE(TAG, "Failed to allocate memory for preview image");
+                    return false;
+                }
+                pixel_yuv422_to_rgb565(frame_.data, (uint16_t*)data, (size_t)w * h, false);
+                lvgl_image_size = w * h * 2;
+                break;
+
             case V4L2_PIX_FMT_YUV420:
             case V4L2_PIX_FMT_RGB24: {
                 color_format = LV_COLOR_FORMAT_RGB565;
@@ -901,44 +892,61 @@ std::string Esp32Camera::Explain(const std::string& question) {
     }
 
     // 创建局部的 JPEG 队列, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
-    QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
-    if (jpeg_queue == nullptr) {
+    JpegEncodeContext ctx;
+    ctx.queue = xQueueCreate(40, sizeof(JpegChunk));
+    if (ctx.queue == nullptr) {
         ESP_LOGE(TAG, "Failed to create JPEG queue");
         throw std::runtime_error("Failed to create JPEG queue");
     }
 
     // We spawn a thread to encode the image to JPEG using optimized encoder (cost about 500ms and 8KB SRAM)
-    encoder_thread_ = std::thread([this, jpeg_queue]() {
+    // The thread always ends the stream with a null chunk, ctx.failed tells whether the JPEG is complete
+    encoder_thread_ = std::thread([this, &ctx]() {
         uint16_t w = frame_.width ? frame_.width : 320;
         uint16_t h = frame_.height ? frame_.height : 240;
         v4l2_pix_fmt_t enc_fmt = frame_.format;
         bool ok = image_to_jpeg_cb(
             frame_.data, frame_.len, w, h, enc_fmt, 80,
             [](void* arg, size_t index, const void* data, size_t len) -> size_t {
-                auto jpeg_queue = static_cast<QueueHandle_t>(arg);
-                JpegChunk chunk = {.data = nullptr, .len = len};
-                if (index == 0 && data != nullptr && len > 0) {
-                    chunk.data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-                    if (chunk.data == nullptr) {
-                        ESP_LOGE(TAG, "Failed to allocate %zu bytes for JPEG chunk", len);
-                        chunk.len = 0;
-                    } else {
-                        memcpy(chunk.data, data, len);
-                    }
-                } else {
-                    chunk.len = 0;  // Sentinel or error
+                auto ctx = static_cast<JpegEncodeContext*>(arg);
+                // The upload has failed or a chunk is already lost, the rest is useless
+                if (ctx->cancelled || ctx->failed || data == nullptr || len == 0) {
+                    return len;
+                }
+                // The encoder streams several chunks, index is their offset in the JPEG
+                JpegChunk chunk = {.data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT),
+                                   .len = len};
+                if (chunk.data == nullptr) {
+                    ESP_LOGE(TAG, "Failed to allocate %zu bytes for JPEG chunk", len);
+                    ctx->failed = true;
+                    return len;
                 }
-                xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
+                memcpy(chunk.data, data, len);
+                xQueueSend(ctx->queue, &chunk, portMAX_DELAY);
                 return len;
             },
-            jpeg_queue);
+            &ctx);
 
         if (!ok) {
-            JpegChunk chunk = {.data = nullptr, .len = 0};
-            xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
+            ctx.failed = true;
         }
+        JpegChunk chunk = {.data = nullptr, .len = 0};
+        xQueueSend(ctx.queue, &chunk, portMAX_DELAY);
     });
 
+    // Stops the encoder and drains the queue until its null chunk, the encoder may be blocked on a full queue
+    bool encoder_done = false;
+    auto stop_encoder = [this, &ctx, &encoder_done]() {
+        ctx.cancelled = true;
+        JpegChunk chunk;
+        while (!encoder_done && xQueueReceive(ctx.queue, &chunk, portMAX_DELAY) == pdPASS) {
+            encoder_done = chunk.data == nullptr;
+            heap_caps_free(chunk.data);
+        }
+        encoder_thread_.join();
+        vQueueDelete(ctx.queue);
+    };
+
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(3);
     // 构造multipart/form-data请求体
@@ -954,20 +962,11 @@ std::string Esp32Camera::Explain(const std::string& question) {
     http->SetHeader("Transfer-Encoding", "chunked");
     if (!http->Open("POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
-        // Clear the queue
-        encoder_thread_.join();
-        JpegChunk chunk;
-        while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS) {
-            if (chunk.data != nullptr) {
-                heap_caps_free(chunk.data);
-            } else {
-                break;
-            }
-        }
-        vQueueDelete(jpeg_queue);
+        stop_encoder();
         throw std::runtime_error("Failed to connect to explain URL");
     }
 
+    bool write_failed = false;
     {
         // 第一块：question字段
         std::string question_field;
@@ -975,7 +974,7 @@ std::string Esp32Camera::Explain(const std::string& question) {
         question_field += "Content-Disposition: form-data; name=\"question\"\r\n";
         question_field += "\r\n";
         question_field += question + "\r\n";
-        http->Write(question_field.c_str(), question_field.size());
+        write_failed |= http->Write(question_field.c_str(), question_field.size()) < 0;
     }
     {
         // 第二块：文件字段头部
@@ -984,33 +983,46 @@ std::string Esp32Camera::Explain(const std::string& question) {
         file_header += "Content-Disposition: form-data; name=\"file\"; filename=\"camera.jpg\"\r\n";
         file_header += "Content-Type: image/jpeg\r\n";
         file_header += "\r\n";
-        http->Write(file_header.c_str(), file_header.size());
+        write_failed |= http->Write(file_header.c_str(), file_header.size()) < 0;
     }
 
     // 第三块：JPEG数据
     size_t total_sent = 0;
-    bool saw_terminator = false;
-    while (true) {
+    while (!write_failed) {
         JpegChunk chunk;
-        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to receive JPEG chunk");
-            break;
+        if (xQueueReceive(ctx.queue, &chunk, portMAX_DELAY) != pdPASS) {
+            continue;
         }
         if (chunk.data == nullptr) {
-            saw_terminator = true;
-            break;  // The last chunk
+            encoder_done = true;
+            break;  // The last chunk, the encoder thread has finished
         }
-        http->Write((const char*)chunk.data, chunk.len);
+        write_failed = http->Write((const char*)chunk.data, chunk.len) < 0;
         total_sent += chunk.len;
         heap_caps_free(chunk.data);
+        if (ctx.failed) {
+            break;
+        }
+    }
+    if (write_failed || ctx.failed) {
+        // 不发送结束块，直接断开连接让服务器丢弃不完整的请求
+        stop_encoder();
+        http->Close();
+        if (write_failed) {
+            ESP_LOGE(TAG, "Failed to upload JPEG data");
+            throw std::runtime_error("Failed to upload photo");
+        }
+        ESP_LOGE(TAG, "JPEG encoder failed, %zu bytes sent before the failure", total_sent);
+        throw std::runtime_error("Failed to encode image to JPEG");
     }
     // Wait for the encoder thread to finish
     encoder_thread_.join();
     // 清理队列
-    vQueueDelete(jpeg_queue);
+    vQueueDelete(ctx.queue);
 
-    if (!saw_terminator || total_sent == 0) {
-        ESP_LOGE(TAG, "JPEG encoder failed or produced empty output");
+    if (total_sent == 0) {
+        ESP_LOGE(TAG, "JPEG encoder produced empty output");
+        http->Close();
         throw std::runtime_error("Failed to encode image to JPEG");
     }
 
@@ -3,6 +3,7 @@
 
 #ifndef CONFIG_IDF_TARGET_ESP32
 #include <lvgl.h>
+#include <atomic>
 #include <thread>
 #include <memory>
 #include <vector>
@@ -19,6 +20,13 @@ struct JpegChunk {
     size_t len;
 };
 
+// Shared by Explain() and its encoder thread
+struct JpegEncodeContext {
+    QueueHandle_t queue = nullptr;
+    std::atomic<bool> failed = false;     // Encoding failed or a chunk was lost, the JPEG is incomplete
+    std::atomic<bool> cancelled = false;  // The upload failed, the encoder stops queueing chunks
+};
+
 class Esp32Camera : public Camera {
 private:
     struct FrameBuffer {
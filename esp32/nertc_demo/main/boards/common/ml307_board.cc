@@ -33,6 +33,7 @@ void Ml307Board::StartNetwork() {
     }
 
     modem_->OnNetworkStateChanged([this, &application](bool network_ready) {
+        Board::GetInstance().GetDisplay()->NotifyStatusChanged(kStatusBarNetwork);
         if (network_ready) {
             ESP_LOGI(TAG, "Network is ready");
             application.Schedule([this, &application]() {
@@ -34,6 +34,7 @@ private:
     void InitializeBatteryMonitor() {
         adc_battery_monitor_ = new AdcBatteryMonitor(ADC_UNIT_1, ADC_CHANNEL_4, 100000, 100000, GPIO_NUM_12);
         adc_battery_monitor_->OnChargingStatusChanged([this](bool is_charging) {
+            display_->NotifyStatusChanged(kStatusBarBattery);
             if (is_charging) {
                 sleep_timer_->SetEnabled(false);
             } else {
@@ -162,10 +163,11 @@ public:
     XminiC3Board() : Ml307Board(ML307_TX_PIN, ML307_RX_PIN, ML307_DTR_PIN),
         boot_button_(BOOT_BUTTON_GPIO, false, 0, 0, true) {
 
-        InitializeBatteryMonitor();
         InitializePowerSaveTimer();
         InitializeCodecI2c();
         InitializeSsd1306Display();
+        // The charging callback uses the display and the power save timer, so it starts after both
+        InitializeBatteryMonitor();
         InitializeButtons();
         InitializeTools();
     }
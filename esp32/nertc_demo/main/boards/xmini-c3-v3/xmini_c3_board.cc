@@ -34,6 +34,7 @@ private:
     void InitializePowerManager() {
         adc_battery_monitor_ = new AdcBatteryMonitor(ADC_UNIT_1, ADC_CHANNEL_3, 100000, 100000, GPIO_NUM_12);
         adc_battery_monitor_->OnChargingStatusChanged([this](bool is_charging) {
+            display_->NotifyStatusChanged(kStatusBarBattery);
             if (is_charging) {
                 power_save_timer_->SetEnabled(false);
             } else {
@@ -157,10 +158,11 @@ private:
 
 public:
     XminiC3Board() : boot_button_(BOOT_BUTTON_GPIO, false, 0, 0, true) {  
-        InitializePowerManager();
         InitializePowerSaveTimer();
         InitializeCodecI2c();
         InitializeSsd1306Display();
+        // The charging callback uses the display and the power save timer, so it starts after both
+        InitializePowerManager();
         InitializeButtons();
         InitializeTools();
     }
@@ -0,0 +1,99 @@
+#include "chat_history.h"
+
+#include <algorithm>
+#include <cstring>
+
+ChatHistory::ChatHistory(size_t max_rows, size_t max_messages)
+    : max_rows_(max_rows), max_messages_(std::max(max_messages, max_rows)) {
+}
+
+int ChatHistory::Add(const char* role, const char* content) {
+    // Store the role as a string literal so that the owner can keep it in widget user data
+    const char* role_name = "assistant";
+    if (strcmp(role, "user") == 0) {
+        role_name = "user";
+    } else if (strcmp(role, "system") == 0) {
+        role_name = "system";
+    }
+
+    bool at_latest = window_ + order_.size() >= messages_.size();
+    bool collapse = strcmp(role_name, "system") == 0 && !messages_.empty() &&
+        strcmp(messages_.back().role, "system") == 0;
+
+    // Avoid empty message boxes
+    if (strlen(content) == 0) {
+        if (collapse) {
+            messages_.pop_back();
+            BindWindow(window_ > 0 && at_latest ? window_ - 1 : window_);
+        }
+        return -1;
+    }
+
+    if (collapse) {
+        messages_.back().content = content;
+    } else {
+        messages_.push_back({role_name, content});
+        if (messages_.size() > max_messages_) {
+            messages_.pop_front();
+            if (window_ > 0) {
+                window_--;
+            }
+        }
+    }
+
+    if (!at_latest) {
+        // Scrolled back in history, jump to the latest messages
+        BindWindow(messages_.size() - order_.size());
+        return order_.back();
+    }
+
+    int row;
+    size_t index = messages_.size() - 1 - window_;
+    if (index < order_.size()) {
+        row = order_[index];
+    } else if (order_.size() < max_rows_) {
+        row = order_.size();
+        order_.push_back(row);
+        on_create_row_(row);
+    } else {
+        // Recycle the oldest row as the newest one
+        row = order_.front();
+        order_.erase(order_.begin());
+        order_.push_back(row);
+        on_move_row_to_end_(row);
+        window_++;
+    }
+    on_bind_row_(row, messages_.back());
+    return row;
+}
+
+int ChatHistory::ScrollBack() {
+    size_t rows = order_.size();
+    if (rows < max_rows_ || window_ == 0) {
+        return -1;
+    }
+    size_t old_window = window_;
+    BindWindow(old_window > rows / 2 ? old_window - rows / 2 : 0);
+    return order_[old_window - window_];
+}
+
+int ChatHistory::ScrollForward() {
+    size_t rows = order_.size();
+    if (rows < max_rows_ || window_ + rows >= messages_.size()) {
+        return -1;
+    }
+    size_t old_window = window_;
+    BindWindow(std::min(old_window + rows / 2, messages_.size() - rows));
+    return order_[rows - 1 - (window_ - old_window)];
+}
+
+void ChatHistory::BindWindow(size_t window) {
+    window_ = window;
+    for (size_t i = 0; i < order_.size(); i++) {
+        if (window + i < messages_.size()) {
+            on_bind_row_(order_[i], messages_[window + i]);
+        } else {
+            on_hide_row_(order_[i]);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef CHAT_HISTORY_H
+#define CHAT_HISTORY_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bounded text history of a chat, shown in a fixed pool of message rows.
+// Rows are created up to max_rows and then recycled: the history decides which
+// message each row shows and the owner only creates, binds, hides and moves
+// the widgets through the callbacks. Rows are numbered in creation order.
+class ChatHistory {
+public:
+    struct Message {
+        const char* role;     // "user", "assistant" or "system"
+        std::string content;
+    };
+
+    ChatHistory(size_t max_rows, size_t max_messages);
+
+    void OnCreateRow(std::function<void(int row)> callback) { on_create_row_ = callback; }
+    void OnBindRow(std::function<void(int row, const Message& message)> callback) { on_bind_row_ = callback; }
+    void OnHideRow(std::function<void(int row)> callback) { on_hide_row_ = callback; }
+    void OnMoveRowToEnd(std::function<void(int row)> callback) { on_move_row_to_end_ = callback; }
+
+    // A system message replaces the one before it if that is a system message too.
+    // Returns the row showing the latest message, or -1 if content is empty
+    int Add(const char* role, const char* content);
+    // Rebind the rows to an earlier or later part of the history, for when the list is
+    // scrolled to its top or bottom edge. Returns the row now showing the message that
+    // was at that edge, or -1 if there is nothing more to show
+    int ScrollBack();
+    int ScrollForward();
+
+    size_t size() const { return messages_.size(); }
+    const Message& message(size_t index) const { return messages_[index]; }
+    size_t row_count() const { return order_.size(); }
+    // Row at position i of the list from the top, it shows message(window() + i)
+    int row_at(size_t i) const { return order_[i]; }
+    size_t window() const { return window_; }
+
+private:
+    void BindWindow(size_t window);
+
+    size_t max_rows_;
+    size_t max_messages_;
+    std::deque<Message> messages_;
+    std::vector<int> order_;    // Rows in display order
+    size_t window_ = 0;         // Index in messages_ of the message shown by order_[0]
+
+    std::function<void(int row)> on_create_row_;
+    std::function<void(int row, const Message& message)> on_bind_row_;
+    std::function<void(int row)> on_hide_row_;
+    std::function<void(int row)> on_move_row_to_end_;
+};
+
+#endif // CHAT_HISTORY_H
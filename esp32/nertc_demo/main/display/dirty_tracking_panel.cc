@@ -0,0 +1,136 @@
+#include "dirty_tracking_panel.h"
+
+#include <cstring>
+
+#include <esp_log.h>
+
+#define TAG "DirtyTrackingPanel"
+
+// A span costs its data bytes plus the column and page address commands, so clean
+// gaps shorter than this are sent along instead of starting another transaction
+#define OLED_SPAN_MERGE_GAP 8
+#define OLED_STATS_LOG_INTERVAL 100
+
+DirtyTrackingPanel::DirtyTrackingPanel(esp_lcd_panel_handle_t panel, int width, int height)
+    : panel_(panel), width_(width), height_(height) {
+    // SSD1306 and SH1106 store 8 vertical pixels per byte, one page per 8 rows
+    shadow_.resize(width_ * ((height_ + 7) / 8));
+    wrapper_.self = this;
+    wrapper_.base.reset = [](esp_lcd_panel_t* panel) { return esp_lcd_panel_reset(InnerPanel(panel)); };
+    wrapper_.base.init = [](esp_lcd_panel_t* panel) { return esp_lcd_panel_init(InnerPanel(panel)); };
+    wrapper_.base.del = [](esp_lcd_panel_t* panel) { return esp_lcd_panel_del(InnerPanel(panel)); };
+    wrapper_.base.draw_bitmap = [](esp_lcd_panel_t* panel, int x_start, int y_start, int x_end, int y_end, const void* data) {
+        auto self = __containerof(panel, Wrapper, base)->self;
+        return self->DrawBitmap(x_start, y_start, x_end, y_end, static_cast<const uint8_t*>(data));
+    };
+    wrapper_.base.mirror = [](esp_lcd_panel_t* panel, bool x, bool y) { return esp_lcd_panel_mirror(InnerPanel(panel), x, y); };
+    wrapper_.base.swap_xy = [](esp_lcd_panel_t* panel, bool swap) { return esp_lcd_panel_swap_xy(InnerPanel(panel), swap); };
+    wrapper_.base.set_gap = [](esp_lcd_panel_t* panel, int x, int y) { return esp_lcd_panel_set_gap(InnerPanel(panel), x, y); };
+    wrapper_.base.invert_color = [](esp_lcd_panel_t* panel, bool invert) { return esp_lcd_panel_invert_color(InnerPanel(panel), invert); };
+    wrapper_.base.disp_on_off = [](esp_lcd_panel_t* panel, bool on) { return esp_lcd_panel_disp_on_off(InnerPanel(panel), on); };
+    wrapper_.base.disp_sleep = [](esp_lcd_panel_t* panel, bool sleep) { return esp_lcd_panel_disp_sleep(InnerPanel(panel), sleep); };
+}
+
+esp_lcd_panel_handle_t DirtyTrackingPanel::InnerPanel(esp_lcd_panel_t* panel) {
+    return __containerof(panel, Wrapper, base)->self->panel_;
+}
+
+esp_err_t DirtyTrackingPanel::SendSpan(int page_start, int page_end, int x_start, int x_end) {
+    stats_.transactions++;
+    stats_.bytes_sent += (page_end - page_start) * (x_end - x_start);
+    // Send from the shadow, where one page span, or several full width pages, are contiguous
+    return esp_lcd_panel_draw_bitmap(panel_, x_start, page_start * 8, x_end, page_end * 8,
+        &shadow_[page_start * width_ + x_start]);
+}
+
+// Called from the LVGL task with the area already converted to pages by esp_lvgl_port:
+// data holds (y_end - y_start) / 8 pages of (x_end - x_start) bytes each
+esp_err_t DirtyTrackingPanel::DrawBitmap(int x_start, int y_start, int x_end, int y_end, const uint8_t* data) {
+    int width = x_end - x_start;
+    int bytes = width * (y_end - y_start) / 8;
+    stats_.flushes++;
+    stats_.bytes_requested += bytes;
+    if (stats_.flushes % OLED_STATS_LOG_INTERVAL == 0) {
+        ESP_LOGD(TAG, "Flushes: %lu, transactions: %lu, bytes sent: %lu of %lu",
+            stats_.flushes, stats_.transactions, stats_.bytes_sent, stats_.bytes_requested);
+    }
+
+    bool page_aligned = y_start % 8 == 0 && y_end % 8 == 0 &&
+        x_start >= 0 && x_end <= width_ && y_start >= 0 && y_end <= height_;
+    // Until the whole screen has been written, the panel RAM is unknown and nothing can be skipped
+    if (!page_aligned || !shadow_valid_) {
+        if (page_aligned) {
+            for (int page = y_start / 8; page < y_end / 8; page++) {
+                memcpy(&shadow_[page * width_ + x_start], data + (page - y_start / 8) * width, width);
+            }
+            shadow_valid_ = x_start == 0 && x_end == width_ && y_start == 0 && y_end == height_;
+        } else {
+            shadow_valid_ = false;
+        }
+        stats_.transactions++;
+        stats_.bytes_sent += bytes;
+        return esp_lcd_panel_draw_bitmap(panel_, x_start, y_start, x_end, y_end, data);
+    }
+
+    // Pending span, extended over following pages while they are dirty across the full width
+    int pending_page = -1;
+    int pending_pages = 0;
+    int pending_start = 0;
+    int pending_end = 0;
+    uint32_t transactions = stats_.transactions;
+    esp_err_t ret = ESP_OK;
+    auto add_span = [&](int page, int start, int end) {
+        if (pending_page >= 0 && start == 0 && end == width_ && pending_start == 0 && pending_end == width_ &&
+            pending_page + pending_pages == page) {
+            pending_pages++;
+            return ESP_OK;
+        }
+        esp_err_t err = ESP_OK;
+        if (pending_page >= 0) {
+            err = SendSpan(pending_page, pending_page + pending_pages, pending_start, pending_end);
+        }
+        pending_page = page;
+        pending_pages = 1;
+        pending_start = start;
+        pending_end = end;
+        return err;
+    };
+
+    for (int page = y_start / 8; page < y_end / 8 && ret == ESP_OK; page++) {
+        const uint8_t* src = data + (page - y_start / 8) * width;
+        uint8_t* dst = &shadow_[page * width_ + x_start];
+        int span_start = -1;
+        int span_end = 0;
+        for (int x = 0; x < width && ret == ESP_OK; x++) {
+            if (src[x] == dst[x]) {
+                continue;
+            }
+            dst[x] = src[x];
+            if (span_start >= 0 && x - span_end > OLED_SPAN_MERGE_GAP) {
+                ret = add_span(page, x_start + span_start, x_start + span_end);
+                span_start = -1;
+            }
+            if (span_start < 0) {
+                span_start = x;
+            }
+            span_end = x + 1;
+        }
+        if (span_start >= 0 && ret == ESP_OK) {
+            ret = add_span(page, x_start + span_start, x_start + span_end);
+        }
+    }
+    if (pending_page >= 0 && ret == ESP_OK) {
+        ret = SendSpan(pending_page, pending_page + pending_pages, pending_start, pending_end);
+    }
+    if (ret != ESP_OK) {
+        // Some of the columns copied to the shadow never reached the panel
+        shadow_valid_ = false;
+    }
+
+    // esp_lvgl_port learns that the flush is done from the panel IO transfer callback,
+    // so when every column was unchanged it has to be told here
+    if (stats_.transactions == transactions && on_flush_skipped_) {
+        on_flush_skipped_();
+    }
+    return ret;
+}
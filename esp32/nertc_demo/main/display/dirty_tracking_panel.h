@@ -0,0 +1,54 @@
+#ifndef DIRTY_TRACKING_PANEL_H
+#define DIRTY_TRACKING_PANEL_H
+
+#include <esp_lcd_panel_ops.h>
+#include <esp_lcd_panel_interface.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct OledFlushStats {
+    uint32_t flushes = 0;
+    uint32_t transactions = 0;      // draw_bitmap calls that reached the panel
+    uint32_t bytes_requested = 0;   // Page bytes LVGL asked to flush
+    uint32_t bytes_sent = 0;        // Page bytes actually sent
+};
+
+// Panel handed to LVGL in front of an SSD1306 or SH1106 panel. It forwards every call
+// to the inner panel, but keeps a shadow of the page data already on the panel and
+// only draws the columns that changed.
+class DirtyTrackingPanel {
+public:
+    DirtyTrackingPanel(esp_lcd_panel_handle_t panel, int width, int height);
+    DirtyTrackingPanel(const DirtyTrackingPanel&) = delete;
+    DirtyTrackingPanel& operator=(const DirtyTrackingPanel&) = delete;
+
+    esp_lcd_panel_handle_t handle() { return &wrapper_.base; }
+
+    // Called when a flush had nothing to send, so no panel IO transfer will report it done
+    void OnFlushSkipped(std::function<void()> callback) { on_flush_skipped_ = callback; }
+
+    esp_err_t DrawBitmap(int x_start, int y_start, int x_end, int y_end, const uint8_t* data);
+
+    const OledFlushStats& stats() const { return stats_; }
+
+private:
+    struct Wrapper {
+        esp_lcd_panel_t base;
+        DirtyTrackingPanel* self;
+    };
+    Wrapper wrapper_ = {};
+    esp_lcd_panel_handle_t panel_;
+    int width_;
+    int height_;
+    std::vector<uint8_t> shadow_;   // Page data on the panel, width_ bytes per page
+    bool shadow_valid_ = false;     // Set once a flush has covered the whole screen
+    OledFlushStats stats_;
+    std::function<void()> on_flush_skipped_;
+
+    static esp_lcd_panel_handle_t InnerPanel(esp_lcd_panel_t* panel);
+    esp_err_t SendSpan(int page_start, int page_end, int x_start, int x_end);
+};
+
+#endif // DIRTY_TRACKING_PANEL_H
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <chrono>
+#include <atomic>
 
 class Theme {
 public:
@@ -25,6 +26,13 @@ private:
     std::string name_;
 };
 
+// Status bar values whose source changed, see Display::NotifyStatusChanged
+enum StatusBarField : uint32_t {
+    kStatusBarBattery = 1 << 0,
+    kStatusBarNetwork = 1 << 1,
+    kStatusBarAll = kStatusBarBattery | kStatusBarNetwork,
+};
+
 class Display {
 public:
     Display();
@@ -41,6 +49,9 @@ public:
     virtual void UpdateStatusBar(bool update_all = false);
     virtual void SetPowerSaveMode(bool on);
 
+    // Called by the status sources from any task, the next UpdateStatusBar re-reads them
+    inline void NotifyStatusChanged(uint32_t fields) { status_changed_.fetch_or(fields); }
+
     inline int width() const { return width_; }
     inline int height() const { return height_; }
 
@@ -49,6 +60,7 @@ protected:
     int height_ = 0;
 
     Theme* current_theme_ = nullptr;
+    std::atomic<uint32_t> status_changed_ = kStatusBarAll;
 
     friend class DisplayLockGuard;
     virtual bool Lock(int timeout_ms = 0) = 0;
@@ -134,6 +134,7 @@ public:
     ~EmoteEngine();
 
     void SetEyes(const std::string &emoji_name, const bool repeat, const int fps, EmoteDisplay* const display);
+    void SetEyes(const EmotionId emoji_id, const bool repeat, const int fps, EmoteDisplay* const display);
     void SetIcon(const std::string &icon_name, EmoteDisplay* const display);
 
     void* GetEngineHandle() const
@@ -308,6 +309,11 @@ EmoteEngine::~EmoteEngine()
 }
 
 void EmoteEngine::SetEyes(const std::string &emoji_name, const bool repeat, const int fps, EmoteDisplay* const display)
+{
+    SetEyes(EmotionRegistry::GetInstance().Find(emoji_name.c_str()), repeat, fps, display);
+}
+
+void EmoteEngine::SetEyes(const EmotionId emoji_id, const bool repeat, const int fps, EmoteDisplay* const display)
 {
     if (!engine_handle_) {
         ESP_LOGE(TAG, "SetEyes: engine_handle_ is nullptr");
@@ -319,7 +325,7 @@ void EmoteEngine::SetEyes(const std::string &emoji_name, const bool repeat, cons
         return;
     }
 
-    const AssetData emoji_data = display->GetEmojiData(emoji_name);
+    const AssetData emoji_data = display->GetEmojiData(emoji_id);
     if (emoji_data.data) {
         DisplayLockGuard lock(display);
         gfx_anim_set_src(g_obj_anim_eye, emoji_data.data, emoji_data.size);
@@ -327,7 +333,7 @@ void EmoteEngine::SetEyes(const std::string &emoji_name, const bool repeat, cons
         gfx_obj_set_visible(g_obj_anim_eye, true);
         gfx_anim_start(g_obj_anim_eye);
     } else {
-        ESP_LOGW(TAG, "SetEyes: No emoji data found for %s", emoji_name.c_str());
+        ESP_LOGW(TAG, "SetEyes: No emoji data found for %s", EmotionRegistry::GetInstance().GetName(emoji_id));
     }
 }
 
@@ -399,7 +405,9 @@ void EmoteDisplay::SetEmotion(const char* const emotion)
         return;
     }
 
-    const AssetData emoji_data = GetEmojiData(emotion);
+    // Resolve the name once, the engine looks the data up again by id
+    const EmotionId emotion_id = EmotionRegistry::GetInstance().Find(emotion);
+    const AssetData emoji_data = GetEmojiData(emotion_id);
     bool repeat = emoji_data.loop;
     int fps = emoji_data.fps > 0 ? emoji_data.fps : 20;
 
@@ -408,7 +416,7 @@ void EmoteDisplay::SetEmotion(const char* const emotion)
     }
 
     DisplayLockGuard lock(this);
-    engine_->SetEyes(emotion, repeat, fps, this);
+    engine_->SetEyes(emotion_id, repeat, fps, this);
 }
 
 void EmoteDisplay::SetChatMessage(const char* const role, const char* const content)
@@ -527,13 +535,20 @@ void EmoteDisplay::SetTheme(Theme* const theme)
 void EmoteDisplay::AddEmojiData(const std::string &name, const void* const data, const size_t size,
                                 uint8_t fps, bool loop, bool lack)
 {
-    emoji_data_map_[name] = AssetData(data, size, fps, loop, lack);
+    const EmotionId id = EmotionRegistry::GetInstance().Intern(name.c_str());
+    if (id == EMOTION_ID_NONE) {
+        return;
+    }
+    if (id >= emoji_data_.size()) {
+        emoji_data_.resize(id + 1);
+    }
+    emoji_data_[id] = AssetData(data, size, fps, loop, lack);
     ESP_LOGD(TAG, "Added emoji data: %s, size: %d, fps: %d, loop: %s, lack: %s",
              name.c_str(), size, fps, loop ? "true" : "false", lack ? "true" : "false");
 
     DisplayLockGuard lock(this);
     if (name == "happy") {
-        engine_->SetEyes("happy", loop, fps > 0 ? fps : 20, this);
+        engine_->SetEyes(id, loop, fps > 0 ? fps : 20, this);
     }
 }
 
@@ -604,9 +619,13 @@ void EmoteDisplay::AddTextFont(std::shared_ptr<LvglFont> text_font)
 
 AssetData EmoteDisplay::GetEmojiData(const std::string &name) const
 {
-    const auto it = emoji_data_map_.find(name);
-    if (it != emoji_data_map_.cend()) {
-        return it->second;
+    return GetEmojiData(EmotionRegistry::GetInstance().Find(name.c_str()));
+}
+
+AssetData EmoteDisplay::GetEmojiData(const EmotionId id) const
+{
+    if (id < emoji_data_.size()) {
+        return emoji_data_[id];
     }
     return AssetData();
 }
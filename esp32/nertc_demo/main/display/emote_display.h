@@ -2,10 +2,12 @@
 
 #include "display.h"
 #include "lvgl_font.h"
+#include "emotion_registry.h"
 #include <memory>
 #include <functional>
 #include <map>
 #include <string>
+#include <vector>
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 
@@ -73,6 +75,7 @@ public:
     void AddLayoutData(const std::string &name, const std::string &align_str, int x, int y, int width = 0, int height = 0);
     void AddTextFont(std::shared_ptr<LvglFont> text_font);
     AssetData GetEmojiData(const std::string &name) const;
+    AssetData GetEmojiData(EmotionId id) const;
     AssetData GetIconData(const std::string &name) const;
 
     EmoteEngine* GetEngine() const;
@@ -94,7 +97,7 @@ private:
     std::shared_ptr<LvglFont> text_font_ = nullptr;
 
     // Non-LVGL asset data storage
-    std::map<std::string, AssetData> emoji_data_map_;
+    std::vector<AssetData> emoji_data_;  // Indexed by EmotionId
     std::map<std::string, AssetData> icon_data_map_;
 
 };
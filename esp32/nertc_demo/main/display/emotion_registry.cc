@@ -0,0 +1,98 @@
+#include "emotion_registry.h"
+
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "EmotionRegistry"
+
+// Emotions sent by the server, interned up front so their ids are stable
+static const char* const kDefaultEmotions[] = {
+    "neutral", "happy", "laughing", "funny", "sad", "angry", "crying", "loving",
+    "embarrassed", "surprised", "shocked", "thinking", "winking", "cool", "relaxed",
+    "delicious", "kissy", "confident", "sleepy", "silly", "confused",
+    // Status animations shown by the device itself
+    "wifi", "call", "mute",
+};
+
+EmotionRegistry::EmotionRegistry() {
+    slots_.assign(64, EMOTION_ID_NONE);
+    for (auto name : kDefaultEmotions) {
+        Intern(name);
+    }
+}
+
+// FNV-1a
+uint32_t EmotionRegistry::Hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = name; *p; ++p) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns the slot holding name, or the empty slot where it would be inserted
+size_t EmotionRegistry::Probe(const char* name, uint32_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        EmotionId id = slots_[i];
+        if (id == EMOTION_ID_NONE || (hashes_[id] == hash && names_[id] == name)) {
+            return i;
+        }
+    }
+}
+
+void EmotionRegistry::Grow() {
+    slots_.assign(slots_.size() * 2, EMOTION_ID_NONE);
+    size_t mask = slots_.size() - 1;
+    for (EmotionId id = 0; id < names_.size(); ++id) {
+        size_t i = hashes_[id] & mask;
+        while (slots_[i] != EMOTION_ID_NONE) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = id;
+    }
+}
+
+EmotionId EmotionRegistry::Intern(const char* name) {
+    if (name == nullptr) {
+        return EMOTION_ID_NONE;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t hash = Hash(name);
+    size_t slot = Probe(name, hash);
+    if (slots_[slot] != EMOTION_ID_NONE) {
+        return slots_[slot];
+    }
+    if (names_.size() >= EMOTION_ID_NONE) {
+        ESP_LOGE(TAG, "Too many emotions, dropping %s", name);
+        return EMOTION_ID_NONE;
+    }
+
+    EmotionId id = names_.size();
+    names_.emplace_back(name);
+    hashes_.push_back(hash);
+    slots_[slot] = id;
+    // Keep the load factor under 1/2 so probes stay short
+    if (names_.size() * 2 > slots_.size()) {
+        Grow();
+    }
+    return id;
+}
+
+EmotionId EmotionRegistry::Find(const char* name) const {
+    if (name == nullptr) {
+        return EMOTION_ID_NONE;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_[Probe(name, Hash(name))];
+}
+
+const char* EmotionRegistry::GetName(EmotionId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= names_.size()) {
+        return "";
+    }
+    return names_[id].c_str();
+}
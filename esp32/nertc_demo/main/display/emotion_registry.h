@@ -0,0 +1,45 @@
+#ifndef EMOTION_REGISTRY_H
+#define EMOTION_REGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Small dense id for an emotion name, usable as an index into per-display tables
+typedef uint16_t EmotionId;
+#define EMOTION_ID_NONE ((EmotionId)0xFFFF)
+
+// Interns emotion names so that displays resolve a name once with a hash lookup
+// and keep their emotion tables in vectors indexed by EmotionId
+class EmotionRegistry {
+public:
+    static EmotionRegistry& GetInstance() {
+        static EmotionRegistry instance;
+        return instance;
+    }
+    // Delete copy constructor and assignment operator
+    EmotionRegistry(const EmotionRegistry&) = delete;
+    EmotionRegistry& operator=(const EmotionRegistry&) = delete;
+
+    // Returns the id of name, adding it if it is not registered yet
+    EmotionId Intern(const char* name);
+    // Returns EMOTION_ID_NONE if name was never interned
+    EmotionId Find(const char* name) const;
+    const char* GetName(EmotionId id) const;
+
+private:
+    EmotionRegistry();
+
+    static uint32_t Hash(const char* name);
+    size_t Probe(const char* name, uint32_t hash) const;
+    void Grow();
+
+    mutable std::mutex mutex_;
+    std::deque<std::string> names_;   // Indexed by id, deque keeps c_str() stable
+    std::vector<uint32_t> hashes_;    // Indexed by id
+    std::vector<EmotionId> slots_;    // Open addressing table, size is a power of 2
+};
+
+#endif // EMOTION_REGISTRY_H
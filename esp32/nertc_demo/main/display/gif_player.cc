@@ -2,40 +2,143 @@
 #include <esp_log.h>
 #include <cstring>
 #include <chrono>
+#include <list>
+#include <mutex>
 #include "display.h"
 
 #define TAG "GifPlayer"
 
-// 静态公共方法
-void GifPlayer::CopyAllResourcesToPSRAM() {
-    if (!esp_psram_is_initialized()) {
-        ESP_LOGE(TAG, "PSRAM not initialized");
-        return;
+#define GIF_EVENT_DECODE        (1 << 0)
+#define GIF_EVENT_EXIT          (1 << 1)
+#define GIF_EVENT_EXITED        (1 << 2)
+#define GIF_EVENT_PREFETCH      (1 << 3)
+
+#ifndef CONFIG_ANIM_EMOJI_PSRAM_CACHE_SIZE_KB
+#define CONFIG_ANIM_EMOJI_PSRAM_CACHE_SIZE_KB 0
+#endif
+
+// PSRAM 中常驻的动画资源，最近使用的在前
+struct ResidentResource {
+    lz4_res_t* res;
+    int users;
+};
+
+static std::mutex resource_mutex;
+static std::list<ResidentResource> resident_resources;
+static size_t resident_bytes = 0;
+static uint32_t resource_hits = 0;
+static uint32_t resource_misses = 0;
+
+// 为 res 腾出空间并拷贝到 PSRAM，调用者需持有 resource_mutex
+static bool MakeResident(lz4_res_t* res, int users) {
+    const size_t budget = CONFIG_ANIM_EMOJI_PSRAM_CACHE_SIZE_KB * 1024;
+    if (res->size > budget || !esp_psram_is_initialized()) {
+        return false;
     }
 
-    ESP_LOGI(TAG, "Copying LZ4: %d resources to PSRAM...", lz4_res_count);
-    for (int i = 0; i < lz4_res_count; ++i) {
-        lz4_res_t* r = (lz4_res_t*)&lz4_res_list[i];
-        printf("lz4_res_t name:%s size:%d start:%p psram:%p\n", r->name, (int)r->size, r->start, r->psram);
-        uint8_t* dst = (uint8_t*)heap_caps_malloc(r->size, MALLOC_CAP_SPIRAM);
-        if (!dst) {
-            ESP_LOGE(TAG, "PSRAM malloc failed for %s", r->name);
+    // 从最久未使用的开始释放，正在播放的资源跳过
+    auto it = resident_resources.end();
+    while (resident_bytes + res->size > budget && it != resident_resources.begin()) {
+        --it;
+        if (it->users > 0) {
             continue;
         }
-        memcpy(dst, r->start, r->size);
-        r->psram = dst;
-        ESP_LOGI(TAG, "%s: %d bytes -> PSRAM %p", r->name, (int)r->size, dst);
+        ESP_LOGI(TAG, "Evict %s from PSRAM: %d bytes", it->res->name, (int)it->res->size);
+        heap_caps_free(it->res->psram);
+        it->res->psram = nullptr;
+        resident_bytes -= it->res->size;
+        it = resident_resources.erase(it);
+    }
+    if (resident_bytes + res->size > budget) {
+        return false;
+    }
+
+    uint8_t* dst = (uint8_t*)heap_caps_malloc(res->size, MALLOC_CAP_SPIRAM);
+    if (!dst) {
+        ESP_LOGE(TAG, "PSRAM malloc failed for %s", res->name);
+        return false;
+    }
+    memcpy(dst, res->start, res->size);
+    res->psram = dst;
+    resident_bytes += res->size;
+    resident_resources.push_front({res, users});
+    return true;
+}
+
+// 静态公共方法
+const uint8_t* GifPlayer::AcquireResource(lz4_res_t* res) {
+    std::lock_guard<std::mutex> lock(resource_mutex);
+    for (auto it = resident_resources.begin(); it != resident_resources.end(); ++it) {
+        if (it->res == res) {
+            resource_hits++;
+            it->users++;
+            resident_resources.splice(resident_resources.begin(), resident_resources, it);
+            return res->psram;
+        }
+    }
+
+    resource_misses++;
+    if (MakeResident(res, 1)) {
+        return res->psram;
     }
+    // PSRAM 放不下时直接从 flash 映射播放
+    return res->start;
+}
+
+void GifPlayer::ReleaseResource(const lz4_res_t* res) {
+    std::lock_guard<std::mutex> lock(resource_mutex);
+    for (auto& resident : resident_resources) {
+        if (resident.res == res && resident.users > 0) {
+            resident.users--;
+            break;
+        }
+    }
+}
+
+void GifPlayer::PrefetchResource(lz4_res_t* res) {
+    std::lock_guard<std::mutex> lock(resource_mutex);
+    for (auto& resident : resident_resources) {
+        if (resident.res == res) {
+            return;
+        }
+    }
+    if (MakeResident(res, 0)) {
+        ESP_LOGI(TAG, "Prefetched %s to PSRAM: %d bytes", res->name, (int)res->size);
+    }
+}
+
+GifPlayer::ResourceStats GifPlayer::GetResourceStats() {
+    std::lock_guard<std::mutex> lock(resource_mutex);
+    return {resource_hits, resource_misses, (int)resident_resources.size(), resident_bytes,
+        CONFIG_ANIM_EMOJI_PSRAM_CACHE_SIZE_KB * 1024};
+}
+
+void GifPlayer::LogResourceStats() {
+    ResourceStats stats = GetResourceStats();
+    ESP_LOGI(TAG, "PSRAM resources: %d resident, %u/%u bytes, hit rate %lu/%lu",
+        stats.resident_count, stats.resident_bytes, stats.budget_bytes,
+        stats.hits, stats.hits + stats.misses);
 }
 
 // 公共方法
 GifPlayer::GifPlayer(Display* dispaly):display_(dispaly) {
     memset(&img_dsc_, 0, sizeof(img_dsc_));
+    event_group_ = xEventGroupCreate();
+
+    // 低优先级解码任务，提前把下一帧解到后台缓冲区，定时器只负责交换和刷新
+    xTaskCreate([](void* arg) {
+        GifPlayer* player = (GifPlayer*)arg;
+        player->DecodeTask();
+        vTaskDelete(NULL);
+    }, "gif_decode", 4096, this, 2, nullptr);
 }
 
 GifPlayer::~GifPlayer() {
     Stop();
+    xEventGroupSetBits(event_group_, GIF_EVENT_EXIT);
+    xEventGroupWaitBits(event_group_, GIF_EVENT_EXITED, pdFALSE, pdFALSE, portMAX_DELAY);
     Cleanup();
+    vEventGroupDelete(event_group_);
 }
 
 void GifPlayer::InitCanvas(lv_obj_t* content) {
@@ -48,25 +151,49 @@ void GifPlayer::InitCanvas(lv_obj_t* content) {
 }
 
 lz4_res_t* GifPlayer::Getlz4ResByName(const char *emotion) {
-    std::string name = lz4_get_gif_name_get_by_name(emotion);
-    if (!name.empty()) {
+    lz4_res_t* res = Getlz4ResById(EmotionRegistry::GetInstance().Find(emotion));
+    if (!res) {
+        ESP_LOGE(TAG, "Unknown emotion: %s for lz4. return null", emotion ? emotion : "(null)");
+    }
+    return res;
+}
+
+#define GIF_RES_UNRESOLVED -2
+#define GIF_RES_NONE -1
+
+// 映射表只在每个表情第一次出现时线性查找一次，之后按 id 直接取下标
+lz4_res_t* GifPlayer::Getlz4ResById(EmotionId id) {
+    if (id == EMOTION_ID_NONE) {
+        return nullptr;
+    }
+    if (id >= res_index_.size()) {
+        res_index_.resize(id + 1, GIF_RES_UNRESOLVED);
+    }
+
+    if (res_index_[id] == GIF_RES_UNRESOLVED) {
+        res_index_[id] = GIF_RES_NONE;
+        const char* name = lz4_get_gif_name_get_by_name(EmotionRegistry::GetInstance().GetName(id));
         for (int i = 0; i < lz4_res_count; ++i) {
-            if (name == lz4_res_list[i].name) {
-                return &lz4_res_list[i];
+            if (strcmp(name, lz4_res_list[i].name) == 0) {
+                res_index_[id] = i;
+                break;
             }
         }
     }
-
-    ESP_LOGE(TAG, "Unknown emotion: %s for lz4. return null", emotion);
-    return nullptr;
+    return res_index_[id] >= 0 ? &lz4_res_list[res_index_[id]] : nullptr;
 }
 
-esp_err_t GifPlayer::LoadAndPlay(const lz4_res_t* res) {
-    if (!res || !res->psram) {
+esp_err_t GifPlayer::LoadAndPlay(lz4_res_t* res) {
+    if (!res || !res->start) {
         ESP_LOGE(TAG, "Invalid resource");
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (res_ == res && first_frame_) {
+        ESP_LOGI(TAG, "Same GIF already playing: %s", res->name);
+        return ESP_OK; // Already playing this GIF
+    }
+
     struct __attribute__((packed)) {
         char magic[4];
         uint16_t width;
@@ -77,21 +204,21 @@ esp_err_t GifPlayer::LoadAndPlay(const lz4_res_t* res) {
         uint32_t data_offset;
     } hdr;
     
-    memcpy(&hdr, res->psram, sizeof(hdr));
+    memcpy(&hdr, res->start, sizeof(hdr));
     if (memcmp(hdr.magic, "GIFL", 4) != 0) {
         ESP_LOGE(TAG, "Invalid magic: %.4s", hdr.magic);
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (current_emotion_ == res->name && first_frame_) {
-        ESP_LOGI(TAG, "Same GIF already playing: %s", res->name);
-        return ESP_OK; // Already playing this GIF
-    }
-
-    ESP_LOGI(TAG, "Loading GIF: %s. release GIF: %s", res->name, current_emotion_.c_str());
+    ESP_LOGI(TAG, "Loading GIF: %s. release GIF: %s, %lu dropped frames, decode %lu us (max %lu us)",
+        res->name, current_emotion_.c_str(), dropped_frames_, decode_time_us_, max_decode_time_us_);
 
+    // 等待解码任务放手后再替换资源
+    std::lock_guard<std::mutex> lock(frame_mutex_);
     Cleanup();
     current_emotion_ = res->name;
+    res_ = res;
+    const uint8_t* data = AcquireResource(res);
 
     uint32_t frame_size = hdr.width * hdr.height * 2;
     if (!frame_buffer_) {
@@ -102,9 +229,9 @@ esp_err_t GifPlayer::LoadAndPlay(const lz4_res_t* res) {
         }
     }
 
-    if (!old_frame_buffer_) {
-        old_frame_buffer_ = (uint8_t*)heap_caps_malloc(frame_size, MALLOC_CAP_SPIRAM);
-        if (!old_frame_buffer_) {
+    if (!back_buffer_) {
+        back_buffer_ = (uint8_t*)heap_caps_malloc(frame_size, MALLOC_CAP_SPIRAM);
+        if (!back_buffer_) {
             ESP_LOGE(TAG, "Failed to allocate frame buffer");
             return ESP_ERR_NO_MEM;
         }
@@ -114,8 +241,12 @@ esp_err_t GifPlayer::LoadAndPlay(const lz4_res_t* res) {
     height_ = hdr.height;
     fps_ = hdr.fps;
     total_frames_ = hdr.frames;
-    current_frame_ = 0;
-    lz4_data_ = res->psram + hdr.data_offset;
+    // 解码任务解的是 current_frame_ 的下一帧，切换表情时从第 0 帧开始
+    current_frame_ = -1;
+    back_frame_ = -1;
+    dropped_frames_ = 0;
+    max_decode_time_us_ = 0;
+    lz4_data_ = data + hdr.data_offset;
     lz4_size_ = res->size - hdr.data_offset;
 
     img_dsc_ = {}; //这一步很重要，确保结构体清零
@@ -125,8 +256,12 @@ esp_err_t GifPlayer::LoadAndPlay(const lz4_res_t* res) {
     img_dsc_.data_size = frame_size;
     img_dsc_.data = frame_buffer_;
 
-    ESP_LOGI(TAG, "Loaded GIF:%s %dx%d, %d frames, %d FPS", 
-            res->name, width_, height_, total_frames_, fps_);
+    ESP_LOGI(TAG, "Loaded GIF:%s %dx%d, %d frames, %d FPS, from %s", 
+            res->name, width_, height_, total_frames_, fps_, data == res->start ? "flash" : "PSRAM");
+    LogResourceStats();
+
+    // 其他表情播放完一轮后通常回到默认表情，提前把它拷贝到 PSRAM
+    prefetch_res_ = (res != &lz4_res_list[0]) ? &lz4_res_list[0] : nullptr;
     
     Play();
 
@@ -162,6 +297,7 @@ esp_err_t GifPlayer::Play() {
         interval_ms = std::max(interval_ms, 10);
         esp_timer_start_periodic(timer_handle_, interval_ms * 1000);
     }
+    xEventGroupSetBits(event_group_, GIF_EVENT_DECODE);
 
     ESP_LOGI(TAG, "Started playing GIF %d", interval_ms);
     return ESP_OK;
@@ -180,62 +316,151 @@ esp_err_t GifPlayer::Stop() {
     return ESP_OK;
 }
 
-bool get_diff_area(const uint8_t* __restrict new_,
-                   const uint8_t* __restrict old_,
-                   lv_area_t* dirty,
-                   int img_w, int img_h)
-{
-    constexpr int W   = 240;
-    constexpr int H   = 240;
-    constexpr int rowBytes = W * 2;          // 480 字节/行
-
-    int x0 = W, y0 = H, x1 = -1, y1 = -1;
-
-    /* 按行扫描，每 4 字节一组比较 */
-    for (int y = 0; y < H; ++y) {
-        const uint32_t* nPtr = reinterpret_cast<const uint32_t*>(new_ + y * rowBytes);
-        const uint32_t* oPtr = reinterpret_cast<const uint32_t*>(old_  + y * rowBytes);
-        int w32 = rowBytes / 4;              // 120 组
-        int firstDiff32 = -1, lastDiff32 = -1;
-
-        for (int i = 0; i < w32; ++i) {
-            if (nPtr[i] != oPtr[i]) {
-                if (firstDiff32 < 0) firstDiff32 = i;
-                lastDiff32 = i;
+#define GIF_DIRTY_GAP 16        // 间隔小于该像素数的变化合并到同一矩形
+#define GIF_DIRTY_WORK_AREAS 16 // 扫描时跟踪的矩形数上限
+
+static inline int area_size(const lv_area_t& a) {
+    return (a.x2 - a.x1 + 1) * (a.y2 - a.y1 + 1);
+}
+
+static inline void area_join(lv_area_t& a, const lv_area_t& b) {
+    a.x1 = std::min(a.x1, b.x1);
+    a.y1 = std::min(a.y1, b.y1);
+    a.x2 = std::max(a.x2, b.x2);
+    a.y2 = std::max(a.y2, b.y2);
+}
+
+// 合并并集面积增长最小的两个矩形
+static void merge_cheapest_areas(lv_area_t* areas, int& count) {
+    int best_i = 0, best_j = 1, best_cost = INT32_MAX;
+    for (int i = 0; i < count; ++i) {
+        for (int j = i + 1; j < count; ++j) {
+            lv_area_t joined = areas[i];
+            area_join(joined, areas[j]);
+            int cost = area_size(joined) - area_size(areas[i]) - area_size(areas[j]);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_i = i;
+                best_j = j;
             }
         }
+    }
+    area_join(areas[best_i], areas[best_j]);
+    areas[best_j] = areas[--count];
+}
 
-        if (firstDiff32 >= 0) {              // 本行有变化
-            int rowX0 = firstDiff32 * 4 / 2; // 转回像素坐标
-            int rowX1 = (lastDiff32 + 1) * 4 / 2 - 1;
-            x0 = std::min(x0, rowX0);
-            x1 = std::max(x1, rowX1);
-            y0 = std::min(y0, y);
-            y1 = std::max(y1, y);
+// 把一行中的变化段 [x0, x1] 并入相邻的矩形，必要时新建矩形
+static void add_dirty_span(lv_area_t* areas, int& count, int y, int x0, int x1) {
+    int target = -1;
+    for (int i = 0; i < count; ++i) {
+        lv_area_t& a = areas[i];
+        if (a.y2 < y - 1 || x0 > a.x2 + GIF_DIRTY_GAP || x1 < a.x1 - GIF_DIRTY_GAP) {
+            continue;
         }
+        if (target < 0) {
+            target = i;
+            area_join(a, {x0, y, x1, y});
+        } else {
+            // 该段连接了两个矩形
+            area_join(areas[target], a);
+            areas[i--] = areas[--count];
+        }
+    }
+    if (target < 0) {
+        if (count == GIF_DIRTY_WORK_AREAS) {
+            merge_cheapest_areas(areas, count);
+        }
+        areas[count++] = {x0, y, x1, y};
     }
+}
+
+int get_diff_areas(const uint8_t* __restrict new_,
+                   const uint8_t* __restrict old_,
+                   int img_w, int img_h,
+                   lv_area_t* areas, int max_areas)
+{
+    lv_area_t work[GIF_DIRTY_WORK_AREAS];
+    int count = 0;
+    const int row_bytes = img_w * 2;
+    // 宽度为偶数时每行都按 4 字节对齐，可以一次比较两个像素
+    const bool wide = (img_w % 2) == 0;
+
+    for (int y = 0; y < img_h; ++y) {
+        const uint8_t* n_row = new_ + y * row_bytes;
+        const uint8_t* o_row = old_ + y * row_bytes;
+        if (memcmp(n_row, o_row, row_bytes) == 0) {
+            continue;
+        }
 
-    if (x1 < 0) return false;                // 全帧相同
+        int span_x0 = -1, span_x1 = -1;
+        auto on_diff = [&](int px0, int px1) {
+            if (span_x0 >= 0 && px0 - span_x1 > GIF_DIRTY_GAP) {
+                add_dirty_span(work, count, y, span_x0, span_x1);
+                span_x0 = -1;
+            }
+            if (span_x0 < 0) {
+                span_x0 = px0;
+            }
+            span_x1 = px1;
+        };
 
-    dirty->x1 = x0;
-    dirty->y1 = y0;
-    dirty->x2 = x1;
-    dirty->y2 = y1;
-    return true;
+        if (wide) {
+            const uint32_t* n32 = reinterpret_cast<const uint32_t*>(n_row);
+            const uint32_t* o32 = reinterpret_cast<const uint32_t*>(o_row);
+            for (int i = 0; i < img_w / 2; ++i) {
+                if (n32[i] != o32[i]) {
+                    on_diff(i * 2, i * 2 + 1);
+                }
+            }
+        } else {
+            const uint16_t* n16 = reinterpret_cast<const uint16_t*>(n_row);
+            const uint16_t* o16 = reinterpret_cast<const uint16_t*>(o_row);
+            for (int i = 0; i < img_w; ++i) {
+                if (n16[i] != o16[i]) {
+                    on_diff(i, i);
+                }
+            }
+        }
+        if (span_x0 >= 0) {
+            add_dirty_span(work, count, y, span_x0, span_x1);
+        }
+    }
+
+    // 扩展后的矩形可能互相重叠，先合并重叠的，再合并到 max_areas 个以内
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < count && !merged; ++i) {
+            for (int j = i + 1; j < count; ++j) {
+                if (work[i].x1 <= work[j].x2 && work[j].x1 <= work[i].x2 &&
+                    work[i].y1 <= work[j].y2 && work[j].y1 <= work[i].y2) {
+                    area_join(work[i], work[j]);
+                    work[j] = work[--count];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    while (count > max_areas) {
+        merge_cheapest_areas(work, count);
+    }
+    for (int i = 0; i < count; ++i) {
+        areas[i] = work[i];
+    }
+    return count;
 }
 
 esp_err_t GifPlayer::SetFrame(int frame_index) {
-    esp_err_t ret = DecodeFrame(frame_index);
+    esp_err_t ret = DecodeFrame(frame_index, frame_buffer_);
+    if (ret == ESP_OK) {
+        current_frame_ = frame_index;
+    }
     if (ret == ESP_OK && canvas_) {
         DisplayLockGuard lock(display_);
         if (!first_frame_) {
             lv_image_set_src(canvas_, &img_dsc_);
             first_frame_ = true;
-        } else if (diff_redraw_) {
-            lv_area_t dirty;
-            if (get_diff_area(old_frame_buffer_, frame_buffer_, &dirty, img_dsc_.header.w, img_dsc_.header.h)) {
-                lv_obj_invalidate_area(canvas_, &dirty);  
-            }
         } else {
             lv_obj_invalidate(canvas_);
         }
@@ -243,14 +468,47 @@ esp_err_t GifPlayer::SetFrame(int frame_index) {
     return ret;
 }
 
+// 把后台帧的变化区域拷贝到显示帧并刷新，调用者需持有 frame_mutex_
+void GifPlayer::ShowBackFrame() {
+    DisplayLockGuard lock(display_);
+    if (back_dirty_count_ < 0) {
+        memcpy(frame_buffer_, back_buffer_, width_ * height_ * 2);
+        if (canvas_) {
+            lv_obj_invalidate(canvas_);
+        }
+        return;
+    }
+
+    lv_area_t coords = {};
+    if (canvas_) {
+        lv_obj_get_coords(canvas_, &coords);
+    }
+    // 图像在画布中居中，矩形需要换算到屏幕坐标
+    int offset_x = coords.x1 + (lv_area_get_width(&coords) - width_) / 2;
+    int offset_y = coords.y1 + (lv_area_get_height(&coords) - height_) / 2;
+    const int row_bytes = width_ * 2;
+    for (int i = 0; i < back_dirty_count_; ++i) {
+        lv_area_t& dirty = back_dirty_[i];
+        int x_bytes = dirty.x1 * 2;
+        int span_bytes = (dirty.x2 - dirty.x1 + 1) * 2;
+        for (int y = dirty.y1; y <= dirty.y2; ++y) {
+            memcpy(frame_buffer_ + y * row_bytes + x_bytes, back_buffer_ + y * row_bytes + x_bytes, span_bytes);
+        }
+        if (canvas_) {
+            lv_area_move(&dirty, offset_x, offset_y);
+            lv_obj_invalidate_area(canvas_, &dirty);
+        }
+    }
+}
+
 // 私有方法实现
-esp_err_t GifPlayer::DecodeFrame(int frame_index) {
+esp_err_t GifPlayer::DecodeFrame(int frame_index, uint8_t* buffer) {
     if (frame_index < 0 || frame_index >= total_frames_) {
         ESP_LOGE(TAG, "Frame index out of range: %d", frame_index);
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (!lz4_data_ || !frame_buffer_) {
+    if (!lz4_data_ || !buffer) {
         ESP_LOGE(TAG, "GIF not loaded properly");
         return ESP_ERR_INVALID_STATE;
     }
@@ -263,24 +521,67 @@ esp_err_t GifPlayer::DecodeFrame(int frame_index) {
 
     uint32_t compressed_len = *(uint32_t*)p;
     p += 4;
-    
-    memcpy(old_frame_buffer_, frame_buffer_, width_ * height_ * 2);
 
     int decompressed_size = width_ * height_ * 2;
-    int result = LZ4_decompress_safe((const char*)p, (char*)frame_buffer_, 
+    int result = LZ4_decompress_safe((const char*)p, (char*)buffer,
                                     compressed_len, decompressed_size);
 
     if (result == decompressed_size) {
-        current_frame_ = frame_index;
         ESP_LOGD(TAG, "Decoded frame %d/%d", frame_index + 1, total_frames_);
         return ESP_OK;
     } else {
-        ESP_LOGE(TAG, "LZ4 decompression failed: expected %d, got %d", 
+        ESP_LOGE(TAG, "LZ4 decompression failed: expected %d, got %d",
                  decompressed_size, result);
         return ESP_ERR_INVALID_SIZE;
     }
 }
 
+void GifPlayer::DecodeTask() {
+    while (true) {
+        auto bits = xEventGroupWaitBits(event_group_, GIF_EVENT_DECODE | GIF_EVENT_PREFETCH | GIF_EVENT_EXIT,
+            pdTRUE, pdFALSE, portMAX_DELAY);
+        if (bits & GIF_EVENT_EXIT) {
+            break;
+        }
+        if (bits & GIF_EVENT_DECODE) {
+            DecodeBackFrame();
+        }
+        if (bits & GIF_EVENT_PREFETCH) {
+            // 先解好下一帧，再在 frame_mutex_ 之外从 flash 拷贝，不阻塞定时器和解码
+            lz4_res_t* res = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(frame_mutex_);
+                res = pending_prefetch_;
+                pending_prefetch_ = nullptr;
+            }
+            if (res) {
+                PrefetchResource(res);
+            }
+        }
+    }
+    xEventGroupSetBits(event_group_, GIF_EVENT_EXITED);
+}
+
+void GifPlayer::DecodeBackFrame() {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (!lz4_data_ || back_frame_ >= 0) {
+        return;
+    }
+
+    int64_t start_time = esp_timer_get_time();
+    int next_frame = (current_frame_ + 1) % total_frames_;
+    if (DecodeFrame(next_frame, back_buffer_) != ESP_OK) {
+        return;
+    }
+    // 变化区域相对显示帧计算，-1 表示整帧刷新
+    back_dirty_count_ = diff_redraw_ ?
+        get_diff_areas(back_buffer_, frame_buffer_, width_, height_, back_dirty_, GIF_MAX_DIRTY_AREAS) : -1;
+    back_frame_ = next_frame;
+
+    decode_time_us_ = esp_timer_get_time() - start_time;
+    max_decode_time_us_ = std::max(max_decode_time_us_, decode_time_us_);
+}
+
 void GifPlayer::Cleanup() {
     if (timer_handle_) {
         esp_timer_stop(timer_handle_);
@@ -290,6 +591,12 @@ void GifPlayer::Cleanup() {
     //     frame_buffer_ = nullptr;
     // }
     
+    if (res_) {
+        ReleaseResource(res_);
+        res_ = nullptr;
+    }
+    prefetch_res_ = nullptr;
+    pending_prefetch_ = nullptr;
     lz4_data_ = nullptr;
     lz4_size_ = 0;
     
@@ -304,6 +611,23 @@ void GifPlayer::Cleanup() {
 }
 
 void GifPlayer::OnTimer() {
-    int next_frame = (current_frame_ + 1) % total_frames_;
-    SetFrame(next_frame);
-}
\ No newline at end of file
+    // 解码任务正在解码或被替换资源时不等待，本次计为丢帧
+    std::unique_lock<std::mutex> lock(frame_mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || back_frame_ < 0) {
+        dropped_frames_++;
+        return;
+    }
+
+    ShowBackFrame();
+    current_frame_ = back_frame_;
+    back_frame_ = -1;
+    EventBits_t bits = GIF_EVENT_DECODE;
+
+    // 拷贝资源较慢，交给解码任务做，定时器任务只负责交换和刷新
+    if (current_frame_ == total_frames_ - 1 && prefetch_res_) {
+        pending_prefetch_ = prefetch_res_;
+        prefetch_res_ = nullptr;
+        bits |= GIF_EVENT_PREFETCH;
+    }
+    xEventGroupSetBits(event_group_, bits);
+}
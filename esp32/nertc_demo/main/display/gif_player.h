@@ -2,28 +2,53 @@
 
 #include <stdint.h>
 #include <string>
+#include <mutex>
+#include <vector>
 #include "lz4.h"
 #include <lvgl.h>
 #include "esp_psram.h"
 #include "esp_heap_caps.h"
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include "lz4_auto.h"
+#include "emotion_registry.h"
+
+#define GIF_MAX_DIRTY_AREAS 4   // 每帧最多刷新的矩形数
+
+// 比较两帧 RGB565 图像，返回最多 max_areas 个覆盖所有变化像素的矩形
+int get_diff_areas(const uint8_t* new_, const uint8_t* old_, int img_w, int img_h,
+                   lv_area_t* areas, int max_areas);
 
 class Display;
 class GifPlayer {
 public:
+    // PSRAM 缓存统计，命中/未命中按 AcquireResource 计数
+    struct ResourceStats {
+        uint32_t hits;
+        uint32_t misses;
+        int resident_count;
+        size_t resident_bytes;
+        size_t budget_bytes;
+    };
+
     // 构造函数/析构函数
     GifPlayer(Display* dispaly); //传递 display 主要是为了使用锁
     ~GifPlayer();
 
-    // 静态方法：加载所有资源到PSRAM
-    static void CopyAllResourcesToPSRAM();
+    // 静态方法：资源按需从 flash 拷贝到 PSRAM，超出预算时按 LRU 释放
+    static const uint8_t* AcquireResource(lz4_res_t* res);
+    static void ReleaseResource(const lz4_res_t* res);
+    static void PrefetchResource(lz4_res_t* res);
+    static ResourceStats GetResourceStats();
+    static void LogResourceStats();
 
     // 公共接口方法
     void      InitCanvas(lv_obj_t* content);
     void      SetDiffRedraw(bool diff_redraw) { diff_redraw_ = diff_redraw; }
     lz4_res_t *Getlz4ResByName(const char *emotion);
-    esp_err_t LoadAndPlay(const lz4_res_t* res);
+    lz4_res_t *Getlz4ResById(EmotionId id);
+    esp_err_t LoadAndPlay(lz4_res_t* res);
     
     // 获取信息（只读）
     int GetWidth() const { return width_; }
@@ -32,6 +57,11 @@ public:
     int GetCurrentFrame() const { return current_frame_; }
     int GetFPS() const { return fps_; }
     bool IsPlaying() const { return first_frame_; }
+
+    // 解码统计：定时器到点时下一帧还没解码好即计为丢帧
+    uint32_t GetDroppedFrames() const { return dropped_frames_; }
+    uint32_t GetDecodeTimeUs() const { return decode_time_us_; }
+    uint32_t GetMaxDecodeTimeUs() const { return max_decode_time_us_; }
     
     // 获取LVGL对象（只读）
     lv_obj_t* GetCanvas() const { return canvas_; }
@@ -42,17 +72,24 @@ private:
     esp_err_t Play();
     esp_err_t Stop();
     esp_err_t SetFrame(int frame_index);
-    esp_err_t DecodeFrame(int frame_index);
+    esp_err_t DecodeFrame(int frame_index, uint8_t* buffer);
+    void ShowBackFrame();
     void Cleanup();
     void OnTimer();
+    void DecodeTask();
+    void DecodeBackFrame();
 
     // 成员变量
     Display* display_ = nullptr; // 用于锁定显示
+    lz4_res_t* res_ = nullptr;          // 正在播放的资源，播放期间不会被换出
+    lz4_res_t* prefetch_res_ = nullptr; // 本轮播放结束后预取的资源
+    lz4_res_t* pending_prefetch_ = nullptr; // 等待解码任务拷贝到 PSRAM 的资源，受 frame_mutex_ 保护
     const uint8_t* lz4_data_ = nullptr;
     uint32_t lz4_size_ = 0;
-    uint8_t* frame_buffer_ = nullptr;
-    uint8_t* old_frame_buffer_ = nullptr;
+    uint8_t* frame_buffer_ = nullptr;   // 正在显示的帧，LVGL 从这里读取
+    uint8_t* back_buffer_ = nullptr;    // 解码任务提前解出的下一帧
     std::string current_emotion_;
+    std::vector<int16_t> res_index_;    // 按 EmotionId 索引的 lz4_res_list 下标，首次查询时解析
     int width_ = 0;
     int height_ = 0;
     int fps_ = 0;
@@ -60,7 +97,17 @@ private:
     int current_frame_ = 0;
     bool first_frame_ = false;
     bool diff_redraw_ = true;
-    
+
+    // 解码任务与定时器之间的交接，back_frame_ >= 0 表示后台帧已就绪
+    std::mutex frame_mutex_;
+    EventGroupHandle_t event_group_ = nullptr;
+    int back_frame_ = -1;
+    int back_dirty_count_ = 0;
+    lv_area_t back_dirty_[GIF_MAX_DIRTY_AREAS];
+    uint32_t dropped_frames_ = 0;
+    uint32_t decode_time_us_ = 0;
+    uint32_t max_decode_time_us_ = 0;
+
     lv_img_dsc_t img_dsc_ = {};
     lv_obj_t* canvas_ = nullptr;
     esp_timer_handle_t timer_handle_ = nullptr;
@@ -171,7 +171,6 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
 
     SetupUI();
 #if defined(CONFIG_ENABLE_ANIM_EMOJI)
-    GifPlayer::CopyAllResourcesToPSRAM();
     gif_player_ = new GifPlayer(this);
 
     SetupGifContainer();
@@ -192,7 +191,7 @@ void SpiLcdDisplay::SetEmotion(const char *emotion)
     }
 
     //todo ����emotion��ѯlz4_res_list��index
-    const lz4_res_t *lz4 = gif_player_->Getlz4ResByName(emotion);
+    lz4_res_t *lz4 = gif_player_->Getlz4ResByName(emotion);
     if (!lz4) {
         ESP_LOGE(TAG, "GifPlayer Getlz4ResByName failed emotion:%s", emotion);
         return;
@@ -626,8 +625,22 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_flex_align(content_, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
     lv_obj_set_style_pad_row(content_, lvgl_theme->spacing(4), 0); // Space between messages
 
-    // We'll create chat messages dynamically in SetChatMessage
+    // Message rows are created by SetChatMessage and recycled once MAX_MESSAGES exist,
+    // older messages are rebound into the rows when scrolling back
     chat_message_label_ = nullptr;
+    chat_history_.OnCreateRow([this](int row) {
+        CreateChatRow();
+    });
+    chat_history_.OnBindRow([this](int row, const ChatHistory::Message& message) {
+        BindChatRow(chat_rows_[row], message);
+    });
+    chat_history_.OnHideRow([this](int row) {
+        lv_obj_add_flag(chat_rows_[row], LV_OBJ_FLAG_HIDDEN);
+    });
+    chat_history_.OnMoveRowToEnd([this](int row) {
+        lv_obj_move_to_index(chat_rows_[row], -1);
+    });
+    lv_obj_add_event_cb(content_, OnChatScrollEnd, LV_EVENT_SCROLL_END, this);
 
     low_battery_popup_ = lv_obj_create(screen);
     lv_obj_set_scrollbar_mode(low_battery_popup_, LV_SCROLLBAR_MODE_OFF);
@@ -651,197 +664,137 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_text_color(emoji_label_, lvgl_theme->text_color(), 0);
     lv_label_set_text(emoji_label_, FONT_AWESOME_MICROCHIP_AI);
 }
-#if CONFIG_IDF_TARGET_ESP32P4
-#define  MAX_MESSAGES 40
-#else
-#define  MAX_MESSAGES 20
-#endif
-void LcdDisplay::SetChatMessage(const char* role, const char* content) {
-    DisplayLockGuard lock(this);
-    if (content_ == nullptr) {
+// Apply the theme colors matching the bubble type saved in its user data
+static void ApplyBubbleTheme(lv_obj_t* bubble, LvglTheme* lvgl_theme) {
+    const char* bubble_type = static_cast<const char*>(lv_obj_get_user_data(bubble));
+    if (bubble_type == nullptr) {
+        ESP_LOGW(TAG, "Bubble type is not found");
         return;
     }
-    
-    // Check if message count exceeds limit
-    uint32_t child_count = lv_obj_get_child_cnt(content_);
-    if (child_count >= MAX_MESSAGES) {
-        // Delete the oldest message (first child object)
-        lv_obj_t* first_child = lv_obj_get_child(content_, 0);
-        lv_obj_t* last_child = lv_obj_get_child(content_, child_count - 1);
-        if (first_child != nullptr) {
-            lv_obj_del(first_child);
-        }
-        // Scroll to the last message immediately
-        if (last_child != nullptr) {
-            lv_obj_scroll_to_view_recursive(last_child, LV_ANIM_OFF);
-        }
-    }
-    
-    // Collapse system messages (if it's a system message, check if the last message is also a system message)
-    if (strcmp(role, "system") == 0) {
-        if (child_count > 0) {
-            // Get the last message container
-            lv_obj_t* last_container = lv_obj_get_child(content_, child_count - 1);
-            if (last_container != nullptr && lv_obj_get_child_cnt(last_container) > 0) {
-                // Get the bubble inside the container
-                lv_obj_t* last_bubble = lv_obj_get_child(last_container, 0);
-                if (last_bubble != nullptr) {
-                    // Check if bubble type is system message
-                    void* bubble_type_ptr = lv_obj_get_user_data(last_bubble);
-                    if (bubble_type_ptr != nullptr && strcmp((const char*)bubble_type_ptr, "system") == 0) {
-                        // If the last message is also a system message, delete it
-                        lv_obj_del(last_container);
-                    }
-                }
-            }
-        }
+
+    if (strcmp(bubble_type, "user") == 0) {
+        lv_obj_set_style_bg_color(bubble, lvgl_theme->user_bubble_color(), 0);
+    } else if (strcmp(bubble_type, "assistant") == 0) {
+        lv_obj_set_style_bg_color(bubble, lvgl_theme->assistant_bubble_color(), 0);
     } else {
-        // Hide the centered AI logo
-        lv_obj_add_flag(emoji_label_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_style_bg_color(bubble, lvgl_theme->system_bubble_color(), 0);
     }
+    lv_obj_set_style_border_color(bubble, lvgl_theme->border_color(), 0);
 
-    // Avoid empty message boxes
-    if(strlen(content) == 0) {
-        return;
+    if (strcmp(bubble_type, "image") != 0 && lv_obj_get_child_cnt(bubble) > 0) {
+        lv_obj_t* text = lv_obj_get_child(bubble, 0);
+        if (strcmp(bubble_type, "system") == 0) {
+            lv_obj_set_style_text_color(text, lvgl_theme->system_text_color(), 0);
+        } else {
+            lv_obj_set_style_text_color(text, lvgl_theme->text_color(), 0);
+        }
     }
+}
 
+// Rows are created once and rebound to other messages, the row is a full-width
+// transparent container so the bubble can be aligned by role
+void LcdDisplay::CreateChatRow() {
     auto lvgl_theme = static_cast<LvglTheme*>(current_theme_);
-    auto text_font = lvgl_theme->text_font()->font();
 
-    // Create a message bubble
-    lv_obj_t* msg_bubble = lv_obj_create(content_);
+    lv_obj_t* row = lv_obj_create(content_);
+    lv_obj_set_width(row, LV_HOR_RES);
+    lv_obj_set_height(row, LV_SIZE_CONTENT);
+    lv_obj_set_style_bg_opa(row, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_width(row, 0, 0);
+    lv_obj_set_style_pad_all(row, 0, 0);
+    lv_obj_set_scrollbar_mode(row, LV_SCROLLBAR_MODE_OFF);
+
+    lv_obj_t* msg_bubble = lv_obj_create(row);
     lv_obj_set_style_radius(msg_bubble, 8, 0);
     lv_obj_set_scrollbar_mode(msg_bubble, LV_SCROLLBAR_MODE_OFF);
     lv_obj_set_style_border_width(msg_bubble, 0, 0);
     lv_obj_set_style_pad_all(msg_bubble, lvgl_theme->spacing(4), 0);
+    lv_obj_set_style_bg_opa(msg_bubble, LV_OPA_70, 0);
+    lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
 
-    // Create the message text
     lv_obj_t* msg_text = lv_label_create(msg_bubble);
-    lv_label_set_text(msg_text, content);
-    
-    // Calculate actual text width
-    lv_coord_t text_width = lv_txt_get_width(content, strlen(content), text_font, 0);
+    lv_label_set_long_mode(msg_text, LV_LABEL_LONG_WRAP);
 
-    // Calculate bubble width
-    lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;  // 85% of screen width
-    lv_coord_t min_width = 20;  
-    lv_coord_t bubble_width;
-    
-    // Ensure text width is not less than minimum width
-    if (text_width < min_width) {
-        text_width = min_width;
-    }
+    chat_rows_.push_back(row);
+}
 
-    // If text width is less than max width, use text width
-    if (text_width < max_width) {
-        bubble_width = text_width; 
-    } else {
-        bubble_width = max_width;
-    }
-    
-    // Set message text width
-    lv_obj_set_width(msg_text, bubble_width);  // Subtract padding
-    lv_label_set_long_mode(msg_text, LV_LABEL_LONG_WRAP);
+void LcdDisplay::BindChatRow(lv_obj_t* row, const ChatHistory::Message& message) {
+    auto lvgl_theme = static_cast<LvglTheme*>(current_theme_);
+    auto text_font = lvgl_theme->text_font()->font();
+    lv_obj_t* msg_bubble = lv_obj_get_child(row, 0);
+    lv_obj_t* msg_text = lv_obj_get_child(msg_bubble, 0);
+
+    lv_label_set_text(msg_text, message.content.c_str());
 
-    // Set bubble width
-    lv_obj_set_width(msg_bubble, bubble_width);
+    // Calculate bubble width, 85% of screen width at most
+    lv_coord_t text_width = lv_txt_get_width(message.content.c_str(), message.content.size(), text_font, 0);
+    lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;
+    lv_coord_t min_width = 20;
+    lv_obj_set_width(msg_text, std::min(std::max(text_width, min_width), max_width));
+    lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
     lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
 
-    // Set alignment and style based on message role
-    if (strcmp(role, "user") == 0) {
-        // User messages are right-aligned with green background
-        lv_obj_set_style_bg_color(msg_bubble, lvgl_theme->user_bubble_color(), 0);
-        lv_obj_set_style_bg_opa(msg_bubble, LV_OPA_70, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, lvgl_theme->text_color(), 0);
-        
-        // Set custom attribute to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"user");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "assistant") == 0) {
-        // Assistant messages are left-aligned with white background
-        lv_obj_set_style_bg_color(msg_bubble, lvgl_theme->assistant_bubble_color(), 0);
-        lv_obj_set_style_bg_opa(msg_bubble, LV_OPA_70, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, lvgl_theme->text_color(), 0);
-        
-        // Set custom attribute to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"assistant");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "system") == 0) {
-        // System messages are center-aligned with light gray background
-        lv_obj_set_style_bg_color(msg_bubble, lvgl_theme->system_bubble_color(), 0);
-        lv_obj_set_style_bg_opa(msg_bubble, LV_OPA_70, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, lvgl_theme->system_text_color(), 0);
-        
-        // Set custom attribute to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"system");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    }
-    
-    // Create a full-width container for user messages to ensure right alignment
-    if (strcmp(role, "user") == 0) {
-        // Create a full-width container
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        // Make container transparent and borderless
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        // Move the message bubble into this container
-        lv_obj_set_parent(msg_bubble, container);
-        
-        // Right align the bubble in the container
+    lv_obj_set_user_data(msg_bubble, (void*)message.role);
+    ApplyBubbleTheme(msg_bubble, lvgl_theme);
+
+    // User messages are right-aligned, system messages centered, assistant messages left-aligned
+    if (strcmp(message.role, "user") == 0) {
         lv_obj_align(msg_bubble, LV_ALIGN_RIGHT_MID, -25, 0);
-        
-        // Auto-scroll to this container
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
-    } else if (strcmp(role, "system") == 0) {
-        // Create full-width container for system messages to ensure center alignment
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        lv_obj_set_parent(msg_bubble, container);
+    } else if (strcmp(message.role, "system") == 0) {
         lv_obj_align(msg_bubble, LV_ALIGN_CENTER, 0, 0);
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
     } else {
-        // For assistant messages
-        // Left align assistant messages
         lv_obj_align(msg_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+    }
+    lv_obj_remove_flag(row, LV_OBJ_FLAG_HIDDEN);
+}
 
-        // Auto-scroll to the message bubble
-        lv_obj_scroll_to_view_recursive(msg_bubble, LV_ANIM_ON);
+// Called from the LVGL task, the display lock is already held
+void LcdDisplay::OnChatScrollEnd(lv_event_t* e) {
+    auto self = static_cast<LcdDisplay*>(lv_event_get_user_data(e));
+    if (self->chat_rebinding_) {
+        return;
     }
-    
+
+    // Keep the message that was at the edge in view after rebinding
+    self->chat_rebinding_ = true;
+    int anchor = -1;
+    if (lv_obj_get_scroll_top(self->content_) <= 0) {
+        anchor = self->chat_history_.ScrollBack();
+    }
+    if (anchor < 0 && lv_obj_get_scroll_bottom(self->content_) <= 0) {
+        anchor = self->chat_history_.ScrollForward();
+    }
+    if (anchor >= 0) {
+        lv_obj_update_layout(self->content_);
+        lv_obj_scroll_to_view(self->chat_rows_[anchor], LV_ANIM_OFF);
+    }
+    self->chat_rebinding_ = false;
+}
+
+void LcdDisplay::SetChatMessage(const char* role, const char* content) {
+    DisplayLockGuard lock(this);
+    if (content_ == nullptr) {
+        return;
+    }
+
+    if (strcmp(role, "system") != 0) {
+        // Hide the centered AI logo
+        lv_obj_add_flag(emoji_label_, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    // Rebinding when scrolled back in history moves the list, ignore the scroll events it causes
+    chat_rebinding_ = true;
+    int row = chat_history_.Add(role, content);
+    chat_rebinding_ = false;
+    if (row < 0) {
+        return;
+    }
+
     // Store reference to the latest message label
-    chat_message_label_ = msg_text;
+    chat_message_label_ = lv_obj_get_child(lv_obj_get_child(chat_rows_[row], 0), 0);
+
+    // Auto-scroll to the new message
+    lv_obj_scroll_to_view_recursive(chat_rows_[row], LV_ANIM_ON);
 }
 
 void LcdDisplay::SetPreviewImage(std::unique_ptr<LvglImage> image) {
@@ -855,8 +808,14 @@ void LcdDisplay::SetPreviewImage(std::unique_ptr<LvglImage> image) {
     }
     
     auto lvgl_theme = static_cast<LvglTheme*>(current_theme_);
+    // Only the latest image preview is kept in the chat
+    if (image_bubble_ != nullptr) {
+        lv_obj_del(image_bubble_);
+    }
+
     // Create a message bubble for image preview
     lv_obj_t* img_bubble = lv_obj_create(content_);
+    image_bubble_ = img_bubble;
     lv_obj_set_style_radius(img_bubble, 8, 0);
     lv_obj_set_scrollbar_mode(img_bubble, LV_SCROLLBAR_MODE_OFF);
     lv_obj_set_style_border_width(img_bubble, 0, 0);
@@ -1127,12 +1086,60 @@ void LcdDisplay::SetChatMessage(const char* role, const char* content) {
 }
 #endif
 
+#ifdef CONFIG_EMOJI_GIF_CACHE_SIZE_KB
+#define EMOJI_GIF_CACHE_SIZE (CONFIG_EMOJI_GIF_CACHE_SIZE_KB * 1024)
+#else
+#define EMOJI_GIF_CACHE_SIZE 0
+#endif
+
+// Stop the playing GIF and keep its decoder, so switching back to the emoji skips
+// parsing the GIF and allocating its canvas. Called with the display lock held
+void LcdDisplay::ReleaseGifController() {
+    if (!gif_controller_) {
+        return;
+    }
+
+    gif_controller_->Stop();
+    gif_controller_->SetFrameCallback(nullptr);
+    // gifdec allocates an ARGB8888 canvas and an 8-bit index frame
+    size_t bytes = gif_controller_->width() * gif_controller_->height() * 5;
+    if (gif_image_ != nullptr && bytes <= EMOJI_GIF_CACHE_SIZE) {
+        gif_cache_.push_front({gif_image_, std::move(gif_controller_), bytes});
+        gif_cache_bytes_ += bytes;
+        while (gif_cache_bytes_ > EMOJI_GIF_CACHE_SIZE) {
+            gif_cache_bytes_ -= gif_cache_.back().bytes;
+            gif_cache_.pop_back();
+        }
+    }
+    gif_controller_.reset();
+    gif_image_ = nullptr;
+}
+
+std::unique_ptr<LvglGif> LcdDisplay::TakeCachedGif(const LvglImage* image) {
+    for (auto it = gif_cache_.begin(); it != gif_cache_.end(); ++it) {
+        if (it->image == image) {
+            auto gif = std::move(it->gif);
+            gif_cache_bytes_ -= it->bytes;
+            gif_cache_.erase(it);
+            return gif;
+        }
+    }
+    return nullptr;
+}
+
+void LcdDisplay::ClearGifCache() {
+    DisplayLockGuard lock(this);
+    gif_cache_.clear();
+    gif_cache_bytes_ = 0;
+    // Nor may the playing decoder be cached under an image that is about to be freed
+    gif_image_ = nullptr;
+}
+
 void LcdDisplay::SetEmotion(const char* emotion) {
     // Stop any running GIF animation
     if (gif_controller_) {
         DisplayLockGuard lock(this);
-        gif_controller_->Stop();
-        gif_controller_.reset();
+        ReleaseGifController();
     }
     
     if (emoji_image_ == nullptr) {
@@ -1140,7 +1147,8 @@ void LcdDisplay::SetEmotion(const char* emotion) {
     }
 
     auto emoji_collection = static_cast<LvglTheme*>(current_theme_)->emoji_collection();
-    auto image = emoji_collection != nullptr ? emoji_collection->GetEmojiImage(emotion) : nullptr;
+    auto image = emoji_collection != nullptr ?
+        emoji_collection->GetEmojiImage(EmotionRegistry::GetInstance().Find(emotion)) : nullptr;
     if (image == nullptr) {
         const char* utf8 = font_awesome_get_utf8(emotion);
         if (utf8 != nullptr && emoji_label_ != nullptr) {
@@ -1154,8 +1162,12 @@ void LcdDisplay::SetEmotion(const char* emotion) {
 
     DisplayLockGuard lock(this);
     if (image->IsGif()) {
-        // Create new GIF controller
-        gif_controller_ = std::make_unique<LvglGif>(image->image_dsc());
+        // Reuse the decoder if this GIF was shown recently, otherwise create a new one
+        gif_controller_ = TakeCachedGif(image);
+        if (!gif_controller_) {
+            gif_controller_ = std::make_unique<LvglGif>(image->image_dsc());
+        }
+        gif_image_ = image;
         
         if (gif_controller_->IsLoaded()) {
             // Set up frame update callback
@@ -1173,6 +1185,7 @@ void LcdDisplay::SetEmotion(const char* emotion) {
         } else {
             ESP_LOGE(TAG, "Failed to load GIF for emotion: %s", emotion);
             gif_controller_.reset();
+            gif_image_ = nullptr;
         }
     } else {
         lv_image_set_src(emoji_image_, image->image_dsc());
@@ -1185,10 +1198,7 @@ void LcdDisplay::SetEmotion(const char* emotion) {
     uint32_t child_count = lv_obj_get_child_cnt(content_);
     if (strcmp(emotion, "neutral") == 0 && child_count > 0) {
         // Stop GIF animation if running
-        if (gif_controller_) {
-            gif_controller_->Stop();
-            gif_controller_.reset();
-        }
+        ReleaseGifController();
         
         lv_obj_add_flag(emoji_image_, LV_OBJ_FLAG_HIDDEN);
         lv_obj_add_flag(emoji_label_, LV_OBJ_FLAG_HIDDEN);
@@ -1200,6 +1210,10 @@ void LcdDisplay::SetTheme(Theme* theme) {
     DisplayLockGuard lock(this);
     
     auto lvgl_theme = static_cast<LvglTheme*>(theme);
+
+    // The theme may come with another emoji collection, drop decoders of the old images
+    gif_cache_.clear();
+    gif_cache_bytes_ = 0;
     
     // Get the active screen
     lv_obj_t* screen = lv_screen_active();
@@ -1250,69 +1264,12 @@ void LcdDisplay::SetTheme(Theme* theme) {
     // Set content background opacity
     lv_obj_set_style_bg_opa(content_, LV_OPA_TRANSP, 0);
 
-    // Iterate through all children of content (message containers or bubbles)
-    uint32_t child_count = lv_obj_get_child_cnt(content_);
-    for (uint32_t i = 0; i < child_count; i++) {
-        lv_obj_t* obj = lv_obj_get_child(content_, i);
-        if (obj == nullptr) continue;
-        
-        lv_obj_t* bubble = nullptr;
-        
-        // Check if this object is a container or bubble
-        // If it's a container (user or system message), get its child as bubble
-        // If it's a bubble (assistant message), use it directly
-        if (lv_obj_get_child_cnt(obj) > 0) {
-            // Might be a container, check if it's a user or system message container
-            // User and system message containers are transparent
-            lv_opa_t bg_opa = lv_obj_get_style_bg_opa(obj, 0);
-            if (bg_opa == LV_OPA_TRANSP) {
-                // This is a user or system message container
-                bubble = lv_obj_get_child(obj, 0);
-            } else {
-                // This might be an assistant message bubble itself
-                bubble = obj;
-            }
-        } else {
-            // No child elements, might be other UI elements, skip
-            continue;
-        }
-        
-        if (bubble == nullptr) continue;
-        
-        // Use saved user data to identify bubble type
-        void* bubble_type_ptr = lv_obj_get_user_data(bubble);
-        if (bubble_type_ptr != nullptr) {
-            const char* bubble_type = static_cast<const char*>(bubble_type_ptr);
-            
-            // Apply correct color based on bubble type
-            if (strcmp(bubble_type, "user") == 0) {
-                lv_obj_set_style_bg_color(bubble, lvgl_theme->user_bubble_color(), 0);
-            } else if (strcmp(bubble_type, "assistant") == 0) {
-                lv_obj_set_style_bg_color(bubble, lvgl_theme->assistant_bubble_color(), 0); 
-            } else if (strcmp(bubble_type, "system") == 0) {
-                lv_obj_set_style_bg_color(bubble, lvgl_theme->system_bubble_color(), 0);
-            } else if (strcmp(bubble_type, "image") == 0) {
-                lv_obj_set_style_bg_color(bubble, lvgl_theme->system_bubble_color(), 0);
-            }
-            
-            // Update border color
-            lv_obj_set_style_border_color(bubble, lvgl_theme->border_color(), 0);
-            
-            // Update text color for the message
-            if (lv_obj_get_child_cnt(bubble) > 0) {
-                lv_obj_t* text = lv_obj_get_child(bubble, 0);
-                if (text != nullptr) {
-                    // Set text color based on bubble type
-                    if (strcmp(bubble_type, "system") == 0) {
-                        lv_obj_set_style_text_color(text, lvgl_theme->system_text_color(), 0);
-                    } else {
-                        lv_obj_set_style_text_color(text, lvgl_theme->text_color(), 0);
-                    }
-                }
-            }
-        } else {
-            ESP_LOGW(TAG, "child[%lu] Bubble type is not found", i);
-        }
+    // Update the recycled message rows and the image preview
+    for (auto row : chat_rows_) {
+        ApplyBubbleTheme(lv_obj_get_child(row, 0), lvgl_theme);
+    }
+    if (image_bubble_ != nullptr) {
+        ApplyBubbleTheme(image_bubble_, lvgl_theme);
     }
 #else
     // Simple UI mode - just update the main chat message
@@ -10,6 +10,9 @@
 
 #include <atomic>
 #include <memory>
+#include <list>
+#include <string>
+#include <vector>
 
 #if defined(CONFIG_ENABLE_ANIM_EMOJI)
 #include "gif_player.h"
@@ -17,6 +20,18 @@
 
 #define PREVIEW_IMAGE_DURATION_MS 5000
 
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+#include "chat_history.h"
+
+#if CONFIG_IDF_TARGET_ESP32P4
+#define  MAX_MESSAGES 40
+#define  MAX_HISTORY_MESSAGES 200
+#else
+#define  MAX_MESSAGES 20
+#define  MAX_HISTORY_MESSAGES 100
+#endif
+#endif
+
 
 class LcdDisplay : public LvglDisplay {
 protected:
@@ -34,13 +49,35 @@ protected:
     lv_obj_t* emoji_label_ = nullptr;
     lv_obj_t* emoji_image_ = nullptr;
     std::unique_ptr<LvglGif> gif_controller_ = nullptr;
+    const LvglImage* gif_image_ = nullptr;  // Emoji image gif_controller_ was opened from
+    struct CachedGif {
+        const LvglImage* image;
+        std::unique_ptr<LvglGif> gif;
+        size_t bytes;
+    };
+    std::list<CachedGif> gif_cache_;        // Stopped GIF decoders, most recently used first
+    size_t gif_cache_bytes_ = 0;
     lv_obj_t* emoji_box_ = nullptr;
     lv_obj_t* chat_message_label_ = nullptr;
     esp_timer_handle_t preview_timer_ = nullptr;
     std::unique_ptr<LvglImage> preview_image_cached_ = nullptr;
     bool hide_subtitle_ = false;  // Control whether to hide chat messages/subtitles
 
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    // Bounded text history, shown in the recycled message rows of chat_rows_
+    ChatHistory chat_history_{MAX_MESSAGES, MAX_HISTORY_MESSAGES};
+    std::vector<lv_obj_t*> chat_rows_;      // Indexed by ChatHistory row number
+    bool chat_rebinding_ = false;
+    lv_obj_t* image_bubble_ = nullptr;
+
+    void CreateChatRow();
+    void BindChatRow(lv_obj_t* row, const ChatHistory::Message& message);
+    static void OnChatScrollEnd(lv_event_t* e);
+#endif
+
     void InitializeLcdThemes();
+    void ReleaseGifController();
+    std::unique_ptr<LvglGif> TakeCachedGif(const LvglImage* image);
     void SetupUI();
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
@@ -60,6 +97,9 @@ public:
     
     // Set whether to hide chat messages/subtitles
     void SetHideSubtitle(bool hide);
+
+    // Drop cached GIF decoders, must be called before the emoji images they were opened from are freed
+    void ClearGifCache();
 };
 
 // SPI LCD display
@@ -1,28 +1,43 @@
 #include "emoji_collection.h"
 
 #include <esp_log.h>
-#include <unordered_map>
 #include <string>
 
 #define TAG "EmojiCollection"
 
 void EmojiCollection::AddEmoji(const std::string& name, LvglImage* image) {
-    emoji_collection_[name] = image;
+    EmotionId id = EmotionRegistry::GetInstance().Intern(name.c_str());
+    if (id == EMOTION_ID_NONE) {
+        delete image;
+        return;
+    }
+    if (id >= emoji_collection_.size()) {
+        emoji_collection_.resize(id + 1, nullptr);
+    }
+    if (emoji_collection_[id] != image) {
+        delete emoji_collection_[id];
+    }
+    emoji_collection_[id] = image;
 }
 
 const LvglImage* EmojiCollection::GetEmojiImage(const char* name) {
-    auto it = emoji_collection_.find(name);
-    if (it != emoji_collection_.end()) {
-        return it->second;
+    auto image = GetEmojiImage(EmotionRegistry::GetInstance().Find(name));
+    if (image == nullptr) {
+        ESP_LOGW(TAG, "Emoji not found: %s", name);
     }
+    return image;
+}
 
-    ESP_LOGW(TAG, "Emoji not found: %s", name);
-    return nullptr;
+const LvglImage* EmojiCollection::GetEmojiImage(EmotionId id) const {
+    if (id >= emoji_collection_.size()) {
+        return nullptr;
+    }
+    return emoji_collection_[id];
 }
 
 EmojiCollection::~EmojiCollection() {
-    for (auto it = emoji_collection_.begin(); it != emoji_collection_.end(); ++it) {
-        delete it->second;
+    for (auto image : emoji_collection_) {
+        delete image;
     }
     emoji_collection_.clear();
 }
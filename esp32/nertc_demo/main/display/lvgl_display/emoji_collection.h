@@ -2,10 +2,11 @@
 #define EMOJI_COLLECTION_H
 
 #include "lvgl_image.h"
+#include "emotion_registry.h"
 
 #include <lvgl.h>
 
-#include <map>
+#include <vector>
 #include <string>
 #include <memory>
 
@@ -15,10 +16,11 @@ class EmojiCollection {
 public:
     virtual void AddEmoji(const std::string& name, LvglImage* image);
     virtual const LvglImage* GetEmojiImage(const char* name);
+    const LvglImage* GetEmojiImage(EmotionId id) const;
     virtual ~EmojiCollection();
 
 private:
-    std::map<std::string, LvglImage*> emoji_collection_;
+    std::vector<LvglImage*> emoji_collection_;  // Indexed by EmotionId
 };
 
 class Twemoji32 : public EmojiCollection {
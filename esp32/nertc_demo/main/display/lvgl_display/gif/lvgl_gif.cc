@@ -106,6 +106,8 @@ void LvglGif::Stop() {
 
     if (gif_) {
         gd_rewind(gif_);
+        // Let the next Start show the first frame right away instead of waiting out the last delay
+        gif_->gce.delay = 0;
         NextFrame();
         ESP_LOGD(TAG, "GIF animation stopped and rewound");
     }
@@ -13,6 +13,7 @@
 #include "driver/jpeg_encode.h"
 #endif
 #include "image_to_jpeg.h"
+#include "pixel_convert.h"
 
 #define TAG "image_to_jpeg"
 
@@ -35,161 +36,245 @@ static __always_inline uint8_t expand_6_to_8(uint8_t v) {
     return (uint8_t)((v << 2) | (v >> 4));
 }
 
-static uint8_t* convert_input_to_encoder_buf(const uint8_t* src, uint16_t width, uint16_t height, v4l2_pix_fmt_t format,
-                                             jpeg_pixel_format_t* out_fmt, int* out_size) {
-    // GRAY 直接作为 JPEG_PIXEL_FORMAT_GRAY 输入
-    if (format == V4L2_PIX_FMT_GREY) {
-        int sz = (int)width * (int)height;
-        uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
-        if (!buf)
-            return NULL;
-        memcpy(buf, src, sz);
-        if (out_fmt)
-            *out_fmt = JPEG_PIXEL_FORMAT_GRAY;
-        if (out_size)
-            *out_size = sz;
-        return buf;
+static int v4l2_bytes_per_pixel(v4l2_pix_fmt_t format) {
+    switch (format) {
+        case V4L2_PIX_FMT_GREY:
+            return 1;
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_UYVY:
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_RGB565X:
+            return 2;
+        case V4L2_PIX_FMT_RGB24:
+            return 3;
+        default:
+            return 0;
     }
+}
 
-    // V4L2 YUYV (Y Cb Y Cr) 可直接作为 JPEG_PIXEL_FORMAT_YCbYCr 输入
-    if (format == V4L2_PIX_FMT_YUYV) {
-        int sz = (int)width * (int)height * 2;
-        uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
-        if (!buf)
-            return NULL;
-        memcpy(buf, src, sz);
-        if (out_fmt)
-            *out_fmt = JPEG_PIXEL_FORMAT_YCbYCr;
-        if (out_size)
-            *out_size = sz;
-        return buf;
+// 基线 JPEG 的一个 8x8 块最多是 22 位的 DC 加 63 个 26 位的 AC（最长 16 位码字加 10 位幅值），
+// 即 208 字节；每个 0xFF 之后还要填充一个 0x00，最坏再翻一倍
+#define JPEG_MAX_DCT_BLOCK_BYTES 416
+// 首块前的文件头（SOI、APP0、DQT、SOF0、DHT、SOS）和末块后的 EOI
+#define JPEG_MAX_HEADER_BYTES 1024
+
+// 条带编码的状态，block 是编码器一次处理的输入块，strip 是 fill 写入的原始格式条带
+typedef struct {
+    jpeg_enc_handle_t enc;
+    esp_imgfx_color_convert_handle_t convert;
+    uint8_t* block;
+    uint8_t* strip;
+    uint8_t* outbuf;
+} strip_encoder_t;
+
+static void strip_encoder_close(strip_encoder_t* se) {
+    if (se->strip && se->strip != se->block)
+        free(se->strip);
+    if (se->block)
+        jpeg_free_align(se->block);
+    if (se->outbuf)
+        free(se->outbuf);
+    if (se->convert)
+        esp_imgfx_color_convert_close(se->convert);
+    if (se->enc)
+        jpeg_enc_close(se->enc);
+}
+
+bool image_to_jpeg_strips_cb(uint16_t width, uint16_t height, v4l2_pix_fmt_t format, uint8_t quality,
+                             jpg_strip_cb fill, void* fill_arg, jpg_out_cb cb, void* arg) {
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+
+    int in_bpp = v4l2_bytes_per_pixel(format);
+    if (in_bpp == 0 || width == 0 || height == 0) {
+        ESP_LOGE(TAG, "unsupported strip input: 0x%08x %ux%u", format, width, height);
+        return false;
     }
+    bool gray = format == V4L2_PIX_FMT_GREY;
 
-    // V4L2 UYVY (Cb Y Cr Y) -> 重排为 YUYV 再作为 YCbYCr 输入
-    // 当前版本暂时不会出现 UYVY 格式
-    if (format == V4L2_PIX_FMT_UYVY) [[unlikely]] {
-        int sz = (int)width * (int)height * 2;
-        const uint8_t* s = src;
-        uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
-        if (!buf)
-            return NULL;
-        uint8_t* d = buf;
-        for (int i = 0; i < sz; i += 4) {
-            // src: Cb, Y0, Cr, Y1 -> dst: Y0, Cb, Y1, Cr
-            d[0] = s[1];
-            d[1] = s[0];
-            d[2] = s[3];
-            d[3] = s[2];
-            s += 4;
-            d += 4;
-        }
-        if (out_fmt)
-            *out_fmt = JPEG_PIXEL_FORMAT_YCbYCr;
-        if (out_size)
-            *out_size = sz;
-        return buf;
+    jpeg_enc_config_t cfg = DEFAULT_JPEG_ENC_CONFIG();
+    cfg.width = width;
+    cfg.height = height;
+    cfg.src_type = gray ? JPEG_PIXEL_FORMAT_GRAY : JPEG_PIXEL_FORMAT_YCbYCr;
+    cfg.subsampling = gray ? JPEG_SUBSAMPLE_GRAY : JPEG_SUBSAMPLE_420;
+    cfg.quality = quality;
+    cfg.rotate = JPEG_ROTATE_0D;
+    cfg.task_enable = false;
+
+    strip_encoder_t se = {};
+    jpeg_error_t ret = jpeg_enc_open(&cfg, &se.enc);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "jpeg_enc_open failed: %d", (int)ret);
+        return false;
     }
 
-    // V4L2 YUV422P (YUV422 Planar) -> 重排为 YUYV (YCbYCr)
-    // 当前版本暂时不会出现 YUV422P 格式
-    if (format == V4L2_PIX_FMT_YUV422P) [[unlikely]] {
-        int sz = (int)width * (int)height * 2;
-        const uint8_t* y_plane = src;
-        const uint8_t* u_plane = y_plane + (int)width * (int)height;
-        const uint8_t* v_plane = u_plane + ((int)width / 2) * (int)height;
-        uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
-        if (!buf)
-            return NULL;
-        uint8_t* dst = buf;
-        for (int y = 0; y < height; y++) {
-            const uint8_t* y_row = y_plane + y * (int)width;
-            const uint8_t* u_row = u_plane + y * ((int)width / 2);
-            const uint8_t* v_row = v_plane + y * ((int)width / 2);
-            for (int x = 0; x < width; x += 2) {
-                uint8_t y0 = y_row[x + 0];
-                uint8_t y1 = y_row[x + 1];
-                uint8_t cb = u_row[x / 2];
-                uint8_t cr = v_row[x / 2];
-                dst[0] = y0;
-                dst[1] = cb;
-                dst[2] = y1;
-                dst[3] = cr;
-                dst += 4;
-            }
-        }
-        if (out_fmt)
-            *out_fmt = JPEG_PIXEL_FORMAT_YCbYCr;
-        if (out_size)
-            *out_size = sz;
-        return buf;
+    // 编码器按 MCU 行分块，块大小必须是整行
+    int block_size = 0;
+    int enc_row_bytes = (int)width * (gray ? 1 : 2);
+    ret = jpeg_enc_get_block_size(se.enc, &block_size);
+    if (ret != JPEG_ERR_OK || block_size <= 0 || block_size % enc_row_bytes != 0) {
+        ESP_LOGE(TAG, "unexpected jpeg block size: %d", block_size);
+        strip_encoder_close(&se);
+        return false;
+    }
+    int lines = block_size / enc_row_bytes;
+    int in_row_bytes = (int)width * in_bpp;
+
+    // GREY 和 YUYV 直接写入编码块，其余格式先写入原始条带再转换
+    se.block = (uint8_t*)jpeg_calloc_align(block_size, 16);
+    se.strip = (gray || format == V4L2_PIX_FMT_YUYV) ? se.block : (uint8_t*)malloc_psram(in_row_bytes * lines);
+    // 输出缓冲区按最坏情况分配，编码器写满时没有办法重试已经编码的块
+    int mcu_width = gray ? 8 : 16;
+    int dct_blocks = (width + mcu_width - 1) / mcu_width * (gray ? 1 : 6);
+    size_t out_cap = (size_t)dct_blocks * JPEG_MAX_DCT_BLOCK_BYTES + JPEG_MAX_HEADER_BYTES;
+    se.outbuf = (uint8_t*)malloc_psram(out_cap);
+    if (!se.block || !se.strip || !se.outbuf) {
+        ESP_LOGE(TAG, "alloc strip buffers failed");
+        strip_encoder_close(&se);
+        return false;
     }
 
-    // RGB 转换为 YUV422 (YCbYCr) 再输入
-    // 见 https://github.com/78/xiaozhi-esp32/issues/1380#issuecomment-3497156378
-    else if (format == V4L2_PIX_FMT_RGB24 || format == V4L2_PIX_FMT_RGB565 || format == V4L2_PIX_FMT_RGB565X) {
-        esp_imgfx_pixel_fmt_t in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888;
-        uint32_t src_len = 0;
-        switch (format) {
-            case V4L2_PIX_FMT_RGB24:
-                in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888;
-                src_len = static_cast<uint32_t>(width * height * 3);
-                break;
-            case V4L2_PIX_FMT_RGB565:
-                in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
-                src_len = static_cast<uint32_t>(width * height * 2);
-                break;
-            [[unlikely]] case V4L2_PIX_FMT_RGB565X: // 当前版本暂时不会出现 RGB565X
-                in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_BE;
-                src_len = static_cast<uint32_t>(width * height * 2);
-                break;
-            [[unlikely]] default:
-                ESP_LOGE(TAG, "[Unreachable Case] unsupported format: 0x%08x", format);
-                std::unreachable();
-        }
-        int sz = (int)width * (int)height * 2;
-        uint8_t* buf = (uint8_t*)jpeg_calloc_align(sz, 16);
-        if (!buf)
-            return nullptr;
+    // RGB565 由 pixel_rgb565_to_yuyv 转换，只有 RGB24 需要 esp_imgfx
+    if (format == V4L2_PIX_FMT_RGB24) {
         esp_imgfx_color_convert_cfg_t convert_cfg = {
             .in_res = {.width = static_cast<int16_t>(width),
-                        .height = static_cast<int16_t>(height)},
-            .in_pixel_fmt = in_pixel_fmt,
+                       .height = static_cast<int16_t>(lines)},
+            .in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888,
             .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_YUYV,
             .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
         };
-        esp_imgfx_color_convert_handle_t convert_handle = nullptr;
-        esp_imgfx_err_t err = esp_imgfx_color_convert_open(&convert_cfg, &convert_handle);
-        if (err != ESP_IMGFX_ERR_OK || convert_handle == nullptr) {
+        if (esp_imgfx_color_convert_open(&convert_cfg, &se.convert) != ESP_IMGFX_ERR_OK || se.convert == nullptr) {
             ESP_LOGE(TAG, "esp_imgfx_color_convert_open failed");
-            jpeg_free_align(buf);
-            return nullptr;
+            strip_encoder_close(&se);
+            return false;
         }
-        esp_imgfx_data_t convert_input_data = {
-            .data = const_cast<uint8_t*>(src),
-            .data_len = static_cast<uint32_t>(src_len),
-        };
-        esp_imgfx_data_t convert_output_data = {
-            .data = buf,
-            .data_len = static_cast<uint32_t>(sz),
-        };
-        err = esp_imgfx_color_convert_process(convert_handle, &convert_input_data, &convert_output_data);
-        if (err != ESP_IMGFX_ERR_OK) {
-            ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
-            jpeg_free_align(buf);
-            return nullptr;
+    }
+
+    size_t offset = 0;
+    for (int y = 0; y < height; y += lines) {
+        int n = height - y < lines ? height - y : lines;
+        if (!fill(fill_arg, (uint16_t)y, (uint16_t)n, se.strip)) {
+            ESP_LOGE(TAG, "fill strip at line %d failed", y);
+            strip_encoder_close(&se);
+            return false;
         }
-        esp_imgfx_color_convert_close(convert_handle);
-        convert_handle = nullptr;
-        if (out_fmt)
-            *out_fmt = JPEG_PIXEL_FORMAT_YCbYCr;
-        if (out_size)
-            *out_size = sz;
-        return buf;
+        // 最后一个条带不足一块时重复末行补齐
+        for (int i = n; i < lines; i++) {
+            memcpy(se.strip + i * in_row_bytes, se.strip + (n - 1) * in_row_bytes, in_row_bytes);
+        }
+
+        if (se.convert) {
+            esp_imgfx_data_t convert_input_data = {
+                .data = se.strip,
+                .data_len = static_cast<uint32_t>(in_row_bytes * lines),
+            };
+            esp_imgfx_data_t convert_output_data = {
+                .data = se.block,
+                .data_len = static_cast<uint32_t>(block_size),
+            };
+            if (esp_imgfx_color_convert_process(se.convert, &convert_input_data, &convert_output_data) != ESP_IMGFX_ERR_OK) {
+                ESP_LOGE(TAG, "esp_imgfx_color_convert_process failed");
+                strip_encoder_close(&se);
+                return false;
+            }
+        } else if (format == V4L2_PIX_FMT_RGB565 || format == V4L2_PIX_FMT_RGB565X) {
+            pixel_rgb565_to_yuyv(se.strip, se.block, (size_t)width * lines, format == V4L2_PIX_FMT_RGB565X);
+        } else if (format == V4L2_PIX_FMT_UYVY) {
+            // src: Cb, Y0, Cr, Y1 -> dst: Y0, Cb, Y1, Cr，即逐个 16 位交换字节
+            pixel_swap16(se.strip, se.block, block_size / 2);
+        }
+
+        int out_len = 0;
+        ret = jpeg_enc_process_with_block(se.enc, se.block, block_size, se.outbuf, (int)out_cap, &out_len);
+        if (ret < JPEG_ERR_OK) {
+            ESP_LOGE(TAG, "jpeg_enc_process_with_block failed: %d", (int)ret);
+            strip_encoder_close(&se);
+            return false;
+        }
+        if (out_len > 0) {
+            cb(arg, offset, se.outbuf, (size_t)out_len);
+            offset += out_len;
+        }
+    }
+    cb(arg, offset, NULL, 0);  // 结束信号
+
+    strip_encoder_close(&se);
+    return true;
+}
+
+// 内存中的整帧图像，按条带交给编码器
+typedef struct {
+    const uint8_t* src;
+    uint16_t width;
+    uint16_t height;
+    v4l2_pix_fmt_t format;
+} frame_source_t;
+
+static bool fill_strip_from_frame(void* arg, uint16_t y, uint16_t lines, uint8_t* strip) {
+    const frame_source_t* fs = (const frame_source_t*)arg;
+    int width = fs->width;
+
+    // V4L2 YUV422P (YUV422 Planar) -> 逐行重排为 YUYV (YCbYCr)
+    // 当前版本暂时不会出现 YUV422P 格式
+    if (fs->format == V4L2_PIX_FMT_YUV422P) [[unlikely]] {
+        const uint8_t* y_plane = fs->src;
+        const uint8_t* u_plane = y_plane + width * (int)fs->height;
+        const uint8_t* v_plane = u_plane + (width / 2) * (int)fs->height;
+        uint8_t* dst = strip;
+        for (int row = y; row < y + lines; row++) {
+            const uint8_t* y_row = y_plane + row * width;
+            const uint8_t* u_row = u_plane + row * (width / 2);
+            const uint8_t* v_row = v_plane + row * (width / 2);
+            for (int x = 0; x < width; x += 2) {
+                dst[0] = y_row[x + 0];
+                dst[1] = u_row[x / 2];
+                dst[2] = y_row[x + 1];
+                dst[3] = v_row[x / 2];
+                dst += 4;
+            }
+        }
+        return true;
+    }
+
+    int row_bytes = width * v4l2_bytes_per_pixel(fs->format);
+    memcpy(strip, fs->src + y * row_bytes, lines * row_bytes);
+    return true;
+}
+
+// 非回调版本的输出缓冲区，按需倍增
+typedef struct {
+    uint8_t* buf;
+    size_t len;
+    size_t cap;
+    bool failed;
+} jpeg_output_t;
+
+static size_t append_to_output(void* arg, size_t index, const void* data, size_t len) {
+    jpeg_output_t* out = (jpeg_output_t*)arg;
+    if (!data || len == 0 || out->failed)
+        return 0;
+    if (out->len + len > out->cap) {
+        size_t cap = out->cap ? out->cap : 16 * 1024;
+        while (cap < out->len + len)
+            cap *= 2;
+        uint8_t* buf = (uint8_t*)malloc_psram(cap);
+        if (!buf) {
+            ESP_LOGE(TAG, "alloc out buffer failed: %u", (unsigned)cap);
+            out->failed = true;
+            return 0;
+        }
+        if (out->buf) {
+            memcpy(buf, out->buf, out->len);
+            free(out->buf);
+        }
+        out->buf = buf;
+        out->cap = cap;
     }
-    ESP_LOGE(TAG, "unsupported format: 0x%08x", format);
-    if (out_size)
-        *out_size = 0;
-    return nullptr;
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+    return len;
 }
 
 #if CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
@@ -261,10 +346,7 @@ static uint8_t* convert_input_to_hw_encoder_buf(const uint8_t* src, uint16_t wid
         uint16_t* buf = (uint16_t*)malloc_psram(sz);
         if (!buf)
             return NULL;
-        const uint16_t* bsrc = (const uint16_t*)src;
-        for (int i = 0; i < sz / 2; i++) {
-            buf[i] = __builtin_bswap16(bsrc[i]);
-        }
+        pixel_swap16(src, buf, sz / 2);
         if (out_fmt)
             *out_fmt = JPEG_ENCODE_IN_FORMAT_YUV422;
         if (out_size)
@@ -350,77 +432,41 @@ static bool encode_with_hw_jpeg(const uint8_t* src, size_t src_len, uint16_t wid
 static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_t width, uint16_t height,
                                      v4l2_pix_fmt_t format, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len,
                                      jpg_out_cb cb, void* cb_arg) {
-    if (quality < 1)
-        quality = 1;
-    if (quality > 100)
-        quality = 100;
-
-    jpeg_pixel_format_t enc_src_type = JPEG_PIXEL_FORMAT_RGB888;
-    int enc_in_size = 0;
-    uint8_t* enc_in = convert_input_to_encoder_buf(src, width, height, format, &enc_src_type, &enc_in_size);
-    if (!enc_in) {
-        ESP_LOGE(TAG, "alloc/convert input failed");
-        return false;
-    }
-
-    jpeg_enc_config_t cfg = DEFAULT_JPEG_ENC_CONFIG();
-    cfg.width = width;
-    cfg.height = height;
-    cfg.src_type = enc_src_type;
-    cfg.subsampling = (enc_src_type == JPEG_PIXEL_FORMAT_GRAY) ? JPEG_SUBSAMPLE_GRAY : JPEG_SUBSAMPLE_420;
-    cfg.quality = quality;
-    cfg.rotate = JPEG_ROTATE_0D;
-    cfg.task_enable = false;
-
-    jpeg_enc_handle_t h = NULL;
-    jpeg_error_t ret = jpeg_enc_open(&cfg, &h);
-    if (ret != JPEG_ERR_OK) {
-        jpeg_free_align(enc_in);
-        ESP_LOGE(TAG, "jpeg_enc_open failed: %d", (int)ret);
-        return false;
-    }
-
-    // 估算输出缓冲区：宽高的 1.5 倍 + 64KB
-    size_t out_cap = (size_t)width * (size_t)height * 3 / 2 + 64 * 1024;
-    if (out_cap < 128 * 1024)
-        out_cap = 128 * 1024;
-    uint8_t* outbuf = (uint8_t*)malloc_psram(out_cap);
-    if (!outbuf) {
-        jpeg_enc_close(h);
-        jpeg_free_align(enc_in);
-        ESP_LOGE(TAG, "alloc out buffer failed");
+    // 按条带转换并编码，不再分配整帧的 YUYV 中间缓冲区
+    v4l2_pix_fmt_t strip_format = format == V4L2_PIX_FMT_YUV422P ? V4L2_PIX_FMT_YUYV : format;
+    int bpp = v4l2_bytes_per_pixel(strip_format);
+    if (bpp == 0) {
+        ESP_LOGE(TAG, "unsupported format: 0x%08x", format);
         return false;
     }
-
-    int out_len = 0;
-    ret = jpeg_enc_process(h, enc_in, enc_in_size, outbuf, (int)out_cap, &out_len);
-    jpeg_enc_close(h);
-    jpeg_free_align(enc_in);
-
-    if (ret != JPEG_ERR_OK) {
-        free(outbuf);
-        ESP_LOGE(TAG, "jpeg_enc_process failed: %d", (int)ret);
+    if (src_len < (size_t)width * height * bpp) {
+        ESP_LOGE(TAG, "source too small: %u < %ux%ux%d", (unsigned)src_len, width, height, bpp);
         return false;
     }
+    frame_source_t fs = {src, width, height, format};
 
     if (cb) {
-        cb(cb_arg, 0, outbuf, (size_t)out_len);
-        cb(cb_arg, 1, NULL, 0);  // 结束信号
-        free(outbuf);
         if (jpg_out)
             *jpg_out = NULL;
         if (jpg_out_len)
             *jpg_out_len = 0;
-        return true;
+        return image_to_jpeg_strips_cb(width, height, strip_format, quality, fill_strip_from_frame, &fs, cb, cb_arg);
+    }
+
+    jpeg_output_t out = {};
+    if (!image_to_jpeg_strips_cb(width, height, strip_format, quality, fill_strip_from_frame, &fs, append_to_output, &out) ||
+        out.failed) {
+        free(out.buf);
+        return false;
     }
 
     if (jpg_out && jpg_out_len) {
-        *jpg_out = outbuf;
-        *jpg_out_len = (size_t)out_len;
+        *jpg_out = out.buf;
+        *jpg_out_len = out.len;
         return true;
     }
 
-    free(outbuf);
+    free(out.buf);
     return true;
 }
 
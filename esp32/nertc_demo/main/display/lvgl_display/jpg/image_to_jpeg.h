@@ -19,6 +19,11 @@ extern "C" {
 // 返回: 实际处理的字节数
 typedef size_t (*jpg_out_cb)(void *arg, size_t index, const void *data, size_t len);
 
+// JPEG输入回调函数类型
+// arg: 用户自定义参数, y: 条带首行, lines: 需要填充的行数, strip: 按输入格式逐行写入的缓冲区
+// 返回: 填充成功返回 true，返回 false 则中止编码
+typedef bool (*jpg_strip_cb)(void *arg, uint16_t y, uint16_t lines, uint8_t *strip);
+
 /**
  * @brief 将图像格式高效转换为JPEG
  * 
@@ -63,6 +68,28 @@ bool image_to_jpeg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height
 bool image_to_jpeg_cb(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, 
                       v4l2_pix_fmt_t format, uint8_t quality, jpg_out_cb cb, void *arg);
 
+/**
+ * @brief 按条带拉取输入并编码为JPEG（回调版本）
+ *
+ * 编码器每次只向 fill 请求一个 MCU 行高的条带，转换后立即编码并通过 cb 输出，
+ * 不需要整帧的输入副本、YUYV 中间缓冲区和整帧大小的输出缓冲区：
+ * - 支持 GREY、YUYV、UYVY、RGB565、RGB565X、RGB24 输入
+ * - cb 的 index 为数据块在 JPEG 中的偏移，结束时以 data 为 NULL 调用一次
+ *
+ * @param width     图像宽度
+ * @param height    图像高度
+ * @param format    fill 写入的像素格式
+ * @param quality   JPEG质量 (1-100)
+ * @param fill      输入回调函数
+ * @param fill_arg  传递给输入回调函数的用户参数
+ * @param cb        输出回调函数
+ * @param arg       传递给输出回调函数的用户参数
+ *
+ * @return true 成功, false 失败
+ */
+bool image_to_jpeg_strips_cb(uint16_t width, uint16_t height, v4l2_pix_fmt_t format, uint8_t quality,
+                             jpg_strip_cb fill, void *fill_arg, jpg_out_cb cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
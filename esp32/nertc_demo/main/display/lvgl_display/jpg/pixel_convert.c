@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include "pixel_convert.h"
+
+static inline uint32_t swap16_pair(uint32_t w) {
+    return ((w & 0x00FF00FFu) << 8) | ((w >> 8) & 0x00FF00FFu);
+}
+
+void pixel_swap16(const void *src, void *dst, size_t count) {
+    const uint16_t *s16 = (const uint16_t *)src;
+    uint16_t *d16 = (uint16_t *)dst;
+
+    // 对齐到 4 字节后按字处理，每个字包含两个像素
+    if ((((uintptr_t)s16 ^ (uintptr_t)d16) & 3) == 0) {
+        if (((uintptr_t)s16 & 3) != 0 && count > 0) {
+            *d16++ = __builtin_bswap16(*s16++);
+            count--;
+        }
+        const uint32_t *s32 = (const uint32_t *)s16;
+        uint32_t *d32 = (uint32_t *)d16;
+        size_t words = count / 2;
+        size_t i = 0;
+        for (; i + 4 <= words; i += 4) {
+            uint32_t w0 = s32[i + 0];
+            uint32_t w1 = s32[i + 1];
+            uint32_t w2 = s32[i + 2];
+            uint32_t w3 = s32[i + 3];
+            d32[i + 0] = swap16_pair(w0);
+            d32[i + 1] = swap16_pair(w1);
+            d32[i + 2] = swap16_pair(w2);
+            d32[i + 3] = swap16_pair(w3);
+        }
+        for (; i < words; i++) {
+            d32[i] = swap16_pair(s32[i]);
+        }
+        s16 += words * 2;
+        d16 += words * 2;
+        count -= words * 2;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        d16[i] = __builtin_bswap16(s16[i]);
+    }
+}
+
+// 把 RGB565 的 G 分量移到高半字，R/B/G 之间留出空位，累加最多 16 个像素不会进位到相邻分量
+#define RGB565_SPREAD_MASK 0x07E0F81Fu
+
+static inline uint32_t rgb565_spread(uint16_t p) {
+    return (p | ((uint32_t)p << 16)) & RGB565_SPREAD_MASK;
+}
+
+static inline uint16_t rgb565_pack(uint32_t v) {
+    v &= RGB565_SPREAD_MASK;
+    return (uint16_t)(v | (v >> 16));
+}
+
+void pixel_rgb565_downscale_row(const uint8_t *src, size_t stride, uint16_t *dst, size_t out_pixels, int shift) {
+    if (shift <= 0) {
+        memcpy(dst, src, out_pixels * 2);
+        return;
+    }
+
+    const uint16_t *row0 = (const uint16_t *)src;
+    if (shift == 1) {
+        const uint16_t *row1 = (const uint16_t *)(src + stride);
+        for (size_t x = 0; x < out_pixels; x++) {
+            uint32_t sum = rgb565_spread(row0[2 * x]) + rgb565_spread(row0[2 * x + 1]) +
+                           rgb565_spread(row1[2 * x]) + rgb565_spread(row1[2 * x + 1]);
+            dst[x] = rgb565_pack(sum >> 2);
+        }
+        return;
+    }
+
+    int scale = 1 << shift;
+    int bits = shift * 2;
+    for (size_t x = 0; x < out_pixels; x++) {
+        if (shift == 2) {
+            uint32_t sum = 0;
+            for (int dy = 0; dy < scale; dy++) {
+                const uint16_t *p = (const uint16_t *)(src + dy * stride) + (x << shift);
+                sum += rgb565_spread(p[0]) + rgb565_spread(p[1]) + rgb565_spread(p[2]) + rgb565_spread(p[3]);
+            }
+            dst[x] = rgb565_pack(sum >> bits);
+            continue;
+        }
+
+        // 64 个像素的和会溢出分量间的空位，分别累加
+        uint32_t r = 0, g = 0, b = 0;
+        for (int dy = 0; dy < scale; dy++) {
+            const uint16_t *p = (const uint16_t *)(src + dy * stride) + (x << shift);
+            for (int dx = 0; dx < scale; dx++) {
+                r += p[dx] >> 11;
+                g += (p[dx] >> 5) & 0x3F;
+                b += p[dx] & 0x1F;
+            }
+        }
+        dst[x] = (uint16_t)(((r >> bits) << 11) | ((g >> bits) << 5) | (b >> bits));
+    }
+}
+
+// JFIF 全范围 BT.601，系数放大 256 倍，每组系数之和正好为 0 或 256
+#define YUV_Y(r, g, b) ((77 * (r) + 150 * (g) + 29 * (b) + 128) >> 8)
+
+static inline uint8_t clamp_u8(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+static inline void rgb565_unpack(uint16_t p, int *r, int *g, int *b) {
+    // 低位用高位补齐，使 0x1F 扩展为 0xFF
+    *r = ((p >> 8) & 0xF8) | (p >> 13);
+    *g = ((p >> 3) & 0xFC) | ((p >> 9) & 0x03);
+    *b = ((p << 3) & 0xF8) | ((p >> 2) & 0x07);
+}
+
+void pixel_rgb565_to_yuyv(const void *src, void *dst, size_t pixels, bool big_endian) {
+    const uint16_t *s = (const uint16_t *)src;
+    uint8_t *d = (uint8_t *)dst;
+    size_t pairs = pixels / 2;
+
+    for (size_t i = 0; i < pairs; i++) {
+        uint16_t p0 = s[2 * i];
+        uint16_t p1 = s[2 * i + 1];
+        if (big_endian) {
+            p0 = __builtin_bswap16(p0);
+            p1 = __builtin_bswap16(p1);
+        }
+        int r0, g0, b0, r1, g1, b1;
+        rgb565_unpack(p0, &r0, &g0, &b0);
+        rgb565_unpack(p1, &r1, &g1, &b1);
+
+        // 色度用两个像素之和计算，多右移一位即为平均值
+        int r = r0 + r1, g = g0 + g1, b = b0 + b1;
+        d[0] = (uint8_t)YUV_Y(r0, g0, b0);
+        d[1] = clamp_u8(((-43 * r - 85 * g + 128 * b + 256) >> 9) + 128);
+        d[2] = (uint8_t)YUV_Y(r1, g1, b1);
+        d[3] = clamp_u8(((128 * r - 107 * g - 21 * b + 256) >> 9) + 128);
+        d += 4;
+    }
+
+    if (pixels & 1) {
+        uint16_t p = s[pixels - 1];
+        if (big_endian) {
+            p = __builtin_bswap16(p);
+        }
+        int r, g, b;
+        rgb565_unpack(p, &r, &g, &b);
+        d[0] = (uint8_t)YUV_Y(r, g, b);
+        d[1] = clamp_u8(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+    }
+}
+
+static inline uint16_t yuv_to_rgb565(int y, int r_diff, int g_diff, int b_diff) {
+    int r = clamp_u8(y + r_diff);
+    int g = clamp_u8(y + g_diff);
+    int b = clamp_u8(y + b_diff);
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+void pixel_yuv422_to_rgb565(const void *src, uint16_t *dst, size_t pixels, bool uyvy) {
+    const uint8_t *s = (const uint8_t *)src;
+    // 每 4 字节一组，YUYV 为 Y0 U Y1 V，UYVY 为 U Y0 V Y1
+    int y0_at = uyvy ? 1 : 0;
+    int u_at = uyvy ? 0 : 1;
+    int r_diff = 0, g_diff = 0, b_diff = 0;
+
+    for (size_t i = 0; i + 1 < pixels; i += 2) {
+        int u = s[u_at] - 128;
+        int v = s[u_at + 2] - 128;
+        // 两个像素共用的色度偏移只算一次
+        r_diff = (359 * v + 128) >> 8;
+        g_diff = (-88 * u - 183 * v + 128) >> 8;
+        b_diff = (454 * u + 128) >> 8;
+        dst[i] = yuv_to_rgb565(s[y0_at], r_diff, g_diff, b_diff);
+        dst[i + 1] = yuv_to_rgb565(s[y0_at + 2], r_diff, g_diff, b_diff);
+        s += 4;
+    }
+
+    if (pixels & 1) {
+        dst[pixels - 1] = yuv_to_rgb565(s[y0_at], r_diff, g_diff, b_diff);
+    }
+}
@@ -0,0 +1,67 @@
+// pixel_convert.h - 摄像头与屏幕共用的像素转换内核
+// 按 32 位字一次处理两个像素，可移植 C 实现，不依赖具体芯片
+// 暂不提供 ESP32-S3 PIE 汇编版本：手写汇编无法在主机上验证，这里只有经过主机
+// 黄金向量测试 (test/display/pixel_convert_test.cc) 的可移植实现
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 交换每个 16 位像素的高低字节
+ *
+ * 用于 RGB565 与 RGB565X 互转，以及 UYVY 与 YUYV 互转（两者按 16 位看正好是字节交换）。
+ * src 与 dst 可以是同一块缓冲区。
+ *
+ * @param src     源数据
+ * @param dst     目标数据
+ * @param count   16 位像素个数
+ */
+void pixel_swap16(const void *src, void *dst, size_t count);
+
+/**
+ * @brief RGB565 按 2^shift 倍缩小一行
+ *
+ * 每个输出像素取 (1 << shift) x (1 << shift) 个源像素的平均值，像素为本机字节序。
+ *
+ * @param src         源图像中对应输出行的左上角
+ * @param stride      源图像每行字节数
+ * @param dst         输出行
+ * @param out_pixels  输出像素个数
+ * @param shift       缩小倍数的对数，0-3
+ */
+void pixel_rgb565_downscale_row(const uint8_t *src, size_t stride, uint16_t *dst, size_t out_pixels, int shift);
+
+/**
+ * @brief RGB565 转 YUYV (YUV422)
+ *
+ * 使用 JPEG (JFIF) 的全范围 BT.601 系数，每两个像素共用一组色度，取两者的平均值。
+ * 输出可以直接交给 JPEG 编码器的 YCbYCr 输入。
+ *
+ * @param src         RGB565 像素
+ * @param dst         YUYV 数据，pixels * 2 字节
+ * @param pixels      像素个数，应为偶数；为奇数时最后一个像素只写出 Y 和 U
+ * @param big_endian  源数据为 RGB565X (大端)
+ */
+void pixel_rgb565_to_yuyv(const void *src, void *dst, size_t pixels, bool big_endian);
+
+/**
+ * @brief YUYV 或 UYVY (YUV422) 转 RGB565
+ *
+ * 与 pixel_rgb565_to_yuyv 使用相同的全范围 BT.601 系数，输出为本机字节序的 RGB565。
+ *
+ * @param src     YUV422 数据，pixels * 2 字节
+ * @param dst     RGB565 像素
+ * @param pixels  像素个数，应为偶数；为奇数时最后一个像素使用前一组的色度
+ * @param uyvy    源数据为 UYVY 排列，否则为 YUYV
+ */
+void pixel_yuv422_to_rgb565(const void *src, uint16_t *dst, size_t pixels, bool uyvy);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,6 +3,7 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <font_awesome.h>
 
 #include "lvgl_display.h"
@@ -12,6 +13,7 @@
 #include "settings.h"
 #include "assets/lang_config.h"
 #include "jpg/image_to_jpeg.h"
+#include "jpg/pixel_convert.h"
 
 #define TAG "Display"
 
@@ -78,6 +80,7 @@ void LvglDisplay::SetStatus(const char* status) {
     lv_obj_remove_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
 
+    status_clock_.clear();
     last_status_update_time_ = std::chrono::system_clock::now();
 }
 
@@ -98,94 +101,80 @@ void LvglDisplay::ShowNotification(const char* notification, int duration_ms) {
     ESP_ERROR_CHECK(esp_timer_start_once(notification_timer_, duration_ms * 1000));
 }
 
+// Battery and network are read again when their source reports a change, the periodic
+// reads only catch sources that don't report, on 4G boards the network icon costs AT commands
+#define STATUS_BAR_BATTERY_INTERVAL 10
+#define STATUS_BAR_NETWORK_INTERVAL 30
+
 void LvglDisplay::UpdateStatusBar(bool update_all) {
     auto& app = Application::GetInstance();
     auto& board = Board::GetInstance();
     auto codec = board.GetAudioCodec();
-
-    // Update mute icon
-    {
-        DisplayLockGuard lock(this);
-        if (mute_label_ == nullptr) {
-            return;
-        }
-
-        // Update icon if mute state changes
-        if (codec->output_volume() == 0 && !muted_) {
-            muted_ = true;
-            lv_label_set_text(mute_label_, FONT_AWESOME_VOLUME_XMARK);
-        } else if (codec->output_volume() > 0 && muted_) {
-            muted_ = false;
-            lv_label_set_text(mute_label_, "");
-        }
+    if (mute_label_ == nullptr) {
+        return;
     }
 
-    // Update time
-    if (app.GetDeviceState() == kDeviceStateIdle) {
-        if (last_status_update_time_ + std::chrono::seconds(10) < std::chrono::system_clock::now()) {
-            // Set status to clock "HH:MM"
-            time_t now = time(NULL);
-            struct tm* tm = localtime(&now);
-            // Check if the we have already set the time
-            if (tm->tm_year >= 2025 - 1900) {
-                char time_str[16];
-                strftime(time_str, sizeof(time_str), "%H:%M", tm);
-                SetStatus(time_str);
-            } else {
-                static bool first_time = true;
-                if (first_time) {
-                    first_time = false;
-                    ESP_LOGW(TAG, "System time is not set, tm_year: %d", tm->tm_year);
-                }
-            }
-        }
+    uint32_t changed = status_changed_.exchange(0);
+    int ticks = status_bar_ticks_++;
+    if (update_all || ticks % STATUS_BAR_BATTERY_INTERVAL == 0) {
+        changed |= kStatusBarBattery;
     }
+    if (update_all || ticks % STATUS_BAR_NETWORK_INTERVAL == 0) {
+        changed |= kStatusBarNetwork;
+    }
+
+    // Read the sources first, without holding the display lock
+    bool muted = codec->output_volume() == 0;
 
-    esp_pm_lock_acquire(pm_lock_);
-    // Update battery icon
-    int battery_level;
-    bool charging, discharging;
-    const char* icon = nullptr;
-    if (board.GetBatteryLevel(battery_level, charging, discharging)) {
-        if (charging) {
-            icon = FONT_AWESOME_BATTERY_BOLT;
+    std::string clock;
+    if (app.GetDeviceState() == kDeviceStateIdle &&
+        last_status_update_time_ + std::chrono::seconds(10) < std::chrono::system_clock::now()) {
+        // Set status to clock "HH:MM"
+        time_t now = time(NULL);
+        struct tm* tm = localtime(&now);
+        // Check if the we have already set the time
+        if (tm->tm_year >= 2025 - 1900) {
+            char time_str[16];
+            strftime(time_str, sizeof(time_str), "%H:%M", tm);
+            clock = time_str;
         } else {
-            const char* levels[] = {
-                FONT_AWESOME_BATTERY_EMPTY, // 0-19%
-                FONT_AWESOME_BATTERY_QUARTER,    // 20-39%
-                FONT_AWESOME_BATTERY_HALF,    // 40-59%
-                FONT_AWESOME_BATTERY_THREE_QUARTERS,    // 60-79%
-                FONT_AWESOME_BATTERY_FULL, // 80-99%
-                FONT_AWESOME_BATTERY_FULL, // 100%
-            };
-            icon = levels[battery_level / 20];
-        }
-        DisplayLockGuard lock(this);
-        if (battery_label_ != nullptr && battery_icon_ != icon) {
-            battery_icon_ = icon;
-            lv_label_set_text(battery_label_, battery_icon_);
+            static bool first_time = true;
+            if (first_time) {
+                first_time = false;
+                ESP_LOGW(TAG, "System time is not set, tm_year: %d", tm->tm_year);
+            }
         }
+    }
 
-        if (low_battery_popup_ != nullptr) {
-            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging) {
-                if (lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // Show if low battery popup is hidden
-                    lv_obj_remove_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                    app.PlaySound(Lang::Sounds::OGG_LOW_BATTERY);
-                }
+    const char* battery_icon = battery_icon_;
+    bool low_battery = low_battery_;
+    const char* network_icon = network_icon_;
+    if (changed != 0) {
+        esp_pm_lock_acquire(pm_lock_);
+    }
+    if (changed & kStatusBarBattery) {
+        int battery_level;
+        bool charging, discharging;
+        if (board.GetBatteryLevel(battery_level, charging, discharging)) {
+            if (charging) {
+                battery_icon = FONT_AWESOME_BATTERY_BOLT;
             } else {
-                // Hide the low battery popup when the battery is not empty
-                if (!lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // Hide if low battery popup is shown
-                    lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                }
+                const char* levels[] = {
+                    FONT_AWESOME_BATTERY_EMPTY, // 0-19%
+                    FONT_AWESOME_BATTERY_QUARTER,    // 20-39%
+                    FONT_AWESOME_BATTERY_HALF,    // 40-59%
+                    FONT_AWESOME_BATTERY_THREE_QUARTERS,    // 60-79%
+                    FONT_AWESOME_BATTERY_FULL, // 80-99%
+                    FONT_AWESOME_BATTERY_FULL, // 100%
+                };
+                battery_icon = levels[battery_level / 20];
             }
+            low_battery = strcmp(battery_icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging;
         }
     }
-
-    // Update network icon every 10 seconds
-    static int seconds_counter = 0;
-    if (update_all || seconds_counter++ % 10 == 0) {
+    if (changed & kStatusBarNetwork) {
         // Don't read 4G network status during firmware upgrade to avoid occupying UART resources
-        auto device_state = Application::GetInstance().GetDeviceState();
+        auto device_state = app.GetDeviceState();
         static const std::vector<DeviceState> allowed_states = {
             kDeviceStateIdle,
             kDeviceStateStarting,
@@ -194,16 +183,71 @@ void LvglDisplay::UpdateStatusBar(bool update_all) {
             kDeviceStateActivating,
         };
         if (std::find(allowed_states.begin(), allowed_states.end(), device_state) != allowed_states.end()) {
-            icon = board.GetNetworkStateIcon();
-            if (network_label_ != nullptr && icon != nullptr && network_icon_ != icon) {
-                DisplayLockGuard lock(this);
-                network_icon_ = icon;
+            const char* icon = board.GetNetworkStateIcon();
+            if (icon != nullptr) {
+                network_icon = icon;
+            }
+        } else {
+            // Keep it pending until the state allows reading the network
+            status_changed_.fetch_or(kStatusBarNetwork);
+        }
+    }
+    if (changed != 0) {
+        esp_pm_lock_release(pm_lock_);
+    }
+
+    bool update_clock = !clock.empty() && clock != status_clock_;
+    if (muted == muted_ && battery_icon == battery_icon_ && low_battery == low_battery_ &&
+        network_icon == network_icon_ && !update_clock) {
+        return;
+    }
+
+    // Apply everything that changed under a single display lock
+    bool play_low_battery = false;
+    {
+        DisplayLockGuard lock(this);
+        if (muted != muted_) {
+            muted_ = muted;
+            lv_label_set_text(mute_label_, muted_ ? FONT_AWESOME_VOLUME_XMARK : "");
+        }
+
+        if (battery_icon != battery_icon_) {
+            battery_icon_ = battery_icon;
+            if (battery_label_ != nullptr) {
+                lv_label_set_text(battery_label_, battery_icon_);
+            }
+        }
+
+        if (low_battery != low_battery_) {
+            low_battery_ = low_battery;
+            if (low_battery_popup_ != nullptr) {
+                if (low_battery_) {
+                    lv_obj_remove_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+                    play_low_battery = true;
+                } else {
+                    lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+                }
+            }
+        }
+
+        if (network_icon != network_icon_) {
+            network_icon_ = network_icon;
+            if (network_label_ != nullptr) {
                 lv_label_set_text(network_label_, network_icon_);
             }
         }
+
+        if (update_clock && status_label_ != nullptr) {
+            status_clock_ = clock;
+            lv_label_set_text(status_label_, status_clock_.c_str());
+            lv_obj_remove_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
+            lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
+        }
     }
 
-    esp_pm_lock_release(pm_lock_);
+    if (play_low_battery) {
+        app.PlaySound(Lang::Sounds::OGG_LOW_BATTERY);
+    }
 }
 
 void LvglDisplay::SetPreviewImage(std::unique_ptr<LvglImage> image) {
@@ -219,36 +263,105 @@ void LvglDisplay::SetPowerSaveMode(bool on) {
     }
 }
 
-bool LvglDisplay::SnapshotToJpeg(std::string& jpeg_data, int quality) {
 #if CONFIG_LV_USE_SNAPSHOT
-    DisplayLockGuard lock(this);
+// Source of the strips encoded by SnapshotToJpeg
+struct SnapshotSource {
+    const lv_draw_buf_t* buffer;
+    lv_area_t area;
+    int shift;  // Output pixels are averages of (1 << shift) squared source pixels
+    uint16_t width;
+};
+
+static bool FillSnapshotStrip(void* arg, uint16_t y, uint16_t lines, uint8_t* strip) {
+    auto source = static_cast<const SnapshotSource*>(arg);
+    uint32_t stride = source->buffer->header.stride;
+    uint16_t* out = reinterpret_cast<uint16_t*>(strip);
+    for (int row = y; row < y + lines; row++) {
+        int src_y = source->area.y1 + (row << source->shift);
+        const uint8_t* src_row = source->buffer->data + src_y * stride + source->area.x1 * 2;
+        pixel_rgb565_downscale_row(src_row, stride, out, source->width, source->shift);
+        out += source->width;
+    }
+    return true;
+}
+
+static size_t AppendJpegData(void* arg, size_t index, const void* data, size_t len) {
+    std::string* output = static_cast<std::string*>(arg);
+    if (data && len > 0) {
+        output->append(static_cast<const char*>(data), len);
+    }
+    return len;
+}
+#endif
 
-    lv_obj_t* screen = lv_screen_active();
-    lv_draw_buf_t* draw_buffer = lv_snapshot_take(screen, LV_COLOR_FORMAT_RGB565);
+bool LvglDisplay::SnapshotToJpeg(std::string& jpeg_data, int quality, const lv_area_t* area, int downscale) {
+#if CONFIG_LV_USE_SNAPSHOT
+    lv_draw_buf_t* draw_buffer = nullptr;
+    {
+        DisplayLockGuard lock(this);
+        lv_obj_t* screen = lv_screen_active();
+        draw_buffer = lv_snapshot_take(screen, LV_COLOR_FORMAT_RGB565);
+    }
     if (draw_buffer == nullptr) {
         ESP_LOGE(TAG, "Failed to take snapshot, draw_buffer is nullptr");
         return false;
     }
 
-    // swap bytes
-    uint16_t* data = (uint16_t*)draw_buffer->data;
-    size_t pixel_count = draw_buffer->data_size / 2;
-    for (size_t i = 0; i < pixel_count; i++) {
-        data[i] = __builtin_bswap16(data[i]);
+    SnapshotSource source = {};
+    source.buffer = draw_buffer;
+    source.shift = std::clamp(downscale, 0, 3);
+    source.area = { 0, 0, (int32_t)draw_buffer->header.w - 1, (int32_t)draw_buffer->header.h - 1 };
+    if (area != nullptr) {
+        source.area.x1 = std::max(source.area.x1, area->x1);
+        source.area.y1 = std::max(source.area.y1, area->y1);
+        source.area.x2 = std::min(source.area.x2, area->x2);
+        source.area.y2 = std::min(source.area.y2, area->y2);
+    }
+    if (source.area.x2 < source.area.x1 || source.area.y2 < source.area.y1) {
+        ESP_LOGE(TAG, "Snapshot area is outside of the screen");
+        lv_draw_buf_destroy(draw_buffer);
+        return false;
+    }
+    source.width = lv_area_get_width(&source.area) >> source.shift;
+    uint16_t height = lv_area_get_height(&source.area) >> source.shift;
+    if (source.width == 0 || height == 0) {
+        ESP_LOGE(TAG, "Snapshot area is too small");
+        lv_draw_buf_destroy(draw_buffer);
+        return false;
     }
 
     // Clear output string and use callback version to avoid pre-allocating large memory blocks
     jpeg_data.clear();
 
-    // Use callback-based JPEG encoder to further save memory
-    bool ret = image_to_jpeg_cb((uint8_t*)draw_buffer->data, draw_buffer->data_size, draw_buffer->header.w, draw_buffer->header.h, V4L2_PIX_FMT_RGB565, quality,
-        [](void *arg, size_t index, const void *data, size_t len) -> size_t {
-        std::string* output = static_cast<std::string*>(arg);
-        if (data && len > 0) {
-            output->append(static_cast<const char*>(data), len);
+#if CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
+    // The hardware encoder takes a whole frame of byte-swapped RGB565. A full size snapshot is swapped
+    // in place, a cropped or scaled one is assembled in a buffer of its own first
+    size_t frame_size = (size_t)source.width * height * 2;
+    uint8_t* frame = draw_buffer->data;
+    bool whole_buffer = source.shift == 0 && source.width == draw_buffer->header.w &&
+        height == draw_buffer->header.h && draw_buffer->header.stride == (uint32_t)source.width * 2;
+    if (!whole_buffer) {
+        frame = (uint8_t*)malloc(frame_size);
+        if (frame == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes for the snapshot", (unsigned)frame_size);
+            lv_draw_buf_destroy(draw_buffer);
+            return false;
         }
-        return len;
-    }, &jpeg_data);
+        FillSnapshotStrip(&source, 0, height, frame);
+    }
+    pixel_swap16(frame, frame, frame_size / 2);
+    // Falls back to the software encoder if the hardware one fails
+    bool ret = image_to_jpeg_cb(frame, frame_size, source.width, height, V4L2_PIX_FMT_RGB565, quality,
+        AppendJpegData, &jpeg_data);
+    if (!whole_buffer) {
+        free(frame);
+    }
+#else
+    // Strips are cropped and scaled straight from the snapshot while encoding. The snapshot is in
+    // native byte order, which pixel_rgb565_to_yuyv reads as RGB565, so no byte swap pass is needed
+    bool ret = image_to_jpeg_strips_cb(source.width, height, V4L2_PIX_FMT_RGB565, quality, FillSnapshotStrip, &source,
+        AppendJpegData, &jpeg_data);
+#endif
     if (!ret) {
         ESP_LOGE(TAG, "Failed to convert image to JPEG");
     }
@@ -23,7 +23,8 @@ public:
     virtual void SetPreviewImage(std::unique_ptr<LvglImage> image);
     virtual void UpdateStatusBar(bool update_all = false);
     virtual void SetPowerSaveMode(bool on);
-    virtual bool SnapshotToJpeg(std::string& jpeg_data, int quality = 80);
+    // Encodes the screen, or the given area of it, scaled down by 1 << downscale (at most 8x)
+    virtual bool SnapshotToJpeg(std::string& jpeg_data, int quality = 80, const lv_area_t* area = nullptr, int downscale = 0);
 
 protected:
     esp_pm_lock_handle_t pm_lock_ = nullptr;
@@ -40,6 +41,9 @@ protected:
     const char* battery_icon_ = nullptr;
     const char* network_icon_ = nullptr;
     bool muted_ = false;
+    bool low_battery_ = false;
+    std::string status_clock_;  // Clock text last written to status_label_, empty once SetStatus overrides it
+    int status_bar_ticks_ = 0;
 
     std::chrono::system_clock::time_point last_status_update_time_;
     esp_timer_handle_t notification_timer_ = nullptr;
@@ -4,6 +4,7 @@
 #include "lvgl_font.h"
 
 #include <string>
+#include <cstring>
 #include <algorithm>
 
 #include <esp_log.h>
@@ -19,7 +20,7 @@ LV_FONT_DECLARE(font_awesome_30_1);
 
 OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
     int width, int height, bool mirror_x, bool mirror_y)
-    : panel_io_(panel_io), panel_(panel) {
+    : panel_io_(panel_io), panel_(panel), dirty_panel_(panel, width, height) {
     width_ = width;
     height_ = height;
 
@@ -48,7 +49,7 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
     ESP_LOGI(TAG, "Adding OLED display");
     const lvgl_port_display_cfg_t display_cfg = {
         .io_handle = panel_io_,
-        .panel_handle = panel_,
+        .panel_handle = dirty_panel_.handle(),
         .control_handle = nullptr,
         .buffer_size = static_cast<uint32_t>(width_ * height_),
         .double_buffer = false,
@@ -75,6 +76,7 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
         ESP_LOGE(TAG, "Failed to add display");
         return;
     }
+    dirty_panel_.OnFlushSkipped([this]() { lv_display_flush_ready(display_); });
 
     if (height_ == 64) {
         SetupUI_128x64();
@@ -2,11 +2,11 @@
 #define OLED_DISPLAY_H
 
 #include "lvgl_display.h"
+#include "dirty_tracking_panel.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 
-
 class OledDisplay : public LvglDisplay {
 private:
     esp_lcd_panel_io_handle_t panel_io_ = nullptr;
@@ -22,6 +22,9 @@ private:
     lv_obj_t *emotion_label_ = nullptr;
     lv_obj_t* chat_message_label_ = nullptr;
 
+    // Panel handed to LVGL, it forwards to panel_ and skips columns that did not change
+    DirtyTrackingPanel dirty_panel_;
+
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
 
@@ -35,6 +38,8 @@ public:
     virtual void SetChatMessage(const char* role, const char* content) override;
     virtual void SetEmotion(const char* emotion) override;
     virtual void SetTheme(Theme* theme) override;
+
+    const OledFlushStats& flush_stats() const { return dirty_panel_.stats(); }
 };
 
 #endif // OLED_DISPLAY_H
@@ -374,17 +374,32 @@ void McpServer::AddUserOnlyTools() {
             });
 
 #if CONFIG_LV_USE_SNAPSHOT
-        AddUserOnlyTool("self.screen.snapshot", "Snapshot the screen and upload it to a specific URL",
+        AddUserOnlyTool("self.screen.snapshot", "Snapshot the screen and upload it to a specific URL.\n"
+            "Args:\n"
+            "  `x`, `y`, `width`, `height`: Area of the screen to capture, a width or height of 0 extends it to the screen edge\n"
+            "  `downscale`: Shrink the image by 2 to the power of this value (0-3)",
             PropertyList({
                 Property("url", kPropertyTypeString),
-                Property("quality", kPropertyTypeInteger, 80, 1, 100)
+                Property("quality", kPropertyTypeInteger, 80, 1, 100),
+                Property("x", kPropertyTypeInteger, 0, 0, 4095),
+                Property("y", kPropertyTypeInteger, 0, 0, 4095),
+                Property("width", kPropertyTypeInteger, 0, 0, 4096),
+                Property("height", kPropertyTypeInteger, 0, 0, 4096),
+                Property("downscale", kPropertyTypeInteger, 0, 0, 3)
             }),
             [display](const PropertyList& properties) -> ReturnValue {
                 auto url = properties["url"].value<std::string>();
                 auto quality = properties["quality"].value<int>();
+                auto width = properties["width"].value<int>();
+                auto height = properties["height"].value<int>();
+                lv_area_t area;
+                area.x1 = properties["x"].value<int>();
+                area.y1 = properties["y"].value<int>();
+                area.x2 = width > 0 ? area.x1 + width - 1 : display->width() - 1;
+                area.y2 = height > 0 ? area.y1 + height - 1 : display->height() - 1;
 
                 std::string jpeg_data;
-                if (!display->SnapshotToJpeg(jpeg_data, quality)) {
+                if (!display->SnapshotToJpeg(jpeg_data, quality, &area, properties["downscale"].value<int>())) {
                     throw std::runtime_error("Failed to snapshot screen");
                 }
 
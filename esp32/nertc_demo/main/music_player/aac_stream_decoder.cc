@@ -0,0 +1,101 @@
+#include "aac_stream_decoder.h"
+
+#include <esp_log.h>
+#include <mutex>
+#include "esp_audio_dec_default.h"
+#include "esp_audio_simple_dec_default.h"
+
+#define TAG "AAC_STREAM_DECODER"
+
+// 一帧 HE-AAC 立体声为 2048 x 2 个 16 位采样，不够时按解码器要求扩大
+#define AAC_PCM_BUFFER_SIZE (2048 * 2 * 2)
+
+AacStreamDecoder::~AacStreamDecoder()
+{
+    if (decoder_ != nullptr)
+    {
+        esp_audio_simple_dec_close(decoder_);
+    }
+}
+
+bool AacStreamDecoder::Initialize()
+{
+    // 本地播放器也会注册，重复注册不影响使用；不同线程可能同时创建解码器
+    static std::once_flag registered;
+    std::call_once(registered, []
+    {
+        esp_audio_dec_register_default();
+        esp_audio_simple_dec_register_default();
+    });
+
+    esp_audio_simple_dec_cfg_t cfg = {};
+    cfg.dec_type = m4a_ ? ESP_AUDIO_SIMPLE_DEC_TYPE_M4A : ESP_AUDIO_SIMPLE_DEC_TYPE_AAC;
+    esp_audio_err_t ret = esp_audio_simple_dec_open(&cfg, &decoder_);
+    if (ret != ESP_AUDIO_ERR_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open %s decoder: %d", name(), ret);
+        decoder_ = nullptr;
+        return false;
+    }
+    pcm_.resize(AAC_PCM_BUFFER_SIZE);
+    return true;
+}
+
+DecodeResult AacStreamDecoder::DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame)
+{
+    esp_audio_simple_dec_raw_t raw = {};
+    raw.buffer = (uint8_t*)data;
+    raw.len = len;
+    raw.eos = eos;
+    esp_audio_simple_dec_out_t out = {};
+    out.buffer = pcm_.data();
+    out.len = pcm_.size();
+
+    esp_audio_err_t ret = esp_audio_simple_dec_process(decoder_, &raw, &out);
+    consumed = raw.consumed;
+    if (ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH)
+    {
+        // 扩大输出缓冲区后重新解码同一帧，此时的 raw.consumed 不可信，不能推进读位置
+        consumed = 0;
+        ESP_LOGI(TAG, "Growing PCM buffer to %u bytes", (unsigned int)out.needed_size);
+        pcm_.resize(out.needed_size);
+        return DecodeResult::kSkipped;
+    }
+    if (ret != ESP_AUDIO_ERR_OK)
+    {
+        ESP_LOGW(TAG, "%s decode failed with error: %d", name(), ret);
+        if (m4a_)
+        {
+            // M4A 依赖 moov 中的索引，出错后无法重新同步
+            return DecodeResult::kFatal;
+        }
+        // ADTS 跳过一个字节后重新查找帧头
+        if (consumed == 0)
+        {
+            consumed = 1;
+        }
+        return DecodeResult::kError;
+    }
+    if (out.decoded_size == 0)
+    {
+        return consumed > 0 ? DecodeResult::kSkipped : DecodeResult::kNeedMoreData;
+    }
+
+    if (!has_info_)
+    {
+        esp_audio_simple_dec_get_info(decoder_, &info_);
+        if (info_.bits_per_sample != 16 || info_.channel == 0)
+        {
+            ESP_LOGE(TAG, "Unsupported output: %d bits, %d channels", info_.bits_per_sample, info_.channel);
+            return DecodeResult::kFatal;
+        }
+        has_info_ = true;
+    }
+    frame.pcm = (const int16_t*)pcm_.data();
+    frame.samples = out.decoded_size / 2 / info_.channel;
+    frame.sample_rate = info_.sample_rate;
+    frame.channels = info_.channel;
+    frame.bitrate = info_.bitrate;
+    frame.offset = 0;
+    return DecodeResult::kFrame;
+}
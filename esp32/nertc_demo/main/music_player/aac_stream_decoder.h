@@ -0,0 +1,26 @@
+#ifndef AAC_STREAM_DECODER_H
+#define AAC_STREAM_DECODER_H
+#include "stream_decoder.h"
+#include <vector>
+
+#include "esp_audio_simple_dec.h"
+
+// AAC-LC/HE-AAC 解码，使用 esp_audio_codec 的 simple decoder 解析 ADTS 或 M4A 封装
+class AacStreamDecoder : public StreamDecoder {
+public:
+    explicit AacStreamDecoder(bool m4a) : m4a_(m4a) {}
+    ~AacStreamDecoder() override;
+    const char* name() const override { return m4a_ ? "m4a" : "aac"; }
+    bool Initialize() override;
+
+protected:
+    DecodeResult DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame) override;
+
+private:
+    bool m4a_;
+    esp_audio_simple_dec_handle_t decoder_ = nullptr;
+    std::vector<uint8_t> pcm_;
+    esp_audio_simple_dec_info_t info_ = {};
+    bool has_info_ = false;
+};
+#endif
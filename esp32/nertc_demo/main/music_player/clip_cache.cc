@@ -0,0 +1,177 @@
+#include "clip_cache.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <cstring>
+
+#define TAG "CLIP_CACHE"
+
+// 新鲜期内的条目直接使用，不再向服务器确认
+#define CLIP_CACHE_FRESH_SECONDS 600
+
+ClipBuffer::ClipBuffer(size_t capacity)
+{
+    data_ = (uint8_t *)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM);
+    if (data_ == nullptr)
+    {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes", (unsigned int)capacity);
+        return;
+    }
+    capacity_ = capacity;
+}
+
+ClipBuffer::~ClipBuffer()
+{
+    if (data_ != nullptr)
+    {
+        heap_caps_free(data_);
+    }
+}
+
+bool ClipBuffer::Append(const void *data, size_t len)
+{
+    if (data_ == nullptr || len > capacity_ - size_)
+    {
+        return false;
+    }
+    memcpy(data_ + size_, data, len);
+    size_ += len;
+    return true;
+}
+
+void ClipBuffer::Shrink()
+{
+    if (data_ == nullptr || size_ == capacity_ || size_ == 0)
+    {
+        return;
+    }
+    uint8_t *data = (uint8_t *)heap_caps_realloc(data_, size_, MALLOC_CAP_SPIRAM);
+    if (data != nullptr)
+    {
+        data_ = data;
+        capacity_ = size_;
+    }
+}
+
+ClipCache::ClipCache(size_t budget, int pcm_seconds) : budget_(budget), pcm_seconds_(pcm_seconds)
+{
+}
+
+std::shared_ptr<const ClipCacheEntry> ClipCache::Find(const std::string &url, bool &fresh)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    fresh = false;
+    auto it = index_.find(url);
+    if (it == index_.end())
+    {
+        stats_.misses++;
+        return nullptr;
+    }
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    fresh = esp_timer_get_time() - it->second->validated_us < (int64_t)CLIP_CACHE_FRESH_SECONDS * 1000 * 1000;
+    return it->second->entry;
+}
+
+void ClipCache::MarkValidated(const std::string &url)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(url);
+    if (it != index_.end())
+    {
+        it->second->validated_us = esp_timer_get_time();
+        stats_.not_modified++;
+    }
+}
+
+void ClipCache::Put(const std::string &url, const std::string &etag, std::unique_ptr<ClipBuffer> data)
+{
+    if (!data || !data->valid() || data->capacity() > max_entry_size())
+    {
+        return;
+    }
+    auto entry = std::make_shared<ClipCacheEntry>();
+    entry->url = url;
+    entry->etag = etag;
+    entry->data = std::move(data);
+    Insert(std::move(entry));
+}
+
+void ClipCache::UpgradeToPcm(const std::string &url, std::unique_ptr<ClipBuffer> pcm, int sample_rate, int channels)
+{
+    pcm->Shrink();
+    if (!pcm->valid() || pcm->capacity() > max_entry_size())
+    {
+        return;
+    }
+    auto entry = std::make_shared<ClipCacheEntry>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(url);
+        if (it == index_.end() || it->second->entry->is_pcm())
+        {
+            return;
+        }
+        entry->etag = it->second->entry->etag;
+    }
+    entry->url = url;
+    entry->data = std::move(pcm);
+    entry->sample_rate = sample_rate;
+    entry->channels = channels;
+    Insert(std::move(entry));
+}
+
+void ClipCache::Remove(const std::string &url)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(url);
+    if (it != index_.end())
+    {
+        RemoveLocked(it->second);
+    }
+}
+
+// 替换同一地址的旧条目，再从最久未用的开始淘汰直到不超出容量
+void ClipCache::Insert(std::shared_ptr<const ClipCacheEntry> entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(entry->url);
+    if (it != index_.end())
+    {
+        RemoveLocked(it->second);
+    }
+    size_t size = entry->data->capacity();
+    while (used_ + size > budget_ && !lru_.empty())
+    {
+        ESP_LOGI(TAG, "Evicting %s", lru_.back().entry->url.c_str());
+        RemoveLocked(std::prev(lru_.end()));
+        stats_.evictions++;
+    }
+    ESP_LOGI(TAG, "Cached %u bytes of %s for %s", (unsigned int)size, entry->is_pcm() ? "PCM" : "data",
+             entry->url.c_str());
+    lru_.push_front({entry, esp_timer_get_time()});
+    index_[entry->url] = lru_.begin();
+    used_ += size;
+}
+
+void ClipCache::RemoveLocked(NodeList::iterator it)
+{
+    used_ -= it->entry->data->capacity();
+    index_.erase(it->entry->url);
+    lru_.erase(it);
+}
+
+ClipCacheStats ClipCache::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ClipCache::LogStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ESP_LOGI(TAG, "%u entries, %u/%u bytes, hits %u, misses %u, not modified %u, evictions %u",
+             (unsigned int)lru_.size(), (unsigned int)used_, (unsigned int)budget_, (unsigned int)stats_.hits,
+             (unsigned int)stats_.misses, (unsigned int)stats_.not_modified, (unsigned int)stats_.evictions);
+}
@@ -0,0 +1,92 @@
+#ifndef CLIP_CACHE_H
+#define CLIP_CACHE_H
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// PSRAM 中容量固定的一块数据
+class ClipBuffer {
+public:
+    explicit ClipBuffer(size_t capacity);
+    ~ClipBuffer();
+    ClipBuffer(const ClipBuffer&) = delete;
+    ClipBuffer& operator=(const ClipBuffer&) = delete;
+
+    bool valid() const { return data_ != nullptr; }
+    // 超出容量时不写入并返回 false
+    bool Append(const void* data, size_t len);
+    // 释放未用到的容量
+    void Shrink();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+struct ClipCacheEntry {
+    std::string url;
+    std::string etag;
+    std::unique_ptr<ClipBuffer> data;   // 下载的原始数据，或 sample_rate > 0 时为解码后的 PCM
+    int sample_rate = 0;
+    int channels = 0;
+    bool is_pcm() const { return sample_rate > 0; }
+};
+
+struct ClipCacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t not_modified = 0;      // 重新验证后内容未变
+    uint32_t evictions = 0;
+};
+
+// 短音频的 LRU 缓存，按 URL 查找，用 ETag 重新验证
+// 超过新鲜期的条目需要先用 If-None-Match 请求确认，无法连网时仍然使用旧数据
+class ClipCache {
+public:
+    // budget 为 0 时缓存关闭，单个条目最多占用四分之一的容量
+    ClipCache(size_t budget, int pcm_seconds);
+
+    bool enabled() const { return budget_ > 0; }
+    size_t max_entry_size() const { return budget_ / 4; }
+    // 解码后的 PCM 最多保存的时长，超过时只缓存原始数据
+    int pcm_seconds() const { return pcm_seconds_; }
+
+    // 返回的条目在使用期间不会被释放，fresh 表示在新鲜期内，可以不经验证直接使用
+    std::shared_ptr<const ClipCacheEntry> Find(const std::string& url, bool& fresh);
+    void MarkValidated(const std::string& url);
+    void Put(const std::string& url, const std::string& etag, std::unique_ptr<ClipBuffer> data);
+    // 把已缓存的原始数据替换成解码后的 PCM，条目不存在时忽略
+    void UpgradeToPcm(const std::string& url, std::unique_ptr<ClipBuffer> pcm, int sample_rate, int channels);
+    void Remove(const std::string& url);
+
+    ClipCacheStats stats();
+    void LogStats();
+
+private:
+    struct Node {
+        std::shared_ptr<const ClipCacheEntry> entry;
+        int64_t validated_us = 0;
+    };
+    using NodeList = std::list<Node>;
+
+    void Insert(std::shared_ptr<const ClipCacheEntry> entry);
+    void RemoveLocked(NodeList::iterator it);
+
+    size_t budget_;
+    int pcm_seconds_;
+    size_t used_ = 0;
+    std::mutex mutex_;
+    NodeList lru_;                                                  // 最近使用的在前
+    std::unordered_map<std::string, NodeList::iterator> index_;
+    ClipCacheStats stats_;
+};
+#endif
@@ -0,0 +1,729 @@
+#include "local_music_library.h"
+
+#include <esp_log.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "mp3_stream_info.h"
+
+#define TAG "LOCAL_MUSIC_LIBRARY"
+
+#define INDEX_FILE_NAME ".music_index"
+#define INDEX_HEADER "# music index v1"
+#define INDEX_LINE_MAX 1024
+// 子目录最多递归的层数
+#define SCAN_MAX_DEPTH 3
+// 只读取这个长度以内的 ID3 文本帧，封面等大帧直接跳过
+#define ID3_TEXT_FRAME_MAX 512
+// 在 ID3 标签之后查找第一帧 MP3 帧头的范围
+#define MP3_PROBE_SIZE 4096
+// 模糊查找结果的最低相似度
+#define SEARCH_MIN_SCORE 0.35f
+
+static const char* kSupportedExtensions[] = {".mp3", ".aac", ".m4a", ".flac", ".wav", ".ogg", ".opus"};
+
+static uint32_t ReadBe32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t ReadSynchsafe32(const uint8_t* p)
+{
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) | ((uint32_t)(p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+static std::string Extension(const std::string& file)
+{
+    size_t dot = file.rfind('.');
+    if (dot == std::string::npos || file.find('/', dot) != std::string::npos)
+    {
+        return "";
+    }
+    std::string ext = file.substr(dot);
+    for (auto& c : ext)
+    {
+        c = (char)tolower((unsigned char)c);
+    }
+    return ext;
+}
+
+// 去掉目录和扩展名
+static std::string FileStem(const std::string& file)
+{
+    size_t slash = file.rfind('/');
+    std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+static bool IsSupportedFile(const std::string& file)
+{
+    std::string ext = Extension(file);
+    for (auto supported : kSupportedExtensions)
+    {
+        if (ext == supported)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void AppendUtf8(uint32_t cp, std::string& out)
+{
+    if (cp < 0x80)
+    {
+        out += (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+// 解码 UTF-8，遇到非法字节时返回 false，该字节按单个码点处理
+static bool DecodeUtf8(const std::string& text, std::vector<uint32_t>& cps)
+{
+    bool valid = true;
+    cps.clear();
+    size_t i = 0;
+    while (i < text.size())
+    {
+        uint8_t c = text[i];
+        int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : -1;
+        uint32_t cp = extra == 0 ? c : extra == 1 ? (c & 0x1F) : extra == 2 ? (c & 0x0F) : (c & 0x07);
+        bool ok = extra >= 0 && i + extra < text.size();
+        for (int k = 1; ok && k <= extra; k++)
+        {
+            uint8_t next = text[i + k];
+            ok = (next & 0xC0) == 0x80;
+            cp = (cp << 6) | (next & 0x3F);
+        }
+        if (!ok)
+        {
+            valid = false;
+            cps.push_back(c);
+            i++;
+            continue;
+        }
+        cps.push_back(cp);
+        i += extra + 1;
+    }
+    return valid;
+}
+
+// ID3 文本帧: 第一个字节是编码，0 = ISO-8859-1，1 = 带 BOM 的 UTF-16，2 = UTF-16BE，3 = UTF-8
+// 很多中文 MP3 在编码 0 下实际写的是 GBK，无法识别时返回空字符串，由调用者改用文件名
+static std::string DecodeId3Text(const uint8_t* data, size_t len)
+{
+    if (len < 2)
+    {
+        return "";
+    }
+    uint8_t encoding = data[0];
+    data++;
+    len--;
+    if (encoding == 0 || encoding == 3)
+    {
+        size_t end = 0;
+        while (end < len && data[end] != 0)
+        {
+            end++;
+        }
+        std::string text((const char*)data, end);
+        std::vector<uint32_t> cps;
+        return DecodeUtf8(text, cps) ? text : "";
+    }
+    if (encoding != 1 && encoding != 2)
+    {
+        return "";
+    }
+    std::string out;
+    bool big_endian = encoding == 2;
+    size_t i = 0;
+    if (encoding == 1 && len >= 2)
+    {
+        big_endian = data[0] == 0xFE && data[1] == 0xFF;
+        if ((data[0] == 0xFE && data[1] == 0xFF) || (data[0] == 0xFF && data[1] == 0xFE))
+        {
+            i = 2;
+        }
+    }
+    while (i + 1 < len)
+    {
+        uint32_t unit = big_endian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+        i += 2;
+        if (unit == 0)
+        {
+            break;
+        }
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < len)
+        {
+            uint32_t low = big_endian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+            if (low >= 0xDC00 && low < 0xE000)
+            {
+                i += 2;
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            }
+        }
+        AppendUtf8(unit, out);
+    }
+    return out;
+}
+
+// 读取 ID3v2.3/2.4 中的标题、歌手和专辑，返回音频数据的起始位置
+static size_t ParseId3Tag(FILE* fp, LocalMusicEntry& entry)
+{
+    uint8_t header[10];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, "ID3", 3) != 0)
+    {
+        return 0;
+    }
+    int version = header[3];
+    uint8_t flags = header[5];
+    size_t tag_end = 10 + ReadSynchsafe32(header + 6);
+    size_t audio_start = tag_end + ((flags & 0x10) ? 10 : 0);
+    if (version != 3 && version != 4)
+    {
+        return audio_start;
+    }
+
+    size_t pos = 10;
+    if (flags & 0x40)
+    {
+        // 扩展头: v2.3 的长度不包括长度字段本身，v2.4 的包括
+        uint8_t size[4];
+        if (fread(size, 1, sizeof(size), fp) != sizeof(size))
+        {
+            return audio_start;
+        }
+        pos += version == 4 ? ReadSynchsafe32(size) : ReadBe32(size) + 4;
+    }
+
+    uint8_t text[ID3_TEXT_FRAME_MAX];
+    while (pos + 10 <= tag_end)
+    {
+        uint8_t frame[10];
+        if (fseek(fp, pos, SEEK_SET) != 0 || fread(frame, 1, sizeof(frame), fp) != sizeof(frame) || frame[0] == 0)
+        {
+            break;  // 读到填充区
+        }
+        size_t size = version == 4 ? ReadSynchsafe32(frame + 4) : ReadBe32(frame + 4);
+        if (size == 0 || pos + 10 + size > tag_end)
+        {
+            break;
+        }
+        std::string* target = nullptr;
+        if (memcmp(frame, "TIT2", 4) == 0)
+        {
+            target = &entry.title;
+        }
+        else if (memcmp(frame, "TPE1", 4) == 0)
+        {
+            target = &entry.artist;
+        }
+        else if (memcmp(frame, "TALB", 4) == 0)
+        {
+            target = &entry.album;
+        }
+        if (target != nullptr && size <= sizeof(text) && fread(text, 1, size, fp) == size)
+        {
+            *target = DecodeId3Text(text, size);
+        }
+        pos += 10 + size;
+    }
+    return audio_start;
+}
+
+// 解析 Layer III 帧头，得到比特率 (bps) 和采样率
+static bool ParseMp3Header(const uint8_t* p, int& bitrate, int& sample_rate)
+{
+    static const int kBitrateMpeg1[15] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+    static const int kBitrateMpeg2[15] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+    static const int kSampleRate[3] = {44100, 48000, 32000};
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0)
+    {
+        return false;
+    }
+    int version = (p[1] >> 3) & 0x03;
+    int layer = (p[1] >> 1) & 0x03;
+    int bitrate_index = (p[2] >> 4) & 0x0F;
+    int rate_index = (p[2] >> 2) & 0x03;
+    if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+    {
+        return false;
+    }
+    bitrate = (version == 3 ? kBitrateMpeg1 : kBitrateMpeg2)[bitrate_index] * 1000;
+    sample_rate = kSampleRate[rate_index] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+    return true;
+}
+
+bool LocalMusicLibrary::ProbeFile(const std::string& path, LocalMusicEntry& entry)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr)
+    {
+        ESP_LOGW(TAG, "Failed to open %s", path.c_str());
+        return false;
+    }
+    entry.title.clear();
+    entry.artist.clear();
+    entry.album.clear();
+    entry.duration_ms = 0;
+    entry.bitrate = 0;
+    if (Extension(entry.file) == ".mp3")
+    {
+        size_t audio_start = ParseId3Tag(fp, entry);
+        std::vector<uint8_t> buffer(MP3_PROBE_SIZE);
+        size_t len = 0;
+        if (fseek(fp, audio_start, SEEK_SET) == 0)
+        {
+            len = fread(buffer.data(), 1, buffer.size(), fp);
+        }
+        for (size_t i = 0; i + 4 <= len; i++)
+        {
+            int bitrate = 0;
+            int sample_rate = 0;
+            if (!ParseMp3Header(buffer.data() + i, bitrate, sample_rate))
+            {
+                continue;
+            }
+            Mp3StreamInfo info;
+            info.Parse(buffer.data() + i, len - i, audio_start + i, entry.size, bitrate, sample_rate);
+            entry.duration_ms = info.DurationMs();
+            entry.bitrate = bitrate;
+            // VBR 文件用平均比特率
+            if (entry.duration_ms > 0 && entry.size > (int64_t)(audio_start + i))
+            {
+                entry.bitrate = (entry.size - audio_start - i) * 8000 / entry.duration_ms;
+            }
+            break;
+        }
+    }
+    fclose(fp);
+    if (entry.title.empty())
+    {
+        entry.title = FileStem(entry.file);
+    }
+    return true;
+}
+
+// 索引文件以 tab 分隔，字段中的 tab 和换行替换成空格
+static std::string Sanitize(const std::string& text)
+{
+    std::string out = text;
+    for (auto& c : out)
+    {
+        if (c == '\t' || c == '\r' || c == '\n')
+        {
+            c = ' ';
+        }
+    }
+    return out;
+}
+
+bool LocalMusicLibrary::Load(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    while (directory_.size() > 1 && directory_.back() == '/')
+    {
+        directory_.pop_back();
+    }
+    entries_.clear();
+
+    std::string index_path = directory_ + "/" INDEX_FILE_NAME;
+    FILE* fp = fopen(index_path.c_str(), "r");
+    if (fp == nullptr)
+    {
+        ESP_LOGI(TAG, "No index at %s", index_path.c_str());
+        RebuildIndex();
+        return false;
+    }
+    std::vector<char> line(INDEX_LINE_MAX);
+    bool valid = fgets(line.data(), line.size(), fp) != nullptr && strncmp(line.data(), INDEX_HEADER, strlen(INDEX_HEADER)) == 0;
+    while (valid && fgets(line.data(), line.size(), fp) != nullptr)
+    {
+        size_t length = strlen(line.data());
+        if (length == 0 || line[length - 1] != '\n')
+        {
+            // 超长的行，丢弃剩余部分
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n')
+            {
+            }
+            continue;
+        }
+        line[length - 1] = '\0';
+        std::vector<char*> fields;
+        char* field = line.data();
+        while (fields.size() < 8)
+        {
+            fields.push_back(field);
+            char* tab = strchr(field, '\t');
+            if (tab == nullptr)
+            {
+                break;
+            }
+            *tab = '\0';
+            field = tab + 1;
+        }
+        if (fields.size() != 8 || fields[0][0] == '\0')
+        {
+            continue;
+        }
+        LocalMusicEntry entry;
+        entry.file = fields[0];
+        entry.mtime = strtoll(fields[1], nullptr, 10);
+        entry.size = strtoll(fields[2], nullptr, 10);
+        entry.duration_ms = strtoul(fields[3], nullptr, 10);
+        entry.bitrate = strtoul(fields[4], nullptr, 10);
+        entry.title = fields[5];
+        entry.artist = fields[6];
+        entry.album = fields[7];
+        entries_.push_back(std::move(entry));
+    }
+    fclose(fp);
+    if (!valid)
+    {
+        ESP_LOGW(TAG, "Index %s has an unknown format, ignoring it", index_path.c_str());
+    }
+    RebuildIndex();
+    ESP_LOGI(TAG, "Loaded %d entries from %s", (int)entries_.size(), index_path.c_str());
+    return valid;
+}
+
+bool LocalMusicLibrary::Save()
+{
+    std::string index_path = directory_ + "/" INDEX_FILE_NAME;
+    std::string temp_path = index_path + ".tmp";
+    FILE* fp = fopen(temp_path.c_str(), "w");
+    if (fp == nullptr)
+    {
+        ESP_LOGE(TAG, "Failed to create %s", temp_path.c_str());
+        return false;
+    }
+    bool ok = fprintf(fp, INDEX_HEADER "\n") > 0;
+    for (auto& entry : entries_)
+    {
+        if (!ok)
+        {
+            break;
+        }
+        ok = fprintf(fp, "%s\t%lld\t%lld\t%u\t%u\t%s\t%s\t%s\n", Sanitize(entry.file).c_str(),
+                     (long long)entry.mtime, (long long)entry.size, (unsigned int)entry.duration_ms,
+                     (unsigned int)entry.bitrate, Sanitize(entry.title).c_str(),
+                     Sanitize(entry.artist).c_str(), Sanitize(entry.album).c_str()) > 0;
+    }
+    ok = fclose(fp) == 0 && ok;
+    // FAT 上 rename 不能覆盖已有文件，先删除旧索引
+    remove(index_path.c_str());
+    if (!ok || rename(temp_path.c_str(), index_path.c_str()) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to write %s", index_path.c_str());
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void LocalMusicLibrary::ScanDirectory(const std::string& relative, int depth, const std::vector<LocalMusicEntry>& old_entries,
+                                      const std::unordered_map<std::string, size_t>& old_by_file,
+                                      std::vector<LocalMusicEntry>& entries, int& unchanged, int& probed)
+{
+    std::string path = relative.empty() ? directory_ : directory_ + "/" + relative;
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr)
+    {
+        ESP_LOGW(TAG, "Failed to open directory %s", path.c_str());
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != nullptr)
+    {
+        if (item->d_name[0] == '.')
+        {
+            continue;
+        }
+        std::string file = relative.empty() ? item->d_name : relative + "/" + item->d_name;
+        std::string full_path = directory_ + "/" + file;
+        struct stat st;
+        if (stat(full_path.c_str(), &st) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+        {
+            if (depth < SCAN_MAX_DEPTH)
+            {
+                ScanDirectory(file, depth + 1, old_entries, old_by_file, entries, unchanged, probed);
+            }
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || !IsSupportedFile(file))
+        {
+            continue;
+        }
+        auto it = old_by_file.find(file);
+        if (it != old_by_file.end() && old_entries[it->second].mtime == (int64_t)st.st_mtime &&
+            old_entries[it->second].size == (int64_t)st.st_size)
+        {
+            entries.push_back(old_entries[it->second]);
+            unchanged++;
+            continue;
+        }
+        LocalMusicEntry entry;
+        entry.file = file;
+        entry.mtime = st.st_mtime;
+        entry.size = st.st_size;
+        if (ProbeFile(full_path, entry))
+        {
+            entries.push_back(std::move(entry));
+            probed++;
+        }
+    }
+    closedir(dir);
+}
+
+bool LocalMusicLibrary::Rescan()
+{
+    std::vector<LocalMusicEntry> old_entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        old_entries = entries_;
+    }
+    std::unordered_map<std::string, size_t> old_by_file;
+    old_by_file.reserve(old_entries.size());
+    for (size_t i = 0; i < old_entries.size(); i++)
+    {
+        old_by_file.emplace(old_entries[i].file, i);
+    }
+
+    // 扫描和探测文件时不持有锁，不影响查找
+    std::vector<LocalMusicEntry> entries;
+    entries.reserve(old_entries.size());
+    int unchanged = 0;
+    int probed = 0;
+    ScanDirectory("", 0, old_entries, old_by_file, entries, unchanged, probed);
+    std::sort(entries.begin(), entries.end(), [](const LocalMusicEntry& a, const LocalMusicEntry& b) {
+        return a.file < b.file;
+    });
+
+    ESP_LOGI(TAG, "Scanned %s: %d entries, %d unchanged, %d probed", directory_.c_str(),
+             (int)entries.size(), unchanged, probed);
+    if (probed == 0 && unchanged == (int)old_entries.size())
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(entries);
+    RebuildIndex();
+    Save();
+    return true;
+}
+
+void LocalMusicLibrary::RebuildIndex()
+{
+    keys_.clear();
+    by_name_.clear();
+    keys_.reserve(entries_.size());
+    by_name_.reserve(entries_.size() * 2);
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        EntryKeys keys;
+        keys.title = Normalize(entries_[i].title);
+        keys.stem = Normalize(FileStem(entries_[i].file));
+        keys.artist = Normalize(entries_[i].artist);
+        // 重名时保留排序靠前的一首
+        if (!keys.title.empty())
+        {
+            by_name_.emplace(keys.title, i);
+        }
+        if (!keys.stem.empty())
+        {
+            by_name_.emplace(keys.stem, i);
+        }
+        keys_.push_back(std::move(keys));
+    }
+}
+
+size_t LocalMusicLibrary::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::vector<LocalMusicEntry> LocalMusicLibrary::Entries()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+}
+
+std::string LocalMusicLibrary::FullPath(const LocalMusicEntry& entry) const
+{
+    return directory_ + "/" + entry.file;
+}
+
+bool LocalMusicLibrary::Find(const std::string& name, LocalMusicEntry& entry)
+{
+    std::string key = Normalize(name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_name_.find(key);
+    if (it == by_name_.end())
+    {
+        return false;
+    }
+    entry = entries_[it->second];
+    return true;
+}
+
+std::string LocalMusicLibrary::Normalize(const std::string& name)
+{
+    std::vector<uint32_t> cps;
+    DecodeUtf8(name, cps);
+    std::string out;
+    out.reserve(name.size());
+    for (uint32_t cp : cps)
+    {
+        // 全角 ASCII
+        if (cp >= 0xFF01 && cp <= 0xFF5E)
+        {
+            cp -= 0xFEE0;
+        }
+        if (cp < 0x80)
+        {
+            if (isalnum((int)cp))
+            {
+                out += (char)tolower((int)cp);
+            }
+            continue;
+        }
+        // 通用标点、CJK 标点、竖排标点和其余全角标点
+        if ((cp >= 0x2000 && cp <= 0x206F) || (cp >= 0x3000 && cp <= 0x303F) ||
+            (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF65) || cp == 0x00A0 || cp == 0x00B7)
+        {
+            continue;
+        }
+        AppendUtf8(cp, out);
+    }
+    return out;
+}
+
+// 单个码点和相邻码点组成的二元组，单字也参与比较，语音识别出的同音错字只影响附近的几项
+static void Grams(const std::string& key, std::vector<uint32_t>& cps, std::vector<uint64_t>& grams)
+{
+    DecodeUtf8(key, cps);
+    grams.clear();
+    for (size_t i = 0; i < cps.size(); i++)
+    {
+        grams.push_back(cps[i]);
+        if (i + 1 < cps.size())
+        {
+            grams.push_back(((uint64_t)(cps[i] + 1) << 32) | cps[i + 1]);
+        }
+    }
+    std::sort(grams.begin(), grams.end());
+}
+
+// 相似度: 完全相同为 1，包含关系按长度比例落在 0.6~1 之间，其余用 Grams 的 Dice 系数 (最高 0.8)
+static float Similarity(const std::string& query, size_t query_length, const std::vector<uint64_t>& query_grams,
+                        const std::string& key, std::vector<uint32_t>& cps, std::vector<uint64_t>& grams)
+{
+    if (key.empty())
+    {
+        return 0.0f;
+    }
+    if (key == query)
+    {
+        return 1.0f;
+    }
+    Grams(key, cps, grams);
+    if (key.find(query) != std::string::npos || query.find(key) != std::string::npos)
+    {
+        size_t shorter = std::min(query_length, cps.size());
+        size_t longer = std::max(query_length, cps.size());
+        return 0.6f + 0.4f * shorter / longer;
+    }
+    size_t common = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < query_grams.size() && j < grams.size())
+    {
+        if (query_grams[i] == grams[j])
+        {
+            common++;
+            i++;
+            j++;
+        }
+        else if (query_grams[i] < grams[j])
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+    }
+    if (common == 0)
+    {
+        return 0.0f;
+    }
+    return 0.8f * 2.0f * common / (query_grams.size() + grams.size());
+}
+
+std::vector<LocalMusicEntry> LocalMusicLibrary::Search(const std::string& query, size_t max_results)
+{
+    std::vector<LocalMusicEntry> results;
+    std::string key = Normalize(query);
+    if (key.empty() || max_results == 0)
+    {
+        return results;
+    }
+    std::vector<uint32_t> cps;
+    std::vector<uint64_t> query_grams;
+    Grams(key, cps, query_grams);
+    size_t query_length = cps.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<float, size_t>> scored;
+    std::vector<uint64_t> grams;
+    for (size_t i = 0; i < keys_.size(); i++)
+    {
+        float score = std::max(Similarity(key, query_length, query_grams, keys_[i].title, cps, grams),
+                               Similarity(key, query_length, query_grams, keys_[i].stem, cps, grams));
+        // 只说了歌手名时也能匹配，但排在歌名匹配之后
+        score = std::max(score, 0.9f * Similarity(key, query_length, query_grams, keys_[i].artist, cps, grams));
+        if (score >= SEARCH_MIN_SCORE)
+        {
+            scored.emplace_back(score, i);
+        }
+    }
+    size_t count = std::min(max_results, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                      [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+                          return a.first != b.first ? a.first > b.first : a.second < b.second;
+                      });
+    for (size_t i = 0; i < count; i++)
+    {
+        results.push_back(entries_[scored[i].second]);
+    }
+    return results;
+}
@@ -0,0 +1,65 @@
+#ifndef LOCAL_MUSIC_LIBRARY_H
+#define LOCAL_MUSIC_LIBRARY_H
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct LocalMusicEntry {
+    std::string file;           // 相对于曲库目录的路径
+    std::string title;          // ID3 标题，没有时为文件名去掉扩展名
+    std::string artist;
+    std::string album;
+    int64_t mtime = 0;
+    int64_t size = 0;
+    uint32_t duration_ms = 0;   // 无法得知时为 0
+    uint32_t bitrate = 0;       // bps，无法得知时为 0
+};
+
+// SD 卡上的本地曲库
+// 索引保存在曲库目录下的 .music_index 文件中，启动时直接读取，
+// 重新扫描时只探测新增或修改时间、大小发生变化的文件
+class LocalMusicLibrary {
+public:
+    // 读取索引文件，索引不存在或版本不符时曲库为空，需要调用 Rescan
+    bool Load(const std::string& directory);
+    // 扫描目录并更新索引，有变化时写回索引文件，返回是否有变化
+    bool Rescan();
+
+    const std::string& directory() const { return directory_; }
+    size_t Size();
+    std::vector<LocalMusicEntry> Entries();
+    std::string FullPath(const LocalMusicEntry& entry) const;
+
+    // 按规范化后的标题或文件名精确查找，O(1)
+    bool Find(const std::string& name, LocalMusicEntry& entry);
+    // 模糊查找，按相似度从高到低返回最多 max_results 项，用于语音点歌
+    std::vector<LocalMusicEntry> Search(const std::string& query, size_t max_results);
+
+    // 转成小写，去掉空格和标点 (包括全角标点)，全角字母数字转成半角
+    static std::string Normalize(const std::string& name);
+
+private:
+    // 查找用的规范化字符串
+    struct EntryKeys {
+        std::string title;
+        std::string stem;       // 文件名去掉目录和扩展名
+        std::string artist;
+    };
+
+    bool Save();
+    void RebuildIndex();
+    static bool ProbeFile(const std::string& path, LocalMusicEntry& entry);
+    void ScanDirectory(const std::string& relative, int depth, const std::vector<LocalMusicEntry>& old_entries,
+                       const std::unordered_map<std::string, size_t>& old_by_file,
+                       std::vector<LocalMusicEntry>& entries, int& unchanged, int& probed);
+
+    std::string directory_;
+    std::mutex mutex_;
+    std::vector<LocalMusicEntry> entries_;
+    std::vector<EntryKeys> keys_;                           // 与 entries_ 一一对应
+    std::unordered_map<std::string, size_t> by_name_;       // 规范化标题/文件名 -> entries_ 下标
+};
+#endif
@@ -22,125 +22,19 @@
 
 
 Mp3OnlinePlayer::Mp3OnlinePlayer() : is_playing_(false), is_downloading_(false),
-                           play_thread_(), download_thread_(), audio_buffer_(), buffer_mutex_(),
-                           buffer_cv_(), buffer_size_(0), mp3_decoder_(nullptr), mp3_frame_info_(),
-                           mp3_decoder_initialized_(false)
+                           play_thread_(), download_thread_(),
+                           clip_cache_(CONFIG_MUSIC_CLIP_CACHE_KB * 1024, CONFIG_MUSIC_CLIP_CACHE_PCM_SECONDS)
 {
     ESP_LOGI(TAG, "Music player initialized with default spectrum display mode");
-    InitializeMp3Decoder();
 }
 
 Mp3OnlinePlayer::~Mp3OnlinePlayer()
 {
     ESP_LOGI(TAG, "Destroying music player - stopping all operations");
-
-    // 停止所有操作
-    is_downloading_ = false;
-    is_playing_ = false;
-
-    // 通知所有等待的线程
-    {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
-    }
-
-    // 等待下载线程结束，设置5秒超时
-    if (download_thread_.joinable())
-    {
-        ESP_LOGI(TAG, "Waiting for download thread to finish (timeout: 5s)");
-        auto start_time = std::chrono::steady_clock::now();
-
-        // 等待线程结束
-        bool thread_finished = false;
-        while (!thread_finished)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                               std::chrono::steady_clock::now() - start_time)
-                               .count();
-
-            if (elapsed >= 5)
-            {
-                ESP_LOGW(TAG, "Download thread join timeout after 5 seconds");
-                break;
-            }
-
-            // 再次设置停止标志，确保线程能够检测到
-            is_downloading_ = false;
-
-            // 通知条件变量
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all();
-            }
-
-            // 检查线程是否已经结束
-            if (!download_thread_.joinable())
-            {
-                thread_finished = true;
-            }
-
-            // 定期打印等待信息
-            if (elapsed > 0 && elapsed % 1 == 0)
-            {
-                ESP_LOGI(TAG, "Still waiting for download thread to finish... (%ds)", (int)elapsed);
-            }
-        }
-
-        if (download_thread_.joinable())
-        {
-            download_thread_.join();
-        }
-        ESP_LOGI(TAG, "Download thread finished");
-    }
-
-    // 等待播放线程结束，设置3秒超时
-    if (play_thread_.joinable())
-    {
-        ESP_LOGI(TAG, "Waiting for playback thread to finish (timeout: 3s)");
-        auto start_time = std::chrono::steady_clock::now();
-
-        bool thread_finished = false;
-        while (!thread_finished)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                               std::chrono::steady_clock::now() - start_time)
-                               .count();
-
-            if (elapsed >= 3)
-            {
-                ESP_LOGW(TAG, "Playback thread join timeout after 3 seconds");
-                break;
-            }
-
-            // 再次设置停止标志
-            is_playing_ = false;
-
-            // 通知条件变量
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all();
-            }
-
-            // 检查线程是否已经结束
-            if (!play_thread_.joinable())
-            {
-                thread_finished = true;
-            }
-        }
-
-        if (play_thread_.joinable())
-        {
-            play_thread_.join();
-        }
-        ESP_LOGI(TAG, "Playback thread finished");
-    }
-
-    // 清理缓冲区和MP3解码器
+    CancelStreaming();
+    std::lock_guard<std::mutex> lock(thread_control_mutex_);
+    JoinStreamingThreads();
     ClearAudioBuffer();
-    CleanupMp3Decoder();
-
     ESP_LOGI(TAG, "Music player destroyed successfully");
 }
 
@@ -152,51 +46,151 @@ void Mp3OnlinePlayer::Mp3OnlinePlayerInit(mp3_player_output_cb_t output_cb, mp3_
     user_context_ = output_cb_arg;
 }
 
+void Mp3OnlinePlayer::SetTrackCallbacks(std::function<std::string()> next_track_cb, std::function<void()> track_changed_cb)
+{
+    next_track_cb_ = std::move(next_track_cb);
+    track_changed_cb_ = std::move(track_changed_cb);
+}
+
+void Mp3OnlinePlayer::SetInterruptCallback(std::function<void()> interrupt_cb)
+{
+    interrupt_cb_ = std::move(interrupt_cb);
+}
 
 // 开始流式播放
-bool Mp3OnlinePlayer::StartStreaming(const std::string &music_url)
+bool Mp3OnlinePlayer::StartStreaming(const std::string &music_url, uint32_t session)
 {
     std::lock_guard<std::mutex> lock(thread_control_mutex_);
-    need_info_cb_ = true;
     if (music_url.empty())
     {
         ESP_LOGE(TAG, "Music URL is empty");
         return false;
     }
+    if (session != session_)
+    {
+        ESP_LOGI(TAG, "Start request %u superseded by %u, ignoring", (unsigned int)session, (unsigned int)session_.load());
+        return false;
+    }
 
     ESP_LOGD(TAG, "Starting streaming for URL: %s", music_url.c_str());
 
-    // 停止之前的播放和下载
-    is_downloading_ = false;
-    is_playing_ = false;
-    try{
-        // 等待之前的线程完全结束
-        if (download_thread_.joinable())
-        {
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all(); // 通知线程退出
-            }
-            download_thread_.join();
-        }
-        if (play_thread_.joinable())
+    // 停止之前的播放和下载，同一时间只有一个会话的线程存在
+    if (!JoinStreamingThreads())
+    {
+        return false;
+    }
+    music_url_ = music_url;
+    stream_length_ = 0;
+    stream_info_.Reset();
+    format_ = StreamFormat::kUnknown;
+    return LaunchStreaming(0, 0);
+}
+
+// 跳转到指定时间，按 Xing/VBRI 索引或比特率估算出字节偏移后从该位置重新下载
+bool Mp3OnlinePlayer::Seek(int64_t position_ms, uint32_t session)
+{
+    std::lock_guard<std::mutex> lock(thread_control_mutex_);
+    if ((!is_playing_ && !is_downloading_) || session != session_)
+    {
+        ESP_LOGW(TAG, "Seek ignored, no streaming in progress");
+        return false;
+    }
+
+    // 播放线程在无缝切歌时会改写 music_url_，线程退出后才能读取
+    if (!JoinStreamingThreads())
+    {
+        return false;
+    }
+    if (music_url_.empty())
+    {
+        ESP_LOGW(TAG, "Seek ignored, no streaming in progress");
+        return false;
+    }
+    if (!stream_info_.valid())
+    {
+        // 只有 MP3 能从第一帧得到时间与偏移的对应关系，其他格式只能从头开始
+        ESP_LOGW(TAG, "Seek index unavailable for %s stream, restarting", StreamFormatName(format_));
+        position_ms = 0;
+    }
+    int64_t duration_ms = stream_info_.DurationMs();
+    if (duration_ms > 0)
+    {
+        position_ms = std::min(position_ms, duration_ms);
+    }
+    size_t offset = position_ms > 0 ? stream_info_.OffsetForTime(position_ms) : 0;
+    ESP_LOGI(TAG, "Seek to %lldms, offset %u", position_ms, (unsigned int)offset);
+    return LaunchStreaming(offset, position_ms);
+}
+
+// 发出停止信号并打断所有阻塞的等待，不等待线程退出，可以在任意线程中调用
+void Mp3OnlinePlayer::CancelStreaming()
+{
+    bool was_playing = false;
+    {
+        std::lock_guard<std::mutex> lock(cancel_mutex_);
+        was_playing = is_playing_;
+        is_downloading_ = false;
+        is_playing_ = false;
+    }
+    cancel_cv_.notify_all();
+    stream_buffer_.Close();
+    {
+        // 关闭连接后阻塞中的 Read 立即返回；正在建立连接时最多等待 HTTP_TIMEOUT_MS
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        if (active_http_ != nullptr)
         {
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all(); // 通知线程退出
-            }
-            play_thread_.join();
+            active_http_->Close();
         }
-    }catch(const std::exception& e){
-        ESP_LOGE(TAG, "Thread join exception: %s", e.what());
-        // 如果 join 失败，说明对象状态已乱，强制 detach 丢弃
-        if (download_thread_.joinable()) download_thread_.detach();
-        if (play_thread_.joinable()) play_thread_.detach();
     }
-    
+    // 上一首已经自然播完时不打断输出，让混音器中剩余的尾音播完
+    if (was_playing && interrupt_cb_)
+    {
+        interrupt_cb_();
+    }
+}
 
-    // 清空缓冲区
+// 停止下载和播放线程并等待它们退出，调用时持有 thread_control_mutex_
+// 线程不会被分离，返回 true 时上一个会话的线程都已退出
+bool Mp3OnlinePlayer::JoinStreamingThreads()
+{
+    std::thread::id self = std::this_thread::get_id();
+    if (self == download_thread_.get_id() || self == play_thread_.get_id())
+    {
+        ESP_LOGE(TAG, "Streaming threads cannot be joined from themselves");
+        return false;
+    }
+    if (!download_thread_.joinable() && !play_thread_.joinable())
+    {
+        return true;
+    }
+    int64_t start_time_us = esp_timer_get_time();
+    CancelStreaming();
+    if (download_thread_.joinable())
+    {
+        download_thread_.join();
+    }
+    if (play_thread_.joinable())
+    {
+        play_thread_.join();
+    }
+    ESP_LOGI(TAG, "Streaming threads stopped in %lldms", (esp_timer_get_time() - start_time_us) / 1000);
+    return true;
+}
+
+// 从文件的 offset 处开始下载，播放时间从 start_time_ms 开始计算，调用时持有 thread_control_mutex_
+bool Mp3OnlinePlayer::LaunchStreaming(size_t offset, int64_t start_time_ms)
+{
+    need_info_cb_ = true;
+
+    // 清空缓冲区，缓冲区只在第一次播放时分配
     ClearAudioBuffer();
+    if (!stream_buffer_.Allocate())
+    {
+        return false;
+    }
+    start_offset_ = offset;
+    start_time_ms_ = start_time_ms;
+    cached_pcm_.reset();
 
     // 配置线程栈大小以避免栈溢出
     esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
@@ -206,12 +200,14 @@ bool Mp3OnlinePlayer::StartStreaming(const std::string &music_url)
     cfg.stack_alloc_caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
     esp_pthread_set_cfg(&cfg);
 
-    // 开始下载线程
+    // 两个标志都要在启动线程前设置，下载线程一开始就会检查 is_playing_
     is_downloading_ = true;
-    download_thread_ = std::thread(&Mp3OnlinePlayer::DownloadAudioStream, this, music_url);
+    is_playing_ = true;
+
+    // 开始下载线程
+    download_thread_ = std::thread(&Mp3OnlinePlayer::DownloadAudioStream, this, music_url_);
 
     // 开始播放线程（会等待缓冲区有足够数据）
-    is_playing_ = true;
     play_thread_ = std::thread(&Mp3OnlinePlayer::PlayAudioStream, this);
 
     ESP_LOGI(TAG, "Streaming threads started successfully");
@@ -222,88 +218,129 @@ bool Mp3OnlinePlayer::StartStreaming(const std::string &music_url)
 // 停止流式播放
 bool Mp3OnlinePlayer::StopStreaming()
 {
-    std::lock_guard<std::mutex> lock(thread_control_mutex_);
-    ESP_LOGI(TAG, "Stopping music streaming - current state: downloading=%d, playing=%d",
-             is_downloading_.load(), is_playing_.load());
+    // 先取消再等锁：StartStreaming 或 Seek 可能正持有锁等待上一个会话退出，
+    // 取消同时让还没执行的请求失效
+    session_++;
+    CancelStreaming();
 
-    // 检查是否有流式播放正在进行
-    if (!is_playing_ && !is_downloading_)
+    std::lock_guard<std::mutex> lock(thread_control_mutex_);
+    ESP_LOGI(TAG, "Stopping music streaming");
+    if (!JoinStreamingThreads())
     {
-        ESP_LOGW(TAG, "No streaming in progress");
-        return true;
+        return false;
     }
+    if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_NONE){
+        player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_NONE;
+        event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_NONE, user_context_);
+    }
+    return true;
+}
 
-    // 停止下载和播放标志
-    is_downloading_ = false;
-    is_playing_ = false;
+// 等待 delay_ms，停止时立即返回 false
+bool Mp3OnlinePlayer::SleepWhileStreaming(int delay_ms)
+{
+    std::unique_lock<std::mutex> lock(cancel_mutex_);
+    return !cancel_cv_.wait_for(lock, std::chrono::milliseconds(delay_ms), [this] {
+        return !is_downloading_ || !is_playing_;
+    });
+}
 
-    // 通知所有等待的线程
+// 关闭并释放下载线程的连接，先取消登记，避免停止时关闭已经释放的连接
+void Mp3OnlinePlayer::ReleaseHttp(std::unique_ptr<Http> &http)
+{
     {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        active_http_ = nullptr;
     }
+    http->Close();
+    http.reset();
+}
 
-    // 等待线程结束（避免重复代码，让StopStreaming也能等待线程完全停止）
-    if (download_thread_.joinable())
+// 打开 HTTP 连接并从文件的 offset 处开始读取
+// 返回 false 时 retry 表示错误是否可能是暂时的
+bool Mp3OnlinePlayer::OpenStream(std::unique_ptr<Http> &http, const std::string &music_url, size_t offset, bool &retry,
+                                 const std::string &etag)
+{
+    retry = true;
+    auto network = Board::GetInstance().GetNetwork();
+    http = network->CreateHttp(0);
+    http->SetTimeout(HTTP_TIMEOUT_MS);
     {
-        download_thread_.join();
-        ESP_LOGI(TAG, "Download thread joined in StopStreaming");
+        // 登记之后停止时才能关闭这个连接，登记前已经停止的直接放弃
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        active_http_ = http.get();
     }
-
-    // 等待播放线程结束，使用更安全的方式
-    if (play_thread_.joinable())
+    if (!is_downloading_)
     {
-        // 先设置停止标志
-        is_playing_ = false;
+        ReleaseHttp(http);
+        return false;
+    }
+    if (offset > 0)
+    {
+        http->SetHeader("Range", "bytes=" + std::to_string(offset) + "-");
+    }
+    if (!etag.empty())
+    {
+        http->SetHeader("If-None-Match", etag);
+    }
 
-        // 通知条件变量，确保线程能够退出
-        {
-            std::lock_guard<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.notify_all();
-        }
+    if (!http->Open("GET", music_url))
+    {
+        ESP_LOGE(TAG, "Failed to connect to music stream URL");
+        ReleaseHttp(http);
+        return false;
+    }
 
-        // 使用超时机制等待线程结束，避免死锁
-        bool thread_finished = false;
-        int wait_count = 0;
-        const int max_wait = 100; // 最多等待1秒
+    int status_code = http->GetStatusCode();
+    if (status_code == 304 && !etag.empty())
+    {
+        return true;  // 缓存的内容仍然有效，由调用者关闭连接
+    }
+    if (status_code != 200 && status_code != 206)
+    { // 206 for partial content
+        ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
+        retry = status_code >= 500;
+        ReleaseHttp(http);
+        return false;
+    }
 
-        while (!thread_finished && wait_count < max_wait)
+    if (status_code == 206)
+    {
+        // Content-Range: bytes <start>-<end>/<total>
+        std::string range = http->GetResponseHeader("Content-Range");
+        size_t slash = range.find('/');
+        if (slash != std::string::npos && isdigit((unsigned char)range[slash + 1]))
         {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            wait_count++;
-
-            // 检查线程是否仍然可join
-            if (!play_thread_.joinable())
-            {
-                thread_finished = true;
-                break;
-            }
+            stream_length_ = strtoul(range.c_str() + slash + 1, nullptr, 10);
         }
-
-        if (play_thread_.joinable())
+    }
+    else
+    {
+        stream_length_ = http->GetBodyLength();
+        // 服务器不支持 Range，丢弃 offset 之前的数据
+        size_t skip = offset;
+        char discard[512];
+        while (skip > 0 && is_downloading_)
         {
-            if (wait_count >= max_wait)
-            {
-                ESP_LOGW(TAG, "Play thread join timeout, detaching thread");
-                play_thread_.detach();
-            }
-            else
+            int bytes_read = http->Read(discard, std::min(skip, sizeof(discard)));
+            if (bytes_read <= 0)
             {
-                play_thread_.join();
-                ESP_LOGI(TAG, "Play thread joined in StopStreaming");
+                ReleaseHttp(http);
+                return false;
             }
+            skip -= bytes_read;
         }
     }
-    ESP_LOGI(TAG, "Music streaming stop signal sent");
-    if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_NONE){
-        player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_NONE;
-        event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_NONE, user_context_);
-    }
+
+    ESP_LOGI(TAG, "Started downloading audio stream, status: %d, offset: %u, length: %u",
+             status_code, (unsigned int)offset, (unsigned int)stream_length_);
     return true;
 }
 
-// 流式下载音频数据
-void Mp3OnlinePlayer::DownloadAudioStream(const std::string &music_url)
+// 从 offset 开始下载一首歌，连接中断时用 Range 请求从已下载的位置继续
+// 从头下载的短歌曲优先使用缓存，allow_pcm 表示可以直接播放缓存的 PCM
+// 整首歌下载完成或由缓存提供时返回 true
+bool Mp3OnlinePlayer::DownloadTrack(const std::string &music_url, size_t offset, bool allow_pcm)
 {
     ESP_LOGD(TAG, "Starting audio stream download from: %s", music_url.c_str());
 
@@ -311,143 +348,248 @@ void Mp3OnlinePlayer::DownloadAudioStream(const std::string &music_url)
     if (music_url.empty() || music_url.find("http") != 0)
     {
         ESP_LOGE(TAG, "Invalid URL format: %s", music_url.c_str());
-        is_downloading_ = false;
-        return;
-    }
-
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
-
-    if (!http->Open("GET", music_url))
-    {
-        ESP_LOGE(TAG, "Failed to connect to music stream URL");
-        is_downloading_ = false;
-        return;
-    }
-
-    int status_code = http->GetStatusCode();
-    if (status_code != 200 && status_code != 206)
-    { // 206 for partial content
-        ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
-        http->Close();
-        is_downloading_ = false;
-        return;
+        return false;
     }
 
-    ESP_LOGI(TAG, "Started downloading audio stream, status: %d", status_code);
-
-    // 分块读取音频数据
-    const size_t chunk_size = 4096;; // 4KB每块
-    char buffer[chunk_size];
-    size_t total_downloaded = 0;
-
-    while (is_downloading_ && is_playing_)
+    std::unique_ptr<Http> http;
+    bool cacheable = clip_cache_.enabled() && offset == 0;
+    if (cacheable)
     {
-        int bytes_read = http->Read(buffer, chunk_size);
-        if (bytes_read < 0)
-        {
-            ESP_LOGE(TAG, "Failed to read audio data: error code %d", bytes_read);
-            break;
-        }
-        if (bytes_read == 0)
+        bool fresh = false;
+        std::shared_ptr<const ClipCacheEntry> cached = clip_cache_.Find(music_url, fresh);
+        if (cached && cached->is_pcm() && !allow_pcm)
         {
-            ESP_LOGI(TAG, "Audio stream download completed, total: %d bytes", total_downloaded);
-            break;
+            // 预取的下一首需要原始数据，重新下载，缓存中的 PCM 保持不变
+            cached.reset();
+            cacheable = false;
         }
-
-        // 打印数据块信息
-        // ESP_LOGI(TAG, "Downloaded chunk: %d bytes at offset %d", bytes_read, total_downloaded);
-
-        // 安全地打印数据块的十六进制内容（前16字节）
-        if (bytes_read >= 16)
+        if (cached && !fresh && !RevalidateCachedClip(http, *cached))
         {
-            // ESP_LOGI(TAG, "Data: %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X ...",
-            //         (unsigned char)buffer[0], (unsigned char)buffer[1], (unsigned char)buffer[2], (unsigned char)buffer[3],
-            //         (unsigned char)buffer[4], (unsigned char)buffer[5], (unsigned char)buffer[6], (unsigned char)buffer[7],
-            //         (unsigned char)buffer[8], (unsigned char)buffer[9], (unsigned char)buffer[10], (unsigned char)buffer[11],
-            //         (unsigned char)buffer[12], (unsigned char)buffer[13], (unsigned char)buffer[14], (unsigned char)buffer[15]);
+            // 内容已更新，用已经打开的连接重新下载
+            clip_cache_.Remove(music_url);
+            cached.reset();
         }
-        else
+        if (cached)
         {
-            ESP_LOGI(TAG, "Data chunk too small: %d bytes", bytes_read);
+            return FeedFromCache(std::move(cached));
         }
+    }
+
+    std::unique_ptr<ClipBuffer> capture;
+    std::string etag;
+    bool completed = false;
+    int attempts = 0;
+    int64_t disconnect_time_us = 0;
 
-        // 尝试检测文件格式（检查文件头）
-        if (total_downloaded == 0 && bytes_read >= 4)
+    while (is_downloading_ && is_playing_)
+    {
+        if (!http)
         {
-            if (memcmp(buffer, "ID3", 3) == 0)
-            {
-                ESP_LOGI(TAG, "Detected MP3 file with ID3 tag");
-            }
-            else if (buffer[0] == 0xFF && (buffer[1] & 0xE0) == 0xE0)
-            {
-                ESP_LOGI(TAG, "Detected MP3 file header");
-            }
-            else if (memcmp(buffer, "RIFF", 4) == 0)
+            bool retry = false;
+            if (!OpenStream(http, music_url, offset, retry))
             {
-                ESP_LOGI(TAG, "Detected WAV file");
-            }
-            else if (memcmp(buffer, "fLaC", 4) == 0)
-            {
-                ESP_LOGI(TAG, "Detected FLAC file");
+                if (!retry || ++attempts > MAX_RECONNECT_ATTEMPTS)
+                {
+                    ESP_LOGE(TAG, "Giving up on music stream at offset %u", (unsigned int)offset);
+                    break;
+                }
+                // 断网后逐渐拉长重试间隔，期间播放线程继续消耗缓冲区中的数据
+                SleepWhileStreaming(attempts * RECONNECT_DELAY_MS);
+                continue;
             }
-            else if (memcmp(buffer, "OggS", 4) == 0)
+            if (disconnect_time_us != 0)
             {
-                ESP_LOGI(TAG, "Detected OGG file");
+                ESP_LOGI(TAG, "Stream resumed at offset %u after %lldms, buffer size: %d",
+                         (unsigned int)offset, (esp_timer_get_time() - disconnect_time_us) / 1000, stream_buffer_.Size());
+                disconnect_time_us = 0;
             }
-            else
+        }
+        if (cacheable)
+        {
+            // 只缓存长度已知且不超过单个条目上限的歌曲
+            cacheable = false;
+            if (stream_length_ > 0 && stream_length_ <= clip_cache_.max_entry_size())
             {
-                ESP_LOGI(TAG, "Unknown audio format, first 4 bytes: %02X %02X %02X %02X",
-                         (unsigned char)buffer[0], (unsigned char)buffer[1],
-                         (unsigned char)buffer[2], (unsigned char)buffer[3]);
+                capture = std::make_unique<ClipBuffer>(stream_length_);
+                etag = http->GetResponseHeader("ETag");
             }
         }
 
-        // 创建音频数据块
-        uint8_t *chunk_data = (uint8_t *)heap_caps_malloc(bytes_read, MALLOC_CAP_SPIRAM);
-        if (!chunk_data)
+        size_t space = 0;
+        uint8_t *buffer = stream_buffer_.WaitWritable(DOWNLOAD_CHUNK_SIZE, space);
+        if (!buffer)
         {
-            ESP_LOGE(TAG, "Failed to allocate memory for audio chunk");
             break;
         }
-        memcpy(chunk_data, buffer, bytes_read);
+        int bytes_read = http->Read((char *)buffer, std::min(space, DOWNLOAD_CHUNK_SIZE));
+        if (!is_downloading_)
+        {
+            break;  // 停止时连接被关闭，读取结果无效
+        }
+        bool truncated = bytes_read == 0 && stream_length_ > 0 && offset < stream_length_;
+        if (bytes_read < 0 || truncated)
+        {
+            ESP_LOGW(TAG, "Music stream interrupted at offset %u (read %d), reconnecting", (unsigned int)offset, bytes_read);
+            ReleaseHttp(http);
+            disconnect_time_us = esp_timer_get_time();
+            continue;
+        }
+        if (bytes_read == 0)
+        {
+            ESP_LOGI(TAG, "Audio stream download completed, total: %u bytes", (unsigned int)offset);
+            completed = true;
+            break;
+        }
+        attempts = 0;
 
-        // 等待缓冲区有空间
+        if (capture && !capture->Append(buffer, bytes_read))
         {
-            std::unique_lock<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.wait(lock, [this]
-                            { return buffer_size_ < MAX_BUFFER_SIZE || !is_downloading_; });
+            capture.reset();
+        }
+        stream_buffer_.Commit(bytes_read);
+        size_t previous = offset;
+        offset += bytes_read;
+        if (offset / (256 * 1024) != previous / (256 * 1024))
+        { // 每256KB打印一次进度
+            ESP_LOGI(TAG, "Downloaded %u bytes, buffer size: %d", (unsigned int)offset, stream_buffer_.Size());
+        }
+    }
 
-            if (is_downloading_)
-            {
-                audio_buffer_.push(AudioChunk(chunk_data, bytes_read));
-                buffer_size_ += bytes_read;
-                total_downloaded += bytes_read;
+    if (http)
+    {
+        ReleaseHttp(http);
+    }
+    if (completed && capture && capture->size() == capture->capacity())
+    {
+        clip_cache_.Put(music_url, etag, std::move(capture));
+        clip_cache_.LogStats();
+    }
+    return completed;
+}
 
-                // 通知播放线程有新数据
-                buffer_cv_.notify_one();
+// 用 If-None-Match 确认缓存的内容没有变化，无法连网时继续使用缓存
+// 返回 false 表示内容已更新 (或没有 ETag 无法确认)，此时 http 可能是已经打开的新内容的连接
+bool Mp3OnlinePlayer::RevalidateCachedClip(std::unique_ptr<Http> &http, const ClipCacheEntry &entry)
+{
+    if (entry.etag.empty())
+    {
+        return false;
+    }
+    bool retry = false;
+    if (!OpenStream(http, entry.url, 0, retry, entry.etag))
+    {
+        ESP_LOGW(TAG, "Failed to revalidate cached clip, using it anyway");
+        return true;
+    }
+    if (http->GetStatusCode() != 304)
+    {
+        ESP_LOGI(TAG, "Cached clip changed on server: %s", entry.url.c_str());
+        return false;
+    }
+    ReleaseHttp(http);
+    clip_cache_.MarkValidated(entry.url);
+    return true;
+}
 
-                if (total_downloaded % (256 * 1024) == 0)
-                { // 每256KB打印一次进度
-                    ESP_LOGI(TAG, "Downloaded %d bytes, buffer size: %d", total_downloaded, buffer_size_);
-                }
-            }
-            else
+// 把缓存的原始数据写入缓冲区，PCM 则交给播放线程直接输出
+bool Mp3OnlinePlayer::FeedFromCache(std::shared_ptr<const ClipCacheEntry> entry)
+{
+    ESP_LOGI(TAG, "Playing %s from cache", entry->url.c_str());
+    clip_cache_.LogStats();
+    if (entry->is_pcm())
+    {
+        cached_pcm_ = std::move(entry);
+        return true;
+    }
+    stream_length_ = entry->data->size();
+    const uint8_t *data = entry->data->data();
+    size_t left = entry->data->size();
+    while (left > 0 && is_downloading_)
+    {
+        size_t space = 0;
+        uint8_t *buffer = stream_buffer_.WaitWritable(std::min(left, DOWNLOAD_CHUNK_SIZE), space);
+        if (!buffer)
+        {
+            return false;
+        }
+        size_t len = std::min(space, left);
+        memcpy(buffer, data, len);
+        stream_buffer_.Commit(len);
+        data += len;
+        left -= len;
+    }
+    return left == 0;
+}
+
+// 播放线程正在播放的歌曲的文件长度，未知时为 0
+// 下载线程已经开始预取下一首时，当前歌曲的长度保存在分段标记中
+size_t Mp3OnlinePlayer::PlayingTrackLength()
+{
+    // 先读 stream_length_：之后仍没有分段标记说明读取时下载线程还在下载这一首
+    size_t length = stream_length_;
+    size_t pending_length = 0;
+    if (stream_buffer_.HasPendingSegment(pending_length))
+    {
+        return pending_length;
+    }
+    return length;
+}
+
+// 等到当前歌曲剩余的播放时间不超过 CONFIG_MUSIC_PREFETCH_SECONDS，返回下一首的地址
+// 没有下一首或播放停止时返回空字符串
+std::string Mp3OnlinePlayer::WaitForPrefetchPoint()
+{
+    if (!next_track_cb_)
+    {
+        return "";
+    }
+    while (is_downloading_ && is_playing_)
+    {
+        // 上一个分段还没被播放线程越过时，当前歌曲的时长和播放时间还属于前一首
+        if (!stream_buffer_.HasPendingSegment())
+        {
+            // 时长未知 (还没解析到第一帧或不是 MP3) 时不按时间判断，等缓冲区快用完再预取
+            int64_t duration_ms = track_duration_ms_;
+            bool near_end = duration_ms > 0 && duration_ms - current_play_time_ms_ <= CONFIG_MUSIC_PREFETCH_SECONDS * 1000;
+            if (near_end || stream_buffer_.Size() < MIN_BUFFER_SIZE)
             {
-                heap_caps_free(chunk_data);
-                break;
+                return next_track_cb_();
             }
         }
+        SleepWhileStreaming(100);
     }
+    return "";
+}
 
-    http->Close();
+// 流式下载音频数据，当前歌曲下载完后接着把下一首预取到同一个缓冲区，实现无缝切换
+void Mp3OnlinePlayer::DownloadAudioStream(const std::string &music_url)
+{
+    std::string url = music_url;
+    size_t offset = start_offset_;
+    bool first_track = true;
+    while (DownloadTrack(url, offset, first_track))
+    {
+        first_track = false;
+        if (cached_pcm_)
+        {
+            break;  // 播放线程直接输出 PCM，不再预取
+        }
+        url = WaitForPrefetchPoint();
+        if (url.empty())
+        {
+            break;
+        }
+        ESP_LOGI(TAG, "Prefetching next track: %s", url.c_str());
+        next_url_ = url;
+        offset = 0;
+        // 当前歌曲的长度随分段标记交给播放线程，之后 stream_length_ 属于下一首
+        stream_buffer_.MarkSegment(stream_length_);
+        stream_length_ = 0;
+    }
     is_downloading_ = false;
 
     // 通知播放线程下载完成
-    {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
-    }
+    stream_buffer_.Finish();
 
     ESP_LOGI(TAG, "Audio stream download thread finished");
 }
@@ -457,250 +599,329 @@ void Mp3OnlinePlayer::PlayAudioStream()
 {
     ESP_LOGI(TAG, "Starting audio stream playback");
 
-    // 初始化时间跟踪变量
-    current_play_time_ms_ = 0;
+    // 初始化时间跟踪变量，跳转后从跳转位置开始计时
+    current_play_time_ms_ = start_time_ms_;
     last_frame_time_ms_ = 0;
     total_frames_decoded_ = 0;
 
-    if (!mp3_decoder_initialized_)
+    // 等待缓冲区有足够数据开始播放
+    if (!WaitForBuffer(MIN_BUFFER_SIZE))
     {
-        ESP_LOGE(TAG, "MP3 decoder not initialized");
-        is_playing_ = false;
+        EndPlayback();
         return;
     }
-
-    // 等待缓冲区有足够数据开始播放
+    // 下载线程在结束前设置，缓冲区的锁保证这里能看到
+    if (cached_pcm_)
     {
-        std::unique_lock<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.wait(lock, [this]
-                        { return buffer_size_ >= MIN_BUFFER_SIZE || (!is_downloading_ && !audio_buffer_.empty()); });
+        PlayCachedPcm(*cached_pcm_);
+        EndPlayback();
+        return;
     }
 
-    ESP_LOGI(TAG, "Starting playback with buffer size: %d", buffer_size_);
+    ESP_LOGI(TAG, "Starting playback with buffer size: %d", stream_buffer_.Size());
 
     size_t total_played = 0;
-    uint8_t *mp3_input_buffer = nullptr;
-    int bytes_left = 0;
-    uint8_t *read_ptr = nullptr;
-
-    // 分配MP3输入缓冲区
-    mp3_input_buffer = (uint8_t *)heap_caps_malloc(8192, MALLOC_CAP_SPIRAM);
-    if (!mp3_input_buffer)
-    {
-        ESP_LOGE(TAG, "Failed to allocate MP3 input buffer");
-        is_playing_ = false;
-        return;
-    }
-
-    // 标记是否已经处理过ID3标签
-    bool id3_processed = false;
+    underrun_count_ = 0;
+    // ID3标签可能比缓冲区中已有的数据还长，剩余部分在后续数据到达时继续跳过
+    size_t id3_remaining = 0;
+    bool id3_processed = start_offset_ > 0;
+    // 缓冲区读取位置对应的文件偏移，以及当前歌曲开始下载的偏移
+    size_t play_offset = start_offset_;
+    size_t track_start_offset = start_offset_;
+    // 无缝播放：丢弃 Xing/Info 帧与 LAME 头记录的开头延迟和末尾填充 (每声道采样数)
+    bool drop_frame = false;
+    int64_t trim_start = 0;
+    int64_t samples_left = -1;
+    track_duration_ms_ = stream_info_.DurationMs();
+    // 解码器在每首歌开头按数据内容创建，跳转后沿用之前识别出的格式
+    std::unique_ptr<StreamDecoder> decoder;
+    DecodedFrame decoded;
+    bool drained = false;
+    // 从头播放的可缓存短歌曲同时保存解码后的 PCM，下次播放不再解码
+    bool capture_pcm = clip_cache_.pcm_seconds() > 0 && start_offset_ == 0;
+    std::unique_ptr<ClipBuffer> pcm_capture;
+    int pcm_sample_rate = 0;
+    int pcm_channels = 0;
+    auto consume = [this, &play_offset](size_t len) {
+        stream_buffer_.Consume(len);
+        play_offset += len;
+    };
 
     while (is_playing_)
     {
-        // 如果需要更多MP3数据，从缓冲区读取
-        if (bytes_left < 4096)
-        { // 保持至少4KB数据用于解码
-            AudioChunk chunk;
-
-            // 从缓冲区获取音频数据
+        // 数据不足一帧所需且当前段未写完时视为欠载，缓冲到恢复水位再继续，避免逐字节地等待
+        if (stream_buffer_.Size() < DECODER_INPUT_SIZE && !stream_buffer_.SegmentComplete())
+        {
+            underrun_count_++;
+            ESP_LOGW(TAG, "Buffer underrun #%d, rebuffering", underrun_count_);
+            if (!WaitForBuffer(RESUME_BUFFER_SIZE))
             {
-                std::unique_lock<std::mutex> lock(buffer_mutex_);
-                if (audio_buffer_.empty())
-                {
-                    if (!is_downloading_)
-                    {
-                        // 下载完成且缓冲区为空，播放结束
-                        if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_FINISHED){
-                            player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_FINISHED;
-                            event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_FINISHED, user_context_);
-                        }
-                        ESP_LOGI(TAG, "Playback finished, total played: %d bytes", total_played);
-                        break;
-                    }
-                    // 等待新数据
-                    buffer_cv_.wait(lock, [this]
-                                    { return !audio_buffer_.empty() || !is_downloading_; });
-                    if (audio_buffer_.empty())
-                    {
-                        continue;
-                    }
-                }
-
-                chunk = audio_buffer_.front();
-                audio_buffer_.pop();
-                buffer_size_ -= chunk.size;
-
-                // 通知下载线程缓冲区有空间
-                buffer_cv_.notify_one();
+                break;
             }
+        }
 
-            // 将新数据添加到MP3输入缓冲区
-            if (chunk.data && chunk.size > 0)
+        // 视图已包含当前段剩余的全部数据时告诉解码器没有后续数据，分段处之后属于下一首
+        bool eos = false;
+        size_t available = 0;
+        const uint8_t *view = stream_buffer_.WaitReadable(DECODER_INPUT_SIZE, available, &eos);
+        if (!view)
+        {
+            break;
+        }
+        // 当前歌曲的数据读完后，先取出解码器内部还缓存着的帧，再切换或结束
+        bool draining = available == 0 && decoder && !drained;
+        if (available == 0 && !draining && stream_buffer_.NextSegment())
+        {
+            // 已预取的下一首紧接在后面，不停止播放直接切换
+            ESP_LOGI(TAG, "Gapless switch to next track, underruns so far: %d", underrun_count_);
+            if (decoder)
             {
-                // 移动剩余数据到缓冲区开头
-                if (bytes_left > 0 && read_ptr != mp3_input_buffer)
-                {
-                    memmove(mp3_input_buffer, read_ptr, bytes_left);
-                }
-
-                // 检查缓冲区空间
-                size_t space_available = 8192 - bytes_left;
-                size_t copy_size = std::min(chunk.size, space_available);
-
-                // 复制新数据
-                memcpy(mp3_input_buffer + bytes_left, chunk.data, copy_size);
-                bytes_left += copy_size;
-                read_ptr = mp3_input_buffer;
-
-                // 检查并跳过ID3标签（仅在开始时处理一次）
-                if (!id3_processed && bytes_left >= 10)
-                {
-                    size_t id3_skip = SkipId3Tag(read_ptr, bytes_left);
-                    if (id3_skip > 0)
-                    {
-                        read_ptr += id3_skip;
-                        bytes_left -= id3_skip;
-                        ESP_LOGI(TAG, "Skipped ID3 tag: %u bytes", (unsigned int)id3_skip);
-                    }
-                    id3_processed = true;
-                }
-
-                // 释放chunk内存
-                heap_caps_free(chunk.data);
+                decoder->LogStats();
+                decoder.reset();
+            }
+            drained = false;
+            capture_pcm = false;
+            pcm_capture.reset();
+            format_ = StreamFormat::kUnknown;
+            music_url_ = next_url_;
+            stream_info_.Reset();
+            track_duration_ms_ = 0;
+            current_play_time_ms_ = 0;
+            total_frames_decoded_ = 0;
+            play_offset = 0;
+            track_start_offset = 0;
+            id3_processed = false;
+            id3_remaining = 0;
+            drop_frame = false;
+            trim_start = 0;
+            samples_left = -1;
+            need_info_cb_ = true;
+            if (track_changed_cb_)
+            {
+                track_changed_cb_();
             }
+            continue;
+        }
+        if (available == 0 && !draining)
+        {
+            // 下载完成且缓冲区为空，播放结束
+            if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_FINISHED){
+                player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_FINISHED;
+                event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_FINISHED, user_context_);
+            }
+            ESP_LOGI(TAG, "Playback finished, total played: %d bytes, underruns: %d", total_played, underrun_count_);
+            if (pcm_capture)
+            {
+                clip_cache_.UpgradeToPcm(music_url_, std::move(pcm_capture), pcm_sample_rate, pcm_channels);
+            }
+            break;
         }
 
-        // 尝试找到MP3帧同步
-        int sync_offset = MP3FindSyncWord(read_ptr, bytes_left);
-        if (sync_offset < 0)
+        // 检查并跳过ID3标签（仅在开始时处理一次）
+        if (!id3_processed && (available >= 10 || eos))
+        {
+            id3_remaining = SkipId3Tag((uint8_t *)view, available);
+            id3_processed = true;
+        }
+        if (id3_remaining > 0 && !draining)
         {
-            ESP_LOGW(TAG, "No MP3 sync word found, skipping %d bytes", bytes_left);
-            bytes_left = 0;
+            size_t skip = std::min(id3_remaining, available);
+            consume(skip);
+            id3_remaining -= skip;
             continue;
         }
 
-        // 跳过到同步位置
-        if (sync_offset > 0)
+        if (!decoder)
         {
-            read_ptr += sync_offset;
-            bytes_left -= sync_offset;
+            if (format_ == StreamFormat::kUnknown)
+            {
+                format_ = SniffStreamFormat(view, available);
+                if (format_ == StreamFormat::kUnknown)
+                {
+                    ESP_LOGW(TAG, "Unknown audio format, first 4 bytes: %02X %02X %02X %02X, trying MP3",
+                             view[0], view[1], view[2], view[3]);
+                    format_ = StreamFormat::kMp3;
+                }
+                ESP_LOGI(TAG, "Detected %s stream", StreamFormatName(format_));
+            }
+            decoder = CreateStreamDecoder(format_);
+            if (!decoder)
+            {
+                player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_ERROR;
+                event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_ERROR, user_context_);
+                break;
+            }
         }
 
-        // 解码MP3帧
-        int16_t pcm_buffer[2304];
-        int decode_result = MP3Decode(mp3_decoder_, &read_ptr, &bytes_left, pcm_buffer, 0);
-
-        if (decode_result == 0)
+        size_t consumed = 0;
+        DecodeResult result = decoder->Decode(view, available, eos, consumed, decoded);
+        if (result == DecodeResult::kFrame && format_ == StreamFormat::kMp3 && !stream_info_.valid() &&
+            track_start_offset == 0)
         {
-            // 解码成功，获取帧信息
-            MP3GetLastFrameInfo(mp3_decoder_, &mp3_frame_info_);
-            total_frames_decoded_++;
+            // 第一帧可能带有 Xing/VBRI 索引，跳转时用它换算字节偏移
+            stream_info_.Parse(view + decoded.offset, available - decoded.offset, play_offset + decoded.offset,
+                               PlayingTrackLength(), decoded.bitrate, decoded.sample_rate);
+            track_duration_ms_ = stream_info_.DurationMs();
+            drop_frame = stream_info_.has_info_frame();
+            trim_start = stream_info_.StartTrimSamples();
+            if (trim_start > 0 && stream_info_.ValidSamples() > 0)
+            {
+                samples_left = stream_info_.ValidSamples();
+            }
+        }
+        consume(consumed);
 
-            // 基本的帧信息有效性检查，防止除零错误
-            if (mp3_frame_info_.samprate == 0 || mp3_frame_info_.nChans == 0)
+        if (result == DecodeResult::kNeedMoreData)
+        {
+            // 当前段已写完时剩余的数据不足一帧，直接丢弃后切换或结束；否则等待更多数据
+            if (available == 0)
             {
-                ESP_LOGW(TAG, "Invalid frame info: rate=%d, channels=%d, skipping",
-                         mp3_frame_info_.samprate, mp3_frame_info_.nChans);
-                continue;
+                drained = true;
             }
-            if(need_info_cb_){
-                need_info_cb_ = false;
-                info_cb_(mp3_frame_info_.samprate, mp3_frame_info_.nChans, mp3_frame_info_.bitrate, user_context_);
+            else if (eos)
+            {
+                consume(available - consumed);
             }
-
-            // 计算当前帧的持续时间(毫秒)
-            int frame_duration_ms = (mp3_frame_info_.outputSamps * 1000) /
-                                    (mp3_frame_info_.samprate * mp3_frame_info_.nChans);
-
-            // 更新当前播放时间
-            current_play_time_ms_ += frame_duration_ms;
-
-            ESP_LOGD(TAG, "Frame %d: time=%lldms, duration=%dms, rate=%d, ch=%d",
-                     total_frames_decoded_, current_play_time_ms_, frame_duration_ms,
-                     mp3_frame_info_.samprate, mp3_frame_info_.nChans);
-            // 播放to do
-            output_cb_((uint8_t*)pcm_buffer, 2 * mp3_frame_info_.outputSamps, user_context_);
-            if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_PLAYING){
-                player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_PLAYING;
-                event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_PLAYING, user_context_);
+            else if (!WaitForBuffer(stream_buffer_.Size() + 1))
+            {
+                break;
             }
+            continue;
+        }
+        if (result == DecodeResult::kFatal)
+        {
+            ESP_LOGE(TAG, "%s stream cannot be decoded, stopping", decoder->name());
+            player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_ERROR;
+            event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_ERROR, user_context_);
+            break;
         }
-        else
+        if (result != DecodeResult::kFrame)
         {
-            // 解码失败
-            ESP_LOGW(TAG, "MP3 decode failed with error: %d", decode_result);
-            // 跳过一些字节继续尝试
-            if (bytes_left > 1)
+            continue;
+        }
+
+        total_frames_decoded_++;
+        if(need_info_cb_){
+            need_info_cb_ = false;
+            info_cb_(decoded.sample_rate, decoded.channels, decoded.bitrate, user_context_);
+        }
+
+        // 计算当前帧的持续时间(毫秒)并更新当前播放时间
+        int frame_duration_ms = decoded.samples * 1000 / decoded.sample_rate;
+        current_play_time_ms_ += frame_duration_ms;
+
+        ESP_LOGD(TAG, "Frame %d: time=%lldms, duration=%dms, rate=%d, ch=%d",
+                 total_frames_decoded_, current_play_time_ms_.load(), frame_duration_ms,
+                 decoded.sample_rate, decoded.channels);
+        if (drop_frame)
+        {
+            // Xing/Info 帧解码出来是一帧静音
+            drop_frame = false;
+            continue;
+        }
+        int channels = decoded.channels;
+        int64_t first = std::min<int64_t>(trim_start, decoded.samples);
+        int64_t count = decoded.samples - first;
+        trim_start -= first;
+        if (samples_left >= 0)
+        {
+            count = std::min(count, samples_left);
+            samples_left -= count;
+        }
+        if (count > 0)
+        {
+            uint8_t *pcm = (uint8_t *)(decoded.pcm + first * channels);
+            size_t bytes = 2 * count * channels;
+            output_cb_(pcm, bytes, user_context_);
+            total_played += bytes;
+            if (capture_pcm)
             {
-                read_ptr++;
-                bytes_left--;
+                // 只有下载时被缓存的歌曲才保存 PCM，时长已知且超过上限时不保存
+                capture_pcm = false;
+                size_t limit = (size_t)clip_cache_.pcm_seconds() * decoded.sample_rate * channels * 2;
+                size_t track_length = PlayingTrackLength();
+                if (track_length > 0 && track_length <= clip_cache_.max_entry_size() &&
+                    track_duration_ms_ <= clip_cache_.pcm_seconds() * 1000)
+                {
+                    pcm_capture = std::make_unique<ClipBuffer>(std::min(limit, clip_cache_.max_entry_size()));
+                    pcm_sample_rate = decoded.sample_rate;
+                    pcm_channels = channels;
+                }
             }
-            else
+            if (pcm_capture && (decoded.sample_rate != pcm_sample_rate || channels != pcm_channels ||
+                                !pcm_capture->Append(pcm, bytes)))
             {
-                bytes_left = 0;
+                pcm_capture.reset();
             }
         }
+        if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_PLAYING){
+            player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_PLAYING;
+            event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_PLAYING, user_context_);
+        }
     }
 
-    // 清理
-    if (mp3_input_buffer)
+    if (decoder)
     {
-        heap_caps_free(mp3_input_buffer);
+        decoder->LogStats();
     }
-
     // 播放结束时进行基本清理，但不调用StopStreaming避免线程自我等待
     ESP_LOGI(TAG, "Audio stream playback finished, total played: %d bytes", total_played);
-    ESP_LOGI(TAG, "Performing basic cleanup from play thread");
-
-    // 停止播放标志
-    is_playing_ = false;
+    EndPlayback();
 }
 
-// 清空音频缓冲区
-void Mp3OnlinePlayer::ClearAudioBuffer()
+// 直接输出缓存中解码好的 PCM，由 output_cb 的阻塞控制节奏
+void Mp3OnlinePlayer::PlayCachedPcm(const ClipCacheEntry &entry)
 {
-    std::lock_guard<std::mutex> lock(buffer_mutex_);
-
-    while (!audio_buffer_.empty())
+    const uint8_t *data = entry.data->data();
+    size_t size = entry.data->size();
+    size_t frame_bytes = entry.channels * 2;
+    ESP_LOGI(TAG, "Playing %u bytes of cached PCM, %dHz, %d channels", (unsigned int)size, entry.sample_rate, entry.channels);
+    need_info_cb_ = false;
+    info_cb_(entry.sample_rate, entry.channels, entry.sample_rate * entry.channels * 16, user_context_);
+
+    size_t offset = 0;
+    while (is_playing_ && offset < size)
     {
-        AudioChunk chunk = audio_buffer_.front();
-        audio_buffer_.pop();
-        if (chunk.data)
-        {
-            heap_caps_free(chunk.data);
+        size_t len = std::min((size_t)CACHED_PCM_CHUNK_SAMPLES * frame_bytes, size - offset);
+        output_cb_((uint8_t *)data + offset, len, user_context_);
+        offset += len;
+        current_play_time_ms_ = start_time_ms_ + (int64_t)(offset / frame_bytes) * 1000 / entry.sample_rate;
+        if(player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_PLAYING){
+            player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_PLAYING;
+            event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_PLAYING, user_context_);
         }
     }
-
-    buffer_size_ = 0;
-    ESP_LOGI(TAG, "Audio buffer cleared");
+    if (offset == size && player_state_ != music_player_state_t::MUSIC_PLAYER_STATE_FINISHED)
+    {
+        player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_FINISHED;
+        event_cb_(music_player_state_t::MUSIC_PLAYER_STATE_FINISHED, user_context_);
+    }
 }
 
-// 初始化MP3解码器
-bool Mp3OnlinePlayer::InitializeMp3Decoder()
+// 播放线程退出前调用：停止播放标志，并让下载线程结束，不再向没有读方的缓冲区写入
+// 不调用 StopStreaming，避免线程等待自己
+void Mp3OnlinePlayer::EndPlayback()
 {
-    mp3_decoder_ = MP3InitDecoder();
-    if (mp3_decoder_ == nullptr)
     {
-        ESP_LOGE(TAG, "Failed to initialize MP3 decoder");
-        mp3_decoder_initialized_ = false;
-        return false;
+        std::lock_guard<std::mutex> lock(cancel_mutex_);
+        is_playing_ = false;
     }
+    cancel_cv_.notify_all();
+    stream_buffer_.Close();
+}
 
-    mp3_decoder_initialized_ = true;
-    ESP_LOGI(TAG, "MP3 decoder initialized successfully");
-    return true;
+// 清空音频缓冲区
+void Mp3OnlinePlayer::ClearAudioBuffer()
+{
+    stream_buffer_.Reset();
+    ESP_LOGI(TAG, "Audio buffer cleared");
 }
 
-// 清理MP3解码器
-void Mp3OnlinePlayer::CleanupMp3Decoder()
+// 等待缓冲区达到 level 字节或下载结束，播放停止时返回 false
+bool Mp3OnlinePlayer::WaitForBuffer(size_t level)
 {
-    if (mp3_decoder_ != nullptr)
-    {
-        MP3FreeDecoder(mp3_decoder_);
-        mp3_decoder_ = nullptr;
-    }
-    mp3_decoder_initialized_ = false;
-    ESP_LOGI(TAG, "MP3 decoder cleaned up");
+    size_t available = 0;
+    return stream_buffer_.WaitReadable(level, available) != nullptr && is_playing_;
 }
 
 // 跳过MP3文件开头的ID3标签
@@ -726,12 +947,6 @@ size_t Mp3OnlinePlayer::SkipId3Tag(uint8_t *data, size_t size)
     // ID3v2头部(10字节) + 标签内容
     size_t total_skip = 10 + tag_size;
 
-    // 确保不超过可用数据大小
-    if (total_skip > size)
-    {
-        total_skip = size;
-    }
-
     ESP_LOGI(TAG, "Found ID3v2 tag, skipping %u bytes", (unsigned int)total_skip);
     return total_skip;
 }
\ No newline at end of file
@@ -2,41 +2,60 @@
 #define MP3_ONLINE_PLAYER
 #include <string>
 #include <thread>
+#include <memory>
+#include <functional>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
 #include "music_player_api.h"
+#include "stream_ring_buffer.h"
+#include "mp3_stream_info.h"
+#include "stream_decoder.h"
+#include "clip_cache.h"
+#include "http.h"
 
-struct AudioChunk {
-    uint8_t* data;
-    size_t size;
-    
-    AudioChunk() : data(nullptr), size(0) {}
-    AudioChunk(uint8_t* d, size_t s) : data(d), size(s) {}
-};
-
-// MP3解码器支持
-extern "C" {
-#include "mp3dec.h"
-}
+// 在线音乐播放，支持 MP3、AAC (ADTS/M4A) 与 Ogg/Opus，格式按数据内容识别
 class Mp3OnlinePlayer{
 public:
     Mp3OnlinePlayer();
     ~Mp3OnlinePlayer();
 public:
-    bool StartStreaming(const std::string& music_url);
-    bool StopStreaming();  // 停止流式播放
+    // 每次请求播放前取得新的会话号，之后的 StopStreaming 或更新的请求会让旧会话号失效
+    // 这样在临时任务中执行的 StartStreaming/Seek 晚于停止执行时不会再次开始播放
+    uint32_t NewSession() { return ++session_; }
+    uint32_t session() const { return session_; }
+    bool StartStreaming(const std::string& music_url, uint32_t session);
+    bool StopStreaming();  // 停止流式播放，返回时下载和播放线程都已退出
+    bool Seek(int64_t position_ms, uint32_t session);  // 跳转到指定播放时间
+    int64_t GetPlayTimeMs() const { return current_play_time_ms_; }
     bool IsPlaying() const { return is_playing_; }
     void Mp3OnlinePlayerInit(mp3_player_output_cb_t output_cb, mp3_player_info_cb_t info_cb, mp3_player_event_cb_t event_cb, void *output_cb_arg);
+    // next_track_cb 返回要预取的下一首地址，没有时返回空字符串
+    // track_changed_cb 在无缝切换到预取的歌曲时调用
+    void SetTrackCallbacks(std::function<std::string()> next_track_cb, std::function<void()> track_changed_cb);
+    // 停止时调用，用于唤醒阻塞在 output_cb 中的播放线程
+    void SetInterruptCallback(std::function<void()> interrupt_cb);
 private:
     // 私有方法
+    void CancelStreaming();
+    bool JoinStreamingThreads();
+    bool SleepWhileStreaming(int delay_ms);
+    void ReleaseHttp(std::unique_ptr<Http>& http);
+    bool LaunchStreaming(size_t offset, int64_t start_time_ms);
+    bool OpenStream(std::unique_ptr<Http>& http, const std::string& music_url, size_t offset, bool& retry,
+                    const std::string& etag = "");
+    bool DownloadTrack(const std::string& music_url, size_t offset, bool allow_pcm);
+    bool RevalidateCachedClip(std::unique_ptr<Http>& http, const ClipCacheEntry& entry);
+    bool FeedFromCache(std::shared_ptr<const ClipCacheEntry> entry);
+    std::string WaitForPrefetchPoint();
+    size_t PlayingTrackLength();
     void DownloadAudioStream(const std::string& music_url);
     void PlayAudioStream();
+    void PlayCachedPcm(const ClipCacheEntry& entry);
+    void EndPlayback();
     void ClearAudioBuffer();
-    bool InitializeMp3Decoder();
-    void CleanupMp3Decoder();
+    bool WaitForBuffer(size_t level);
 
     // ID3标签处理
     size_t SkipId3Tag(uint8_t* data, size_t size);
@@ -45,7 +64,7 @@ private:
     std::atomic<bool> is_downloading_;
     std::thread play_thread_;
     std::thread download_thread_;
-    int64_t current_play_time_ms_;  // 当前播放时间(毫秒)
+    std::atomic<int64_t> current_play_time_ms_ = 0;  // 当前播放时间(毫秒)
     int64_t last_frame_time_ms_;    // 上一帧的时间戳
     int total_frames_decoded_;      // 已解码的帧数
     mp3_player_output_cb_t output_cb_ = nullptr;
@@ -54,20 +73,45 @@ private:
     std::atomic<bool> need_info_cb_ = false;
     music_player_state_t player_state_ = music_player_state_t::MUSIC_PLAYER_STATE_NONE;
     void* user_context_;
-    // 音频缓冲区
-    std::queue<AudioChunk> audio_buffer_;
-    std::mutex buffer_mutex_;
-    std::condition_variable buffer_cv_;
-    std::mutex thread_control_mutex_;
-    size_t buffer_size_;
+    // 音频缓冲区，下载线程直接写入，解码器直接读取
     static constexpr size_t MAX_BUFFER_SIZE = 256 * 1024;  // 256KB缓冲区（降低以减少brownout风险）
     static constexpr size_t MIN_BUFFER_SIZE = 32 * 1024;   // 32KB最小播放缓冲（降低以减少brownout风险）
+    static constexpr size_t RESUME_BUFFER_SIZE = 16 * 1024; // 欠载后恢复播放所需的缓冲
+    static constexpr size_t DOWNLOAD_CHUNK_SIZE = 4096;     // 每次 HTTP 读取的最大长度
+    static constexpr size_t DECODER_INPUT_SIZE = 4096;      // 解码时保持的最少连续数据
+    StreamRingBuffer stream_buffer_{MAX_BUFFER_SIZE, DECODER_INPUT_SIZE};
+    int underrun_count_ = 0;
+
+    // 断线续传与跳转
+    static constexpr int MAX_RECONNECT_ATTEMPTS = 5;
+    static constexpr int RECONNECT_DELAY_MS = 500;     // 第 n 次重试前等待 n 倍的时间
+    static constexpr int HTTP_TIMEOUT_MS = 5000;       // 建立连接和等待数据的超时，也是停止时等待建立连接的上限
+    std::string music_url_;                  // 播放线程在无缝切歌时改写，其他线程只能在线程退出后读取
+    std::atomic<size_t> stream_length_ = 0;  // 文件总长度，未知时为 0
+    size_t start_offset_ = 0;                // 本次下载开始的文件偏移
+    int64_t start_time_ms_ = 0;              // start_offset_ 对应的播放时间
+    Mp3StreamInfo stream_info_;              // 仅 MP3 流有效
+    StreamFormat format_ = StreamFormat::kUnknown;  // 当前歌曲的格式，跳转后沿用
+
+    // 预取下一首
+    std::function<std::string()> next_track_cb_;
+    std::function<void()> track_changed_cb_;
+    std::string next_url_;                   // 下载线程写入，播放线程越过分段后读取
+    std::atomic<int64_t> track_duration_ms_ = 0;
+    std::mutex thread_control_mutex_;
+
+    // 短音频缓存
+    static constexpr int CACHED_PCM_CHUNK_SAMPLES = 1152;  // 播放缓存的 PCM 时每次输出的采样数 (每声道)
+    ClipCache clip_cache_;
+    std::shared_ptr<const ClipCacheEntry> cached_pcm_;     // 下载线程在结束前设置，播放线程直接输出
 
-    // MP3解码器相关
-    HMP3Decoder mp3_decoder_;
-    MP3FrameInfo mp3_frame_info_;
-    bool mp3_decoder_initialized_;
-    int16_t* final_pcm_data_fft = nullptr;
+    // 取消
+    std::function<void()> interrupt_cb_;
+    std::atomic<uint32_t> session_ = 0;
+    std::mutex cancel_mutex_;
+    std::condition_variable cancel_cv_;      // 下载线程的重试和预取等待在停止时立即返回
+    std::mutex http_mutex_;
+    Http* active_http_ = nullptr;            // 下载线程正在使用的连接，停止时关闭它以打断阻塞的读取
 
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "mp3_stream_decoder.h"
+
+#include <esp_log.h>
+
+#define TAG "MP3_STREAM_DECODER"
+
+Mp3StreamDecoder::~Mp3StreamDecoder()
+{
+    if (decoder_ != nullptr)
+    {
+        MP3FreeDecoder(decoder_);
+    }
+}
+
+bool Mp3StreamDecoder::Initialize()
+{
+    decoder_ = MP3InitDecoder();
+    if (decoder_ == nullptr)
+    {
+        ESP_LOGE(TAG, "Failed to initialize MP3 decoder");
+        return false;
+    }
+    return true;
+}
+
+DecodeResult Mp3StreamDecoder::DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame)
+{
+    if (len == 0)
+    {
+        return DecodeResult::kNeedMoreData;
+    }
+    int sync_offset = MP3FindSyncWord((unsigned char*)data, len);
+    if (sync_offset < 0)
+    {
+        ESP_LOGW(TAG, "No MP3 sync word found, skipping %d bytes", (int)len);
+        consumed = len;
+        return DecodeResult::kSkipped;
+    }
+
+    // 解码器直接读取缓冲区中的数据
+    unsigned char* read_ptr = (unsigned char*)data + sync_offset;
+    int bytes_left = (int)len - sync_offset;
+    int result = MP3Decode(decoder_, &read_ptr, &bytes_left, pcm_, 0);
+    consumed = read_ptr - data;
+    if (result == ERR_MP3_INDATA_UNDERFLOW && !eos)
+    {
+        // 帧不完整，从同步字处等待更多数据
+        consumed = sync_offset;
+        return DecodeResult::kNeedMoreData;
+    }
+    if (result != ERR_MP3_NONE)
+    {
+        ESP_LOGW(TAG, "MP3 decode failed with error: %d", result);
+        // 同步字是假的或帧已损坏，跳过同步字继续尝试
+        if (consumed == (size_t)sync_offset)
+        {
+            consumed++;
+        }
+        return DecodeResult::kError;
+    }
+
+    MP3GetLastFrameInfo(decoder_, &frame_info_);
+    // 基本的帧信息有效性检查，防止除零错误
+    if (frame_info_.samprate == 0 || frame_info_.nChans == 0)
+    {
+        ESP_LOGW(TAG, "Invalid frame info: rate=%d, channels=%d, skipping",
+                 frame_info_.samprate, frame_info_.nChans);
+        return DecodeResult::kSkipped;
+    }
+    frame.pcm = pcm_;
+    frame.samples = frame_info_.outputSamps / frame_info_.nChans;
+    frame.sample_rate = frame_info_.samprate;
+    frame.channels = frame_info_.nChans;
+    frame.bitrate = frame_info_.bitrate;
+    frame.offset = sync_offset;
+    return DecodeResult::kFrame;
+}
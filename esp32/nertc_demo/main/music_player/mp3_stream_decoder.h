@@ -0,0 +1,24 @@
+#ifndef MP3_STREAM_DECODER_H
+#define MP3_STREAM_DECODER_H
+#include "stream_decoder.h"
+
+extern "C" {
+#include "mp3dec.h"
+}
+
+// Helix MP3 解码器，自行在输入中查找帧同步
+class Mp3StreamDecoder : public StreamDecoder {
+public:
+    ~Mp3StreamDecoder() override;
+    const char* name() const override { return "mp3"; }
+    bool Initialize() override;
+
+protected:
+    DecodeResult DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame) override;
+
+private:
+    HMP3Decoder decoder_ = nullptr;
+    MP3FrameInfo frame_info_ = {};
+    int16_t pcm_[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+};
+#endif
@@ -0,0 +1,204 @@
+#include "mp3_stream_info.h"
+
+#include <esp_log.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "MP3_STREAM_INFO"
+
+// 解码器自身引入的延迟 (每声道采样数)
+#define MP3_DECODER_DELAY 529
+
+static uint32_t ReadBe32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t ReadBe(const uint8_t *p, int bytes)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void Mp3StreamInfo::Reset()
+{
+    *this = Mp3StreamInfo();
+}
+
+void Mp3StreamInfo::Parse(const uint8_t *frame, size_t len, size_t frame_offset, size_t file_length,
+                          int bitrate, int sample_rate)
+{
+    Reset();
+    if (len < 4 || frame[0] != 0xFF || (frame[1] & 0xE0) != 0xE0 || sample_rate <= 0)
+    {
+        return;
+    }
+
+    // 帧头: 版本 (3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5)，声道模式 (3 = 单声道)
+    int version = (frame[1] >> 3) & 0x03;
+    bool mono = ((frame[3] >> 6) & 0x03) == 3;
+    bool mpeg1 = version == 3;
+
+    valid_ = true;
+    audio_start_ = frame_offset;
+    audio_bytes_ = file_length > frame_offset ? file_length - frame_offset : 0;
+    bitrate_ = bitrate;
+    sample_rate_ = sample_rate;
+    samples_per_frame_ = mpeg1 ? 1152 : 576;
+
+    // Xing/Info 位于 side information 之后，VBRI 固定在帧头后 32 字节
+    size_t xing_offset = 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+    if (len > xing_offset && ParseXing(frame + xing_offset, len - xing_offset))
+    {
+        ESP_LOGI(TAG, "Xing header: frames=%u, bytes=%u, toc=%d",
+                 (unsigned int)total_frames_, (unsigned int)audio_bytes_, has_toc_);
+    }
+    else if (len > 36 && ParseVbri(frame + 36, len - 36))
+    {
+        ESP_LOGI(TAG, "VBRI header: frames=%u, bytes=%u, entries=%u",
+                 (unsigned int)total_frames_, (unsigned int)audio_bytes_, (unsigned int)vbri_table_.size());
+    }
+}
+
+bool Mp3StreamInfo::ParseXing(const uint8_t *tag, size_t len)
+{
+    if (len < 8 || (memcmp(tag, "Xing", 4) != 0 && memcmp(tag, "Info", 4) != 0))
+    {
+        return false;
+    }
+    uint32_t flags = ReadBe32(tag + 4);
+    const uint8_t *p = tag + 8;
+    const uint8_t *end = tag + len;
+    if ((flags & 0x01) && p + 4 <= end)
+    {
+        total_frames_ = ReadBe32(p);
+        p += 4;
+    }
+    if ((flags & 0x02) && p + 4 <= end)
+    {
+        audio_bytes_ = ReadBe32(p);
+        p += 4;
+    }
+    if ((flags & 0x04) && p + 100 <= end)
+    {
+        memcpy(toc_, p, 100);
+        has_toc_ = true;
+        p += 100;
+    }
+    if (flags & 0x08)
+    {
+        p += 4;
+    }
+    has_info_frame_ = true;
+
+    // LAME 扩展头，第 21-23 字节是 12 位的编码器延迟与 12 位的填充
+    if (p + 24 <= end && (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavf", 4) == 0 || memcmp(p, "Lavc", 4) == 0))
+    {
+        encoder_delay_ = (p[21] << 4) | (p[22] >> 4);
+        encoder_padding_ = ((p[22] & 0x0F) << 8) | p[23];
+        ESP_LOGI(TAG, "LAME header: delay=%d, padding=%d", encoder_delay_, encoder_padding_);
+    }
+    return true;
+}
+
+bool Mp3StreamInfo::ParseVbri(const uint8_t *tag, size_t len)
+{
+    if (len < 26 || memcmp(tag, "VBRI", 4) != 0)
+    {
+        return false;
+    }
+    audio_bytes_ = ReadBe32(tag + 10);
+    total_frames_ = ReadBe32(tag + 14);
+    uint32_t entries = ReadBe(tag + 18, 2);
+    uint32_t scale = ReadBe(tag + 20, 2);
+    uint32_t entry_size = ReadBe(tag + 22, 2);
+    vbri_frames_per_entry_ = ReadBe(tag + 24, 2);
+    if (entry_size < 1 || entry_size > 4 || 26 + entries * entry_size > len)
+    {
+        return true;
+    }
+    vbri_table_.resize(entries);
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        vbri_table_[i] = ReadBe(tag + 26 + i * entry_size, entry_size) * scale;
+    }
+    return true;
+}
+
+int64_t Mp3StreamInfo::DurationMs() const
+{
+    if (!valid_)
+    {
+        return 0;
+    }
+    if (total_frames_ > 0)
+    {
+        return (int64_t)total_frames_ * samples_per_frame_ * 1000 / sample_rate_;
+    }
+    if (audio_bytes_ > 0 && bitrate_ > 0)
+    {
+        return (int64_t)audio_bytes_ * 8000 / bitrate_;
+    }
+    return 0;
+}
+
+int64_t Mp3StreamInfo::ValidSamples() const
+{
+    if (!valid_ || total_frames_ == 0)
+    {
+        return 0;
+    }
+    int64_t samples = (int64_t)total_frames_ * samples_per_frame_ - encoder_delay_ - encoder_padding_;
+    return samples > 0 ? samples : 0;
+}
+
+int Mp3StreamInfo::StartTrimSamples() const
+{
+    return encoder_delay_ > 0 || encoder_padding_ > 0 ? encoder_delay_ + MP3_DECODER_DELAY : 0;
+}
+
+size_t Mp3StreamInfo::OffsetForTime(int64_t time_ms) const
+{
+    if (!valid_ || time_ms <= 0)
+    {
+        return audio_start_;
+    }
+
+    size_t offset = 0;
+    int64_t duration_ms = DurationMs();
+    if (has_toc_ && duration_ms > 0 && audio_bytes_ > 0)
+    {
+        // TOC 在两个百分点之间线性插值
+        double percent = std::min(99.999, time_ms * 100.0 / duration_ms);
+        int index = (int)percent;
+        double a = toc_[index];
+        double b = index < 99 ? toc_[index + 1] : 256.0;
+        double position = a + (b - a) * (percent - index);
+        offset = (size_t)(position / 256.0 * audio_bytes_);
+    }
+    else if (!vbri_table_.empty() && vbri_frames_per_entry_ > 0)
+    {
+        int64_t entry_ms = (int64_t)vbri_frames_per_entry_ * samples_per_frame_ * 1000 / sample_rate_;
+        int64_t elapsed_ms = 0;
+        for (size_t i = 0; i < vbri_table_.size() && elapsed_ms + entry_ms <= time_ms; i++)
+        {
+            offset += vbri_table_[i];
+            elapsed_ms += entry_ms;
+        }
+    }
+    else if (bitrate_ > 0)
+    {
+        // CBR 或没有索引的 VBR，按第一帧的比特率估算
+        offset = (size_t)(time_ms * bitrate_ / 8000);
+    }
+
+    if (audio_bytes_ > 0)
+    {
+        offset = std::min(offset, audio_bytes_ - 1);
+    }
+    return audio_start_ + offset;
+}
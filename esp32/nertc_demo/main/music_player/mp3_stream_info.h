@@ -0,0 +1,53 @@
+#ifndef MP3_STREAM_INFO_H
+#define MP3_STREAM_INFO_H
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// MP3 流的全局信息，从第一帧中的 Xing/Info 或 VBRI 头解析
+// 用于把播放时间换算成文件中的字节偏移，以便用 HTTP Range 从该位置继续下载
+class Mp3StreamInfo {
+public:
+    void Reset();
+
+    // frame 指向第一帧的帧头，frame_offset 是它在文件中的位置，file_length 未知时为 0
+    // bitrate 与 sample_rate 取自解码器对该帧的解析结果
+    void Parse(const uint8_t* frame, size_t len, size_t frame_offset, size_t file_length,
+               int bitrate, int sample_rate);
+
+    bool valid() const { return valid_; }
+    size_t audio_start() const { return audio_start_; }
+    // 第一帧是不含音频的 Xing/Info 帧，解码出的静音需要丢弃
+    bool has_info_frame() const { return has_info_frame_; }
+    // LAME 头记录的编码器延迟与末尾填充 (每声道采样数)，没有 LAME 头时为 0
+    int encoder_delay() const { return encoder_delay_; }
+    int encoder_padding() const { return encoder_padding_; }
+    // 从头播放时开头需要丢弃的采样数 (每声道)，包括编码器延迟和解码器延迟
+    int StartTrimSamples() const;
+    // 去掉延迟与填充后的有效采样数 (每声道)，无法得知时为 0
+    int64_t ValidSamples() const;
+    // 整首歌的时长，无法得知时为 0
+    int64_t DurationMs() const;
+    // 播放到 time_ms 时对应的文件偏移，结果不一定落在帧边界上，解码前需要重新同步
+    size_t OffsetForTime(int64_t time_ms) const;
+
+private:
+    bool ParseXing(const uint8_t* tag, size_t len);
+    bool ParseVbri(const uint8_t* tag, size_t len);
+
+    bool valid_ = false;
+    bool has_info_frame_ = false;
+    int encoder_delay_ = 0;
+    int encoder_padding_ = 0;
+    size_t audio_start_ = 0;
+    size_t audio_bytes_ = 0;        // 音频数据总长度，未知时为 0
+    int bitrate_ = 0;               // bps，VBR 文件为第一帧的比特率
+    int sample_rate_ = 0;
+    int samples_per_frame_ = 0;
+    uint32_t total_frames_ = 0;     // Xing/VBRI 中记录的总帧数，未知时为 0
+    bool has_toc_ = false;
+    uint8_t toc_[100] = {};         // Xing TOC，第 i 项是 i% 时长处的位置 (1/256 audio_bytes_)
+    std::vector<uint32_t> vbri_table_;  // 每项是 vbri_frames_per_entry_ 帧的字节数
+    uint32_t vbri_frames_per_entry_ = 0;
+};
+#endif
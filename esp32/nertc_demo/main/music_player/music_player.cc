@@ -1,81 +1,8 @@
 #include "music_player.h"
 #include <vector>
 #include <cstring>
-#include <cmath>
 #include "mcp_server.h"
 #include "application.h"
-// 工具：把字节流拆成 16-bit 采样
-static void deinterleave_int16(const uint8_t* src, int16_t* dstL, int16_t* dstR, int samples) {
-    const int16_t* s = reinterpret_cast<const int16_t*>(src);
-    for (int i = 0; i < samples; ++i) {
-        dstL[i] = s[i * 2];
-        dstR[i] = s[i * 2 + 1];
-    }
-}
-
-// 工具：单声道 → 目标采样率
-static std::vector<int16_t> resample(const std::vector<int16_t>& in,
-                                      int inRate, int outRate) {
-    double ratio = static_cast<double>(inRate) / outRate;
-    int outLen = static_cast<int>(std::ceil(in.size() / ratio));
-    std::vector<int16_t> out(outLen);
-
-    for (int i = 0; i < outLen; ++i) {
-        double srcIdx = i * ratio;
-        int   idx0    = static_cast<int>(srcIdx);
-        int   idx1    = std::min(idx0 + 1, static_cast<int>(in.size()) - 1);
-        double frac   = srcIdx - idx0;
-        out[i] = static_cast<int16_t>(std::round(
-                    in[idx0] * (1.0 - frac) + in[idx1] * frac));
-    }
-    return out;
-}
-
-// 主接口
-void TransferInpuAudioIntoGivenParamAudio(const char* input_data,
-                                           int input_len,
-                                           int input_sample,
-                                           int input_channel,
-                                           int out_putchannel,
-                                           int out_sample,
-                                           std::vector<int16_t>& out_put_samples)
-{
-    out_put_samples.clear();
-    if (!input_data || input_len <= 0) return;
-
-    // 1. 字节流 → 16-bit 采样
-    int samples_in = input_len / 2;          // 16-bit 每采样 2 字节
-    std::vector<int16_t> pcm_in(samples_in);
-    std::memcpy(pcm_in.data(), input_data, input_len);
-
-    // 2. 通道处理：先统一到单声道
-    std::vector<int16_t> mono;
-    if (input_channel == 2) {
-        // 立体声 → 单声道 (L+R)/2
-        int frameCount = samples_in / 2;
-        mono.resize(frameCount);
-        const int16_t* p = pcm_in.data();
-        for (int i = 0; i < frameCount; ++i)
-            mono[i] = static_cast<int16_t>((static_cast<int32_t>(p[i*2]) + p[i*2+1]) >> 1);
-    } else {
-        mono = std::move(pcm_in);
-    }
-
-    // 3. 采样率转换
-    std::vector<int16_t> resampled = resample(mono, input_sample, out_sample);
-
-    // 4. 通道展开：单声道 → 立体声（如果需要）
-    if (out_putchannel == 2) {
-        int frames = resampled.size();
-        out_put_samples.resize(frames * 2);
-        for (int i = 0; i < frames; ++i) {
-            out_put_samples[i*2]   = resampled[i];
-            out_put_samples[i*2+1] = resampled[i];
-        }
-    } else {
-        out_put_samples = std::move(resampled);
-    }
-}
 
 int DataOutCb(unsigned char*data, int data_size, void *arg){
     auto player = static_cast<MusicPlayer*>(arg);
@@ -117,20 +44,15 @@ int MusicPlayer::DataCallback(uint8_t *data, int data_size){
     if(codec_ == nullptr){
         return -1;
     }
-    std::vector<int16_t> pcm;
-    //convert data to int16_t pcm
-    TransferInpuAudioIntoGivenParamAudio(reinterpret_cast<const char*>(data),
-                                          data_size,
-                                          sample_rate_,
-                                          channels_,
-                                          codec_->output_channels(),
-                                          codec_->output_sample_rate(),
-                                          pcm);
-    if (!codec_->output_enabled()) {
-        codec_->EnableOutput(true);
+    // 一步完成声道与采样率转换，缓冲区跨帧复用
+    if (!converter_.IsConfigured(sample_rate_, channels_, codec_->output_sample_rate(), codec_->output_channels())) {
+        converter_.Configure(sample_rate_, channels_, codec_->output_sample_rate(), codec_->output_channels());
+    }
+    std::vector<int16_t>& pcm = converter_.Convert(reinterpret_cast<const int16_t*>(data), data_size / 2);
+    // 交给 AudioService 混音，播报时音乐自动压低，同时进入回声消除参考
+    if (!audio_service_->WriteMusicData(pcm.data(), pcm.size())) {
+        return -1;
     }
-    codec_->OutputData(pcm);
-    audio_service_->UpdateLastOutputTime();
     return data_size;
 }
 
@@ -145,10 +67,35 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
         audio_service_ = audio_service;
         mp3_player_init(DataOutCb, InfoCb, PlayStateCb, this);
         mp3_online_player_.Mp3OnlinePlayerInit(DataOutCb, InfoCb, PlayStateCb, this);
+        // 与 PlayStateCallback 一样，只在列表中还有下一首时自动续播
+        mp3_online_player_.SetTrackCallbacks(
+            [this]() -> std::string {
+                std::lock_guard<std::mutex> lock(call_back_mutex_);
+                return music_list_manager_.PeekNextAirMusic().uri;
+            },
+            [this]() {
+                std::lock_guard<std::mutex> lock(call_back_mutex_);
+                MusicInfo music = music_list_manager_.GetNextAirMusic();
+                ESP_LOGI("MusicPlayer", "Playing next music without gap: %s", music.name.c_str());
+            });
+        // 停止或切歌时唤醒阻塞在混音器上的播放线程，让它尽快退出
+        mp3_online_player_.SetInterruptCallback([this]() {
+            ClearPendingAudio();
+        });
     }
     if(!sd_card_music_path.empty())
     {
         music_list_manager_.InitLocalMusicListAuto(sd_card_music_path);
+        // 启动时只读取索引，目录扫描放到低优先级任务中，曲库很大时也不拖慢启动
+        xTaskCreate(
+        [](void* arg){
+            MusicPlayer* player = (MusicPlayer*)arg;
+            if(player->music_list_manager_.RescanLocalMusic()){
+                std::lock_guard<std::mutex> lock(player->call_back_mutex_);
+                player->music_list_manager_.RefreshLocalMusicList();
+            }
+            vTaskDelete(NULL);
+        }, "music_scan", 6 * 1024, this, 1, NULL);
     }
     //add mcp tools
     McpServer::GetInstance().AddTool("self.music_player.play_online_music", 
@@ -166,16 +113,13 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
                 int play_index = properties[param].value<int>();
                 if(music_list_manager_.PlayCachedAirMusicByIndex(play_index)){
                     if(PlayCurrentAirMusic()){
-                        Application::GetInstance().Close();
                         return R"({"operator":"success","message":"Music playing from cached list"})";;
                     }
                 }
                 if(PlayAirMusicByIndex(play_index)){
-                    Application::GetInstance().Close();
                     return R"({"operator":"success","message":"Music playing"})";;
                 }
                 if(!music_list_manager_.IsAirMusicListEmpty() && PlayAirMusicByIndex(0)){
-                    Application::GetInstance().Close();
                     return R"({"operator":"success","message":"Music playing, but play_index out of range, play the first music"})";
                 }
                 return R"({"operator":"fail","message":"No music found at given index"})";
@@ -184,23 +128,33 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
                 return R"({"operator":"fail","message":"Invalid play_index"})";
             }
         });
-#if 0
+    if(!sd_card_music_path.empty()){
         McpServer::GetInstance().AddTool("self.music_player.play_local_music", 
             "Play music from given music name "
-            "当用户想要播放本地sd卡中音乐时，可以调用此工具，并传入音乐的名字{name}。", 
+            "当用户想要播放本地sd卡中音乐时，可以调用此工具，并传入音乐的名字或歌手名{name}，支持模糊匹配。", 
             PropertyList({Property("name", kPropertyTypeString)}), 
             [this](const PropertyList& properties) -> ReturnValue {
                 std::string param = "name";
-                std::string mp3_path = properties[param].value<std::string>();
-                if(!mp3_path.empty()){
-                    Application::GetInstance().Close();
-                    this->Play(mp3_path.c_str());
-                    return R"({"operator":"success","message":"Music playing"})";;
+                std::string name = properties[param].value<std::string>();
+                ESP_LOGI("MusicPlayer", "Received play_local_music tool call: %s", name.c_str());
+                MusicInfo music;
+                {
+                    std::lock_guard<std::mutex> lock(call_back_mutex_);
+                    music = music_list_manager_.FindLocalMusic(name);
+                }
+                if(music.uri.empty()){
+                    return R"({"operator":"fail","message":"No local music matches the given name"})";
                 }
-                //to do fallback play
-                return R"({"operator":"fail","message":"mp3_uri is empty"})";
+                this->StopAirPlay();
+                this->Play(music.uri.c_str());
+                cJSON* result = cJSON_CreateObject();
+                cJSON_AddStringToObject(result, "operator", "success");
+                cJSON_AddStringToObject(result, "message", "Music playing");
+                cJSON_AddStringToObject(result, "name", music.name.c_str());
+                cJSON_AddStringToObject(result, "artist", music.artist.c_str());
+                return result;
             });
-#endif
+    }
     McpServer::GetInstance().AddTool("self.music_player.stop_music",
         "Stop playing music "
         "当用户想要停止播放音乐时，可以调用此工具。", 
@@ -210,6 +164,17 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
             this->StopAirPlay();
             return R"({"operator":"success","message":"Music stopped"})";
         });
+    McpServer::GetInstance().AddTool("self.music_player.seek",
+        "Seek the current music to the given position in seconds "
+        "当用户想要快进、快退或从某个时间点继续播放当前音乐时，可以调用此工具，并传入目标位置{position}(秒)。",
+        PropertyList({Property("position", kPropertyTypeInteger, 0, 24 * 3600)}),
+        [this](const PropertyList& properties) -> ReturnValue {
+            ESP_LOGI("MusicPlayer", "Received seek tool call");
+            if(this->Seek(properties["position"].value<int>())){
+                return R"({"operator":"success","message":"Music seeking"})";
+            }
+            return R"({"operator":"fail","message":"No online music playing"})";
+        });
     McpServer::GetInstance().AddTool("self.music_player.next_music", 
         "Play next music "
         "当用户想听下一首音乐时，可以调用此工具",
@@ -217,7 +182,6 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
         [this](const PropertyList& properties) -> ReturnValue {
             ESP_LOGI("MusicPlayer", "Received next_music tool call");
             if(this->PlayNextAirMusic()){
-                Application::GetInstance().Close();
                 return R"({"operator":"success","message":"Playing next music"})";
             }
             return R"({"operator":"failed","message":"Playing next music"})";
@@ -229,7 +193,6 @@ int MusicPlayer::Initialize(AudioCodec* codec, AudioService* audio_service, std:
         [this](const PropertyList& properties) -> ReturnValue {
             ESP_LOGI("MusicPlayer", "Received previous_music tool call");
             if(this->PlayPreviousAirMusic()){
-                Application::GetInstance().Close();
                 return R"({"operator":"success","message":"Playing previous music"})";
             }
             return R"({"operator":"fail","message":"Playing previous music"})";
@@ -252,23 +215,52 @@ void MusicPlayer::Play(const char* mp3_path){
         struct Params{
             Mp3OnlinePlayer* ptr;
             std::string url;
+            uint32_t session;
         };
         Params* input = new Params;
         input->ptr = &mp3_online_player_;
         input->url = std::string(mp3_path);
+        // 任务执行前又有新的播放或停止请求时，这次请求直接作废
+        input->session = mp3_online_player_.NewSession();
+        // StartStreaming 会先停止上一首 (等待线程退出、关闭连接) 再查缓存、建立连接，2K 的栈不够用
         xTaskCreate(
         [](void* arg){
             Params* p = (Params*)arg;
             Mp3OnlinePlayer* palyer = p->ptr;
-            palyer->StartStreaming(p->url);
+            palyer->StartStreaming(p->url, p->session);
             delete p;
             vTaskDelete(NULL);
-        }, "tmp_play", 2 * 1024, input, 8,  NULL); 
+        }, "tmp_play", 4 * 1024, input, 8,  NULL); 
     } else {
         mp3_player_play(mp3_path, false, this);
     }
 }
 
+bool MusicPlayer::Seek(int position_s){
+    if(!initialed || current_state_ != music_player_state_t::MUSIC_PLAYER_STATE_PLAYING){
+        return false;
+    }
+    if (!is_air_music_playing_) {
+        // esp_audio_simple_player 没有跳转接口，本地音乐暂不支持
+        return false;
+    }
+    // 跳转需要重新建立连接，和 Play 一样放到临时任务中执行
+    struct Params{
+        Mp3OnlinePlayer* ptr;
+        int64_t position_ms;
+        uint32_t session;
+    };
+    Params* input = new Params{&mp3_online_player_, (int64_t)position_s * 1000, mp3_online_player_.session()};
+    xTaskCreate(
+    [](void* arg){
+        Params* p = (Params*)arg;
+        p->ptr->Seek(p->position_ms, p->session);
+        delete p;
+        vTaskDelete(NULL);
+    }, "tmp_seek", 3 * 1024, input, 8,  NULL);
+    return true;
+}
+
 void MusicPlayer::UpdateAirMusicListAndPlay(const std::vector<MusicInfo>& music_list, bool play_now){
     if(!initialed){
         return;
@@ -276,10 +268,7 @@ void MusicPlayer::UpdateAirMusicListAndPlay(const std::vector<MusicInfo>& music_
     if(play_now){
         music_list_manager_.ClearCacheAirMusicList();
         music_list_manager_.SetAirMusicList(music_list);
-        bool res = PlayCurrentAirMusic();
-        if(res){
-            Application::GetInstance().Close();
-        }
+        PlayCurrentAirMusic();
     }
     music_list_manager_.CacheAirMusicList(music_list);
 }
\ No newline at end of file
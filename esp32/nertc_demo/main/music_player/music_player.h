@@ -3,10 +3,12 @@
 #include "music_player_api.h"
 #include "audio/audio_codec.h"
 #include "audio/audio_service.h"
+#include "audio/pcm_converter.h"
 #include <string>
 #include <vector>
 #include "esp_log.h"
 #include "mp3_online_player.h"
+#include "local_music_library.h"
 struct MusicInfo {
     std::string name;
     std::string uri;
@@ -63,8 +65,43 @@ public:
         }
     }
 
+    // 读取曲库索引生成本地播放列表，不扫描目录，扫描由 RescanLocalMusic 在后台完成
     void InitLocalMusicListAuto(const std::string& sd_card_music_path) {
-        // to do
+        local_library_.Load(sd_card_music_path);
+        RefreshLocalMusicList();
+    }
+
+    // 增量扫描曲库，有变化时返回 true，之后需要调用 RefreshLocalMusicList
+    bool RescanLocalMusic() {
+        return local_library_.Rescan();
+    }
+
+    void RefreshLocalMusicList() {
+        std::vector<MusicInfo> music_list;
+        for (auto& entry : local_library_.Entries()) {
+            music_list.push_back({entry.title, "file:/" + local_library_.FullPath(entry), entry.album, entry.artist});
+        }
+        SetLocalMusicList(music_list);
+    }
+
+    // 按名字查找本地音乐，先精确匹配再模糊匹配，找到后成为当前播放的位置
+    MusicInfo FindLocalMusic(const std::string& name) {
+        LocalMusicEntry entry;
+        if (!local_library_.Find(name, entry)) {
+            std::vector<LocalMusicEntry> results = local_library_.Search(name, 1);
+            if (results.empty()) {
+                return {};
+            }
+            entry = results[0];
+        }
+        std::string uri = "file:/" + local_library_.FullPath(entry);
+        for (size_t i = 0; i < local_music_list_.size(); i++) {
+            if (local_music_list_[i].uri == uri) {
+                current_local_music_index_ = i;
+                return local_music_list_[i];
+            }
+        }
+        return {entry.title, uri, entry.album, entry.artist};
     }
 
     void ClearAirMusicList() {
@@ -117,6 +154,14 @@ public:
         return air_music_list_[current_air_music_index_];
     }
 
+    // 不移动当前位置，返回下一首；当前已是最后一首时返回空
+    MusicInfo PeekNextAirMusic() {
+        if (air_music_list_.empty() || current_air_music_index_ + 1 >= static_cast<int>(air_music_list_.size())) {
+            return {};
+        }
+        return air_music_list_[current_air_music_index_ + 1];
+    }
+
     MusicInfo GetNextLocalMusic() {
         if (local_music_list_.empty()) {
             return {};
@@ -146,6 +191,7 @@ private:
     std::vector<MusicInfo> air_music_list_cache_;
     int current_air_music_index_ = -1;
     int current_local_music_index_ = -1;
+    LocalMusicLibrary local_library_;
 };
 
 //music player 单例
@@ -194,10 +240,14 @@ public:
 
     void StopAirPlay(){
         mp3_online_player_.StopStreaming();
+        ClearPendingAudio();
     }
     void StopPlay() {
         mp3_player_stop();
+        ClearPendingAudio();
     }
+    // 跳转到当前歌曲的 position_s 秒处
+    bool Seek(int position_s);
 
     bool CurrentPlayingLastMusic(){
         return music_list_manager_.CurrentLastMusicOnList(is_air_music_playing_);
@@ -223,17 +273,24 @@ private:
     MusicPlayer& operator=(const MusicPlayer&) = delete;
 private:
     void Play(const char* mp3_path);  
+    // 丢弃混音器中尚未播放的音乐，停止后立即静音
+    void ClearPendingAudio(){
+        if(audio_service_ != nullptr){
+            audio_service_->ClearMusicData();
+        }
+    }
 private:
     int sample_rate_ = 48000;
     int channels_ = 2;
     int bits_ = 16;
     AudioCodec* codec_ = nullptr;
     MusicListManager music_list_manager_;
-    AudioService* audio_service_;
+    AudioService* audio_service_ = nullptr;
     music_player_state_t current_state_ = music_player_state_t::MUSIC_PLAYER_STATE_NONE;
     bool is_air_music_playing_ = true;
     std::mutex call_back_mutex_;
     bool initialed = false;
     Mp3OnlinePlayer mp3_online_player_;
+    PcmConverter converter_;
 };
 #endif //MUSIC_PLAYER_H
\ No newline at end of file
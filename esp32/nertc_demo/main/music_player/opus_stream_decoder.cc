@@ -0,0 +1,99 @@
+#include "opus_stream_decoder.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "OPUS_STREAM_DECODER"
+
+#define OPUS_SAMPLE_RATE 48000
+// 一个包最长 120ms
+#define OPUS_MAX_FRAME_SAMPLES (OPUS_SAMPLE_RATE * 120 / 1000)
+// 每次交给解封装器的字节数，够一页左右即可，避免一次解出大量等待的包
+#define OPUS_FEED_SIZE 1024
+
+OpusStreamDecoder::~OpusStreamDecoder()
+{
+    if (decoder_ != nullptr)
+    {
+        opus_decoder_destroy(decoder_);
+    }
+}
+
+bool OpusStreamDecoder::Initialize()
+{
+    demuxer_.OnPacket([this](const uint8_t* data, size_t size) {
+        Packet packet;
+        packet.data.assign(data, data + size);
+        if (demuxer_.end_of_stream())
+        {
+            packet.end = demuxer_.granule_position();
+        }
+        packets_.push_back(std::move(packet));
+    });
+    return true;
+}
+
+DecodeResult OpusStreamDecoder::DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame)
+{
+    if (packets_.empty())
+    {
+        consumed = std::min(len, (size_t)OPUS_FEED_SIZE);
+        demuxer_.Process(data, consumed);
+        if (packets_.empty())
+        {
+            return consumed > 0 ? DecodeResult::kSkipped : DecodeResult::kNeedMoreData;
+        }
+    }
+
+    if (decoder_ == nullptr)
+    {
+        // 解封装器只在读到 OpusHead 之后才输出音频包
+        channels_ = demuxer_.channels();
+        if (channels_ < 1 || channels_ > 2)
+        {
+            ESP_LOGE(TAG, "Unsupported channel count: %d", channels_);
+            return DecodeResult::kFatal;
+        }
+        int error = 0;
+        decoder_ = opus_decoder_create(OPUS_SAMPLE_RATE, channels_, &error);
+        if (decoder_ == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create Opus decoder: %d", error);
+            return DecodeResult::kFatal;
+        }
+        pcm_.resize(OPUS_MAX_FRAME_SAMPLES * channels_);
+        pre_skip_ = demuxer_.pre_skip();
+        ESP_LOGI(TAG, "Opus stream: %d channels, pre-skip %d", channels_, pre_skip_);
+    }
+
+    Packet packet = std::move(packets_.front());
+    packets_.pop_front();
+    int samples = opus_decode(decoder_, packet.data.data(), packet.data.size(), pcm_.data(), OPUS_MAX_FRAME_SAMPLES, 0);
+    if (samples < 0)
+    {
+        ESP_LOGW(TAG, "Opus decode failed with error: %d", samples);
+        return DecodeResult::kError;
+    }
+    int decoded = samples;
+    // 最后一页的 granule position 是整个流的长度 (包括 pre-skip)，超出的是编码器补齐帧长的填充
+    // 从流中间开始的流 granule position 远大于 position_，不会被截断
+    if (packet.end >= 0 && position_ + samples > packet.end)
+    {
+        samples = (int)std::max<int64_t>(0, packet.end - position_);
+    }
+    position_ += decoded;
+
+    int skip = std::min(pre_skip_, samples);
+    pre_skip_ -= skip;
+    if (samples == skip)
+    {
+        return DecodeResult::kSkipped;
+    }
+    frame.pcm = pcm_.data() + skip * channels_;
+    frame.samples = samples - skip;
+    frame.sample_rate = OPUS_SAMPLE_RATE;
+    frame.channels = channels_;
+    frame.bitrate = packet.data.size() * 8 * OPUS_SAMPLE_RATE / decoded;
+    frame.offset = 0;
+    return DecodeResult::kFrame;
+}
@@ -0,0 +1,34 @@
+#ifndef OPUS_STREAM_DECODER_H
+#define OPUS_STREAM_DECODER_H
+#include "stream_decoder.h"
+#include "audio/ogg_demuxer.h"
+#include <deque>
+#include <vector>
+
+#include "opus.h"
+
+// Ogg/Opus 解码，输出 48kHz，按 OpusHead 中的 pre-skip 丢弃开头的采样，
+// 按最后一页的 granule position 丢弃结尾的填充采样
+class OpusStreamDecoder : public StreamDecoder {
+public:
+    ~OpusStreamDecoder() override;
+    const char* name() const override { return "opus"; }
+    bool Initialize() override;
+
+protected:
+    DecodeResult DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame) override;
+
+private:
+    OggDemuxer demuxer_;
+    OpusDecoder* decoder_ = nullptr;
+    struct Packet {
+        std::vector<uint8_t> data;
+        int64_t end = -1;       // 位于最后一页时为该页的 granule position
+    };
+    std::deque<Packet> packets_;    // 已解封装、等待解码的包
+    std::vector<int16_t> pcm_;
+    int channels_ = 0;
+    int pre_skip_ = 0;
+    int64_t position_ = 0;  // 已解码的采样数，包括 pre-skip
+};
+#endif
@@ -0,0 +1,123 @@
+#include "stream_decoder.h"
+#include "mp3_stream_decoder.h"
+#include "aac_stream_decoder.h"
+#include "opus_stream_decoder.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "STREAM_DECODER"
+
+// 识别格式时最多向后查找帧同步字的字节数
+#define SNIFF_WINDOW 2048
+
+const char* StreamFormatName(StreamFormat format)
+{
+    switch (format)
+    {
+    case StreamFormat::kMp3: return "mp3";
+    case StreamFormat::kAac: return "aac";
+    case StreamFormat::kM4a: return "m4a";
+    case StreamFormat::kOpus: return "opus";
+    default: return "unknown";
+    }
+}
+
+// ADTS 头: 12 位同步字，layer 为 0，采样率索引小于 13
+static bool IsAdtsHeader(const uint8_t* p)
+{
+    return p[0] == 0xFF && (p[1] & 0xF6) == 0xF0 && ((p[2] >> 2) & 0x0F) < 13;
+}
+
+// MPEG 音频帧头: 11 位同步字，layer 不为 0，比特率和采样率索引有效
+static bool IsMpegAudioHeader(const uint8_t* p)
+{
+    return p[0] == 0xFF && (p[1] & 0xE0) == 0xE0 && (p[1] & 0x06) != 0 &&
+           (p[2] & 0xF0) != 0xF0 && (p[2] & 0x0C) != 0x0C;
+}
+
+StreamFormat SniffStreamFormat(const uint8_t* data, size_t len)
+{
+    if (len >= 4 && memcmp(data, "OggS", 4) == 0)
+    {
+        // 第一页只有 OpusHead 一个包，Ogg Vorbis 等其他编码不支持
+        return len >= 36 && memcmp(data + 28, "OpusHead", 8) == 0 ? StreamFormat::kOpus : StreamFormat::kUnknown;
+    }
+    if (len >= 8 && memcmp(data + 4, "ftyp", 4) == 0)
+    {
+        return StreamFormat::kM4a;
+    }
+
+    // ADTS 与 MPEG 音频的同步字只差 layer 字段，ADTS 再用下一帧的帧头确认
+    size_t end = std::min(len, (size_t)SNIFF_WINDOW);
+    for (size_t i = 0; i + 6 <= end; i++)
+    {
+        if (IsAdtsHeader(data + i))
+        {
+            size_t frame_len = ((data[i + 3] & 0x03) << 11) | (data[i + 4] << 3) | (data[i + 5] >> 5);
+            size_t next = i + frame_len;
+            if (frame_len > 7 && (next + 3 > len || IsAdtsHeader(data + next)))
+            {
+                return StreamFormat::kAac;
+            }
+        }
+        else if (IsMpegAudioHeader(data + i))
+        {
+            return StreamFormat::kMp3;
+        }
+    }
+    return StreamFormat::kUnknown;
+}
+
+DecodeResult StreamDecoder::Decode(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame)
+{
+    consumed = 0;
+    int64_t start = esp_timer_get_time();
+    DecodeResult result = DecodeFrame(data, len, eos, consumed, frame);
+    stats_.decode_us += esp_timer_get_time() - start;
+    if (result == DecodeResult::kFrame && frame.sample_rate > 0)
+    {
+        stats_.frames++;
+        stats_.audio_us += (int64_t)frame.samples * 1000000 / frame.sample_rate;
+    }
+    return result;
+}
+
+float StreamDecoder::CpuLoad() const
+{
+    return stats_.audio_us > 0 ? stats_.decode_us * 100.0f / stats_.audio_us : 0;
+}
+
+void StreamDecoder::LogStats() const
+{
+    ESP_LOGI(TAG, "%s decoder: %u frames, %lldms audio in %lldms, CPU %.1f%%", name(),
+             (unsigned int)stats_.frames, stats_.audio_us / 1000, stats_.decode_us / 1000, CpuLoad());
+}
+
+std::unique_ptr<StreamDecoder> CreateStreamDecoder(StreamFormat format)
+{
+    std::unique_ptr<StreamDecoder> decoder;
+    switch (format)
+    {
+    case StreamFormat::kAac:
+        decoder = std::make_unique<AacStreamDecoder>(false);
+        break;
+    case StreamFormat::kM4a:
+        decoder = std::make_unique<AacStreamDecoder>(true);
+        break;
+    case StreamFormat::kOpus:
+        decoder = std::make_unique<OpusStreamDecoder>();
+        break;
+    default:
+        decoder = std::make_unique<Mp3StreamDecoder>();
+        break;
+    }
+    if (!decoder->Initialize())
+    {
+        ESP_LOGE(TAG, "Failed to initialize %s decoder", decoder->name());
+        return nullptr;
+    }
+    return decoder;
+}
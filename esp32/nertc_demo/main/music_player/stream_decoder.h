@@ -0,0 +1,68 @@
+#ifndef STREAM_DECODER_H
+#define STREAM_DECODER_H
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// 在线音乐支持的流格式
+enum class StreamFormat {
+    kUnknown,
+    kMp3,
+    kAac,       // ADTS 封装的 AAC
+    kM4a,       // MP4 封装的 AAC，moov 需要位于 mdat 之前
+    kOpus,      // Ogg 封装的 Opus
+};
+
+const char* StreamFormatName(StreamFormat format);
+// 根据数据开头识别格式，data 应从 ID3 标签之后开始，无法识别时返回 kUnknown
+StreamFormat SniffStreamFormat(const uint8_t* data, size_t len);
+
+// 解码出的一帧 PCM，数据在下一次 Decode 前有效
+struct DecodedFrame {
+    const int16_t* pcm = nullptr;
+    int samples = 0;            // 每声道采样数
+    int sample_rate = 0;
+    int channels = 0;
+    int bitrate = 0;
+    size_t offset = 0;          // 该帧在输入数据中的起始位置
+};
+
+enum class DecodeResult {
+    kFrame,         // 输出了一帧
+    kSkipped,       // 消费了不含音频的数据，或内部状态有推进，继续调用即可
+    kNeedMoreData,  // 输入不足一帧
+    kError,         // 当前帧损坏，已跳过
+    kFatal,         // 流无法继续解码
+};
+
+struct StreamDecoderStats {
+    uint32_t frames = 0;
+    int64_t decode_us = 0;      // Decode 的累计耗时
+    int64_t audio_us = 0;       // 解码出的音频时长
+};
+
+// 流式解码器接口，输入是环形缓冲区中的一段连续数据
+// 每次调用至多解码一帧，consumed 返回消费的字节数，调用方据此推进读位置
+class StreamDecoder {
+public:
+    virtual ~StreamDecoder() = default;
+    virtual const char* name() const = 0;
+    virtual bool Initialize() = 0;
+
+    DecodeResult Decode(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame);
+
+    const StreamDecoderStats& stats() const { return stats_; }
+    // 解码耗时占音频时长的百分比
+    float CpuLoad() const;
+    void LogStats() const;
+
+protected:
+    virtual DecodeResult DecodeFrame(const uint8_t* data, size_t len, bool eos, size_t& consumed, DecodedFrame& frame) = 0;
+
+private:
+    StreamDecoderStats stats_;
+};
+
+// 创建并初始化对应格式的解码器，失败时返回 nullptr
+std::unique_ptr<StreamDecoder> CreateStreamDecoder(StreamFormat format);
+#endif
@@ -0,0 +1,199 @@
+#include "stream_ring_buffer.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#define TAG "STREAM_RING_BUFFER"
+
+StreamRingBuffer::StreamRingBuffer(size_t capacity, size_t guard_size)
+    : capacity_(capacity), guard_size_(guard_size)
+{
+}
+
+StreamRingBuffer::~StreamRingBuffer()
+{
+    if (buffer_)
+    {
+        heap_caps_free(buffer_);
+    }
+}
+
+bool StreamRingBuffer::Allocate()
+{
+    if (buffer_)
+    {
+        return true;
+    }
+    buffer_ = (uint8_t *)heap_caps_malloc(capacity_ + guard_size_, MALLOC_CAP_SPIRAM);
+    if (!buffer_)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes", (unsigned int)(capacity_ + guard_size_));
+        return false;
+    }
+    return true;
+}
+
+void StreamRingBuffer::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_pos_ = 0;
+    write_pos_ = 0;
+    size_ = 0;
+    segment_end_ = SIZE_MAX;
+    finished_ = false;
+    closed_ = false;
+}
+
+void StreamRingBuffer::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    cv_.notify_all();
+}
+
+uint8_t *StreamRingBuffer::WaitWritable(size_t min_space, size_t &len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    min_space = std::min(min_space, capacity_);
+    cv_.wait(lock, [this, min_space]
+             { return capacity_ - size_ >= min_space || closed_; });
+    if (closed_)
+    {
+        len = 0;
+        return nullptr;
+    }
+    len = std::min(capacity_ - size_, capacity_ - write_pos_);
+    return buffer_ + write_pos_;
+}
+
+void StreamRingBuffer::Commit(size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    write_pos_ = (write_pos_ + len) % capacity_;
+    size_ += len;
+    cv_.notify_all();
+}
+
+void StreamRingBuffer::Finish()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    cv_.notify_all();
+}
+
+void StreamRingBuffer::MarkSegment(size_t tag)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    segment_end_ = size_;
+    segment_tag_ = tag;
+    cv_.notify_all();
+}
+
+bool StreamRingBuffer::HasPendingSegment()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segment_end_ != SIZE_MAX;
+}
+
+bool StreamRingBuffer::HasPendingSegment(size_t &tag)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segment_end_ == SIZE_MAX)
+    {
+        return false;
+    }
+    tag = segment_tag_;
+    return true;
+}
+
+// 当前段中还能读取的数据，调用时持有 mutex_
+size_t StreamRingBuffer::SegmentRemaining() const
+{
+    return std::min(size_, segment_end_);
+}
+
+const uint8_t *StreamRingBuffer::WaitReadable(size_t min_len, size_t &len, bool *segment_end)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    min_len = std::min(min_len, capacity_);
+    cv_.wait(lock, [this, min_len]
+             { return SegmentRemaining() >= min_len || segment_end_ <= size_ || finished_ || closed_; });
+    if (closed_)
+    {
+        len = 0;
+        return nullptr;
+    }
+    const uint8_t *view = ReadView(len);
+    if (segment_end != nullptr)
+    {
+        *segment_end = SegmentCompleteLocked() && len == SegmentRemaining();
+    }
+    return view;
+}
+
+// 调用时持有 mutex_。被复制到镜像区的数据已经提交，在读方消费之前写方不会覆盖
+const uint8_t *StreamRingBuffer::ReadView(size_t &len)
+{
+    size_t readable = SegmentRemaining();
+    size_t first = std::min(readable, capacity_ - read_pos_);
+    len = first;
+    if (first < readable && first < guard_size_)
+    {
+        size_t wrapped = std::min(readable - first, guard_size_ - first);
+        memcpy(buffer_ + capacity_, buffer_, wrapped);
+        len += wrapped;
+    }
+    return buffer_ + read_pos_;
+}
+
+void StreamRingBuffer::Consume(size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    len = std::min(len, SegmentRemaining());
+    read_pos_ = (read_pos_ + len) % capacity_;
+    size_ -= len;
+    if (segment_end_ != SIZE_MAX)
+    {
+        segment_end_ -= len;
+    }
+    cv_.notify_all();
+}
+
+bool StreamRingBuffer::NextSegment()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segment_end_ != 0)
+    {
+        return false;
+    }
+    segment_end_ = SIZE_MAX;
+    cv_.notify_all();
+    return true;
+}
+
+size_t StreamRingBuffer::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+bool StreamRingBuffer::finished()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+}
+
+bool StreamRingBuffer::SegmentComplete()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return SegmentCompleteLocked();
+}
+
+// 调用时持有 mutex_
+bool StreamRingBuffer::SegmentCompleteLocked() const
+{
+    return finished_ || segment_end_ != SIZE_MAX;
+}
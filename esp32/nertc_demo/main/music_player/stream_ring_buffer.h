@@ -0,0 +1,70 @@
+#ifndef STREAM_RING_BUFFER_H
+#define STREAM_RING_BUFFER_H
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+// 下载线程与播放线程共享的字节环形缓冲区
+// 缓冲区只在 Allocate 时分配一次，读写双方直接访问其中的内存，不再逐块分配和拷贝。
+// 数据区之后留有 guard_size 字节的镜像区，读取跨越末尾时把开头的数据复制过去，
+// 因此读方总能拿到一段连续的数据交给解码器。
+// 写方可以在两首歌之间做分段标记，读方不会读过分段处，需要调用 NextSegment 才能继续。
+class StreamRingBuffer {
+public:
+    StreamRingBuffer(size_t capacity, size_t guard_size);
+    ~StreamRingBuffer();
+    StreamRingBuffer(const StreamRingBuffer&) = delete;
+    StreamRingBuffer& operator=(const StreamRingBuffer&) = delete;
+
+    bool Allocate();
+    // 清空数据并重新打开，调用时不能有线程在读写
+    void Reset();
+    // 唤醒所有等待者，之后的等待立即返回 nullptr
+    void Close();
+
+    // 写方：等待至少 min_space 字节空闲，返回可连续写入的位置和长度
+    uint8_t* WaitWritable(size_t min_space, size_t& len);
+    void Commit(size_t len);
+    // 写方：数据已经写完
+    void Finish();
+    // 写方：之后写入的数据属于下一段，同一时间只能有一个未被读方越过的标记
+    // tag 随标记保存，描述结束的这一段 (例如所属文件的长度)
+    void MarkSegment(size_t tag = 0);
+    bool HasPendingSegment();
+    // 有未被读方越过的标记时返回 true 并取出它的 tag
+    bool HasPendingSegment(size_t& tag);
+
+    // 读方：等待至少 min_len 字节数据或写方结束，返回连续的数据视图
+    // 写方结束或读到分段处且没有数据时返回非空指针且 len 为 0
+    // segment_end 返回当前段是否已经写完且视图包含了其剩余的全部数据
+    const uint8_t* WaitReadable(size_t min_len, size_t& len, bool* segment_end = nullptr);
+    void Consume(size_t len);
+    // 读方：位于分段处时越过它并返回 true
+    bool NextSegment();
+
+    size_t Size();
+    size_t capacity() const { return capacity_; }
+    bool finished();
+    // 当前段的数据已经全部写入 (写方结束或已做分段标记)
+    bool SegmentComplete();
+
+private:
+    const uint8_t* ReadView(size_t& len);
+    size_t SegmentRemaining() const;
+    bool SegmentCompleteLocked() const;
+
+    uint8_t* buffer_ = nullptr;
+    size_t capacity_;
+    size_t guard_size_;
+    size_t read_pos_ = 0;
+    size_t write_pos_ = 0;
+    size_t size_ = 0;
+    size_t segment_end_ = SIZE_MAX;     // 分段处到读位置的距离，没有分段时为 SIZE_MAX
+    size_t segment_tag_ = 0;
+    bool finished_ = false;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+#endif
@@ -0,0 +1,352 @@
+#include "ota_upgrade.h"
+#include "settings.h"
+#include "board.h"
+
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <esp_app_format.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <spi_flash_mmap.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/event_groups.h>
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#define TAG "Ota"
+
+// Firmware is streamed through a small pool of large blocks: the caller's task
+// downloads into free blocks while a writer task drains full blocks into flash,
+// so network stalls and flash erase/write overlap instead of serializing.
+// Every block except the last is full, which keeps flash offsets sector aligned.
+#define OTA_BLOCK_SIZE          (16 * 1024)
+#define OTA_BLOCK_COUNT         4
+#define OTA_MAX_RETRY           8
+#define OTA_SAVE_INTERVAL       (64 * 1024)
+#define OTA_WRITER_DONE_EVENT   (1 << 0)
+
+struct OtaBlock {
+    char* data;
+    size_t size;    // 0 marks the end of the stream
+};
+
+struct OtaWriter {
+    esp_ota_handle_t handle = 0;
+    QueueHandle_t free_queue = nullptr;
+    QueueHandle_t full_queue = nullptr;
+    EventGroupHandle_t event_group = nullptr;
+    std::atomic<size_t> written{0};
+    std::atomic<bool> failed{false};
+    int64_t write_time_us = 0;
+};
+
+static void OtaWriterTask(void* arg) {
+    auto writer = static_cast<OtaWriter*>(arg);
+    size_t last_saved = writer->written;
+    OtaBlock block;
+    while (xQueueReceive(writer->full_queue, &block, portMAX_DELAY) == pdTRUE) {
+        if (block.size == 0) {
+            break;
+        }
+        if (!writer->failed) {
+            auto start_time = esp_timer_get_time();
+            auto err = esp_ota_write(writer->handle, block.data, block.size);
+            writer->write_time_us += esp_timer_get_time() - start_time;
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write OTA data: %s", esp_err_to_name(err));
+                writer->failed = true;
+            } else {
+                size_t written = writer->written += block.size;
+                // Only persist sector aligned offsets, esp_ota_write re-erases
+                // the sector it starts in when the upgrade resumes from there
+                if (written % SPI_FLASH_SEC_SIZE == 0 && written - last_saved >= OTA_SAVE_INTERVAL) {
+                    Settings settings("ota", true);
+                    settings.SetInt("offset", written);
+                    last_saved = written;
+                }
+            }
+        }
+        xQueueSend(writer->free_queue, &block, portMAX_DELAY);
+    }
+    xEventGroupSetBits(writer->event_group, OTA_WRITER_DONE_EVENT);
+    vTaskDelete(NULL);
+}
+
+static std::unique_ptr<Http> OpenFirmwareStream(const std::string& url, size_t offset, size_t& total_size) {
+    auto network = Board::GetInstance().GetNetwork();
+    auto http = network->CreateHttp(0);
+    if (offset > 0) {
+        http->SetHeader("Range", "bytes=" + std::to_string(offset) + "-");
+    }
+    if (!http->Open("GET", url)) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection");
+        return nullptr;
+    }
+
+    int status_code = http->GetStatusCode();
+    if (offset == 0) {
+        if (status_code != 200) {
+            ESP_LOGE(TAG, "Failed to get firmware, status code: %d", status_code);
+            return nullptr;
+        }
+        size_t content_length = http->GetBodyLength();
+        if (content_length == 0) {
+            ESP_LOGE(TAG, "Failed to get content length");
+            return nullptr;
+        }
+        if (total_size != 0 && total_size != content_length) {
+            ESP_LOGE(TAG, "Firmware size changed from %u to %u", total_size, content_length);
+            return nullptr;
+        }
+        total_size = content_length;
+        return http;
+    }
+
+    if (status_code != 206) {
+        ESP_LOGW(TAG, "Range request not honored, status code: %d", status_code);
+        return nullptr;
+    }
+
+    // Content-Range: bytes <first>-<last>/<total>
+    unsigned long first = 0, total = 0;
+    auto content_range = http->GetResponseHeader("Content-Range");
+    if (sscanf(content_range.c_str(), "bytes %lu-%*lu/%lu", &first, &total) != 2 ||
+        first != offset || (total_size != 0 && total != total_size)) {
+        ESP_LOGW(TAG, "Unexpected Content-Range: %s", content_range.c_str());
+        return nullptr;
+    }
+    total_size = total;
+    return http;
+}
+
+bool UpgradeFirmware(const std::string& url, const esp_partition_t* partition,
+    std::function<void(int progress, size_t speed)> progress_callback) {
+    ESP_LOGI(TAG, "Writing to partition %s at offset 0x%lx", partition->label, partition->address);
+
+    // Continue an interrupted upgrade of the same image into the same slot
+    size_t total_size = 0;
+    size_t resume_offset = 0;
+    {
+        Settings settings("ota", false);
+        if (settings.GetString("url") == url && settings.GetString("partition") == partition->label) {
+            total_size = settings.GetInt("total");
+            resume_offset = settings.GetInt("offset");
+            if (resume_offset >= total_size || resume_offset % OTA_BLOCK_SIZE != 0) {
+                total_size = 0;
+                resume_offset = 0;
+            }
+        }
+    }
+
+    std::unique_ptr<Http> http;
+    if (resume_offset > 0) {
+        ESP_LOGI(TAG, "Resuming upgrade at %u/%u", resume_offset, total_size);
+        http = OpenFirmwareStream(url, resume_offset, total_size);
+        if (!http) {
+            ESP_LOGW(TAG, "Failed to resume, restarting upgrade from the beginning");
+            total_size = 0;
+            resume_offset = 0;
+        }
+    }
+    if (!http) {
+        http = OpenFirmwareStream(url, 0, total_size);
+        if (!http) {
+            return false;
+        }
+    }
+
+    OtaWriter writer;
+    writer.written = resume_offset;
+    writer.free_queue = xQueueCreate(OTA_BLOCK_COUNT, sizeof(OtaBlock));
+    writer.full_queue = xQueueCreate(OTA_BLOCK_COUNT + 1, sizeof(OtaBlock));
+    writer.event_group = xEventGroupCreate();
+    std::vector<char*> blocks;
+    for (int i = 0; i < OTA_BLOCK_COUNT; i++) {
+        auto data = (char*)heap_caps_malloc_prefer(OTA_BLOCK_SIZE, 2,
+            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (data == nullptr) {
+            break;
+        }
+        blocks.push_back(data);
+        OtaBlock block = { data, 0 };
+        xQueueSend(writer.free_queue, &block, 0);
+    }
+
+    auto cleanup = [&]() {
+        for (auto data : blocks) {
+            heap_caps_free(data);
+        }
+        vQueueDelete(writer.free_queue);
+        vQueueDelete(writer.full_queue);
+        vEventGroupDelete(writer.event_group);
+    };
+
+    if (blocks.size() < 2) {
+        ESP_LOGE(TAG, "Failed to allocate OTA buffers");
+        cleanup();
+        return false;
+    }
+
+    // Fill a block completely, reconnecting with a Range request when the
+    // connection drops so a flaky link does not restart the whole image
+    size_t received = resume_offset;
+    size_t recent_read = 0;
+    int retry_count = 0;
+    auto fill_block = [&](OtaBlock& block) -> bool {
+        block.size = 0;
+        while (block.size < OTA_BLOCK_SIZE && received < total_size) {
+            int ret = http ? http->Read(block.data + block.size, OTA_BLOCK_SIZE - block.size) : -1;
+            if (ret > 0) {
+                block.size += ret;
+                received += ret;
+                recent_read += ret;
+                retry_count = 0;
+                continue;
+            }
+
+            if (ret < 0) {
+                ESP_LOGW(TAG, "Failed to read HTTP data: %s", esp_err_to_name(ret));
+            } else {
+                ESP_LOGW(TAG, "Connection closed at %u/%u", received, total_size);
+            }
+            if (http) {
+                http->Close();
+                http.reset();
+            }
+            if (++retry_count > OTA_MAX_RETRY || writer.failed) {
+                ESP_LOGE(TAG, "Giving up after %d retries", OTA_MAX_RETRY);
+                return false;
+            }
+            vTaskDelay(pdMS_TO_TICKS(1000 * retry_count));
+            ESP_LOGI(TAG, "Reconnecting at %u/%u, retry %d", received, total_size, retry_count);
+            http = OpenFirmwareStream(url, received, total_size);
+        }
+        return true;
+    };
+
+    OtaBlock block;
+    xQueueReceive(writer.free_queue, &block, portMAX_DELAY);
+    if (!fill_block(block)) {
+        cleanup();
+        return false;
+    }
+
+    if (resume_offset == 0) {
+        if (block.size < sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)) {
+            ESP_LOGE(TAG, "Firmware image is too small");
+            cleanup();
+            return false;
+        }
+        esp_app_desc_t new_app_info;
+        memcpy(&new_app_info, block.data + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t), sizeof(esp_app_desc_t));
+
+        auto current_version = esp_app_get_description()->version;
+        ESP_LOGI(TAG, "Current version: %s, New version: %s", current_version, new_app_info.version);
+
+        if (esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &writer.handle)) {
+            esp_ota_abort(writer.handle);
+            ESP_LOGE(TAG, "Failed to begin OTA");
+            cleanup();
+            return false;
+        }
+
+        Settings settings("ota", true);
+        settings.SetString("url", url);
+        settings.SetString("partition", partition->label);
+        settings.SetInt("total", total_size);
+        settings.SetInt("offset", 0);
+    } else if (esp_ota_resume(partition, OTA_WITH_SEQUENTIAL_WRITES, resume_offset, &writer.handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to resume OTA");
+        Settings settings("ota", true);
+        settings.EraseAll();
+        cleanup();
+        return false;
+    }
+
+    xTaskCreate(OtaWriterTask, "ota_writer", 4096, &writer, 3, NULL);
+
+    auto start_time = esp_timer_get_time();
+    auto last_calc_time = start_time;
+    bool download_ok = true;
+    while (true) {
+        xQueueSend(writer.full_queue, &block, portMAX_DELAY);
+
+        // Report throughput over the real elapsed time and the ETA from the average rate
+        auto now = esp_timer_get_time();
+        if (now - last_calc_time >= 1000000 || received == total_size) {
+            size_t speed = recent_read * 1000000ULL / std::max<int64_t>(now - last_calc_time, 1);
+            size_t average = (received - resume_offset) * 1000000ULL / std::max<int64_t>(now - start_time, 1);
+            size_t progress = received * 100ULL / total_size;
+            int eta = average > 0 ? (total_size - received) / average : -1;
+            ESP_LOGI(TAG, "Progress: %u%% (%u/%u, flashed %u), Speed: %uB/s, Avg: %uB/s, ETA: %ds",
+                progress, received, total_size, writer.written.load(), speed, average, eta);
+            if (progress_callback) {
+                progress_callback(progress, speed);
+            }
+            last_calc_time = now;
+            recent_read = 0;
+        }
+
+        if (received >= total_size || writer.failed) {
+            break;
+        }
+        xQueueReceive(writer.free_queue, &block, portMAX_DELAY);
+        if (!fill_block(block)) {
+            xQueueSend(writer.free_queue, &block, portMAX_DELAY);
+            download_ok = false;
+            break;
+        }
+    }
+    if (http) {
+        http->Close();
+    }
+
+    // Drain the pipeline so the persisted offset covers everything downloaded
+    OtaBlock end_block = { nullptr, 0 };
+    xQueueSend(writer.full_queue, &end_block, portMAX_DELAY);
+    xEventGroupWaitBits(writer.event_group, OTA_WRITER_DONE_EVENT, pdFALSE, pdTRUE, portMAX_DELAY);
+    ESP_LOGI(TAG, "Downloaded %u bytes in %d ms, flash write %d ms", received - resume_offset,
+        int((esp_timer_get_time() - start_time) / 1000), int(writer.write_time_us / 1000));
+    cleanup();
+
+    if (writer.failed) {
+        esp_ota_abort(writer.handle);
+        Settings settings("ota", true);
+        settings.EraseAll();
+        return false;
+    }
+    if (!download_ok) {
+        // Keep the resume state, the next attempt continues from the saved offset
+        esp_ota_abort(writer.handle);
+        return false;
+    }
+
+    esp_err_t err = esp_ota_end(writer.handle);
+    {
+        Settings settings("ota", true);
+        settings.EraseAll();
+    }
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+            ESP_LOGE(TAG, "Image validation failed, image is corrupted");
+        } else {
+            ESP_LOGE(TAG, "Failed to end OTA: %s", esp_err_to_name(err));
+        }
+        return false;
+    }
+
+    err = esp_ota_set_boot_partition(partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Firmware upgrade successful");
+    return true;
+}
+
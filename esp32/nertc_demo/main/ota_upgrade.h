@@ -0,0 +1,15 @@
+#ifndef _OTA_UPGRADE_H
+#define _OTA_UPGRADE_H
+
+#include <functional>
+#include <string>
+
+#include <esp_partition.h>
+
+// Downloads the firmware image at url into partition and makes it the boot
+// partition once esp_ota_end() has validated it. A download that is cut off
+// continues with HTTP Range requests, also on the next call after a reboot.
+bool UpgradeFirmware(const std::string& url, const esp_partition_t* partition,
+    std::function<void(int progress, size_t speed)> progress_callback);
+
+#endif // _OTA_UPGRADE_H
@@ -0,0 +1,34 @@
+# Fixes to the vendored components under components/, which is not tracked.
+# Each patches/<component>/*.patch is applied to components/<component> once,
+# before the components are registered; a patch that is already in is skipped.
+find_package(Git QUIET REQUIRED)
+
+get_filename_component(COMPONENTS_DIR "${CMAKE_CURRENT_LIST_DIR}/../components" ABSOLUTE)
+file(GLOB COMPONENT_PATCHES "${CMAKE_CURRENT_LIST_DIR}/*/*.patch")
+list(SORT COMPONENT_PATCHES)
+
+foreach(patch ${COMPONENT_PATCHES})
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${patch}")
+    get_filename_component(patch_dir "${patch}" DIRECTORY)
+    get_filename_component(component "${patch_dir}" NAME)
+    set(component_dir "${COMPONENTS_DIR}/${component}")
+    if(NOT EXISTS "${component_dir}")
+        message(WARNING "Component ${component} not found, ${patch} not applied")
+        continue()
+    endif()
+
+    # Keep git from finding the enclosing repository so the patch paths stay relative to the component
+    set(git_apply ${CMAKE_COMMAND} -E env "GIT_CEILING_DIRECTORIES=${COMPONENTS_DIR}" "${GIT_EXECUTABLE}" apply)
+    execute_process(COMMAND ${git_apply} --reverse --check "${patch}"
+                    WORKING_DIRECTORY "${component_dir}"
+                    RESULT_VARIABLE already_applied OUTPUT_QUIET ERROR_QUIET)
+    if(NOT already_applied EQUAL 0)
+        execute_process(COMMAND ${git_apply} "${patch}"
+                        WORKING_DIRECTORY "${component_dir}"
+                        RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Failed to apply ${patch} to ${component_dir}")
+        endif()
+        message(STATUS "Applied ${patch}")
+    endif()
+endforeach()
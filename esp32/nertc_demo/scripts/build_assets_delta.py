@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+Build a delta update between two assets.bin packs
+
+The target pack is first re-laid out against the base pack: unchanged assets
+keep their offsets, changed assets reuse their old slot when they still fit and
+are appended otherwise. The delta then carries only the flash sectors that
+differ, so updating one font or emoji set no longer rewrites the whole assets
+partition. Both packs must be in the v2 format written by build_default_assets.py.
+Publish the re-laid out pack as the full download as well, it is the base the
+devices will hold after applying the delta.
+
+Usage:
+    ./build_assets_delta.py --base <old assets.bin> --target <new assets.bin> \
+        --output_pack <re-laid out assets.bin> --output_delta <assets.delta>
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+from build_default_assets import (ASSETS_V2_MAGIC, ASSETS_V2_HEADER_SIZE, ASSETS_V2_ENTRY_SIZE,
+                                  pack_header_v2, sort_key)
+
+
+# Delta header, see mmap_assets_delta_header in main/assets.cc
+ASSETS_DELTA_MAGIC = b'ASTD'
+ASSETS_DELTA_VERSION = 1
+ASSETS_DELTA_HEADER_SIZE = 80
+SECTOR_SIZE = 4096
+
+
+def parse_pack(data):
+    """
+    Parse a v2 pack, returns (data_start, assets) where assets maps the name to
+    (offset, size, width, height, content) with offsets relative to data_start.
+    content is the stored asset including its 2-byte magic.
+    """
+    if data[:4] != ASSETS_V2_MAGIC:
+        raise ValueError('not a v2 assets pack, rebuild it with build_default_assets.py')
+    version, header_size, count, data_length, table_crc = struct.unpack_from('<HHIII', data, 4)
+    if version != 2:
+        raise ValueError(f'unsupported assets pack version {version}')
+    if hashlib.sha256(data[header_size:header_size + data_length]).digest() != data[20:52]:
+        raise ValueError('assets pack digest mismatch')
+
+    table = data[header_size:header_size + count * ASSETS_V2_ENTRY_SIZE]
+    data_start = header_size + len(table)
+    assets = {}
+    for i in range(count):
+        name, size, offset, width, height, crc32 = struct.unpack_from('<32sIIHHI', table, i * ASSETS_V2_ENTRY_SIZE)
+        name = name.rstrip(b'\0').decode('utf-8')
+        content = data[data_start + offset:data_start + offset + 2 + size]
+        assets[name] = (offset, size, width, height, content)
+    return data_start, assets
+
+
+def relayout(base_data, base_start, base_assets, target_assets, max_waste):
+    """
+    Lay out the target assets so that as many bytes as possible stay where they
+    are in the base pack. Returns the new pack, or None if the layout cannot be
+    kept or wastes more than max_waste of the data area.
+    """
+    names = sorted(target_assets.keys(), key=sort_key)
+    header_size = base_start - len(names) * ASSETS_V2_ENTRY_SIZE
+    if header_size < ASSETS_V2_HEADER_SIZE:
+        print(f'Table grows past the reserved slack ({len(names)} assets), falling back to a full layout')
+        return None
+
+    # Start from the base data so holes left by removed assets stay untouched in flash
+    merged_data = bytearray(base_data[base_start:])
+    placements = {}
+    appended = []
+    for name in names:
+        _, size, _, _, content = target_assets[name]
+        if name in base_assets:
+            offset, base_size, _, _, base_content = base_assets[name]
+            if content == base_content or size <= base_size:
+                placements[name] = offset
+                continue
+        appended.append(name)
+
+    end = max((offset + 2 + size for offset, size, _, _, _ in base_assets.values()), default=0)
+    for name in appended:
+        placements[name] = end
+        end += 2 + target_assets[name][1]
+    del merged_data[end:]
+    merged_data.extend(b'\0' * (end - len(merged_data)))
+
+    mmap_table = bytearray()
+    used = 0
+    for name in names:
+        offset = placements[name]
+        _, size, width, height, content = target_assets[name]
+        merged_data[offset:offset + 2 + size] = content
+        used += 2 + size
+        fixed_name = name.encode('utf-8').ljust(32, b'\0')[:32]
+        mmap_table.extend(struct.pack('<32sIIHHI', fixed_name, size, offset, width, height, zlib.crc32(content[2:])))
+
+    waste = 1 - used / max(len(merged_data), 1)
+    print(f'Relaid {len(names)} assets, {len(appended)} appended, {waste * 100:.1f}% of the data area unused')
+    if waste > max_waste:
+        print(f'Unused space exceeds {max_waste * 100:.0f}%, falling back to a full layout')
+        return None
+
+    combined_data = bytes(mmap_table + merged_data)
+    return pack_header_v2(len(names), mmap_table, combined_data, header_size) + combined_data
+
+
+def full_layout(target_assets):
+    names = sorted(target_assets.keys(), key=sort_key)
+    merged_data = bytearray()
+    mmap_table = bytearray()
+    for name in names:
+        _, size, width, height, content = target_assets[name]
+        fixed_name = name.encode('utf-8').ljust(32, b'\0')[:32]
+        mmap_table.extend(struct.pack('<32sIIHHI', fixed_name, size, len(merged_data), width, height, zlib.crc32(content[2:])))
+        merged_data.extend(content)
+    combined_data = bytes(mmap_table + merged_data)
+    return pack_header_v2(len(names), mmap_table, combined_data) + combined_data
+
+
+def build_delta(base_data, target_data):
+    """
+    Emit the sector aligned ranges of target_data that differ from base_data,
+    merging adjacent sectors into one record
+    """
+    records = []
+    for sector in range(0, len(target_data), SECTOR_SIZE):
+        new = target_data[sector:sector + SECTOR_SIZE]
+        old = base_data[sector:sector + len(new)]
+        if new == old:
+            continue
+        if records and records[-1][0] + len(records[-1][1]) == sector:
+            records[-1][1].extend(new)
+        else:
+            records.append((sector, bytearray(new)))
+
+    delta = ASSETS_DELTA_MAGIC
+    delta += struct.pack('<HH', ASSETS_DELTA_VERSION, ASSETS_DELTA_HEADER_SIZE)
+    delta += base_data[20:52] + target_data[20:52]
+    delta += struct.pack('<II', len(target_data), len(records))
+    for offset, data in records:
+        delta += struct.pack('<II', offset, len(data)) + bytes(data)
+    return delta, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build a delta update between two assets packs')
+    parser.add_argument('--base', required=True, help='Path to the assets.bin installed on the devices')
+    parser.add_argument('--target', required=True, help='Path to the new assets.bin')
+    parser.add_argument('--output_pack', required=True, help='Output path for the re-laid out assets.bin')
+    parser.add_argument('--output_delta', required=True, help='Output path for the delta')
+    parser.add_argument('--max_waste', type=float, default=0.25,
+                        help='Largest unused fraction of the data area before a full layout is used')
+    args = parser.parse_args()
+
+    with open(args.base, 'rb') as f:
+        base_data = f.read()
+    with open(args.target, 'rb') as f:
+        target_data = f.read()
+
+    try:
+        base_start, base_assets = parse_pack(base_data)
+        _, target_assets = parse_pack(target_data)
+    except ValueError as e:
+        print(f'Error: {e}')
+        sys.exit(1)
+
+    pack = relayout(base_data, base_start, base_assets, target_assets, args.max_waste)
+    if pack is None:
+        pack = full_layout(target_assets)
+
+    delta, records = build_delta(base_data, pack)
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output_pack)), exist_ok=True)
+    with open(args.output_pack, 'wb') as f:
+        f.write(pack)
+    os.makedirs(os.path.dirname(os.path.abspath(args.output_delta)), exist_ok=True)
+    with open(args.output_delta, 'wb') as f:
+        f.write(delta)
+
+    patched = sum(len(data) for _, data in records)
+    print(f'Generated: {args.output_pack} ({len(pack)} bytes)')
+    print(f'Generated: {args.output_delta} ({len(delta)} bytes, {len(records)} records, '
+          f'{patched / 1024:.1f}K of {len(pack) / 1024:.1f}K rewritten)')
+
+
+if __name__ == '__main__':
+    main()
@@ -17,6 +17,9 @@ import shutil
 import sys
 import json
 import struct
+import hashlib
+import zlib
+import fnmatch
 from datetime import datetime
 
 
@@ -339,14 +342,46 @@ def compute_checksum(data):
     return checksum
 
 
+# Version 2 pack header, see mmap_assets_header_v2 in main/assets.cc
+ASSETS_V2_MAGIC = b'ASTP'
+ASSETS_V2_VERSION = 2
+ASSETS_V2_HEADER_SIZE = 52
+ASSETS_V2_ENTRY_SIZE = 48
+# Spare table entries reserved in the header padding, so a later delta can add
+# assets without moving the data of the existing ones
+ASSETS_V2_TABLE_SLACK = 16
+
+
+def pack_header_v2(total_files, mmap_table, combined_data, header_size=None):
+    if header_size is None:
+        header_size = ASSETS_V2_HEADER_SIZE + ASSETS_V2_TABLE_SLACK * ASSETS_V2_ENTRY_SIZE
+    header = ASSETS_V2_MAGIC
+    header += struct.pack('<HHIII', ASSETS_V2_VERSION, header_size, total_files,
+                          len(combined_data), zlib.crc32(mmap_table))
+    header += hashlib.sha256(combined_data).digest()
+    return header.ljust(header_size, b'\0')
+
+
 def sort_key(filename):
     basename, extension = os.path.splitext(filename)
     return extension, basename
 
 
-def pack_assets_simple(target_path, include_path, out_file, assets_path, max_name_len=32):
+def compress_asset(data):
     """
-    Simplified version of pack_assets that handles basic file packing
+    Compress an asset into an LZ4 frame the firmware can stream: independent
+    64KB blocks keep the decoder window small, and the stored content size lets
+    it allocate the decompressed copy up front
+    """
+    import lz4.frame
+    return lz4.frame.compress(data, block_size=lz4.frame.BLOCKSIZE_MAX64KB, block_linked=False,
+                              compression_level=lz4.frame.COMPRESSIONLEVEL_MINHC, store_size=True)
+
+
+def pack_assets_simple(target_path, include_path, out_file, assets_path, max_name_len=32, compress_patterns=None):
+    """
+    Simplified version of pack_assets that handles basic file packing.
+    Files matching compress_patterns are stored as LZ4 frames when that saves space.
     """
     merged_data = bytearray()
     file_info_list = []
@@ -368,19 +403,27 @@ def pack_assets_simple(target_path, include_path, out_file, assets_path, max_nam
         file_name = os.path.basename(file_path)
         file_size = os.path.getsize(file_path)
 
-        file_info_list.append((file_name, len(merged_data), file_size, 0, 0))
-        # Add 0x5A5A prefix to merged_data
-        merged_data.extend(b'\x5A' * 2)
-
         with open(file_path, 'rb') as bin_file:
             bin_data = bin_file.read()
 
+        # Add 0x5A5A prefix to merged_data, or "Z4" for an LZ4 frame
+        magic = b'\x5A' * 2
+        if compress_patterns and any(fnmatch.fnmatch(file_name, p) for p in compress_patterns):
+            compressed = compress_asset(bin_data)
+            if len(compressed) < len(bin_data) * 0.9:
+                print(f'Compressed {file_name}: {file_size} -> {len(compressed)} bytes')
+                bin_data = compressed
+                file_size = len(compressed)
+                magic = b'Z4'
+
+        file_info_list.append((file_name, len(merged_data), file_size, 0, 0, zlib.crc32(bin_data)))
+        merged_data.extend(magic)
         merged_data.extend(bin_data)
 
     total_files = len(file_info_list)
 
     mmap_table = bytearray()
-    for file_name, offset, file_size, width, height in file_info_list:
+    for file_name, offset, file_size, width, height, crc32 in file_info_list:
         if len(file_name) > max_name_len:
             print(f'Warning: "{file_name}" exceeds {max_name_len} bytes and will be truncated.')
         fixed_name = file_name.ljust(max_name_len, '\0')[:max_name_len]
@@ -389,12 +432,11 @@ def pack_assets_simple(target_path, include_path, out_file, assets_path, max_nam
         mmap_table.extend(offset.to_bytes(4, byteorder='little'))
         mmap_table.extend(width.to_bytes(2, byteorder='little'))
         mmap_table.extend(height.to_bytes(2, byteorder='little'))
+        mmap_table.extend(crc32.to_bytes(4, byteorder='little'))
 
     combined_data = mmap_table + merged_data
     combined_checksum = compute_checksum(combined_data)
-    combined_data_length = len(combined_data).to_bytes(4, byteorder='little')
-    header_data = total_files.to_bytes(4, byteorder='little') + combined_checksum.to_bytes(4, byteorder='little')
-    final_data = header_data + combined_data_length + combined_data
+    final_data = pack_header_v2(total_files, mmap_table, combined_data) + combined_data
 
     with open(out_file, 'wb') as output_bin:
         output_bin.write(final_data)
@@ -419,7 +461,7 @@ def pack_assets_simple(target_path, include_path, out_file, assets_path, max_nam
         output_header.write(f'#define MMAP_{asset_name.upper()}_CHECKSUM        0x{combined_checksum:04X}\n\n')
         output_header.write(f'enum MMAP_{asset_name.upper()}_LISTS {{\n')
 
-        for i, (file_name, _, _, _, _) in enumerate(file_info_list):
+        for i, (file_name, _, _, _, _, _) in enumerate(file_info_list):
             enum_name = file_name.replace('.', '_')
             output_header.write(f'    MMAP_{asset_name.upper()}_{enum_name.upper()} = {i},        /*!< {file_name} */\n')
 
@@ -698,7 +740,7 @@ def get_emoji_collection_path(default_emoji_collection, xiaozhi_fonts_path):
         return None
 
 
-def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None, blufi_bin_path=None):
+def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None, blufi_bin_path=None, compress_patterns=None):
     """
     Build assets using integrated functions (no external dependencies)
     """
@@ -736,7 +778,7 @@ def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font
         # Use simplified packing function
         include_path = config_data['include_path']
         image_file = config_data['image_file']
-        pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']))
+        pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']), compress_patterns)
         
         # Copy final assets.bin to output location
         if os.path.exists(image_file):
@@ -771,6 +813,7 @@ def main():
     parser.add_argument('--xiaozhi_fonts_path', help='Path to xiaozhi-fonts component directory')
     parser.add_argument('--extra_files', help='Path to extra files directory to be included in assets')
     parser.add_argument('--nertc_blufi_path', help='Path to nertc blufi bin directory')
+    parser.add_argument('--compress', nargs='*', help='File name patterns to store LZ4 compressed (e.g., "*.bin"), requires the lz4 package')
     
     args = parser.parse_args()
     
@@ -873,7 +916,7 @@ def main():
     
     # Build the assets
     success = build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, 
-                                     extra_files_path, args.output, multinet_model_info, args.nertc_blufi_path)
+                                     extra_files_path, args.output, multinet_model_info, args.nertc_blufi_path, args.compress)
     
     if not success:
         sys.exit(1)
@@ -0,0 +1,154 @@
+#include "asset_reader.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <lz4frame.h>
+#include <lz4hc.h>
+
+namespace {
+
+// Emoji-like RGB565 frames: a flat background with a shaded, dithered disc and a few features
+std::vector<uint8_t> MakeImages(int count, int size) {
+    std::vector<uint8_t> data;
+    data.reserve((size_t)count * size * size * 2);
+    for (int i = 0; i < count; i++) {
+        int cx = size / 2 + i % 7 - 3, cy = size / 2 + i % 5 - 2, radius = size * 2 / 5;
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int dx = x - cx, dy = y - cy;
+                uint16_t pixel = 0x0000;
+                if (dx * dx + dy * dy < radius * radius) {
+                    int shade = 31 - (dx * dx + dy * dy) * 16 / (radius * radius);
+                    // Dithered like an antialiased bitmap, so it does not compress unrealistically well
+                    uint32_t noise = (uint32_t)(x * 2654435761u ^ y * 40503u ^ i * 97u) >> 27;
+                    pixel = (uint16_t)((shade << 11) | ((shade * 2) << 5) | noise);
+                    if ((dy == -radius / 3 && (dx == -radius / 3 || dx == radius / 3)) ||
+                        (dy > radius / 3 && dy < radius / 3 + 3 && dx > -radius / 2 && dx < radius / 2)) {
+                        pixel = 0x0000;
+                    }
+                }
+                data.push_back(pixel & 0xFF);
+                data.push_back(pixel >> 8);
+            }
+        }
+    }
+    return data;
+}
+
+// Same frame format as scripts/build_default_assets.py: 64 KB independent blocks
+// with the content size stored
+std::vector<uint8_t> Compress(const std::vector<uint8_t>& data, bool store_size = true) {
+    LZ4F_preferences_t prefs = {};
+    prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    prefs.frameInfo.contentSize = store_size ? data.size() : 0;
+    prefs.compressionLevel = LZ4HC_CLEVEL_MIN;
+    std::vector<uint8_t> frame(LZ4F_compressFrameBound(data.size(), &prefs));
+    size_t size = LZ4F_compressFrame(frame.data(), frame.size(), data.data(), data.size(), &prefs);
+    EXPECT_FALSE(LZ4F_isError(size));
+    frame.resize(size);
+    return frame;
+}
+
+std::vector<uint8_t> ReadAll(AssetReader& reader, size_t chunk) {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> buffer(chunk);
+    int ret;
+    while ((ret = reader.Read(buffer.data(), buffer.size())) > 0) {
+        out.insert(out.end(), buffer.begin(), buffer.begin() + ret);
+    }
+    EXPECT_EQ(ret, 0);
+    return out;
+}
+
+}  // namespace
+
+TEST(AssetReaderTest, ReadsCompressedAssetInAnyChunkSize) {
+    auto data = MakeImages(8, 64);
+    auto frame = Compress(data);
+    for (size_t chunk : {1, 1000, 4096, 65536, 1 << 20}) {
+        auto reader = AssetReader::Open(frame.data(), frame.size(), true);
+        ASSERT_NE(reader, nullptr);
+        EXPECT_TRUE(reader->compressed());
+        EXPECT_EQ(reader->size(), data.size());
+        EXPECT_EQ(ReadAll(*reader, chunk), data) << chunk;
+    }
+}
+
+TEST(AssetReaderTest, ReadsRawAsset) {
+    auto data = MakeImages(1, 32);
+    auto reader = AssetReader::Open(data.data(), data.size(), false);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_FALSE(reader->compressed());
+    EXPECT_EQ(reader->size(), data.size());
+    EXPECT_EQ(ReadAll(*reader, 100), data);
+}
+
+TEST(AssetReaderTest, RejectsBadFrames) {
+    auto data = MakeImages(4, 64);
+
+    // GetAssetData sizes its copy from the frame header, so the size is required
+    auto unsized = Compress(data, false);
+    EXPECT_EQ(AssetReader::Open(unsized.data(), unsized.size(), true), nullptr);
+
+    auto frame = Compress(data);
+    std::vector<uint8_t> garbage(frame.size(), 0x5A);
+    EXPECT_EQ(AssetReader::Open(garbage.data(), garbage.size(), true), nullptr);
+
+    // A truncated frame comes up short rather than reading past the asset
+    auto reader = AssetReader::Open(frame.data(), frame.size() / 2, true);
+    ASSERT_NE(reader, nullptr);
+    std::vector<uint8_t> out(data.size());
+    int ret = reader->Read(out.data(), out.size());
+    EXPECT_LT(ret, (int)data.size());
+
+    // A corrupted block size is caught by the decoder
+    auto corrupt = frame;
+    size_t header_size = LZ4F_HEADER_SIZE_MAX;
+    LZ4F_dctx* dctx = nullptr;
+    LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+    LZ4F_frameInfo_t info;
+    LZ4F_getFrameInfo(dctx, &info, corrupt.data(), &header_size);
+    LZ4F_freeDecompressionContext(dctx);
+    corrupt[header_size + 3] = 0x7F;
+    reader = AssetReader::Open(corrupt.data(), corrupt.size(), true);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(reader->Read(out.data(), out.size()), -1);
+}
+
+// Cost of a compressed asset over a raw one: the one-off decompression into the
+// PSRAM copy against the memcpy a raw asset would need for the same copy (raw
+// assets are used straight from the mmap, so this is an upper bound for them).
+// Host numbers, to compare the two paths and not to predict the ESP32.
+TEST(AssetReaderTest, DecompressThroughputAgainstMmapCopy) {
+    auto data = MakeImages(64, 96);
+    auto frame = Compress(data);
+    std::vector<uint8_t> out(data.size());
+    constexpr int kRounds = 20;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        auto reader = AssetReader::Open(frame.data(), frame.size(), true);
+        ASSERT_EQ(reader->Read(out.data(), out.size()), (int)out.size());
+    }
+    double lz4_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(out, data);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        memcpy(out.data(), data.data(), data.size());
+        asm volatile("" : : "r"(out.data()) : "memory");
+    }
+    double copy_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double mb = (double)data.size() * kRounds / (1024 * 1024);
+    printf("%zu KB of RGB565 frames, LZ4 frame of %zu KB (%.1f%%):\n", data.size() / 1024, frame.size() / 1024,
+        100.0 * frame.size() / data.size());
+    printf("  LZ4 decompress %8.0f MB/s\n", mb / lz4_s);
+    printf("  mmap memcpy    %8.0f MB/s\n", mb / copy_s);
+    EXPECT_LT(frame.size(), data.size() / 2);
+}
@@ -0,0 +1,187 @@
+#include "assets.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fake_flash.h"
+#include "music_player/fake_server.h"
+
+namespace {
+
+const std::string kUrl = "http://assets.test/assets.bin";
+// The v2 header and the spare table entries build_default_assets.py reserves
+constexpr size_t kHeaderSize = 52 + 16 * 48;
+constexpr size_t kTableEntrySize = 48;
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Packs built by make_test_assets.py from the files under TEST_ASSETS_DIR
+std::vector<uint8_t> Pack(const std::string& name) {
+    return ReadFile(std::string(TEST_ASSETS_DIR) + "/" + name);
+}
+
+std::vector<uint8_t> SourceFile(const std::string& dir, const std::string& name) {
+    return ReadFile(std::string(TEST_ASSETS_DIR) + "/" + dir + "/" + name);
+}
+
+bool AssetEquals(const std::string& name, const std::vector<uint8_t>& expected) {
+    void* ptr = nullptr;
+    size_t size = 0;
+    if (!Assets::GetInstance().GetAssetData(name, ptr, size)) {
+        return false;
+    }
+    auto data = static_cast<const uint8_t*>(ptr);
+    return std::vector<uint8_t>(data, data + size) == expected;
+}
+
+class AssetsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fake_flash::Reset();
+        base_ = Pack("base.bin");
+        ASSERT_GT(base_.size(), 400u * 1024);
+    }
+
+    bool Download(const std::vector<uint8_t>& pack) {
+        server_.Put(kUrl, FakeResource{pack, "", true});
+        return Assets::GetInstance().Download(kUrl, nullptr);
+    }
+
+    FakeServer server_;
+    std::vector<uint8_t> base_;
+};
+
+}  // namespace
+
+TEST_F(AssetsTest, GoodPackPassesDigest) {
+    auto& assets = Assets::GetInstance();
+    ASSERT_TRUE(Download(base_));
+    EXPECT_TRUE(assets.checksum_valid());
+    EXPECT_TRUE(assets.VerifyDigest());
+    EXPECT_EQ(fake_flash::Read(fake_flash::Find("assets"), 0, base_.size()), base_);
+    for (auto name : {"index.json", "font.bin", "emoji_3.png", "success.ogg"}) {
+        EXPECT_TRUE(AssetEquals(name, SourceFile("base", name))) << name;
+    }
+}
+
+TEST_F(AssetsTest, FlippedOrTruncatedPackIsRejectedBeforeUse) {
+    auto& assets = Assets::GetInstance();
+    // In the asset data, covered by the SHA-256
+    auto flipped = base_;
+    flipped[flipped.size() / 2] ^= 0x10;
+    EXPECT_FALSE(Download(flipped));
+    EXPECT_FALSE(assets.checksum_valid());
+    void* ptr = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(assets.GetAssetData("index.json", ptr, size));
+
+    // In the table, covered by its CRC32 as well
+    auto table = base_;
+    table[kHeaderSize + 2 * kTableEntrySize + 33] ^= 0x01;
+    EXPECT_FALSE(Download(table));
+    EXPECT_FALSE(assets.checksum_valid());
+
+    auto truncated = base_;
+    truncated.resize(base_.size() - 1);
+    EXPECT_FALSE(Download(truncated));
+    EXPECT_FALSE(assets.checksum_valid());
+    EXPECT_FALSE(assets.GetAssetData("index.json", ptr, size));
+
+    ASSERT_TRUE(Download(base_));
+    EXPECT_TRUE(AssetEquals("index.json", SourceFile("base", "index.json")));
+}
+
+// A bit that flips in flash after the pack was verified is caught by the asset's
+// CRC32 on first access, without hashing the whole pack at boot
+TEST_F(AssetsTest, FlashBitFlipIsCaughtOnFirstAccess) {
+    ASSERT_TRUE(Download(base_));
+    auto emoji = SourceFile("base", "emoji_5.png");
+    auto it = std::search(base_.begin(), base_.end(), emoji.begin(), emoji.begin() + 64);
+    ASSERT_NE(it, base_.end());
+    size_t offset = it - base_.begin();
+    while (base_[offset] == 0) {
+        offset++;
+    }
+    uint8_t cleared = base_[offset] & (base_[offset] - 1);
+    ASSERT_EQ(esp_partition_write(fake_flash::Find("assets"), offset, &cleared, 1), ESP_OK);
+
+    void* ptr = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(Assets::GetInstance().GetAssetData("emoji_5.png", ptr, size));
+    EXPECT_TRUE(AssetEquals("emoji_4.png", SourceFile("base", "emoji_4.png")));
+}
+
+TEST_F(AssetsTest, DigestVerifyTime) {
+    auto& assets = Assets::GetInstance();
+    ASSERT_TRUE(Download(base_));
+    constexpr int kRounds = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; i++) {
+        ASSERT_TRUE(assets.VerifyDigest());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mb = (double)base_.size() * kRounds / (1024 * 1024);
+    printf("SHA-256 of a %zu KB pack: %.2f ms per MB (host)\n", base_.size() / 1024, seconds * 1000 / mb);
+}
+
+// The delta rewrites base.bin into pack.bin, the re-laid out full pack the
+// generator publishes next to it, and every asset reads back as in the plain
+// full build of the new files (target.bin)
+TEST_F(AssetsTest, DeltaMatchesFullBuild) {
+    auto pack = Pack("pack.bin");
+    auto delta = Pack("delta.bin");
+    auto partition = fake_flash::Find("assets");
+    ASSERT_TRUE(Download(base_));
+    size_t erased_before = fake_flash::erased_bytes(partition);
+    ASSERT_TRUE(Download(delta));
+    size_t erased = fake_flash::erased_bytes(partition) - erased_before;
+
+    EXPECT_EQ(fake_flash::Read(partition, 0, pack.size()), pack);
+    auto& assets = Assets::GetInstance();
+    EXPECT_TRUE(assets.checksum_valid());
+    for (auto name : {"index.json", "font.bin", "emoji_2.png", "emoji_5.png", "emoji_8.png", "success.ogg"}) {
+        EXPECT_TRUE(AssetEquals(name, SourceFile("target", name))) << name;
+    }
+    void* ptr = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(assets.GetAssetData("popup.ogg", ptr, size));
+
+    printf("Delta of %zu KB for a %zu KB pack, %zu KB erased and rewritten\n",
+        delta.size() / 1024, pack.size() / 1024, erased / 1024);
+    EXPECT_LT(delta.size(), pack.size() / 4);
+    EXPECT_LT(erased, pack.size() / 4);
+}
+
+TEST_F(AssetsTest, DeltaForAnotherBaseLeavesThePackInstalled) {
+    auto pack = Pack("pack.bin");
+    auto delta = Pack("delta.bin");
+    ASSERT_TRUE(Download(base_));
+    ASSERT_TRUE(Download(delta));
+    // The installed pack is now the target, not the delta's base
+    EXPECT_FALSE(Download(delta));
+    EXPECT_TRUE(Assets::GetInstance().checksum_valid());
+    EXPECT_EQ(fake_flash::Read(fake_flash::Find("assets"), 0, pack.size()), pack);
+    EXPECT_TRUE(AssetEquals("emoji_8.png", SourceFile("target", "emoji_8.png")));
+}
+
+TEST_F(AssetsTest, TruncatedDeltaIsRejectedAndFullPackRecovers) {
+    auto& assets = Assets::GetInstance();
+    auto delta = Pack("delta.bin");
+    ASSERT_TRUE(Download(base_));
+    delta.resize(delta.size() - 100);
+    EXPECT_FALSE(Download(delta));
+    EXPECT_FALSE(assets.checksum_valid());
+
+    auto pack = Pack("pack.bin");
+    ASSERT_TRUE(Download(pack));
+    EXPECT_TRUE(AssetEquals("font.bin", SourceFile("target", "font.bin")));
+}
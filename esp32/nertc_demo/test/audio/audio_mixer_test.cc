@@ -0,0 +1,140 @@
+#include "audio/audio_mixer.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+constexpr int kRate = 16000;
+constexpr size_t kFrame = kRate / 50;   // 20 ms, mono
+
+class AudioMixerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mixer_.Configure(kRate, 1, 240);
+    }
+
+    // Mixes ms of constant music, with voice of the given value on top if voice is true
+    std::vector<int16_t> Mix(int ms, int16_t music, bool voice = false, int16_t voice_value = 0) {
+        std::vector<int16_t> output;
+        for (int t = 0; t < ms; t += 20) {
+            std::vector<int16_t> music_block(kFrame, music);
+            EXPECT_EQ(mixer_.Write(kAudioMixerSourceMusic, music_block.data(), kFrame), kFrame);
+            if (voice) {
+                std::vector<int16_t> voice_block(kFrame, voice_value);
+                EXPECT_EQ(mixer_.Write(kAudioMixerSourceVoice, voice_block.data(), kFrame), kFrame);
+            }
+            std::vector<int16_t> block(kFrame);
+            mixer_.Mix(block.data(), kFrame);
+            output.insert(output.end(), block.begin(), block.end());
+        }
+        return output;
+    }
+
+    AudioMixer mixer_;
+};
+
+// Sample index of the first output at or below level
+size_t FirstAtOrBelow(const std::vector<int16_t>& pcm, int16_t level) {
+    for (size_t i = 0; i < pcm.size(); i++) {
+        if (pcm[i] <= level) {
+            return i;
+        }
+    }
+    return pcm.size();
+}
+
+size_t FirstAtOrAbove(const std::vector<int16_t>& pcm, int16_t level) {
+    for (size_t i = 0; i < pcm.size(); i++) {
+        if (pcm[i] >= level) {
+            return i;
+        }
+    }
+    return pcm.size();
+}
+
+}  // namespace
+
+TEST_F(AudioMixerTest, VoiceAlonePassesBitExact) {
+    std::vector<int16_t> voice(kFrame);
+    for (size_t i = 0; i < kFrame; i++) {
+        voice[i] = (int16_t)(i * 331 - 32768);
+    }
+    mixer_.Write(kAudioMixerSourceVoice, voice.data(), voice.size());
+    std::vector<int16_t> output(kFrame);
+    mixer_.Mix(output.data(), output.size());
+    EXPECT_EQ(output, voice);
+}
+
+TEST_F(AudioMixerTest, MusicAlonePlaysAtUnity) {
+    auto output = Mix(100, 12345);
+    for (int16_t sample : output) {
+        ASSERT_NEAR(sample, 12345, 1);
+    }
+    EXPECT_FALSE(mixer_.IsDucking(kAudioMixerSourceMusic));
+}
+
+TEST_F(AudioMixerTest, VoiceDucksMusicWithoutSteps) {
+    Mix(100, 16000);
+    auto ducked = Mix(200, 16000, true);
+    EXPECT_TRUE(mixer_.IsDucking(kAudioMixerSourceMusic));
+    // Down to 25% over 80 ms, moving 12000 / 1280 per sample rather than in block sized steps
+    size_t reached = FirstAtOrBelow(ducked, 4001);
+    EXPECT_NEAR((double)reached, kRate * 0.080, kRate * 0.005);
+    for (size_t i = 1; i < ducked.size(); i++) {
+        ASSERT_LE(ducked[i], ducked[i - 1]);
+        ASSERT_LE(ducked[i - 1] - ducked[i], 10);
+    }
+    EXPECT_NEAR(ducked.back(), 4000, 1);
+}
+
+TEST_F(AudioMixerTest, ReleasesAfterHoldTime) {
+    Mix(200, 16000, true);
+    auto released = Mix(1200, 16000);
+    // Stays ducked for the 400 ms hold, then back to unity over 600 ms
+    size_t start = FirstAtOrAbove(released, 4002);
+    EXPECT_NEAR((double)start, kRate * 0.400, kRate * 0.025);
+    size_t done = FirstAtOrAbove(released, 15999);
+    EXPECT_NEAR((double)(done - start), kRate * 0.600, kRate * 0.025);
+    EXPECT_FALSE(mixer_.IsDucking(kAudioMixerSourceMusic));
+}
+
+TEST_F(AudioMixerTest, HeldVoiceDucksWithoutAudio) {
+    Mix(100, 16000);
+    mixer_.SetHold(kAudioMixerSourceVoice, true);
+    EXPECT_TRUE(mixer_.IsDucking(kAudioMixerSourceMusic));
+    auto held = Mix(1000, 16000);
+    EXPECT_NEAR(held.back(), 4000, 1);
+
+    mixer_.SetHold(kAudioMixerSourceVoice, false);
+    auto released = Mix(1000, 16000);
+    EXPECT_NEAR(released.back(), 16000, 1);
+    // No hold time after an explicit release, the music comes straight back up
+    EXPECT_LT(FirstAtOrAbove(released, 4002), kFrame);
+}
+
+TEST_F(AudioMixerTest, SumClips) {
+    Mix(1000, 0);
+    auto output = Mix(200, 30000, true, 30000);
+    // Music is ducked to 7500, so the sum is 37500 and clips
+    EXPECT_EQ(output.back(), 32767);
+    output = Mix(200, -30000, true, -30000);
+    EXPECT_EQ(output.back(), -32768);
+}
+
+TEST_F(AudioMixerTest, WriteStopsAtCapacityAndClearEmpties) {
+    std::vector<int16_t> data(kRate, 1);
+    size_t capacity = kRate * 240 / 1000;
+    EXPECT_EQ(mixer_.Write(kAudioMixerSourceMusic, data.data(), data.size()), capacity);
+    EXPECT_EQ(mixer_.Space(kAudioMixerSourceMusic), 0u);
+    EXPECT_EQ(mixer_.Write(kAudioMixerSourceMusic, data.data(), 1), 0u);
+    mixer_.Clear(kAudioMixerSourceMusic);
+    EXPECT_EQ(mixer_.Available(kAudioMixerSourceMusic), 0u);
+
+    // A short source contributes silence for the rest of the block
+    mixer_.Write(kAudioMixerSourceMusic, data.data(), 10);
+    std::vector<int16_t> output(kFrame, -1);
+    mixer_.Mix(output.data(), output.size());
+    EXPECT_EQ(output[9], 1);
+    EXPECT_EQ(output[10], 0);
+}
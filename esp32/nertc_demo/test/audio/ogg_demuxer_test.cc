@@ -0,0 +1,233 @@
+#include "audio/ogg_demuxer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Packet = std::vector<uint8_t>;
+
+const char* kBundledSounds[] = {
+    "common/exclamation.ogg",
+    "common/low_battery.ogg",
+    "common/popup.ogg",
+    "common/success.ogg",
+    "common/vibration.ogg",
+};
+
+std::vector<uint8_t> ReadAsset(const std::string& name) {
+    std::ifstream file(std::string(ASSETS_DIR) + "/" + name, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+struct DemuxResult {
+    std::vector<Packet> packets;
+    uint32_t crc_errors = 0;
+    uint32_t lost_pages = 0;
+};
+
+DemuxResult Demux(const std::vector<uint8_t>& data, size_t chunk_size) {
+    DemuxResult result;
+    OggDemuxer demuxer;
+    demuxer.OnPacket([&](const uint8_t* packet, size_t size) {
+        result.packets.emplace_back(packet, packet + size);
+    });
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+        demuxer.Process(data.data() + offset, std::min(chunk_size, data.size() - offset));
+    }
+    result.crc_errors = demuxer.crc_errors();
+    result.lost_pages = demuxer.lost_pages();
+    return result;
+}
+
+// Straightforward whole-file parser used as the reference, without CRC checks
+std::vector<Packet> ReferencePackets(const std::vector<uint8_t>& data) {
+    std::vector<Packet> packets;
+    Packet pending;
+    size_t offset = 0;
+    while (offset + 27 <= data.size()) {
+        const uint8_t* page = data.data() + offset;
+        size_t segments = page[26];
+        const uint8_t* body = page + 27 + segments;
+        for (size_t i = 0; i < segments; i++) {
+            pending.insert(pending.end(), body, body + page[27 + i]);
+            body += page[27 + i];
+            if (page[27 + i] < 255) {
+                packets.push_back(pending);
+                pending.clear();
+            }
+        }
+        offset = body - data.data();
+    }
+    // Drop OpusHead and OpusTags
+    packets.erase(packets.begin(), packets.begin() + 2);
+    return packets;
+}
+
+uint32_t OggCrc(const std::vector<uint8_t>& page) {
+    uint32_t crc = 0;
+    for (uint8_t byte : page) {
+        crc ^= (uint32_t)byte << 24;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Builds one page holding the given lacing values and body
+std::vector<uint8_t> MakePage(uint32_t sequence, uint8_t flags, const std::vector<uint8_t>& lacing,
+                              const std::vector<uint8_t>& body) {
+    std::vector<uint8_t> page = {'O', 'g', 'g', 'S', 0, flags};
+    page.resize(27, 0);
+    for (int i = 0; i < 4; i++) {
+        page[14 + i] = 0x5a;                    // Serial number
+        page[18 + i] = (sequence >> (8 * i)) & 0xff;
+    }
+    page[26] = lacing.size();
+    page.insert(page.end(), lacing.begin(), lacing.end());
+    page.insert(page.end(), body.begin(), body.end());
+    uint32_t crc = OggCrc(page);
+    for (int i = 0; i < 4; i++) {
+        page[22 + i] = (crc >> (8 * i)) & 0xff;
+    }
+    return page;
+}
+
+std::vector<uint8_t> MakeHeaderPages(uint8_t channels, uint16_t pre_skip) {
+    std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, channels,
+                                 (uint8_t)(pre_skip & 0xff), (uint8_t)(pre_skip >> 8),
+                                 0x80, 0xbb, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's', 0, 0, 0, 0, 0, 0, 0, 0};
+    auto stream = MakePage(0, 0x02, {(uint8_t)head.size()}, head);
+    auto tags_page = MakePage(1, 0, {(uint8_t)tags.size()}, tags);
+    stream.insert(stream.end(), tags_page.begin(), tags_page.end());
+    return stream;
+}
+
+Packet Pattern(size_t size, uint8_t seed) {
+    Packet packet(size);
+    for (size_t i = 0; i < size; i++) {
+        packet[i] = (uint8_t)(seed + i * 7);
+    }
+    return packet;
+}
+
+}  // namespace
+
+TEST(OggDemuxerTest, BundledSoundsMatchReferenceInAnyChunkSize) {
+    for (const char* name : kBundledSounds) {
+        SCOPED_TRACE(name);
+        auto data = ReadAsset(name);
+        ASSERT_FALSE(data.empty());
+        auto reference = ReferencePackets(data);
+        ASSERT_FALSE(reference.empty());
+
+        for (size_t chunk_size : {data.size(), (size_t)1, (size_t)7, (size_t)100, (size_t)4096}) {
+            SCOPED_TRACE(chunk_size);
+            auto result = Demux(data, chunk_size);
+            EXPECT_EQ(result.crc_errors, 0u);
+            EXPECT_EQ(result.lost_pages, 0u);
+            EXPECT_EQ(result.packets, reference);
+        }
+    }
+}
+
+TEST(OggDemuxerTest, ParsesOpusHead) {
+    auto data = ReadAsset("common/success.ogg");
+    OggDemuxer demuxer;
+    demuxer.Process(data.data(), data.size());
+    EXPECT_TRUE(demuxer.has_head());
+    EXPECT_EQ(demuxer.channels(), 1);
+    EXPECT_EQ(demuxer.sample_rate(), 16000);
+    EXPECT_EQ(demuxer.pre_skip(), 312);
+
+    auto stream = MakeHeaderPages(2, 3840);
+    demuxer.Reset();
+    demuxer.Process(stream.data(), stream.size());
+    EXPECT_EQ(demuxer.channels(), 2);
+    EXPECT_EQ(demuxer.sample_rate(), 48000);
+    EXPECT_EQ(demuxer.pre_skip(), 3840);
+}
+
+TEST(OggDemuxerTest, ReassemblesPacketSpanningPages) {
+    Packet big = Pattern(600, 1);
+    Packet small = Pattern(20, 2);
+    auto stream = MakeHeaderPages(1, 0);
+    // 510 bytes of the big packet end the first page, the rest continues on the second
+    auto first = MakePage(2, 0, {255, 255}, Packet(big.begin(), big.begin() + 510));
+    Packet second_body(big.begin() + 510, big.end());
+    second_body.insert(second_body.end(), small.begin(), small.end());
+    auto second = MakePage(3, 0x01, {90, 20}, second_body);
+    stream.insert(stream.end(), first.begin(), first.end());
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    for (size_t chunk_size : {stream.size(), (size_t)1, (size_t)33}) {
+        auto result = Demux(stream, chunk_size);
+        ASSERT_EQ(result.packets.size(), 2u);
+        EXPECT_EQ(result.packets[0], big);
+        EXPECT_EQ(result.packets[1], small);
+    }
+}
+
+TEST(OggDemuxerTest, DropsCorruptedPageAndResyncs) {
+    auto stream = MakeHeaderPages(1, 0);
+    std::vector<Packet> packets;
+    std::vector<size_t> page_offsets;
+    for (uint32_t i = 0; i < 4; i++) {
+        packets.push_back(Pattern(40 + i, i));
+        page_offsets.push_back(stream.size());
+        auto page = MakePage(2 + i, 0, {(uint8_t)packets.back().size()}, packets.back());
+        stream.insert(stream.end(), page.begin(), page.end());
+    }
+    // Garbage before the stream must be skipped too
+    stream.insert(stream.begin(), {'x', 'O', 'g', 'g', 0, 1, 2});
+    stream[page_offsets[1] + 7 + 28 + 5] ^= 0xff;
+
+    auto result = Demux(stream, 64);
+    EXPECT_EQ(result.crc_errors, 1u);
+    EXPECT_EQ(result.lost_pages, 1u);
+    ASSERT_EQ(result.packets.size(), 3u);
+    EXPECT_EQ(result.packets[0], packets[0]);
+    EXPECT_EQ(result.packets[1], packets[2]);
+    EXPECT_EQ(result.packets[2], packets[3]);
+}
+
+TEST(OggDemuxerTest, DropsContinuationOfLostPacket) {
+    Packet big = Pattern(300, 3);
+    Packet next = Pattern(10, 4);
+    auto stream = MakeHeaderPages(1, 0);
+    auto first = MakePage(2, 0, {255}, Packet(big.begin(), big.begin() + 255));
+    Packet body(big.begin() + 255, big.end());
+    body.insert(body.end(), next.begin(), next.end());
+    auto second = MakePage(3, 0x01, {45, 10}, body);
+    first[30] ^= 0xff;
+    stream.insert(stream.end(), first.begin(), first.end());
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    auto result = Demux(stream, stream.size());
+    ASSERT_EQ(result.packets.size(), 1u);
+    EXPECT_EQ(result.packets[0], next);
+}
+
+// Time from the first byte until the first audio packet reaches the decoder
+TEST(OggDemuxerTest, TimeToFirstPacket) {
+    for (const char* name : kBundledSounds) {
+        auto data = ReadAsset(name);
+        OggDemuxer demuxer;
+        bool got_packet = false;
+        demuxer.OnPacket([&](const uint8_t*, size_t) { got_packet = true; });
+        auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < data.size() && !got_packet; offset += 256) {
+            demuxer.Process(data.data() + offset, std::min((size_t)256, data.size() - offset));
+        }
+        auto us = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+        EXPECT_TRUE(got_packet);
+        printf("%-24s %5zu bytes, first packet after %.1f us\n", name, data.size(), us);
+    }
+}
@@ -0,0 +1,122 @@
+#include "audio/pcm_converter.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+std::vector<int16_t> Convert(PcmConverter& converter, const std::vector<int16_t>& input, int block_samples) {
+    std::vector<int16_t> output;
+    for (size_t offset = 0; offset < input.size(); offset += block_samples) {
+        int samples = (int)std::min<size_t>(block_samples, input.size() - offset);
+        auto& converted = converter.Convert(input.data() + offset, samples);
+        output.insert(output.end(), converted.begin(), converted.end());
+    }
+    return output;
+}
+
+// Left is a ramp, right is its negative, so mixed up channels are easy to spot
+std::vector<int16_t> Stereo(int frames) {
+    std::vector<int16_t> pcm(frames * 2);
+    for (int i = 0; i < frames; i++) {
+        pcm[i * 2] = (int16_t)(i * 7 % 20000);
+        pcm[i * 2 + 1] = (int16_t)-(i * 7 % 20000);
+    }
+    return pcm;
+}
+
+}  // namespace
+
+TEST(PcmConverterTest, IsConfigured) {
+    PcmConverter converter;
+    converter.Configure(44100, 2, 16000, 1);
+    EXPECT_TRUE(converter.IsConfigured(44100, 2, 16000, 1));
+    EXPECT_FALSE(converter.IsConfigured(44100, 1, 16000, 1));
+    EXPECT_FALSE(converter.IsConfigured(48000, 2, 16000, 1));
+    EXPECT_FALSE(converter.IsConfigured(44100, 2, 16000, 2));
+}
+
+TEST(PcmConverterTest, SameLayoutPassesThrough) {
+    PcmConverter converter;
+    converter.Configure(16000, 2, 16000, 2);
+    auto input = Stereo(1000);
+    EXPECT_EQ(Convert(converter, input, 333 * 2), input);
+}
+
+TEST(PcmConverterTest, StereoToMonoAverages) {
+    PcmConverter converter;
+    converter.Configure(16000, 2, 16000, 1);
+    std::vector<int16_t> input = {100, 300, -32768, -32768, 32767, 32767, 1, 2};
+    EXPECT_EQ(Convert(converter, input, input.size()), (std::vector<int16_t>{200, -32768, 32767, 1}));
+
+    // Any other channel count is averaged too
+    converter.Configure(16000, 4, 16000, 1);
+    input = {4, 8, 12, 16, -4, -4, -4, -4};
+    EXPECT_EQ(Convert(converter, input, input.size()), (std::vector<int16_t>{10, -4}));
+}
+
+TEST(PcmConverterTest, MonoToStereoDuplicates) {
+    PcmConverter converter;
+    converter.Configure(16000, 1, 16000, 2);
+    std::vector<int16_t> input = {1, -2, 3, -4, 5};
+    EXPECT_EQ(Convert(converter, input, 2), (std::vector<int16_t>{1, 1, -2, -2, 3, 3, -4, -4, 5, 5}));
+}
+
+// Resampled mono duplicated to stereo equals the mono result with each sample doubled
+TEST(PcmConverterTest, ResamplesBeforeDuplicating) {
+    std::vector<int16_t> mono(4410);
+    for (size_t i = 0; i < mono.size(); i++) {
+        mono[i] = (int16_t)(i * 13 % 8000);
+    }
+    PcmConverter to_mono;
+    to_mono.Configure(44100, 1, 16000, 1);
+    auto expected = Convert(to_mono, mono, mono.size());
+    ASSERT_EQ(expected.size(), 1600u);
+
+    PcmConverter to_stereo;
+    to_stereo.Configure(44100, 1, 16000, 2);
+    auto stereo = Convert(to_stereo, mono, 1152);
+    ASSERT_EQ(stereo.size(), expected.size() * 2);
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(stereo[i * 2], expected[i]);
+        ASSERT_EQ(stereo[i * 2 + 1], expected[i]);
+    }
+}
+
+TEST(PcmConverterTest, StereoResamplingKeepsChannelsApart) {
+    PcmConverter converter;
+    converter.Configure(48000, 2, 16000, 2);
+    auto output = Convert(converter, Stereo(4800), 1152 * 2);
+    ASSERT_EQ(output.size(), 1600u * 2);
+    for (size_t i = 0; i < output.size(); i += 2) {
+        ASSERT_NEAR(output[i], -output[i + 1], 1);
+    }
+}
+
+TEST(PcmConverterTest, BlockSizeAndResetKeepOutput) {
+    PcmConverter converter;
+    converter.Configure(44100, 2, 16000, 1);
+    auto input = Stereo(4410);
+    auto reference = Convert(converter, input, input.size());
+    for (int block : {2, 14, 1152 * 2}) {
+        SCOPED_TRACE(block);
+        converter.Reset();
+        EXPECT_EQ(Convert(converter, input, block), reference);
+    }
+}
+
+// Once the buffers have grown to the block size, converting more blocks does not allocate
+TEST(PcmConverterTest, SteadyStateReusesBuffers) {
+    PcmConverter converter;
+    converter.Configure(44100, 2, 16000, 1);
+    auto input = Stereo(1152);
+    auto& first = converter.Convert(input.data(), input.size());
+    const int16_t* data = first.data();
+    size_t capacity = first.capacity();
+    for (int i = 0; i < 100; i++) {
+        auto& output = converter.Convert(input.data(), input.size());
+        ASSERT_EQ(&output, &first);
+        ASSERT_EQ(output.data(), data);
+        ASSERT_EQ(output.capacity(), capacity);
+    }
+}
@@ -0,0 +1,178 @@
+#include "audio/polyphase_resampler.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<int16_t> Tone(int sample_rate, double frequency, int frames, int channels, double amplitude) {
+    std::vector<int16_t> pcm(frames * channels);
+    for (int i = 0; i < frames; i++) {
+        double value = amplitude * 32767 * std::sin(2 * M_PI * frequency * i / sample_rate);
+        for (int c = 0; c < channels; c++) {
+            pcm[i * channels + c] = (int16_t)std::lround(value);
+        }
+    }
+    return pcm;
+}
+
+std::vector<int16_t> Resample(PolyphaseResampler& resampler, const std::vector<int16_t>& input, int block) {
+    std::vector<int16_t> output;
+    int channels = resampler.channels();
+    block *= channels;
+    for (size_t offset = 0; offset < input.size(); offset += block) {
+        int samples = (int)std::min<size_t>(block, input.size() - offset);
+        std::vector<int16_t> chunk(resampler.GetOutputSamples(samples));
+        int written = resampler.Process(input.data() + offset, samples, chunk.data());
+        EXPECT_EQ(written, (int)chunk.size());
+        output.insert(output.end(), chunk.begin(), chunk.begin() + written);
+    }
+    return output;
+}
+
+struct ToneFit {
+    double signal_power;
+    double residual_power;
+};
+
+// Least squares fit of a sine at frequency plus DC to channel 0, skipping the filter's start-up
+ToneFit FitTone(const std::vector<int16_t>& pcm, int channels, int sample_rate, double frequency, int skip) {
+    int frames = (int)pcm.size() / channels;
+    double ss = 0, cc = 0, sc = 0, sy = 0, cy = 0, y_sum = 0;
+    int n = 0;
+    for (int i = skip; i < frames; i++, n++) {
+        double w = 2 * M_PI * frequency * i / sample_rate;
+        double s = std::sin(w), c = std::cos(w), y = pcm[i * channels];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        sy += s * y;
+        cy += c * y;
+        y_sum += y;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (sy * cc - cy * sc) / det;
+    double b = (cy * ss - sy * sc) / det;
+    double dc = y_sum / n;
+    double residual = 0;
+    for (int i = skip; i < frames; i++) {
+        double w = 2 * M_PI * frequency * i / sample_rate;
+        double e = pcm[i * channels] - (a * std::sin(w) + b * std::cos(w) + dc);
+        residual += e * e;
+    }
+    return {(a * a + b * b) / 2, residual / n};
+}
+
+double PowerDb(const std::vector<int16_t>& pcm, int skip) {
+    double sum = 0;
+    for (size_t i = skip; i < pcm.size(); i++) {
+        sum += (double)pcm[i] * pcm[i];
+    }
+    return 10 * std::log10(sum / (pcm.size() - skip) + 1e-9);
+}
+
+// 1 kHz at half scale must pass with at least this SNR (noise and distortion)
+double SnrDb(int input_rate, int output_rate, ResamplerQuality quality) {
+    PolyphaseResampler resampler;
+    resampler.Configure(input_rate, output_rate, 1, quality);
+    auto output = Resample(resampler, Tone(input_rate, 1000, input_rate, 1, 0.5), 480);
+    auto fit = FitTone(output, 1, output_rate, 1000, output_rate / 10);
+    return 10 * std::log10(fit.signal_power / fit.residual_power);
+}
+
+// Output level of a full scale tone relative to the input, skipping the filter's start-up
+double GainDb(int input_rate, int output_rate, ResamplerQuality quality, double frequency) {
+    auto input = Tone(input_rate, frequency, input_rate, 1, 1.0);
+    PolyphaseResampler resampler;
+    resampler.Configure(input_rate, output_rate, 1, quality);
+    auto output = Resample(resampler, input, 480);
+    return PowerDb(output, output_rate / 10) - PowerDb(input, 0);
+}
+
+// A tone at 0.7 of the lower Nyquist frequency must pass
+double PassbandDb(int input_rate, int output_rate, ResamplerQuality quality) {
+    return GainDb(input_rate, output_rate, quality, 0.35 * std::min(input_rate, output_rate));
+}
+
+// A tone at 0.6 of the output rate folds back to 0.4 of it, well inside the passband
+double AliasingDb(int input_rate, int output_rate, ResamplerQuality quality) {
+    return GainDb(input_rate, output_rate, quality, 0.6 * output_rate);
+}
+
+const char* QualityName(ResamplerQuality quality) {
+    switch (quality) {
+    case ResamplerQuality::kLow: return "low";
+    case ResamplerQuality::kHigh: return "high";
+    default: return "medium";
+    }
+}
+
+}  // namespace
+
+TEST(PolyphaseResamplerTest, BlockSizeDoesNotChangeOutput) {
+    auto input = Tone(44100, 440, 4410, 2, 0.8);
+    for (int i = 0; i < 4410; i++) {
+        input[i * 2 + 1] = (int16_t)(input[i * 2] / 3);    // Channels must stay apart
+    }
+    PolyphaseResampler resampler;
+    resampler.Configure(44100, 16000, 2);
+    auto reference = Resample(resampler, input, 4410);
+    EXPECT_EQ(reference.size(), 1600u * 2);
+    for (int block : {1, 7, 160, 441}) {
+        SCOPED_TRACE(block);
+        resampler.Reset();
+        EXPECT_EQ(Resample(resampler, input, block), reference);
+    }
+}
+
+TEST(PolyphaseResamplerTest, MatchingRatesCopyInput) {
+    auto input = Tone(16000, 1000, 160, 1, 0.5);
+    PolyphaseResampler resampler;
+    resampler.Configure(16000, 16000);
+    EXPECT_EQ(Resample(resampler, input, 33), input);
+}
+
+// The cutoff drops with the decimation ratio, so the filter must get longer to stay as sharp
+TEST(PolyphaseResamplerTest, DecimationKeepsPassbandAndRejectsAliases) {
+    for (auto [input_rate, output_rate] : {std::pair{48000, 16000}, {44100, 16000}, {44100, 8000}, {44100, 24000}}) {
+        SCOPED_TRACE(std::to_string(input_rate) + " -> " + std::to_string(output_rate));
+        EXPECT_GT(PassbandDb(input_rate, output_rate, ResamplerQuality::kMedium), -1);
+        EXPECT_LT(AliasingDb(input_rate, output_rate, ResamplerQuality::kMedium), -60);
+        EXPECT_GT(SnrDb(input_rate, output_rate, ResamplerQuality::kMedium), 60);
+    }
+}
+
+TEST(PolyphaseResamplerTest, InterpolationKeepsTone) {
+    for (auto [input_rate, output_rate] : {std::pair{16000, 48000}, {22050, 24000}, {44100, 48000}}) {
+        SCOPED_TRACE(std::to_string(input_rate) + " -> " + std::to_string(output_rate));
+        EXPECT_GT(PassbandDb(input_rate, output_rate, ResamplerQuality::kMedium), -1);
+        EXPECT_GT(SnrDb(input_rate, output_rate, ResamplerQuality::kMedium), 60);
+    }
+}
+
+// Passband level, SNR of a 1 kHz tone, level of a tone that would alias, and cost per second of stereo audio
+TEST(PolyphaseResamplerTest, SnrAndAliasingBenchmark) {
+    const std::pair<int, int> conversions[] = {{44100, 16000}, {48000, 16000}, {44100, 24000}, {44100, 8000}, {16000, 48000}};
+    for (auto quality : {ResamplerQuality::kLow, ResamplerQuality::kMedium, ResamplerQuality::kHigh}) {
+        for (auto [input_rate, output_rate] : conversions) {
+            double passband = PassbandDb(input_rate, output_rate, quality);
+            double snr = SnrDb(input_rate, output_rate, quality);
+            double aliasing = input_rate > output_rate ? AliasingDb(input_rate, output_rate, quality) : 0;
+
+            auto input = Tone(input_rate, 1000, input_rate, 2, 0.5);
+            PolyphaseResampler resampler;
+            resampler.Configure(input_rate, output_rate, 2, quality);
+            auto start = std::chrono::steady_clock::now();
+            Resample(resampler, input, 1152);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            printf("%-6s %5d -> %5d Hz: passband %5.1f dB, SNR %5.1f dB, aliasing %6.1f dB, %6.0f us per second of stereo\n",
+                   QualityName(quality), input_rate, output_rate, passband, snr, aliasing, us);
+            EXPECT_GT(snr, 40);
+        }
+    }
+}
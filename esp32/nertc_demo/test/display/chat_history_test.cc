@@ -0,0 +1,174 @@
+#include "display/chat_history.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kRows = 20;
+constexpr size_t kHistory = 100;
+
+// Stands in for the LVGL rows of LcdDisplay, in the order they are laid out
+class FakeRows {
+public:
+    explicit FakeRows(ChatHistory& history) {
+        history.OnCreateRow([this](int row) {
+            EXPECT_EQ(row, (int)rows_.size());
+            rows_.push_back({});
+            order_.push_back(row);
+            creates++;
+        });
+        history.OnBindRow([this](int row, const ChatHistory::Message& message) {
+            rows_[row] = {message.role, message.content, false};
+            binds++;
+        });
+        history.OnHideRow([this](int row) {
+            rows_[row].hidden = true;
+        });
+        history.OnMoveRowToEnd([this](int row) {
+            order_.erase(std::find(order_.begin(), order_.end(), row));
+            order_.push_back(row);
+        });
+    }
+
+    // The contents of the visible rows from the top
+    std::vector<std::string> Shown() const {
+        std::vector<std::string> shown;
+        for (int row : order_) {
+            if (!rows_[row].hidden) {
+                shown.push_back(rows_[row].content);
+            }
+        }
+        return shown;
+    }
+
+    const std::string& content(int row) const { return rows_[row].content; }
+    const std::vector<int>& order() const { return order_; }
+
+    int creates = 0;
+    int binds = 0;
+
+private:
+    struct Row {
+        std::string role;
+        std::string content;
+        bool hidden;
+    };
+    std::vector<Row> rows_;
+    std::vector<int> order_;
+};
+
+// What the rows should show when the history window starts at first
+std::vector<std::string> Expected(const ChatHistory& history, size_t first, size_t count) {
+    std::vector<std::string> expected;
+    for (size_t i = first; i < first + count && i < history.size(); i++) {
+        expected.push_back(history.message(i).content);
+    }
+    return expected;
+}
+
+}  // namespace
+
+TEST(ChatHistoryTest, ThousandMessagesReuseTheRowPool) {
+    ChatHistory history(kRows, kHistory);
+    FakeRows rows(history);
+
+    size_t max_row_count = 0, max_size = 0, max_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; i++) {
+        const char* role = i % 2 == 0 ? "user" : "assistant";
+        std::string content = std::string(role) + " message " + std::to_string(i) + std::string(i % 97, '.');
+        int binds = rows.binds;
+        int row = history.Add(role, content.c_str());
+        // One row is bound per message whatever the length of the conversation
+        ASSERT_GE(row, 0);
+        ASSERT_EQ(rows.binds - binds, 1);
+        ASSERT_EQ(rows.content(row), content);
+        ASSERT_EQ(rows.order().back(), row);
+
+        max_row_count = std::max(max_row_count, history.row_count());
+        max_size = std::max(max_size, history.size());
+        size_t bytes = 0;
+        for (size_t m = 0; m < history.size(); m++) {
+            bytes += history.message(m).content.size();
+        }
+        max_bytes = std::max(max_bytes, bytes);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(rows.creates, (int)kRows);
+    EXPECT_EQ(max_row_count, kRows);
+    EXPECT_EQ(max_size, kHistory);
+    // The rows show the latest messages in order
+    EXPECT_EQ(rows.Shown(), Expected(history, kHistory - kRows, kRows));
+    EXPECT_EQ(history.message(kHistory - 1).content.rfind("assistant message 999", 0), 0u);
+    printf("1000 messages: %d rows created, %d binds, %zu messages kept (%zu bytes of text at most), %.2f us per message\n",
+        rows.creates, rows.binds, max_size, max_bytes, us / 1000);
+}
+
+TEST(ChatHistoryTest, ScrollingBackRebindsOlderMessages) {
+    ChatHistory history(kRows, kHistory);
+    FakeRows rows(history);
+    for (int i = 0; i < 1000; i++) {
+        history.Add(i % 2 == 0 ? "user" : "assistant", ("message " + std::to_string(i)).c_str());
+    }
+    ASSERT_EQ(history.window(), kHistory - kRows);
+
+    // Scroll to the top edge until the oldest kept message is shown
+    int scrolls = 0;
+    while (true) {
+        std::string top = rows.Shown().front();
+        int binds = rows.binds;
+        int anchor = history.ScrollBack();
+        if (anchor < 0) {
+            break;
+        }
+        scrolls++;
+        // Only the rows are rebound, and the message that was at the top is still shown
+        EXPECT_EQ(rows.binds - binds, (int)kRows);
+        EXPECT_EQ(rows.content(anchor), top);
+        EXPECT_EQ(rows.Shown(), Expected(history, history.window(), kRows));
+    }
+    EXPECT_EQ(history.window(), 0u);
+    EXPECT_EQ(rows.Shown().front(), "message 900");
+    EXPECT_EQ(scrolls, (int)((kHistory - kRows) / (kRows / 2)));
+
+    // And back down again
+    std::string bottom = rows.Shown().back();
+    int anchor = history.ScrollForward();
+    ASSERT_GE(anchor, 0);
+    EXPECT_EQ(rows.content(anchor), bottom);
+    EXPECT_EQ(rows.Shown(), Expected(history, kRows / 2, kRows));
+
+    // A new message while scrolled back jumps to the latest ones
+    int row = history.Add("assistant", "message 1000");
+    EXPECT_EQ(rows.content(row), "message 1000");
+    EXPECT_EQ(row, rows.order().back());
+    EXPECT_EQ(rows.Shown(), Expected(history, kHistory - kRows, kRows));
+    EXPECT_EQ(history.ScrollForward(), -1);
+}
+
+TEST(ChatHistoryTest, SystemMessagesCollapse) {
+    ChatHistory history(kRows, kHistory);
+    FakeRows rows(history);
+    history.Add("user", "hello");
+    history.Add("system", "connecting");
+    history.Add("system", "connected");
+    EXPECT_EQ(rows.Shown(), (std::vector<std::string>{"hello", "connected"}));
+    EXPECT_EQ(rows.creates, 2);
+
+    // An empty system message removes the system message before it
+    EXPECT_EQ(history.Add("system", ""), -1);
+    EXPECT_EQ(rows.Shown(), (std::vector<std::string>{"hello"}));
+    EXPECT_EQ(history.Add("user", ""), -1);
+    EXPECT_EQ(history.size(), 1u);
+
+    // Roles other than user and system are shown as the assistant
+    int row = history.Add("tool", "result");
+    EXPECT_STREQ(history.message(history.size() - 1).role, "assistant");
+    EXPECT_EQ(rows.content(row), "result");
+}
@@ -0,0 +1,13 @@
+#pragma once
+// Forced into the sources whose heap use is measured: the standard headers are read first, then
+// malloc and free are renamed to the counting versions from heap_counter.h
+#include <stdlib.h>
+#include <string.h>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "heap_counter.h"
+
+#define malloc counted_malloc
+#define free counted_free
@@ -0,0 +1,299 @@
+#include "display/dirty_tracking_panel.h"
+
+#include <gtest/gtest.h>
+#include <esp_lcd_panel_io.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kWidth = 128;
+constexpr int kHeight = 64;
+constexpr int kPages = kHeight / 8;
+
+#define SSD1306_CMD_SET_COLUMN_RANGE 0x21
+#define SSD1306_CMD_SET_PAGE_RANGE 0x22
+
+struct Transfer {
+    int x_start;
+    int x_end;
+    int page_start;
+    int page_end;
+    size_t bytes;
+};
+
+// Panel IO of an SSD1306 in horizontal addressing mode: records the data transfers
+// and writes them into a copy of the panel RAM
+struct MockPanelIo {
+    esp_lcd_panel_io_t base = {};
+    std::vector<uint8_t> ram = std::vector<uint8_t>(kWidth * kPages, 0);
+    std::vector<Transfer> transfers;
+    int column_range[2] = {0, kWidth - 1};
+    int page_range[2] = {0, kPages - 1};
+    bool fail_next = false;
+
+    MockPanelIo() {
+        base.tx_param = [](esp_lcd_panel_io_t* io, int cmd, const void* param, size_t size) {
+            auto self = __containerof(io, MockPanelIo, base);
+            auto bytes = static_cast<const uint8_t*>(param);
+            if (size != 2) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (cmd == SSD1306_CMD_SET_COLUMN_RANGE) {
+                self->column_range[0] = bytes[0];
+                self->column_range[1] = bytes[1];
+            } else if (cmd == SSD1306_CMD_SET_PAGE_RANGE) {
+                self->page_range[0] = bytes[0];
+                self->page_range[1] = bytes[1];
+            }
+            return ESP_OK;
+        };
+        base.tx_color = [](esp_lcd_panel_io_t* io, int cmd, const void* color, size_t size) {
+            auto self = __containerof(io, MockPanelIo, base);
+            if (self->fail_next) {
+                self->fail_next = false;
+                return ESP_FAIL;
+            }
+            self->transfers.push_back({self->column_range[0], self->column_range[1] + 1,
+                self->page_range[0], self->page_range[1] + 1, size});
+            // The column pointer wraps within the column range and moves to the next page
+            auto data = static_cast<const uint8_t*>(color);
+            int x = self->column_range[0];
+            int page = self->page_range[0];
+            for (size_t i = 0; i < size; i++) {
+                self->ram[page * kWidth + x] = data[i];
+                if (++x > self->column_range[1]) {
+                    x = self->column_range[0];
+                    if (++page > self->page_range[1]) {
+                        page = self->page_range[0];
+                    }
+                }
+            }
+            return ESP_OK;
+        };
+    }
+
+    size_t bytes_sent() const {
+        size_t bytes = 0;
+        for (auto& transfer : transfers) {
+            bytes += transfer.bytes;
+        }
+        return bytes;
+    }
+};
+
+// The draw_bitmap of the esp_lcd SSD1306 driver: set the window, then send the pages
+struct FakeSsd1306 {
+    esp_lcd_panel_t base = {};
+    esp_lcd_panel_io_handle_t io;
+
+    explicit FakeSsd1306(esp_lcd_panel_io_handle_t io) : io(io) {
+        base.draw_bitmap = [](esp_lcd_panel_t* panel, int x_start, int y_start, int x_end, int y_end, const void* data) {
+            auto self = __containerof(panel, FakeSsd1306, base);
+            y_start /= 8;
+            y_end /= 8;
+            uint8_t columns[] = {(uint8_t)(x_start & 0x7F), (uint8_t)((x_end - 1) & 0x7F)};
+            uint8_t pages[] = {(uint8_t)(y_start & 0x07), (uint8_t)((y_end - 1) & 0x07)};
+            esp_err_t ret = esp_lcd_panel_io_tx_param(self->io, SSD1306_CMD_SET_COLUMN_RANGE, columns, 2);
+            if (ret == ESP_OK) {
+                ret = esp_lcd_panel_io_tx_param(self->io, SSD1306_CMD_SET_PAGE_RANGE, pages, 2);
+            }
+            if (ret == ESP_OK) {
+                ret = esp_lcd_panel_io_tx_color(self->io, -1, data, (x_end - x_start) * (y_end - y_start));
+            }
+            return ret;
+        };
+    }
+};
+
+class DirtyTrackingPanelTest : public ::testing::Test {
+protected:
+    DirtyTrackingPanelTest() : panel_(&ssd1306_.base, kWidth, kHeight), frame_(kWidth * kPages, 0) {
+        panel_.OnFlushSkipped([this]() { skipped_++; });
+    }
+
+    // Flushes the pages of frame_ in the area like esp_lvgl_port does after converting it to pages
+    esp_err_t Flush(int x_start, int page_start, int x_end, int page_end) {
+        std::vector<uint8_t> area;
+        for (int page = page_start; page < page_end; page++) {
+            area.insert(area.end(), &frame_[page * kWidth + x_start], &frame_[page * kWidth + x_end]);
+        }
+        return esp_lcd_panel_draw_bitmap(panel_.handle(), x_start, page_start * 8, x_end, page_end * 8, area.data());
+    }
+
+    esp_err_t FlushAll() {
+        return Flush(0, 0, kWidth, kPages);
+    }
+
+    // Flushes the whole frame once, so that the panel RAM is known
+    void Prime() {
+        for (size_t i = 0; i < frame_.size(); i++) {
+            frame_[i] = (uint8_t)(i * 31 + 7);
+        }
+        ASSERT_EQ(FlushAll(), ESP_OK);
+        io_.transfers.clear();
+    }
+
+    uint8_t& at(int x, int page) {
+        return frame_[page * kWidth + x];
+    }
+
+    MockPanelIo io_;
+    FakeSsd1306 ssd1306_{&io_.base};
+    DirtyTrackingPanel panel_;
+    std::vector<uint8_t> frame_;
+    int skipped_ = 0;
+};
+
+}  // namespace
+
+TEST_F(DirtyTrackingPanelTest, FirstFlushPassesThrough) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    // The frame went out in one full screen transfer
+    EXPECT_EQ(panel_.stats().transactions, 1u);
+    EXPECT_EQ(panel_.stats().bytes_sent, (uint32_t)(kWidth * kPages));
+    EXPECT_EQ(io_.ram, frame_);
+    EXPECT_EQ(skipped_, 0);
+}
+
+TEST_F(DirtyTrackingPanelTest, PartialFlushBeforeTheFirstFullOnePassesThrough) {
+    at(5, 1) = 0xFF;
+    ASSERT_EQ(Flush(0, 0, 16, 2), ESP_OK);
+    ASSERT_EQ(Flush(0, 0, 16, 2), ESP_OK);
+    // The rest of the panel RAM is unknown, so even the unchanged repeat is sent
+    ASSERT_EQ(io_.transfers.size(), 2u);
+    EXPECT_EQ(io_.transfers[1].bytes, 32u);
+    EXPECT_EQ(skipped_, 0);
+}
+
+TEST_F(DirtyTrackingPanelTest, UnchangedPagesSendNothing) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    ASSERT_EQ(Flush(32, 2, 96, 5), ESP_OK);
+    EXPECT_TRUE(io_.transfers.empty());
+    // esp_lvgl_port is told that both flushes are done
+    EXPECT_EQ(skipped_, 2);
+    EXPECT_EQ(io_.ram, frame_);
+}
+
+TEST_F(DirtyTrackingPanelTest, NearbyColumnsMergeIntoOneSpan) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    // Columns 10 and 19 leave a gap of 8 clean columns, which is cheaper to send along
+    at(10, 3) ^= 0xFF;
+    at(19, 3) ^= 0xFF;
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    ASSERT_EQ(io_.transfers.size(), 1u);
+    EXPECT_EQ(io_.transfers[0].x_start, 10);
+    EXPECT_EQ(io_.transfers[0].x_end, 20);
+    EXPECT_EQ(io_.transfers[0].page_start, 3);
+    EXPECT_EQ(io_.transfers[0].page_end, 4);
+    EXPECT_EQ(io_.ram, frame_);
+    EXPECT_EQ(skipped_, 0);
+}
+
+TEST_F(DirtyTrackingPanelTest, DistantColumnsSplitIntoTwoSpans) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    // A gap of 9 clean columns starts a new span
+    at(10, 3) ^= 0xFF;
+    at(20, 3) ^= 0xFF;
+    at(100, 6) ^= 0xFF;
+    at(101, 6) ^= 0xFF;
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    ASSERT_EQ(io_.transfers.size(), 3u);
+    EXPECT_EQ(io_.transfers[0].x_start, 10);
+    EXPECT_EQ(io_.transfers[0].x_end, 11);
+    EXPECT_EQ(io_.transfers[1].x_start, 20);
+    EXPECT_EQ(io_.transfers[1].x_end, 21);
+    EXPECT_EQ(io_.transfers[2].x_start, 100);
+    EXPECT_EQ(io_.transfers[2].x_end, 102);
+    EXPECT_EQ(io_.transfers[2].page_start, 6);
+    EXPECT_EQ(io_.bytes_sent(), 4u);
+    EXPECT_EQ(io_.ram, frame_);
+}
+
+TEST_F(DirtyTrackingPanelTest, FullWidthPagesMergeIntoOneWindow) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    // New text across the full width, with clean gaps short enough to send along
+    for (int page : {2, 3, 4, 6}) {
+        for (int x = 0; x < kWidth; x += 4) {
+            at(x, page) ^= 0xFF;
+        }
+        at(kWidth - 1, page) ^= 0xFF;
+    }
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    // Pages 2 to 4 are consecutive and go out as one window, page 6 on its own
+    ASSERT_EQ(io_.transfers.size(), 2u);
+    EXPECT_EQ(io_.transfers[0].page_start, 2);
+    EXPECT_EQ(io_.transfers[0].page_end, 5);
+    EXPECT_EQ(io_.transfers[0].x_start, 0);
+    EXPECT_EQ(io_.transfers[0].x_end, kWidth);
+    EXPECT_EQ(io_.transfers[1].page_start, 6);
+    EXPECT_EQ(io_.transfers[1].page_end, 7);
+    EXPECT_EQ(io_.ram, frame_);
+}
+
+TEST_F(DirtyTrackingPanelTest, PartialAreaSendsOnlyItsChangedColumns) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    at(40, 4) ^= 0x0F;
+    at(41, 4) ^= 0x0F;
+    ASSERT_EQ(Flush(32, 3, 64, 6), ESP_OK);
+    ASSERT_EQ(io_.transfers.size(), 1u);
+    EXPECT_EQ(io_.transfers[0].x_start, 40);
+    EXPECT_EQ(io_.transfers[0].x_end, 42);
+    EXPECT_EQ(io_.transfers[0].page_start, 4);
+    EXPECT_EQ(io_.ram, frame_);
+}
+
+TEST_F(DirtyTrackingPanelTest, FailedTransferResendsTheNextFlush) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    at(10, 1) ^= 0xFF;
+    io_.fail_next = true;
+    EXPECT_NE(FlushAll(), ESP_OK);
+    EXPECT_NE(io_.ram, frame_);
+    // What reached the panel is unknown again, so the next flush is sent whole
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    ASSERT_EQ(io_.transfers.size(), 1u);
+    EXPECT_EQ(io_.transfers[0].bytes, (size_t)(kWidth * kPages));
+    EXPECT_EQ(io_.ram, frame_);
+    EXPECT_EQ(skipped_, 0);
+}
+
+TEST_F(DirtyTrackingPanelTest, UnalignedAreaPassesThrough) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    std::vector<uint8_t> data(16 * 2, 0xAA);
+    ASSERT_EQ(esp_lcd_panel_draw_bitmap(panel_.handle(), 0, 4, 16, 20, data.data()), ESP_OK);
+    EXPECT_EQ(io_.transfers.size(), 1u);
+    // The shadow can no longer be trusted, so a repeated full frame is sent whole
+    io_.transfers.clear();
+    ASSERT_EQ(FlushAll(), ESP_OK);
+    ASSERT_EQ(io_.transfers.size(), 1u);
+    EXPECT_EQ(io_.transfers[0].bytes, (size_t)(kWidth * kPages));
+    EXPECT_EQ(io_.ram, frame_);
+}
+
+TEST_F(DirtyTrackingPanelTest, RandomEditsKeepThePanelInSync) {
+    ASSERT_NO_FATAL_FAILURE(Prime());
+    std::mt19937 rng(40);
+    for (int i = 0; i < 500; i++) {
+        // A few changed bytes, like a clock or a status icon, and sometimes a whole page of text
+        int edits = rng() % 6;
+        for (int e = 0; e < edits; e++) {
+            at(rng() % kWidth, rng() % kPages) = (uint8_t)rng();
+        }
+        if (rng() % 10 == 0) {
+            int page = rng() % kPages;
+            for (int x = 0; x < kWidth; x++) {
+                at(x, page) = (uint8_t)rng();
+            }
+        }
+        ASSERT_EQ(FlushAll(), ESP_OK);
+        ASSERT_EQ(io_.ram, frame_) << "after flush " << i;
+    }
+    const auto& stats = panel_.stats();
+    printf("500 flushes of %dx%d: %lu transactions, %lu of %lu bytes sent (%.1f%%), %d skipped\n",
+        kWidth, kHeight, (unsigned long)stats.transactions, (unsigned long)stats.bytes_sent,
+        (unsigned long)stats.bytes_requested, 100.0 * stats.bytes_sent / stats.bytes_requested, skipped_);
+    EXPECT_LT(stats.bytes_sent, stats.bytes_requested / 10);
+}
@@ -0,0 +1,73 @@
+#include "display/emotion_registry.h"
+
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(EmotionRegistryTest, DefaultEmotionsAreRegistered) {
+    auto& registry = EmotionRegistry::GetInstance();
+    std::set<EmotionId> ids;
+    for (const char* name : {"neutral", "happy", "sad", "thinking", "confused", "wifi", "call", "mute"}) {
+        SCOPED_TRACE(name);
+        EmotionId id = registry.Find(name);
+        ASSERT_NE(id, EMOTION_ID_NONE);
+        EXPECT_STREQ(registry.GetName(id), name);
+        EXPECT_EQ(registry.Intern(name), id);
+        ids.insert(id);
+    }
+    EXPECT_EQ(ids.size(), 8u);
+    EXPECT_EQ(registry.Find("neutral"), 0);
+}
+
+TEST(EmotionRegistryTest, FindDoesNotRegisterUnknownNames) {
+    auto& registry = EmotionRegistry::GetInstance();
+    EXPECT_EQ(registry.Find("never-sent-by-anyone"), EMOTION_ID_NONE);
+    EXPECT_EQ(registry.Find("never-sent-by-anyone"), EMOTION_ID_NONE);
+    EXPECT_EQ(registry.Find(nullptr), EMOTION_ID_NONE);
+    EXPECT_EQ(registry.Intern(nullptr), EMOTION_ID_NONE);
+    EXPECT_STREQ(registry.GetName(EMOTION_ID_NONE), "");
+}
+
+TEST(EmotionRegistryTest, InternKeepsIdsAndNamesStableWhileGrowing) {
+    auto& registry = EmotionRegistry::GetInstance();
+    EmotionId happy = registry.Find("happy");
+    const char* happy_name = registry.GetName(happy);
+
+    // Well past the initial 64 slots, so the table grows several times
+    std::vector<EmotionId> ids;
+    for (int i = 0; i < 300; i++) {
+        std::string name = "custom_" + std::to_string(i);
+        EmotionId id = registry.Intern(name.c_str());
+        ASSERT_NE(id, EMOTION_ID_NONE);
+        ids.push_back(id);
+    }
+    for (int i = 0; i < 300; i++) {
+        std::string name = "custom_" + std::to_string(i);
+        EXPECT_EQ(registry.Find(name.c_str()), ids[i]);
+        EXPECT_EQ(registry.GetName(ids[i]), name);
+    }
+    EXPECT_EQ(std::set<EmotionId>(ids.begin(), ids.end()).size(), ids.size());
+    EXPECT_EQ(registry.Find("happy"), happy);
+    EXPECT_EQ(registry.GetName(happy), happy_name);
+}
+
+TEST(EmotionRegistryTest, ConcurrentInternReturnsOneIdPerName) {
+    auto& registry = EmotionRegistry::GetInstance();
+    std::vector<std::vector<EmotionId>> results(4);
+    std::vector<std::thread> threads;
+    for (auto& result : results) {
+        threads.emplace_back([&registry, &result] {
+            for (int i = 0; i < 200; i++) {
+                result.push_back(registry.Intern(("threaded_" + std::to_string(i)).c_str()));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t t = 1; t < results.size(); t++) {
+        EXPECT_EQ(results[t], results[0]);
+    }
+}
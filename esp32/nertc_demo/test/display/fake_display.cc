@@ -0,0 +1,128 @@
+#include "fake_display.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+struct _lv_obj_t {
+    lv_area_t coords;
+    const void* src;
+};
+
+// Areas invalidated since the last flush, guarded by the display lock as in LVGL
+static std::vector<lv_area_t> invalidated_areas;
+
+// The out of line members of Display, without the settings and logging of display.cc
+Display::Display() {
+}
+
+Display::~Display() {
+}
+
+void Display::SetStatus(const char* status) {
+}
+
+void Display::ShowNotification(const std::string& notification, int duration_ms) {
+}
+
+void Display::ShowNotification(const char* notification, int duration_ms) {
+}
+
+void Display::UpdateStatusBar(bool update_all) {
+}
+
+void Display::SetEmotion(const char* emotion) {
+}
+
+void Display::SetChatMessage(const char* role, const char* content) {
+}
+
+void Display::SetTheme(Theme* theme) {
+    current_theme_ = theme;
+}
+
+void Display::SetPowerSaveMode(bool on) {
+}
+
+FakeDisplay::FakeDisplay() {
+    width_ = LV_HOR_RES;
+    height_ = LV_VER_RES;
+    screen_ = new _lv_obj_t{{0, 0, LV_HOR_RES - 1, LV_VER_RES - 1}, nullptr};
+}
+
+FakeDisplay::~FakeDisplay() {
+    delete screen_;
+    invalidated_areas.clear();
+}
+
+void FakeDisplay::SetFlushCallback(FlushCallback callback) {
+    std::lock_guard<std::recursive_timed_mutex> lock(mutex_);
+    flush_callback_ = std::move(callback);
+}
+
+bool FakeDisplay::Lock(int timeout_ms) {
+    if (!mutex_.try_lock_for(std::chrono::milliseconds(timeout_ms))) {
+        return false;
+    }
+    lock_depth_++;
+    return true;
+}
+
+void FakeDisplay::Unlock() {
+    if (--lock_depth_ == 0 && !invalidated_areas.empty()) {
+        if (flush_callback_) {
+            flush_callback_(invalidated_areas);
+        }
+        invalidated_areas.clear();
+    }
+    mutex_.unlock();
+}
+
+lv_obj_t* lv_image_create(lv_obj_t* parent) {
+    lv_area_t coords = parent != nullptr ? parent->coords : lv_area_t{0, 0, LV_HOR_RES - 1, LV_VER_RES - 1};
+    return new _lv_obj_t{coords, nullptr};
+}
+
+void lv_image_set_src(lv_obj_t* obj, const void* src) {
+    obj->src = src;
+    lv_obj_invalidate(obj);
+}
+
+void lv_obj_set_size(lv_obj_t* obj, int32_t w, int32_t h) {
+    obj->coords.x2 = obj->coords.x1 + w - 1;
+    obj->coords.y2 = obj->coords.y1 + h - 1;
+}
+
+void lv_obj_set_style_border_width(lv_obj_t* obj, int32_t value, uint32_t selector) {
+}
+
+void lv_obj_set_style_bg_opa(lv_obj_t* obj, uint8_t value, uint32_t selector) {
+}
+
+void lv_obj_center(lv_obj_t* obj) {
+    lv_area_move(&obj->coords, (LV_HOR_RES - lv_area_get_width(&obj->coords)) / 2 - obj->coords.x1,
+        (LV_VER_RES - lv_area_get_height(&obj->coords)) / 2 - obj->coords.y1);
+}
+
+void lv_obj_del(lv_obj_t* obj) {
+    delete obj;
+}
+
+void lv_obj_get_coords(const lv_obj_t* obj, lv_area_t* coords) {
+    *coords = obj->coords;
+}
+
+void lv_obj_invalidate(const lv_obj_t* obj) {
+    invalidated_areas.push_back(obj->coords);
+}
+
+void lv_obj_invalidate_area(const lv_obj_t* obj, const lv_area_t* area) {
+    // LVGL clips the area to the object
+    lv_area_t clipped = {
+        std::max(area->x1, obj->coords.x1), std::max(area->y1, obj->coords.y1),
+        std::min(area->x2, obj->coords.x2), std::min(area->y2, obj->coords.y2),
+    };
+    if (clipped.x1 <= clipped.x2 && clipped.y1 <= clipped.y2) {
+        invalidated_areas.push_back(clipped);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+// A Display over the LVGL stub (stubs/lvgl.h) for the code that draws through LVGL.
+// Nothing is rendered: the areas invalidated while the display was locked are handed
+// to the flush callback when it is unlocked, which is when LVGL would send them to the panel.
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "display/display.h"
+
+class FakeDisplay : public Display {
+public:
+    using FlushCallback = std::function<void(const std::vector<lv_area_t>& areas)>;
+
+    FakeDisplay();
+    ~FakeDisplay() override;
+
+    // Called on the thread that unlocks the display, with the display still locked
+    void SetFlushCallback(FlushCallback callback);
+    lv_obj_t* screen() const { return screen_; }
+
+private:
+    bool Lock(int timeout_ms = 0) override;
+    void Unlock() override;
+
+    std::recursive_timed_mutex mutex_;
+    int lock_depth_ = 0;
+    FlushCallback flush_callback_;
+    lv_obj_t* screen_ = nullptr;
+};
@@ -0,0 +1,194 @@
+// Host stand-ins for esp_new_jpeg's encoder and esp_image_effects' color conversion. The encoder is
+// libjpeg with the standard tables and 4:2:0 sampling, fed in the same blocks of whole MCU rows, so
+// output sizes and quality are close to the device's; its own memory is not part of any measurement
+#include <cstdio>
+#include <vector>
+
+#include <jpeglib.h>
+
+#include "esp_imgfx_color_convert.h"
+#include "esp_jpeg_enc.h"
+
+namespace {
+
+struct FakeEncoder {
+    jpeg_enc_config_t config;
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr error;
+    jpeg_destination_mgr destination;
+    JOCTET chunk[256];
+    std::vector<uint8_t> pending;  // Compressed bytes not handed out yet
+    std::vector<JSAMPLE> row;
+    int lines_done = 0;
+    bool started = false;
+
+    bool gray() const { return config.src_type == JPEG_PIXEL_FORMAT_GRAY; }
+    int block_lines() const { return gray() ? 8 : 16; }
+    int row_bytes() const { return config.width * (gray() ? 1 : 2); }
+};
+
+FakeEncoder* FromDestination(j_compress_ptr cinfo) {
+    return static_cast<FakeEncoder*>(cinfo->client_data);
+}
+
+void InitDestination(j_compress_ptr cinfo) {
+    auto encoder = FromDestination(cinfo);
+    cinfo->dest->next_output_byte = encoder->chunk;
+    cinfo->dest->free_in_buffer = sizeof(encoder->chunk);
+}
+
+boolean EmptyOutputBuffer(j_compress_ptr cinfo) {
+    auto encoder = FromDestination(cinfo);
+    encoder->pending.insert(encoder->pending.end(), encoder->chunk, encoder->chunk + sizeof(encoder->chunk));
+    InitDestination(cinfo);
+    return TRUE;
+}
+
+void TermDestination(j_compress_ptr cinfo) {
+    auto encoder = FromDestination(cinfo);
+    size_t used = sizeof(encoder->chunk) - cinfo->dest->free_in_buffer;
+    encoder->pending.insert(encoder->pending.end(), encoder->chunk, encoder->chunk + used);
+}
+
+// Encodes whole input rows until the image is complete, then hands out what was produced
+jpeg_error_t Encode(FakeEncoder* encoder, const uint8_t* in, int lines, uint8_t* out, int out_cap, int* out_size) {
+    if (!encoder->started) {
+        jpeg_start_compress(&encoder->cinfo, TRUE);
+        encoder->started = true;
+    }
+    for (int i = 0; i < lines && encoder->lines_done < encoder->config.height; i++) {
+        const uint8_t* src = in + i * encoder->row_bytes();
+        JSAMPROW row = const_cast<JSAMPROW>(src);
+        if (!encoder->gray()) {
+            // Y0 Cb Y1 Cr -> Y0 Cb Cr Y1 Cb Cr
+            for (int x = 0; x < encoder->config.width; x += 2) {
+                const uint8_t* p = src + x * 2;
+                JSAMPLE* q = &encoder->row[x * 3];
+                q[0] = p[0], q[1] = p[1], q[2] = p[3];
+                q[3] = p[2], q[4] = p[1], q[5] = p[3];
+            }
+            row = encoder->row.data();
+        }
+        jpeg_write_scanlines(&encoder->cinfo, &row, 1);
+        encoder->lines_done++;
+    }
+    if (encoder->lines_done == encoder->config.height) {
+        jpeg_finish_compress(&encoder->cinfo);
+        encoder->lines_done++;
+    }
+
+    *out_size = 0;
+    if (encoder->pending.size() > (size_t)out_cap) {
+        return JPEG_ERR_NO_MEM;
+    }
+    memcpy(out, encoder->pending.data(), encoder->pending.size());
+    *out_size = (int)encoder->pending.size();
+    encoder->pending.clear();
+    return JPEG_ERR_OK;
+}
+
+}  // namespace
+
+jpeg_error_t jpeg_enc_open(jpeg_enc_config_t* info, jpeg_enc_handle_t* jpeg_enc) {
+    bool gray = info->src_type == JPEG_PIXEL_FORMAT_GRAY;
+    if ((!gray && info->src_type != JPEG_PIXEL_FORMAT_YCbYCr) || info->width <= 0 || info->height <= 0 ||
+        info->width % 2 != 0) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    auto encoder = new FakeEncoder();
+    encoder->config = *info;
+    encoder->row.resize(info->width * 3);
+
+    auto& cinfo = encoder->cinfo;
+    cinfo.err = jpeg_std_error(&encoder->error);
+    jpeg_create_compress(&cinfo);
+    cinfo.client_data = encoder;
+    encoder->destination.init_destination = InitDestination;
+    encoder->destination.empty_output_buffer = EmptyOutputBuffer;
+    encoder->destination.term_destination = TermDestination;
+    cinfo.dest = &encoder->destination;
+    cinfo.image_width = info->width;
+    cinfo.image_height = info->height;
+    cinfo.input_components = gray ? 1 : 3;
+    cinfo.in_color_space = gray ? JCS_GRAYSCALE : JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, info->quality, TRUE);
+    *jpeg_enc = encoder;
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_enc_get_block_size(const jpeg_enc_handle_t jpeg_enc, int* block_size) {
+    auto encoder = static_cast<FakeEncoder*>(jpeg_enc);
+    *block_size = encoder->row_bytes() * encoder->block_lines();
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_enc_process_with_block(const jpeg_enc_handle_t jpeg_enc, const uint8_t* in_buf, int inbuf_size,
+                                         uint8_t* out_buf, int outbuf_size, int* out_size) {
+    auto encoder = static_cast<FakeEncoder*>(jpeg_enc);
+    if (inbuf_size != encoder->row_bytes() * encoder->block_lines()) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    return Encode(encoder, in_buf, encoder->block_lines(), out_buf, outbuf_size, out_size);
+}
+
+jpeg_error_t jpeg_enc_process(const jpeg_enc_handle_t jpeg_enc, const uint8_t* in_buf, int inbuf_size,
+                              uint8_t* out_buf, int outbuf_size, int* out_size) {
+    auto encoder = static_cast<FakeEncoder*>(jpeg_enc);
+    if (inbuf_size < encoder->row_bytes() * encoder->config.height) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    return Encode(encoder, in_buf, encoder->config.height, out_buf, outbuf_size, out_size);
+}
+
+jpeg_error_t jpeg_enc_close(jpeg_enc_handle_t jpeg_enc) {
+    auto encoder = static_cast<FakeEncoder*>(jpeg_enc);
+    jpeg_destroy_compress(&encoder->cinfo);
+    delete encoder;
+    return JPEG_ERR_OK;
+}
+
+namespace {
+
+struct FakeConvert {
+    esp_imgfx_color_convert_cfg_t config;
+};
+
+uint8_t Clamp(int v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+}  // namespace
+
+esp_imgfx_err_t esp_imgfx_color_convert_open(esp_imgfx_color_convert_cfg_t* cfg, esp_imgfx_color_convert_handle_t* handle) {
+    if (cfg->in_pixel_fmt != ESP_IMGFX_PIXEL_FMT_RGB888 || cfg->out_pixel_fmt != ESP_IMGFX_PIXEL_FMT_YUYV) {
+        return ESP_IMGFX_ERR_INVALID_PARAMETER;
+    }
+    *handle = new FakeConvert{*cfg};
+    return ESP_IMGFX_ERR_OK;
+}
+
+// BT.601 full range, chroma taken from the first pixel of each pair
+esp_imgfx_err_t esp_imgfx_color_convert_process(esp_imgfx_color_convert_handle_t handle, esp_imgfx_data_t* in_image,
+                                                esp_imgfx_data_t* out_image) {
+    auto convert = static_cast<FakeConvert*>(handle);
+    size_t pixels = (size_t)convert->config.in_res.width * convert->config.in_res.height;
+    if (in_image->data_len < pixels * 3 || out_image->data_len < pixels * 2) {
+        return ESP_IMGFX_ERR_INVALID_PARAMETER;
+    }
+    const uint8_t* p = in_image->data;
+    uint8_t* q = out_image->data;
+    for (size_t i = 0; i < pixels; i += 2, p += 6, q += 4) {
+        int r = p[0], g = p[1], b = p[2];
+        q[0] = Clamp((77 * r + 150 * g + 29 * b) >> 8);
+        q[1] = Clamp(((-43 * r - 85 * g + 128 * b) >> 8) + 128);
+        q[2] = Clamp((77 * p[3] + 150 * p[4] + 29 * p[5]) >> 8);
+        q[3] = Clamp(((128 * r - 107 * g - 21 * b) >> 8) + 128);
+    }
+    return ESP_IMGFX_ERR_OK;
+}
+
+esp_imgfx_err_t esp_imgfx_color_convert_close(esp_imgfx_color_convert_handle_t handle) {
+    delete static_cast<FakeConvert*>(handle);
+    return ESP_IMGFX_ERR_OK;
+}
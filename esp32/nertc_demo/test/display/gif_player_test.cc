@@ -0,0 +1,406 @@
+#include "display/gif_player.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "fake_display.h"
+
+namespace {
+
+struct __attribute__((packed)) GiflHeader {
+    char magic[4];
+    uint16_t width;
+    uint16_t height;
+    uint8_t fps;
+    uint8_t reserved;
+    uint16_t frames;
+    uint32_t data_offset;
+};
+
+// Every frame of an animation as RGB565, decoded independently of the player
+std::vector<std::vector<uint8_t>> DecodeFrames(const lz4_res_t* res) {
+    GiflHeader hdr;
+    memcpy(&hdr, res->start, sizeof(hdr));
+    const size_t frame_size = hdr.width * hdr.height * 2;
+    std::vector<std::vector<uint8_t>> frames;
+    const uint8_t* p = res->start + hdr.data_offset;
+    for (int i = 0; i < hdr.frames; i++) {
+        uint32_t len;
+        memcpy(&len, p, 4);
+        std::vector<uint8_t> frame(frame_size);
+        int n = LZ4_decompress_safe((const char*)p + 4, (char*)frame.data(), len, frame_size);
+        EXPECT_EQ(n, (int)frame_size);
+        frames.push_back(std::move(frame));
+        p += 4 + len;
+    }
+    return frames;
+}
+
+int AreaPixels(const lv_area_t& area) {
+    return lv_area_get_width(&area) * lv_area_get_height(&area);
+}
+
+// Copies the areas of an RGB565 image onto another of the same size, as a panel receives them
+void CopyAreas(const std::vector<uint8_t>& src, std::vector<uint8_t>& dst, int width,
+               const lv_area_t* areas, int count) {
+    for (int i = 0; i < count; i++) {
+        for (int y = areas[i].y1; y <= areas[i].y2; y++) {
+            size_t offset = (y * width + areas[i].x1) * 2;
+            memcpy(dst.data() + offset, src.data() + offset, lv_area_get_width(&areas[i]) * 2);
+        }
+    }
+}
+
+struct Flush {
+    int64_t time_us;
+    std::vector<lv_area_t> areas;
+    std::vector<uint8_t> image;     // The player's frame buffer as LVGL reads it for this flush
+};
+
+// Re-encodes an animation at another frame rate, repeated to at least min_frames frames, with
+// the frame index in the first pixel so that every frame differs and can be told apart on screen
+std::vector<uint8_t> Restamp(const lz4_res_t* res, uint8_t fps, int min_frames) {
+    GiflHeader hdr;
+    memcpy(&hdr, res->start, sizeof(hdr));
+    auto frames = DecodeFrames(res);
+    int count = (min_frames + frames.size() - 1) / frames.size() * frames.size();
+    hdr.fps = fps;
+    hdr.frames = count;
+    hdr.data_offset = sizeof(hdr);
+    std::vector<uint8_t> out((const uint8_t*)&hdr, (const uint8_t*)&hdr + sizeof(hdr));
+    std::vector<char> block(LZ4_compressBound(frames[0].size()));
+    for (int i = 0; i < count; i++) {
+        auto frame = frames[i % frames.size()];
+        frame[0] = i & 0xff;
+        frame[1] = i >> 8;
+        uint32_t len = LZ4_compress_default((const char*)frame.data(), block.data(), frame.size(), block.size());
+        out.insert(out.end(), (const uint8_t*)&len, (const uint8_t*)&len + 4);
+        out.insert(out.end(), block.begin(), block.begin() + len);
+    }
+    return out;
+}
+
+class GifPlayerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        display_.SetFlushCallback([this](const std::vector<lv_area_t>& areas) {
+            std::function<void(const std::vector<lv_area_t>&)> delay;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                delay = flush_delay_;
+            }
+            if (delay) {
+                delay(areas);
+            }
+            const lv_img_dsc_t* dsc = player_->GetImageDescriptor();
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushes_.push_back({esp_timer_get_time(), areas,
+                std::vector<uint8_t>(dsc->data, dsc->data + dsc->data_size)});
+            cv_.notify_all();
+        });
+        player_ = std::make_unique<GifPlayer>(&display_);
+        player_->InitCanvas(display_.screen());
+    }
+
+    // Runs before the flush is recorded, on the thread that flushes
+    void SetFlushDelay(std::function<void(const std::vector<lv_area_t>&)> delay) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_delay_ = std::move(delay);
+    }
+
+    void TearDown() override {
+        player_.reset();
+    }
+
+    size_t flush_count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return flushes_.size();
+    }
+
+    bool WaitForFlushes(size_t count, int timeout_ms = 2000) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return flushes_.size() >= count; });
+    }
+
+    Flush flush(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return flushes_[index];
+    }
+
+    FakeDisplay display_;
+    std::unique_ptr<GifPlayer> player_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Flush> flushes_;
+    std::function<void(const std::vector<lv_area_t>&)> flush_delay_;
+};
+
+}  // namespace
+
+TEST_F(GifPlayerTest, ReplayedEmotionsHitThePsramCache) {
+    // A conversation as the server drives it: thinking while the answer is generated,
+    // the answer's emotion, then back to neutral
+    const char* answers[] = {"happy", "sad", "surprised", "happy", "loving", "confused",
+                             "happy", "angry", "sleepy", "surprised", "embarrassed", "happy"};
+    std::vector<const char*> sequence;
+    for (const char* answer : answers) {
+        sequence.insert(sequence.end(), {"thinking", answer, "neutral"});
+    }
+
+    struct Timing {
+        int count = 0;
+        int64_t load_us = 0;
+        int64_t first_frame_us = 0;
+        int64_t max_first_frame_us = 0;
+    } hit, miss;
+    std::map<const lz4_res_t*, std::vector<uint8_t>> first_frames;
+    auto before = GifPlayer::GetResourceStats();
+    size_t peak_resident = 0;
+
+    for (const char* emotion : sequence) {
+        SCOPED_TRACE(emotion);
+        lz4_res_t* res = player_->Getlz4ResByName(emotion);
+        ASSERT_NE(res, nullptr);
+        if (!first_frames.count(res)) {
+            first_frames[res] = DecodeFrames(res)[0];
+        }
+
+        size_t flushed = flush_count();
+        uint32_t misses = GifPlayer::GetResourceStats().misses;
+        int64_t start = esp_timer_get_time();
+        ASSERT_EQ(player_->LoadAndPlay(res), ESP_OK);
+        int64_t loaded = esp_timer_get_time();
+        auto stats = GifPlayer::GetResourceStats();
+
+        // The new emotion starts from its first frame
+        ASSERT_TRUE(WaitForFlushes(flushed + 1));
+        Flush first = flush(flushed);
+        EXPECT_TRUE(first.image == first_frames[res]);
+
+        Timing& timing = stats.misses > misses ? miss : hit;
+        timing.count++;
+        timing.load_us += loaded - start;
+        timing.first_frame_us += first.time_us - start;
+        timing.max_first_frame_us = std::max(timing.max_first_frame_us, first.time_us - start);
+
+        // Every eye2 animation fits the budget, so the one playing is always resident
+        EXPECT_NE(res->psram, nullptr);
+        EXPECT_LE(stats.resident_bytes, stats.budget_bytes);
+        peak_resident = std::max(peak_resident, stats.resident_bytes);
+
+        // Stands in for the end of the first loop, where the decode task prefetches the default emotion
+        if (res != &lz4_res_list[0]) {
+            GifPlayer::PrefetchResource(&lz4_res_list[0]);
+        }
+    }
+
+    auto after = GifPlayer::GetResourceStats();
+    uint32_t hits = after.hits - before.hits;
+    uint32_t total = hits + after.misses - before.misses;
+    EXPECT_EQ(total, sequence.size());
+    size_t all_bytes = 0;
+    for (int i = 0; i < lz4_res_count; i++) {
+        all_bytes += lz4_res_list[i].size;
+    }
+    printf("%zu emotion switches over %d eye2 animations (%zu KB), %zu KB PSRAM budget:\n",
+        sequence.size(), lz4_res_count, all_bytes / 1024, after.budget_bytes / 1024);
+    printf("  hit rate %u/%u (%.0f%%), peak resident %zu KB, %d resident at the end\n",
+        hits, total, 100.0 * hits / total, peak_resident / 1024, after.resident_count);
+    for (auto [name, t] : {std::pair<const char*, Timing>{"hit", hit}, {"miss", miss}}) {
+        if (t.count > 0) {
+            printf("  %-4s LoadAndPlay %5.0f us, first frame after %6.1f ms (max %6.1f ms), %d switches\n", name,
+                (double)t.load_us / t.count, t.first_frame_us / 1000.0 / t.count, t.max_first_frame_us / 1000.0,
+                t.count);
+        }
+    }
+    // Neutral comes back after every answer and is prefetched, so at least those switches hit
+    EXPECT_GE(hits, std::size(answers));
+}
+
+TEST(GifDiffAreasTest, SmallChangesGiveSmallAreas) {
+    const int w = 240, h = 240;
+    std::vector<uint8_t> old_frame(w * h * 2, 0), new_frame = old_frame;
+    lv_area_t areas[GIF_MAX_DIRTY_AREAS];
+    EXPECT_EQ(get_diff_areas(new_frame.data(), old_frame.data(), w, h, areas, GIF_MAX_DIRTY_AREAS), 0);
+
+    // Two eyes blinking in opposite corners stay two areas instead of one spanning the frame
+    for (auto [x0, y0] : {std::pair{10, 10}, std::pair{220, 226}}) {
+        for (int y = y0; y < y0 + 6; y++) {
+            for (int x = x0; x < x0 + 8; x++) {
+                new_frame[(y * w + x) * 2] = 0xff;
+            }
+        }
+    }
+    int count = get_diff_areas(new_frame.data(), old_frame.data(), w, h, areas, GIF_MAX_DIRTY_AREAS);
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(AreaPixels(areas[0]) + AreaPixels(areas[1]), 2 * 8 * 6);
+
+    // Odd widths compare one pixel at a time
+    const int odd_w = 161, odd_h = 120;
+    std::vector<uint8_t> odd_old(odd_w * odd_h * 2, 0), odd_new = odd_old;
+    odd_new[(odd_h * odd_w - 1) * 2 + 1] = 0x01;
+    ASSERT_EQ(get_diff_areas(odd_new.data(), odd_old.data(), odd_w, odd_h, areas, GIF_MAX_DIRTY_AREAS), 1);
+    EXPECT_EQ(areas[0].x1, odd_w - 1);
+    EXPECT_EQ(areas[0].y1, odd_h - 1);
+    EXPECT_EQ(AreaPixels(areas[0]), 1);
+}
+
+TEST(GifDiffAreasTest, Eye2AnimationsPixelsFlushedAndDetectTime) {
+    constexpr int kRounds = 20;
+    long long all_pixels = 0, all_frames = 0;
+    double all_us = 0;
+    printf("Changed areas between consecutive eye2 frames, looping back to the first:\n");
+    for (int r = 0; r < lz4_res_count; r++) {
+        const lz4_res_t* res = &lz4_res_list[r];
+        SCOPED_TRACE(res->name);
+        GiflHeader hdr;
+        memcpy(&hdr, res->start, sizeof(hdr));
+        auto frames = DecodeFrames(res);
+        long long pixels = 0;
+        double total_us = 0, max_us = 0;
+        for (size_t i = 0; i < frames.size(); i++) {
+            const auto& old_frame = frames[i];
+            const auto& new_frame = frames[(i + 1) % frames.size()];
+            lv_area_t areas[GIF_MAX_DIRTY_AREAS];
+            int count = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < kRounds; round++) {
+                count = get_diff_areas(new_frame.data(), old_frame.data(), hdr.width, hdr.height,
+                    areas, GIF_MAX_DIRTY_AREAS);
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / kRounds;
+            total_us += us;
+            max_us = std::max(max_us, us);
+
+            // Sending only the areas turns the old frame into the new one
+            ASSERT_LE(count, GIF_MAX_DIRTY_AREAS);
+            auto shown = old_frame;
+            CopyAreas(new_frame, shown, hdr.width, areas, count);
+            ASSERT_TRUE(shown == new_frame) << "frame " << i;
+            for (int a = 0; a < count; a++) {
+                pixels += AreaPixels(areas[a]);
+            }
+        }
+        int full = hdr.width * hdr.height;
+        printf("  %-12s %2zu frames: %6lld px flushed per frame (%3.0f%% of %d), detect %5.1f us (max %5.1f us)\n",
+            res->name, frames.size(), pixels / (long long)frames.size(), 100.0 * pixels / frames.size() / full, full,
+            total_us / frames.size(), max_us);
+        all_pixels += pixels;
+        all_frames += frames.size();
+        all_us += total_us;
+        EXPECT_LT(pixels, (long long)full * frames.size());
+    }
+    printf("  all %lld frames: %.0f%% of the pixels of full frame refreshes, detect %.1f us per frame\n", all_frames,
+        100.0 * all_pixels / all_frames / (LV_HOR_RES * LV_VER_RES), all_us / all_frames);
+}
+
+TEST_F(GifPlayerTest, FlushedAreasRebuildEveryPlayedFrame) {
+    lz4_res_t* res = player_->Getlz4ResByName("crying");
+    ASSERT_NE(res, nullptr);
+    auto frames = DecodeFrames(res);
+    const size_t loop = frames.size() + 1;
+
+    ASSERT_EQ(player_->LoadAndPlay(res), ESP_OK);
+    ASSERT_TRUE(WaitForFlushes(loop, 5000));
+
+    // The first frame is sent whole, after that only the flushed areas reach the panel
+    Flush first = flush(0);
+    ASSERT_TRUE(first.image == frames[0]);
+    std::vector<uint8_t> panel = first.image;
+    size_t next = 1;
+    long long pixels = 0;
+    for (size_t i = 1; i < loop; i++) {
+        SCOPED_TRACE(i);
+        Flush f = flush(i);
+        ASSERT_LE(f.areas.size(), (size_t)GIF_MAX_DIRTY_AREAS);
+        CopyAreas(f.image, panel, LV_HOR_RES, f.areas.data(), f.areas.size());
+        // Frames identical to the one before flush nothing, so skip those
+        while (frames[next % frames.size()] == frames[(next + frames.size() - 1) % frames.size()]) {
+            next++;
+        }
+        ASSERT_TRUE(f.image == frames[next % frames.size()]);
+        ASSERT_TRUE(panel == f.image);
+        next++;
+        for (const auto& area : f.areas) {
+            pixels += AreaPixels(area);
+        }
+    }
+    printf("crying through the player: %lld px per flush over %zu flushes, %d for a full refresh\n",
+        pixels / (long long)(loop - 1), loop - 1, LV_HOR_RES * LV_VER_RES);
+}
+
+TEST_F(GifPlayerTest, FramePacingJitter) {
+    // 20 fps, which Play turns into a 50 ms timer period
+    constexpr uint8_t kFps = 20;
+    constexpr int64_t kPeriodUs = 50000;
+    constexpr int kFrames = 40;
+    // Static as the PSRAM cache keeps pointing at the resource after the test
+    static std::vector<uint8_t> data = Restamp(player_->Getlz4ResByName("neutral"), kFps, kFrames);
+    static lz4_res_t res = {"paced", data.data(), data.data() + data.size(), (uint32_t)data.size(), nullptr};
+    ASSERT_EQ(player_->LoadAndPlay(&res), ESP_OK);
+
+    struct Run {
+        const char* name;
+        std::function<void(const std::vector<lv_area_t>&)> flush_delay;
+    } runs[] = {
+        {"instant flush", nullptr},
+        // 16 bits per pixel over a 40 MHz SPI bus, sent before the timer callback returns
+        {"40 MHz SPI flush", [](const std::vector<lv_area_t>& areas) {
+            int64_t pixels = 0;
+            for (const auto& area : areas) {
+                pixels += AreaPixels(area);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(pixels * 16 / 40));
+        }},
+    };
+
+    printf("%d frames at %d fps (%lld ms period), jitter from the period between flushes:\n", kFrames, kFps,
+        (long long)kPeriodUs / 1000);
+    for (auto& run : runs) {
+        SCOPED_TRACE(run.name);
+        uint32_t dropped = player_->GetDroppedFrames();
+        SetFlushDelay(run.flush_delay);
+        size_t start = flush_count();
+        ASSERT_TRUE(WaitForFlushes(start + kFrames + 1, 10000));
+        dropped = player_->GetDroppedFrames() - dropped;
+        uint32_t max_decode_us = player_->GetMaxDecodeTimeUs();
+
+        std::vector<int64_t> jitter;
+        int previous = -1;
+        for (size_t i = start; i <= start + kFrames; i++) {
+            Flush f = flush(i);
+            int index = f.image[0] | f.image[1] << 8;
+            // Frames are never skipped or repeated, a late one only shows late
+            if (previous >= 0) {
+                ASSERT_EQ(index, (previous + 1) % kFrames);
+                jitter.push_back(f.time_us - flush(i - 1).time_us - kPeriodUs);
+            }
+            previous = index;
+        }
+        std::vector<int64_t> abs_jitter(jitter.size());
+        std::transform(jitter.begin(), jitter.end(), abs_jitter.begin(), [](int64_t j) { return std::abs(j); });
+        std::sort(abs_jitter.begin(), abs_jitter.end());
+        double mean = 0;
+        for (int64_t j : jitter) {
+            mean += j;
+        }
+        mean /= jitter.size();
+        printf("  %-16s mean %+6.0f us, |jitter| p50 %5lld us, p99 %6lld us, max %6lld us, %u dropped, decode max %u us\n",
+            run.name, mean, (long long)abs_jitter[abs_jitter.size() / 2],
+            (long long)abs_jitter[abs_jitter.size() * 99 / 100], (long long)abs_jitter.back(), dropped, max_decode_us);
+        // Loose bounds, the host scheduler is not a real time one
+        EXPECT_LT(std::abs(mean), kPeriodUs / 10);
+        EXPECT_LT(abs_jitter[abs_jitter.size() / 2], kPeriodUs / 5);
+    }
+    SetFlushDelay(nullptr);
+}
@@ -0,0 +1,48 @@
+#include "heap_counter.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+
+std::atomic<size_t> current_bytes{0};
+std::atomic<size_t> peak_bytes{0};
+
+}  // namespace
+
+void* counted_malloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) {
+        size_t now = current_bytes += malloc_usable_size(ptr);
+        size_t peak = peak_bytes;
+        while (now > peak && !peak_bytes.compare_exchange_weak(peak, now)) {
+        }
+    }
+    return ptr;
+}
+
+void counted_free(void* ptr) {
+    if (ptr) {
+        current_bytes -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+namespace heap_counter {
+
+void ResetPeak() {
+    peak_bytes = current_bytes.load();
+}
+
+size_t peak() {
+    return peak_bytes;
+}
+
+size_t current() {
+    return current_bytes;
+}
+
+}  // namespace heap_counter
@@ -0,0 +1,24 @@
+#pragma once
+// Peak heap use of code compiled with malloc and free renamed to counted_malloc and counted_free
+// (see counted_heap.h), for memory comparisons that do not depend on the host allocator
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* counted_malloc(size_t size);
+void counted_free(void* ptr);
+
+#ifdef __cplusplus
+}
+
+namespace heap_counter {
+
+// Starts a new measurement from the bytes currently held
+void ResetPeak();
+size_t peak();
+size_t current();
+
+}  // namespace heap_counter
+#endif
@@ -0,0 +1,259 @@
+#include "display/lvgl_display/jpg/image_to_jpeg.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+
+#include "display/lvgl_display/jpg/pixel_convert.h"
+#include "esp_jpeg_enc.h"
+#include "heap_counter.h"
+
+namespace {
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+
+// A screen-like RGB565 image in native byte order: a gradient background, solid panels and
+// rows of small glyph-like marks
+std::vector<uint16_t> MakeScreen(int width, int height) {
+    std::vector<uint16_t> screen(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int r = x * 31 / width, g = y * 63 / height, b = 16;
+            uint16_t pixel = (uint16_t)((r << 11) | (g << 5) | b);
+            if (y >= 20 && y < 60 && x >= 10 && x < width - 10) {
+                pixel = 0xFFFF;
+            }
+            if (y >= 28 && y < 52 && x >= 16 && x < width - 16 && (x * 7 + y * 3) % 11 < 3) {
+                pixel = 0x0000;
+            }
+            if (y >= height / 2 && x >= width / 3 && x < width * 2 / 3 && y < height - 20) {
+                pixel = 0xF800;
+            }
+            screen[y * width + x] = pixel;
+        }
+    }
+    return screen;
+}
+
+struct Decoded {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+Decoded Decode(const std::string& jpeg) {
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr error;
+    cinfo.err = jpeg_std_error(&error);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (const unsigned char*)jpeg.data(), jpeg.size());
+    Decoded decoded;
+    if (jpeg_read_header(&cinfo, TRUE) == JPEG_HEADER_OK) {
+        cinfo.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&cinfo);
+        decoded.width = cinfo.output_width;
+        decoded.height = cinfo.output_height;
+        decoded.rgb.resize((size_t)decoded.width * decoded.height * 3);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = &decoded.rgb[(size_t)cinfo.output_scanline * decoded.width * 3];
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+    }
+    jpeg_destroy_decompress(&cinfo);
+    return decoded;
+}
+
+size_t AppendJpeg(void* arg, size_t index, const void* data, size_t len) {
+    auto output = static_cast<std::string*>(arg);
+    if (data && len > 0) {
+        output->append(static_cast<const char*>(data), len);
+    }
+    return len;
+}
+
+// What LvglDisplay::SnapshotToJpeg reads from the snapshot: a crop scaled down by 1 << shift
+struct Snapshot {
+    const std::vector<uint16_t>* screen;
+    int x1, y1;
+    int shift;
+    uint16_t width;
+};
+
+bool FillSnapshotStrip(void* arg, uint16_t y, uint16_t lines, uint8_t* strip) {
+    auto snapshot = static_cast<const Snapshot*>(arg);
+    size_t stride = kWidth * 2;
+    uint16_t* out = reinterpret_cast<uint16_t*>(strip);
+    for (int row = y; row < y + lines; row++) {
+        int src_y = snapshot->y1 + (row << snapshot->shift);
+        auto src_row = reinterpret_cast<const uint8_t*>(snapshot->screen->data() + src_y * kWidth + snapshot->x1);
+        pixel_rgb565_downscale_row(src_row, stride, out, snapshot->width, snapshot->shift);
+        out += snapshot->width;
+    }
+    return true;
+}
+
+bool EncodeSnapshot(const std::vector<uint16_t>& screen, int x1, int y1, int width, int height, int shift,
+                    int quality, std::string& jpeg) {
+    Snapshot snapshot = {&screen, x1, y1, shift, (uint16_t)(width >> shift)};
+    jpeg.clear();
+    return image_to_jpeg_strips_cb(snapshot.width, height >> shift, V4L2_PIX_FMT_RGB565, quality, FillSnapshotStrip,
+                                   &snapshot, AppendJpeg, &jpeg);
+}
+
+// The snapshot path before strip encoding: the whole frame converted to YUYV, then encoded in one
+// call into an output buffer of 1.5 times the frame (at least 128 KB)
+bool EncodeFullFrame(const std::vector<uint16_t>& screen, int quality, std::string& jpeg) {
+    size_t pixels = screen.size();
+    auto yuyv = static_cast<uint8_t*>(counted_malloc(pixels * 2));
+    size_t out_cap = std::max<size_t>(pixels * 3 / 2 + 64 * 1024, 128 * 1024);
+    auto out = static_cast<uint8_t*>(counted_malloc(out_cap));
+    pixel_rgb565_to_yuyv(screen.data(), yuyv, pixels, false);
+
+    jpeg_enc_config_t cfg = DEFAULT_JPEG_ENC_CONFIG();
+    cfg.width = kWidth;
+    cfg.height = kHeight;
+    cfg.quality = quality;
+    jpeg_enc_handle_t encoder = nullptr;
+    int out_len = 0;
+    bool ok = jpeg_enc_open(&cfg, &encoder) == JPEG_ERR_OK &&
+              jpeg_enc_process(encoder, yuyv, (int)pixels * 2, out, (int)out_cap, &out_len) == JPEG_ERR_OK;
+    if (encoder) {
+        jpeg_enc_close(encoder);
+    }
+    jpeg.assign(reinterpret_cast<char*>(out), out_len);
+    counted_free(out);
+    counted_free(yuyv);
+    return ok;
+}
+
+// PSNR of the decoded image against the RGB565 source, expanded to 8 bits per channel
+double Psnr(const std::vector<uint16_t>& source, const Decoded& decoded) {
+    double squared_error = 0;
+    for (size_t i = 0; i < source.size(); i++) {
+        int r = source[i] >> 11, g = (source[i] >> 5) & 0x3F, b = source[i] & 0x1F;
+        int expected[3] = {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+        for (int c = 0; c < 3; c++) {
+            double d = expected[c] - decoded.rgb[i * 3 + c];
+            squared_error += d * d;
+        }
+    }
+    double mse = squared_error / (source.size() * 3);
+    return mse == 0 ? INFINITY : 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+struct Measurement {
+    size_t peak_bytes;
+    double time_us;
+    size_t jpeg_bytes;
+};
+
+template <typename Encode>
+Measurement Measure(Encode&& encode) {
+    const int rounds = 5;
+    std::string jpeg;
+    size_t base = heap_counter::current();
+    heap_counter::ResetPeak();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        EXPECT_TRUE(encode(jpeg));
+    }
+    double time_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    EXPECT_EQ(heap_counter::current(), base);
+    return {heap_counter::peak() - base, time_us, jpeg.size()};
+}
+
+}  // namespace
+
+TEST(ImageToJpegTest, SnapshotCropAndDownscale) {
+    auto screen = MakeScreen(kWidth, kHeight);
+    std::string jpeg;
+
+    ASSERT_TRUE(EncodeSnapshot(screen, 0, 0, kWidth, kHeight, 0, 80, jpeg));
+    auto decoded = Decode(jpeg);
+    EXPECT_EQ(decoded.width, kWidth);
+    EXPECT_EQ(decoded.height, kHeight);
+
+    // The red panel fills the crop
+    ASSERT_TRUE(EncodeSnapshot(screen, kWidth / 3 + 8, kHeight / 2 + 8, 64, 48, 1, 80, jpeg));
+    decoded = Decode(jpeg);
+    ASSERT_EQ(decoded.width, 32);
+    ASSERT_EQ(decoded.height, 24);
+    for (size_t i = 0; i < decoded.rgb.size(); i += 3) {
+        ASSERT_GT(decoded.rgb[i], 220) << i;
+        ASSERT_LT(decoded.rgb[i + 1], 40) << i;
+        ASSERT_LT(decoded.rgb[i + 2], 40) << i;
+    }
+}
+
+TEST(ImageToJpegTest, SnapshotMemoryAndTime) {
+    auto screen = MakeScreen(kWidth, kHeight);
+    auto full_frame = Measure([&](std::string& jpeg) { return EncodeFullFrame(screen, 80, jpeg); });
+    auto strips = Measure([&](std::string& jpeg) { return EncodeSnapshot(screen, 0, 0, kWidth, kHeight, 0, 80, jpeg); });
+    auto half = Measure([&](std::string& jpeg) { return EncodeSnapshot(screen, 0, 0, kWidth, kHeight, 1, 80, jpeg); });
+    auto crop = Measure([&](std::string& jpeg) { return EncodeSnapshot(screen, 0, 0, kWidth, 64, 0, 80, jpeg); });
+
+    printf("%dx%d snapshot, quality 80 (encoder internals not counted):\n", kWidth, kHeight);
+    for (auto [name, m] : {std::pair{"full frame", full_frame}, {"strips", strips}, {"strips 1/2", half},
+                           {"strips top 64 rows", crop}}) {
+        printf("  %-20s peak %7zu bytes, %6.0f us, %6zu bytes of JPEG\n", name, m.peak_bytes, m.time_us, m.jpeg_bytes);
+    }
+    // Sizes within a few percent: the same encoder sees the same pixels either way
+    EXPECT_NEAR((double)strips.jpeg_bytes, (double)full_frame.jpeg_bytes, full_frame.jpeg_bytes * 0.05);
+    EXPECT_LT(strips.peak_bytes * 4, full_frame.peak_bytes);
+    EXPECT_LT(half.peak_bytes, strips.peak_bytes);
+    EXPECT_LE(crop.peak_bytes, strips.peak_bytes);
+}
+
+TEST(ImageToJpegTest, QualityAndPeakMemory) {
+    auto screen = MakeScreen(kWidth, kHeight);
+    // Strip, encoder block and worst case output of one 16-row strip of 4:2:0
+    const size_t strip_bytes = kWidth * 16 * 2;
+    const size_t out_cap = kWidth / 16 * 6 * 416 + 1024;
+
+    double last_psnr = 0;
+    printf("%dx%d strips:\n", kWidth, kHeight);
+    for (int quality : {30, 60, 80, 95}) {
+        std::string jpeg;
+        auto m = Measure([&](std::string& out) { return EncodeSnapshot(screen, 0, 0, kWidth, kHeight, 0, quality, out); });
+        ASSERT_TRUE(EncodeSnapshot(screen, 0, 0, kWidth, kHeight, 0, quality, jpeg));
+        auto decoded = Decode(jpeg);
+        ASSERT_EQ(decoded.width, kWidth);
+        double psnr = Psnr(screen, decoded);
+        printf("  quality %2d: PSNR %.1f dB, %6zu bytes, peak %zu bytes\n", quality, psnr, jpeg.size(), m.peak_bytes);
+        EXPECT_GT(psnr, last_psnr);
+        EXPECT_LE(m.peak_bytes, strip_bytes * 2 + out_cap + 1024);
+        last_psnr = psnr;
+    }
+    // 4:2:0 chroma subsampling limits the sharp colored edges of a screen to about 35 dB
+    EXPECT_GT(last_psnr, 33);
+}
+
+// Noise at quality 100 is the largest output per strip; it must fit the buffer sized from the
+// worst case bound, in color and in gray
+TEST(ImageToJpegTest, NoiseFitsWorstCaseOutputBuffer) {
+    std::mt19937 random(1);
+    std::vector<uint16_t> noise(kWidth * kHeight);
+    for (auto& pixel : noise) {
+        pixel = (uint16_t)random();
+    }
+    std::string jpeg;
+    ASSERT_TRUE(EncodeSnapshot(noise, 0, 0, kWidth, kHeight, 0, 100, jpeg));
+    EXPECT_EQ(Decode(jpeg).width, kWidth);
+    printf("Noise at quality 100: %zu bytes, %.2f bytes per pixel\n", jpeg.size(), (double)jpeg.size() / noise.size());
+
+    std::vector<uint8_t> gray(kWidth * kHeight);
+    for (auto& pixel : gray) {
+        pixel = (uint8_t)random();
+    }
+    jpeg.clear();
+    ASSERT_TRUE(image_to_jpeg_cb(gray.data(), gray.size(), kWidth, kHeight, V4L2_PIX_FMT_GREY, 100, AppendJpeg, &jpeg));
+    EXPECT_EQ(Decode(jpeg).width, kWidth);
+}
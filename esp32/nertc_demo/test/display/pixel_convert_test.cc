@@ -0,0 +1,181 @@
+#include "display/lvgl_display/jpg/pixel_convert.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+struct Rgb {
+    int r, g, b;
+};
+
+Rgb Unpack565(uint16_t p) {
+    int r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// Floating point JFIF (full range BT.601) reference
+void ReferenceYuv(Rgb c, double& y, double& u, double& v) {
+    y = 0.299 * c.r + 0.587 * c.g + 0.114 * c.b;
+    u = -0.168736 * c.r - 0.331264 * c.g + 0.5 * c.b + 128;
+    v = 0.5 * c.r - 0.418688 * c.g - 0.081312 * c.b + 128;
+}
+
+uint16_t ReferenceRgb565(int y, int u, int v) {
+    auto clamp = [](double x) { return (int)std::clamp(std::lround(x), 0L, 255L); };
+    int r = clamp(y + 1.402 * (v - 128));
+    int g = clamp(y - 0.344136 * (u - 128) - 0.714136 * (v - 128));
+    int b = clamp(y + 1.772 * (u - 128));
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+std::vector<uint8_t> ToYuyv(const std::vector<uint16_t>& rgb, bool big_endian = false) {
+    std::vector<uint8_t> yuyv(rgb.size() * 2);
+    pixel_rgb565_to_yuyv(rgb.data(), yuyv.data(), rgb.size(), big_endian);
+    return yuyv;
+}
+
+std::vector<uint16_t> ToRgb565(const std::vector<uint8_t>& yuv, bool uyvy = false) {
+    std::vector<uint16_t> rgb(yuv.size() / 2);
+    pixel_yuv422_to_rgb565(yuv.data(), rgb.data(), rgb.size(), uyvy);
+    return rgb;
+}
+
+int MaxChannelError(uint16_t a, uint16_t b) {
+    int dr = std::abs((a >> 11) - (b >> 11));
+    int dg = std::abs(((a >> 5) & 0x3F) - ((b >> 5) & 0x3F));
+    int db = std::abs((a & 0x1F) - (b & 0x1F));
+    return std::max({dr, dg, db});
+}
+
+}  // namespace
+
+TEST(PixelConvertTest, Rgb565ToYuyvGoldenVectors) {
+    // White, black, red, green, blue, each as a pair sharing one chroma sample
+    std::vector<uint16_t> rgb = {0xFFFF, 0xFFFF, 0x0000, 0x0000, 0xF800, 0xF800, 0x07E0, 0x07E0, 0x001F, 0x001F};
+    std::vector<uint8_t> expected = {
+        0xFF, 0x80, 0xFF, 0x80,
+        0x00, 0x80, 0x00, 0x80,
+        0x4D, 0x55, 0x4D, 0xFF,
+        0x95, 0x2B, 0x95, 0x15,
+        0x1D, 0xFF, 0x1D, 0x6B,
+    };
+    EXPECT_EQ(ToYuyv(rgb), expected);
+
+    std::vector<uint16_t> swapped(rgb.size());
+    pixel_swap16(rgb.data(), swapped.data(), rgb.size());
+    EXPECT_EQ(ToYuyv(swapped, true), expected);
+
+    // Red next to blue: chroma is the average of both pixels
+    EXPECT_EQ(ToYuyv({0xF800, 0x001F}), (std::vector<uint8_t>{0x4D, 0xAA, 0x1D, 0xB5}));
+}
+
+TEST(PixelConvertTest, Yuv422ToRgb565GoldenVectors) {
+    std::vector<uint8_t> yuyv = {
+        0xFF, 0x80, 0xFF, 0x80,
+        0x00, 0x80, 0x00, 0x80,
+        0x80, 0x80, 0x80, 0x80,
+        0x4D, 0x55, 0x4D, 0xFF,
+        0x1D, 0xFF, 0x1D, 0x6B,
+    };
+    std::vector<uint16_t> expected = {0xFFFF, 0xFFFF, 0x0000, 0x0000, 0x8410, 0x8410, 0xF800, 0xF800, 0x001F, 0x001F};
+    EXPECT_EQ(ToRgb565(yuyv), expected);
+
+    std::vector<uint8_t> uyvy(yuyv.size());
+    pixel_swap16(yuyv.data(), uyvy.data(), yuyv.size() / 2);
+    EXPECT_EQ(ToRgb565(uyvy, true), expected);
+}
+
+TEST(PixelConvertTest, Rgb565ToYuyvMatchesFloatReference) {
+    for (uint32_t p = 0; p <= 0xFFFF; p++) {
+        auto yuyv = ToYuyv({(uint16_t)p, (uint16_t)p});
+        double y, u, v;
+        ReferenceYuv(Unpack565(p), y, u, v);
+        ASSERT_NEAR(yuyv[0], y, 1.5) << std::hex << p;
+        ASSERT_EQ(yuyv[0], yuyv[2]);
+        ASSERT_NEAR(yuyv[1], std::min(u, 255.0), 1.5) << std::hex << p;
+        ASSERT_NEAR(yuyv[3], std::min(v, 255.0), 1.5) << std::hex << p;
+    }
+}
+
+TEST(PixelConvertTest, Yuv422ToRgb565MatchesFloatReference) {
+    for (int y = 0; y < 256; y += 3) {
+        for (int u = 0; u < 256; u += 5) {
+            for (int v = 0; v < 256; v += 5) {
+                auto rgb = ToRgb565({(uint8_t)y, (uint8_t)u, (uint8_t)y, (uint8_t)v});
+                ASSERT_LE(MaxChannelError(rgb[0], ReferenceRgb565(y, u, v)), 1) << y << " " << u << " " << v;
+                ASSERT_EQ(rgb[0], rgb[1]);
+            }
+        }
+    }
+}
+
+TEST(PixelConvertTest, RoundTripKeepsEveryColor) {
+    std::vector<uint16_t> rgb;
+    for (uint32_t p = 0; p <= 0xFFFF; p++) {
+        rgb.push_back(p);
+        rgb.push_back(p);
+    }
+    auto back = ToRgb565(ToYuyv(rgb));
+    int worst = 0;
+    for (size_t i = 0; i < rgb.size(); i++) {
+        worst = std::max(worst, MaxChannelError(rgb[i], back[i]));
+    }
+    // Y is 8 bits against 6 bits of green, only rounding of the 5/6-bit channels is lost
+    EXPECT_LE(worst, 1);
+}
+
+TEST(PixelConvertTest, OddPixelCount) {
+    std::vector<uint8_t> yuyv(6, 0xAA);
+    pixel_rgb565_to_yuyv(std::vector<uint16_t>{0xFFFF, 0xFFFF, 0xF800}.data(), yuyv.data(), 3, false);
+    EXPECT_EQ(yuyv, (std::vector<uint8_t>{0xFF, 0x80, 0xFF, 0x80, 0x4D, 0x55}));
+
+    std::vector<uint16_t> rgb(3, 0x1234);
+    pixel_yuv422_to_rgb565(yuyv.data(), rgb.data(), 3, false);
+    EXPECT_EQ(rgb[0], 0xFFFF);
+    EXPECT_EQ(rgb[1], 0xFFFF);
+    // The last pixel reuses the chroma of the previous pair
+    EXPECT_EQ(rgb[2], 0x4A69);
+}
+
+// Throughput of the kernels against a per-pixel floating point conversion, one VGA frame
+TEST(PixelConvertTest, Benchmark) {
+    const size_t pixels = 640 * 480;
+    std::vector<uint16_t> rgb(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        rgb[i] = (uint16_t)(i * 2654435761u >> 16);
+    }
+    std::vector<uint8_t> yuyv(pixels * 2);
+    std::vector<uint16_t> back(pixels);
+
+    auto measure = [](auto&& fn) {
+        const int rounds = 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fn();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    };
+
+    double to_yuv = measure([&] { pixel_rgb565_to_yuyv(rgb.data(), yuyv.data(), pixels, false); });
+    double to_rgb = measure([&] { pixel_yuv422_to_rgb565(yuyv.data(), back.data(), pixels, false); });
+    double swap = measure([&] { pixel_swap16(rgb.data(), back.data(), pixels); });
+    double reference = measure([&] {
+        for (size_t i = 0; i < pixels; i += 2) {
+            double y, u, v;
+            ReferenceYuv(Unpack565(rgb[i]), y, u, v);
+            yuyv[i * 2] = (uint8_t)y;
+            yuyv[i * 2 + 1] = (uint8_t)u;
+            ReferenceYuv(Unpack565(rgb[i + 1]), y, u, v);
+            yuyv[i * 2 + 2] = (uint8_t)y;
+            yuyv[i * 2 + 3] = (uint8_t)v;
+        }
+    });
+    printf("VGA frame: rgb565->yuyv %.0f us, yuyv->rgb565 %.0f us, swap16 %.0f us, float reference %.0f us\n",
+           to_yuv, to_rgb, swap, reference);
+    EXPECT_GT(to_yuv, 0);
+}
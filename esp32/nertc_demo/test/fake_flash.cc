@@ -0,0 +1,336 @@
+#include "fake_flash.h"
+
+#include <spi_flash_mmap.h>
+#include <openssl/sha.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace {
+
+struct FakePartition {
+    esp_partition_t info;
+    int fd = -1;
+    size_t erased = 0;
+};
+
+struct OtaSession {
+    const esp_partition_t* partition = nullptr;
+    size_t written = 0;
+    bool active = false;
+};
+
+std::mutex flash_mutex;
+std::string directory;
+std::vector<FakePartition> partitions;
+std::map<esp_partition_mmap_handle_t, std::pair<void*, size_t>> mappings;
+esp_partition_mmap_handle_t next_mapping = 1;
+OtaSession session;
+esp_ota_handle_t session_handle = 0;
+const esp_partition_t* boot = nullptr;
+size_t fail_writes_after = SIZE_MAX;
+
+FakePartition* Lookup(const esp_partition_t* partition) {
+    for (auto& p : partitions) {
+        if (&p.info == partition) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t Erase(FakePartition* p, size_t offset, size_t size) {
+    if (offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0 || offset + size > p->info.size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::vector<uint8_t> ones(size, 0xFF);
+    if (pwrite(p->fd, ones.data(), size, offset) != (ssize_t)size) {
+        return ESP_FAIL;
+    }
+    p->erased += size;
+    return ESP_OK;
+}
+
+esp_err_t Program(FakePartition* p, size_t offset, const void* src, size_t size) {
+    if (offset + size > p->info.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::vector<uint8_t> cells(size);
+    if (pread(p->fd, cells.data(), size, offset) != (ssize_t)size) {
+        return ESP_FAIL;
+    }
+    auto bytes = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < size; i++) {
+        cells[i] &= bytes[i];
+    }
+    return pwrite(p->fd, cells.data(), size, offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+void AddPartition(const char* label, esp_partition_type_t type, esp_partition_subtype_t subtype,
+    uint32_t address, uint32_t size) {
+    FakePartition p;
+    p.info.type = type;
+    p.info.subtype = subtype;
+    p.info.address = address;
+    p.info.size = size;
+    p.info.erase_size = SPI_FLASH_SEC_SIZE;
+    strncpy(p.info.label, label, sizeof(p.info.label) - 1);
+    p.info.encrypted = false;
+    auto path = directory + "/" + label + ".bin";
+    p.fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    // Unlinked right away, the file lives as long as the test process
+    unlink(path.c_str());
+    ftruncate(p.fd, size);
+    partitions.push_back(p);
+}
+
+}  // namespace
+
+namespace fake_flash {
+
+void Reset() {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    // Erased in place on later calls, so code that keeps a partition or a
+    // mapping from an earlier test (the Assets singleton) stays valid
+    if (partitions.empty()) {
+        char path[] = "/tmp/fake_flash_XXXXXX";
+        directory = mkdtemp(path);
+        partitions.reserve(3);
+        AddPartition("ota_0", ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x20000, kAppSize);
+        AddPartition("ota_1", ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x20000 + kAppSize, kAppSize);
+        AddPartition("assets", ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x20000 + 2 * kAppSize, kAssetsSize);
+    }
+    for (auto& p : partitions) {
+        Erase(&p, 0, p.info.size);
+        p.erased = 0;
+    }
+    session = OtaSession();
+    boot = &partitions[0].info;
+    fail_writes_after = SIZE_MAX;
+}
+
+const esp_partition_t* Find(const char* label) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    for (auto& p : partitions) {
+        if (strcmp(p.info.label, label) == 0) {
+            return &p.info;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<uint8_t> Read(const esp_partition_t* partition, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    std::vector<uint8_t> data(size);
+    pread(Lookup(partition)->fd, data.data(), size, offset);
+    return data;
+}
+
+const esp_partition_t* boot_partition() {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return boot;
+}
+
+size_t erased_bytes(const esp_partition_t* partition) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return Lookup(partition)->erased;
+}
+
+void FailOtaWritesAfter(size_t bytes) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    fail_writes_after = bytes;
+}
+
+std::vector<uint8_t> MakeFirmware(size_t size, const char* version, uint32_t seed) {
+    std::vector<uint8_t> image(size);
+    std::mt19937 rng(seed);
+    for (auto& byte : image) {
+        byte = (uint8_t)rng();
+    }
+    esp_image_header_t header = {};
+    header.magic = ESP_IMAGE_HEADER_MAGIC;
+    header.segment_count = 1;
+    header.hash_appended = 1;
+    memcpy(image.data(), &header, sizeof(header));
+    esp_app_desc_t desc = {};
+    desc.magic_word = ESP_APP_DESC_MAGIC_WORD;
+    strncpy(desc.version, version, sizeof(desc.version) - 1);
+    memcpy(image.data() + sizeof(header) + sizeof(esp_image_segment_header_t), &desc, sizeof(desc));
+    SHA256(image.data(), size - SHA256_DIGEST_LENGTH, image.data() + size - SHA256_DIGEST_LENGTH);
+    return image;
+}
+
+}  // namespace fake_flash
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    for (auto& p : partitions) {
+        if ((type == ESP_PARTITION_TYPE_ANY || p.info.type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p.info.subtype == subtype) &&
+            (label == nullptr || strcmp(p.info.label, label) == 0)) {
+            return &p.info;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    auto p = Lookup(partition);
+    if (src_offset + size > p->info.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return pread(p->fd, dst, size, src_offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return Program(Lookup(partition), dst_offset, src, size);
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return Erase(Lookup(partition), offset, size);
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+    esp_partition_mmap_memory_t memory, const void** out_ptr, esp_partition_mmap_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    auto p = Lookup(partition);
+    if (offset % SPI_FLASH_SEC_SIZE != 0 || offset + size > p->info.size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Shared with the file, so later writes show through like on the flash cache
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, p->fd, offset);
+    if (ptr == MAP_FAILED) {
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = next_mapping++;
+    mappings[*out_handle] = {ptr, size};
+    *out_ptr = ptr;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    auto it = mappings.find(handle);
+    if (it != mappings.end()) {
+        munmap(it->second.first, it->second.second);
+        mappings.erase(it);
+    }
+}
+
+uint32_t esp_partition_get_main_flash_sector_size(void) {
+    return SPI_FLASH_SEC_SIZE;
+}
+
+uint32_t spi_flash_mmap_get_free_pages(spi_flash_mmap_memory_t memory) {
+    return 128;
+}
+
+const esp_app_desc_t* esp_app_get_description(void) {
+    static esp_app_desc_t desc = [] {
+        esp_app_desc_t desc = {};
+        desc.magic_word = ESP_APP_DESC_MAGIC_WORD;
+        strcpy(desc.version, "1.0.0");
+        return desc;
+    }();
+    return &desc;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle) {
+    return esp_ota_resume(partition, image_size, 0, out_handle);
+}
+
+// Like OTA_WITH_SEQUENTIAL_WRITES, sectors are erased as the image reaches them
+esp_err_t esp_ota_resume(const esp_partition_t* partition, size_t erase_size, size_t image_offset, esp_ota_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    if (session.active || partition == &partitions[0].info || image_offset > partition->size) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    session.partition = partition;
+    session.written = image_offset;
+    session.active = true;
+    *out_handle = ++session_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    if (!session.active || handle != session_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (session.written + size > fail_writes_after) {
+        return ESP_FAIL;
+    }
+    auto p = Lookup(session.partition);
+    if (session.written + size > p->info.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t first_sector = (session.written + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE;
+    size_t end_sector = (session.written + size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE;
+    for (size_t sector = first_sector; sector < end_sector; sector++) {
+        Erase(p, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE);
+    }
+    esp_err_t err = Program(p, session.written, data, size);
+    if (err == ESP_OK) {
+        session.written += size;
+    }
+    return err;
+}
+
+// Checks what the bootloader would: the magic bytes and the appended SHA-256
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    if (!session.active || handle != session_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    session.active = false;
+    size_t size = session.written;
+    size_t minimum = sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t) + SHA256_DIGEST_LENGTH;
+    if (size < minimum) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    std::vector<uint8_t> image(size);
+    pread(Lookup(session.partition)->fd, image.data(), size, 0);
+    esp_app_desc_t desc;
+    memcpy(&desc, image.data() + sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t), sizeof(desc));
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(image.data(), size - SHA256_DIGEST_LENGTH, digest);
+    if (image[0] != ESP_IMAGE_HEADER_MAGIC || desc.magic_word != ESP_APP_DESC_MAGIC_WORD ||
+        memcmp(digest, image.data() + size - SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH) != 0) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    if (handle == session_handle) {
+        session.active = false;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    boot = partition;
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition(void) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return &partitions[0].info;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from) {
+    std::lock_guard<std::mutex> lock(flash_mutex);
+    return &partitions[1].info;
+}
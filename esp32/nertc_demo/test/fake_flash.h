@@ -0,0 +1,32 @@
+#pragma once
+// File-backed flash for the OTA and assets code: esp_partition_*, esp_ota_*
+// and spi_flash_mmap_* work on one file per partition in a temporary directory.
+// Writes only clear bits like NOR flash, so a missing erase corrupts the data.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <esp_ota_ops.h>
+
+namespace fake_flash {
+
+// Partitions: ota_0 (running) and ota_1 of kAppSize, assets of kAssetsSize
+constexpr size_t kAppSize = 1024 * 1024;
+constexpr size_t kAssetsSize = 2 * 1024 * 1024;
+
+// Erases every partition; the boot partition is ota_0 again
+void Reset();
+
+const esp_partition_t* Find(const char* label);
+std::vector<uint8_t> Read(const esp_partition_t* partition, size_t offset, size_t size);
+const esp_partition_t* boot_partition();
+// Bytes erased in a partition since Reset
+size_t erased_bytes(const esp_partition_t* partition);
+// esp_ota_write fails once this many image bytes have been written
+void FailOtaWritesAfter(size_t bytes);
+
+// A firmware image esp_ota_end accepts: image and segment headers, the app
+// description with version, a pseudo-random body and the appended SHA-256
+std::vector<uint8_t> MakeFirmware(size_t size, const char* version, uint32_t seed);
+
+}  // namespace fake_flash
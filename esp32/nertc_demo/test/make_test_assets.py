@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Build the assets packs the host tests download, with the packing code of the
+firmware build (scripts/build_default_assets.py) and the delta generator
+(scripts/build_assets_delta.py)
+
+Usage:
+    ./make_test_assets.py <scripts dir> <sound dir> <output dir>
+"""
+
+import os
+import random
+import shutil
+import subprocess
+import sys
+
+
+def write_files(directory, files):
+    shutil.rmtree(directory, ignore_errors=True)
+    os.makedirs(directory)
+    for name, data in files.items():
+        with open(os.path.join(directory, name), 'wb') as f:
+            f.write(data)
+
+
+def sample_files(sound_dir):
+    """The shipped sounds, plus a font and emoji sized like the real ones"""
+    rng = random.Random(1)
+    files = {}
+    for name in sorted(os.listdir(sound_dir)):
+        with open(os.path.join(sound_dir, name), 'rb') as f:
+            files[name] = f.read()
+    files['index.json'] = b'{"version": 1, "text_font": "font.bin"}'
+    files['font.bin'] = rng.randbytes(300 * 1024)
+    for i in range(8):
+        files[f'emoji_{i}.png'] = rng.randbytes(20 * 1024 + i * 100)
+    return files
+
+
+def changed_files(files):
+    """One emoji redrawn, a few glyphs of the font changed, a sound dropped and an emoji added"""
+    rng = random.Random(2)
+    files = dict(files)
+    files['emoji_2.png'] = rng.randbytes(len(files['emoji_2.png']))
+    font = bytearray(files['font.bin'])
+    font[100 * 1024:101 * 1024] = rng.randbytes(1024)
+    files['font.bin'] = bytes(font)
+    del files['popup.ogg']
+    files['emoji_8.png'] = rng.randbytes(24 * 1024)
+    return files
+
+
+def main():
+    scripts_dir, sound_dir, output_dir = sys.argv[1:4]
+    sys.path.insert(0, scripts_dir)
+    from build_default_assets import pack_assets_simple
+
+    include_dir = os.path.join(output_dir, 'include')
+    base_dir = os.path.join(output_dir, 'base')
+    write_files(base_dir, sample_files(sound_dir))
+    pack_assets_simple(base_dir, include_dir, os.path.join(output_dir, 'base.bin'), base_dir)
+
+    # target.bin is a plain full build of the new files, pack.bin the same
+    # assets re-laid out against base.bin, which is what the delta produces
+    target_dir = os.path.join(output_dir, 'target')
+    write_files(target_dir, changed_files(sample_files(sound_dir)))
+    pack_assets_simple(target_dir, include_dir, os.path.join(output_dir, 'target.bin'), target_dir)
+    subprocess.run([sys.executable, os.path.join(scripts_dir, 'build_assets_delta.py'),
+                    '--base', os.path.join(output_dir, 'base.bin'),
+                    '--target', os.path.join(output_dir, 'target.bin'),
+                    '--output_pack', os.path.join(output_dir, 'pack.bin'),
+                    '--output_delta', os.path.join(output_dir, 'delta.bin')], check=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,150 @@
+#include "music_player/clip_cache.h"
+
+#include <esp_timer.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t kFreshUs = 600LL * 1000 * 1000;
+
+std::unique_ptr<ClipBuffer> Buffer(size_t size, uint8_t fill = 0) {
+    auto buffer = std::make_unique<ClipBuffer>(size);
+    std::vector<uint8_t> data(size, fill);
+    buffer->Append(data.data(), data.size());
+    return buffer;
+}
+
+bool Contains(ClipCache& cache, const std::string& url) {
+    bool fresh = false;
+    return cache.Find(url, fresh) != nullptr;
+}
+
+}  // namespace
+
+TEST(ClipBufferTest, AppendStopsAtCapacityAndShrinkReleasesTheRest) {
+    ClipBuffer buffer(8);
+    ASSERT_TRUE(buffer.valid());
+    EXPECT_TRUE(buffer.Append("abcde", 5));
+    EXPECT_FALSE(buffer.Append("fghi", 4));
+    EXPECT_EQ(buffer.size(), 5u);
+    EXPECT_TRUE(buffer.Append("fgh", 3));
+    EXPECT_EQ(std::string((const char*)buffer.data(), buffer.size()), "abcdefgh");
+
+    ClipBuffer partial(100);
+    partial.Append("xyz", 3);
+    partial.Shrink();
+    EXPECT_EQ(partial.capacity(), 3u);
+    EXPECT_EQ(std::string((const char*)partial.data(), partial.size()), "xyz");
+}
+
+TEST(ClipCacheTest, DisabledWithoutBudget) {
+    ClipCache cache(0, 5);
+    EXPECT_FALSE(cache.enabled());
+    cache.Put("a", "v1", Buffer(1));
+    EXPECT_FALSE(Contains(cache, "a"));
+}
+
+TEST(ClipCacheTest, FindsEntriesAndCountsHits) {
+    ClipCache cache(4000, 5);
+    EXPECT_EQ(cache.max_entry_size(), 1000u);
+    cache.Put("a", "v1", Buffer(1000, 7));
+    // Larger than a quarter of the budget
+    cache.Put("b", "v1", Buffer(1001));
+
+    bool fresh = false;
+    auto entry = cache.Find("a", fresh);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(fresh);
+    EXPECT_EQ(entry->etag, "v1");
+    EXPECT_FALSE(entry->is_pcm());
+    EXPECT_EQ(entry->data->size(), 1000u);
+    EXPECT_EQ(entry->data->data()[999], 7);
+    EXPECT_EQ(cache.Find("b", fresh), nullptr);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.evictions, 0u);
+}
+
+TEST(ClipCacheTest, EvictsLeastRecentlyUsed) {
+    ClipCache cache(4000, 5);
+    for (auto url : {"a", "b", "c", "d"}) {
+        cache.Put(url, "", Buffer(1000));
+    }
+    // Using a makes b the oldest
+    EXPECT_TRUE(Contains(cache, "a"));
+    cache.Put("e", "", Buffer(1000));
+    EXPECT_FALSE(Contains(cache, "b"));
+    for (auto url : {"a", "c", "d", "e"}) {
+        EXPECT_TRUE(Contains(cache, url)) << url;
+    }
+    EXPECT_EQ(cache.stats().evictions, 1u);
+
+    // Replacing an entry frees its old size first
+    cache.Put("a", "v2", Buffer(500));
+    cache.Put("f", "", Buffer(500));
+    for (auto url : {"a", "c", "d", "e", "f"}) {
+        EXPECT_TRUE(Contains(cache, url)) << url;
+    }
+    EXPECT_EQ(cache.stats().evictions, 1u);
+}
+
+TEST(ClipCacheTest, EntryOutlivesRemoval) {
+    ClipCache cache(4000, 5);
+    cache.Put("a", "", Buffer(1000, 3));
+    bool fresh = false;
+    auto entry = cache.Find("a", fresh);
+    cache.Remove("a");
+    cache.Put("b", "", Buffer(1000));
+    EXPECT_FALSE(Contains(cache, "a"));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->data->data()[0], 3);
+}
+
+TEST(ClipCacheTest, EntriesGoStaleUntilValidated) {
+    ClipCache cache(4000, 5);
+    cache.Put("a", "v1", Buffer(100));
+    bool fresh = false;
+    cache.Find("a", fresh);
+    EXPECT_TRUE(fresh);
+
+    esp_timer_stub_advance(kFreshUs + 1000);
+    EXPECT_NE(cache.Find("a", fresh), nullptr);
+    EXPECT_FALSE(fresh);
+    cache.MarkValidated("a");
+    cache.MarkValidated("missing");
+    cache.Find("a", fresh);
+    EXPECT_TRUE(fresh);
+    EXPECT_EQ(cache.stats().not_modified, 1u);
+}
+
+TEST(ClipCacheTest, UpgradeToPcmKeepsEtag) {
+    ClipCache cache(40000, 5);
+    cache.Put("a", "v1", Buffer(1000));
+
+    // PCM smaller than its buffer is shrunk before the size check
+    auto pcm = std::make_unique<ClipBuffer>(20000);
+    std::vector<uint8_t> samples(8000, 9);
+    pcm->Append(samples.data(), samples.size());
+    cache.UpgradeToPcm("a", std::move(pcm), 44100, 2);
+    bool fresh = false;
+    auto entry = cache.Find("a", fresh);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->is_pcm());
+    EXPECT_EQ(entry->etag, "v1");
+    EXPECT_EQ(entry->sample_rate, 44100);
+    EXPECT_EQ(entry->channels, 2);
+    EXPECT_EQ(entry->data->size(), 8000u);
+
+    // Not applied twice, nor to an entry that is gone or to PCM over the entry limit
+    cache.UpgradeToPcm("a", Buffer(100), 16000, 1);
+    EXPECT_EQ(cache.Find("a", fresh)->sample_rate, 44100);
+    cache.UpgradeToPcm("missing", Buffer(100), 16000, 1);
+    EXPECT_FALSE(Contains(cache, "missing"));
+    cache.Put("b", "v1", Buffer(1000));
+    cache.UpgradeToPcm("b", Buffer(10001), 16000, 1);
+    EXPECT_FALSE(cache.Find("b", fresh)->is_pcm());
+}
@@ -0,0 +1,299 @@
+// Host stand-ins for helix MP3, esp_audio_codec and libopus, decoding the streams from fake_media.h
+#include "fake_media.h"
+
+#include <cstring>
+
+#include "esp_audio_dec_default.h"
+#include "esp_audio_simple_dec_default.h"
+#include "mp3dec.h"
+#include "opus.h"
+
+namespace fake_media {
+
+// Frame numbers are stored as two 7-bit bytes so that no payload byte looks like a sync word
+static void PutNumber(uint8_t* p, int number) {
+    p[0] = (number >> 7) & 0x7F;
+    p[1] = number & 0x7F;
+}
+
+static int GetNumber(const uint8_t* p) {
+    return (p[0] << 7) | p[1];
+}
+
+std::vector<uint8_t> Mp3Frame(int number) {
+    std::vector<uint8_t> frame(kMp3FrameSize, 0);
+    frame[0] = 0xFF;
+    frame[1] = 0xFB;
+    frame[2] = 0x90;
+    frame[3] = 0x00;
+    // Side information is all zero for a fake frame, the number follows it
+    PutNumber(frame.data() + 4 + 32 + 4, number);
+    return frame;
+}
+
+std::vector<uint8_t> Mp3Stream(int frames, int first_number) {
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < frames; i++) {
+        auto frame = Mp3Frame(first_number + i);
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    return stream;
+}
+
+std::vector<uint8_t> Mp3LameFrame(int frames, int delay, int padding) {
+    std::vector<uint8_t> frame = Mp3Frame(0);
+    uint8_t* tag = frame.data() + 4 + 32;
+    memcpy(tag, "Xing", 4);
+    tag[7] = 0x01;                          // Only the frame count
+    tag[8] = (frames >> 24) & 0xFF;
+    tag[9] = (frames >> 16) & 0xFF;
+    tag[10] = (frames >> 8) & 0xFF;
+    tag[11] = frames & 0xFF;
+    uint8_t* lame = tag + 12;
+    memcpy(lame, "LAME3.100", 9);
+    lame[21] = (delay >> 4) & 0xFF;
+    lame[22] = ((delay & 0x0F) << 4) | ((padding >> 8) & 0x0F);
+    lame[23] = padding & 0xFF;
+    return frame;
+}
+
+std::vector<uint8_t> AdtsFrame(int number, size_t size, int channels) {
+    std::vector<uint8_t> frame(size, 0);
+    frame[0] = 0xFF;
+    frame[1] = 0xF1;                        // MPEG-4, no CRC
+    frame[2] = 0x50 | ((channels >> 2) & 0x01);  // AAC-LC, 44.1 kHz
+    frame[3] = ((channels & 0x03) << 6) | ((size >> 11) & 0x03);
+    frame[4] = (size >> 3) & 0xFF;
+    frame[5] = ((size & 0x07) << 5) | 0x1F;
+    frame[6] = 0xFC;
+    PutNumber(frame.data() + 7, number);
+    return frame;
+}
+
+std::vector<uint8_t> AdtsStream(int frames, size_t frame_size, int first_number, int channels) {
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < frames; i++) {
+        auto frame = AdtsFrame(first_number + i, frame_size, channels);
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+    return stream;
+}
+
+static bool opus_real_packets = false;
+
+void SetOpusRealPackets(bool enable) {
+    opus_real_packets = enable;
+}
+
+int OpusPacketSamples(const uint8_t* packet, size_t size) {
+    if (size < 1) {
+        return -1;
+    }
+    int config = packet[0] >> 3;
+    int frame_samples;
+    if (config < 12) {
+        // SILK: 10, 20, 40 or 60 ms
+        static const int silk[] = {480, 960, 1920, 2880};
+        frame_samples = silk[config & 3];
+    } else if (config < 16) {
+        // Hybrid: 10 or 20 ms
+        frame_samples = (config & 1) ? 960 : 480;
+    } else {
+        // CELT: 2.5, 5, 10 or 20 ms
+        static const int celt[] = {120, 240, 480, 960};
+        frame_samples = celt[config & 3];
+    }
+    int frames;
+    switch (packet[0] & 3) {
+    case 0:
+        frames = 1;
+        break;
+    case 1:
+    case 2:
+        frames = 2;
+        break;
+    default:
+        if (size < 2) {
+            return -1;
+        }
+        frames = packet[1] & 0x3F;
+        break;
+    }
+    return frames * frame_samples;
+}
+
+std::vector<Run> Runs(const std::vector<int16_t>& samples) {
+    std::vector<Run> runs;
+    for (int16_t sample : samples) {
+        if (runs.empty() || runs.back().number != sample) {
+            runs.push_back({sample, 0});
+        }
+        runs.back().samples++;
+    }
+    return runs;
+}
+
+}  // namespace fake_media
+
+using namespace fake_media;
+
+static void FillPcm(int16_t* pcm, int samples, int channels, int number) {
+    for (int i = 0; i < samples * channels; i++) {
+        pcm[i] = (int16_t)number;
+    }
+}
+
+// ---- helix MP3
+
+struct FakeMp3Decoder {
+    MP3FrameInfo info = {};
+};
+
+HMP3Decoder MP3InitDecoder(void) {
+    return new FakeMp3Decoder();
+}
+
+void MP3FreeDecoder(HMP3Decoder decoder) {
+    delete static_cast<FakeMp3Decoder*>(decoder);
+}
+
+int MP3FindSyncWord(unsigned char* buf, int size) {
+    for (int i = 0; i + 1 < size; i++) {
+        if (buf[i] == 0xFF && (buf[i + 1] & 0xE0) == 0xE0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int MP3Decode(HMP3Decoder decoder, unsigned char** inbuf, int* bytes_left, short* outbuf, int use_size) {
+    (void)use_size;
+    const unsigned char* frame = *inbuf;
+    if (*bytes_left < 4) {
+        return ERR_MP3_INDATA_UNDERFLOW;
+    }
+    if (frame[0] != 0xFF || frame[1] != 0xFB) {
+        return ERR_MP3_INVALID_FRAMEHEADER;
+    }
+    if (*bytes_left < (int)kMp3FrameSize) {
+        return ERR_MP3_INDATA_UNDERFLOW;
+    }
+    FillPcm(outbuf, kMp3FrameSamples, 2, GetNumber(frame + 4 + 32 + 4));
+    *inbuf += kMp3FrameSize;
+    *bytes_left -= kMp3FrameSize;
+
+    auto fake = static_cast<FakeMp3Decoder*>(decoder);
+    fake->info.bitrate = kMp3Bitrate;
+    fake->info.nChans = 2;
+    fake->info.samprate = kMp3SampleRate;
+    fake->info.bitsPerSample = 16;
+    fake->info.outputSamps = kMp3FrameSamples * 2;
+    fake->info.layer = 3;
+    return ERR_MP3_NONE;
+}
+
+void MP3GetLastFrameInfo(HMP3Decoder decoder, MP3FrameInfo* info) {
+    *info = static_cast<FakeMp3Decoder*>(decoder)->info;
+}
+
+// ---- esp_audio_codec simple decoder, ADTS only
+// Like the real decoder it reports nothing decoded and nothing consumed for an
+// incomplete frame, whether or not eos is set
+
+esp_audio_err_t esp_audio_dec_register_default(void) {
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_audio_simple_dec_register_default(void) {
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_audio_simple_dec_open(esp_audio_simple_dec_cfg_t* cfg, esp_audio_simple_dec_handle_t* handle) {
+    if (cfg->dec_type != ESP_AUDIO_SIMPLE_DEC_TYPE_AAC) {
+        return ESP_AUDIO_ERR_FAIL;
+    }
+    *handle = new int(0);
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_audio_simple_dec_process(esp_audio_simple_dec_handle_t handle, esp_audio_simple_dec_raw_t* raw,
+                                             esp_audio_simple_dec_out_t* out) {
+    raw->consumed = 0;
+    out->decoded_size = 0;
+    uint32_t skip = 0;
+    while (skip + 1 < raw->len && !(raw->buffer[skip] == 0xFF && (raw->buffer[skip + 1] & 0xF6) == 0xF0)) {
+        skip++;
+    }
+    if (skip > 0) {
+        raw->consumed = skip;
+        return ESP_AUDIO_ERR_OK;
+    }
+    const uint8_t* frame = raw->buffer;
+    if (raw->len < 9) {
+        return ESP_AUDIO_ERR_OK;
+    }
+    uint32_t size = ((frame[3] & 0x03) << 11) | (frame[4] << 3) | (frame[5] >> 5);
+    if (raw->len < size) {
+        return ESP_AUDIO_ERR_OK;
+    }
+    int channels = ((frame[2] & 0x01) << 2) | (frame[3] >> 6);
+    uint32_t pcm_size = kAacFrameSamples * channels * sizeof(int16_t);
+    if (out->len < pcm_size) {
+        // consumed is not meaningful with this error, report the frame as if it had been read
+        raw->consumed = size;
+        out->needed_size = pcm_size;
+        return ESP_AUDIO_ERR_BUFF_NOT_ENOUGH;
+    }
+    *static_cast<int*>(handle) = channels;
+    FillPcm((int16_t*)out->buffer, kAacFrameSamples, channels, GetNumber(frame + 7));
+    out->decoded_size = pcm_size;
+    raw->consumed = size;
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_audio_simple_dec_get_info(esp_audio_simple_dec_handle_t handle, esp_audio_simple_dec_info_t* info) {
+    info->sample_rate = kAacSampleRate;
+    info->bits_per_sample = 16;
+    info->channel = *static_cast<int*>(handle);
+    info->bitrate = 128000;
+    info->frame_size = 0;
+    return ESP_AUDIO_ERR_OK;
+}
+
+void esp_audio_simple_dec_close(esp_audio_simple_dec_handle_t handle) {
+    delete static_cast<int*>(handle);
+}
+
+// ---- libopus, a packet's first byte is its number
+
+struct OpusDecoder {
+    int channels;
+    int packets;
+};
+
+OpusDecoder* opus_decoder_create(int32_t sample_rate, int channels, int* error) {
+    (void)sample_rate;
+    *error = 0;
+    return new OpusDecoder{channels, 0};
+}
+
+void opus_decoder_destroy(OpusDecoder* decoder) {
+    delete decoder;
+}
+
+int opus_decode(OpusDecoder* decoder, const unsigned char* data, int32_t len, int16_t* pcm, int frame_size, int decode_fec) {
+    (void)decode_fec;
+    if (opus_real_packets) {
+        int samples = OpusPacketSamples(data, len);
+        if (samples < 0 || frame_size < samples) {
+            return -1;
+        }
+        FillPcm(pcm, samples, decoder->channels, decoder->packets++);
+        return samples;
+    }
+    if (len < 1 || frame_size < kOpusFrameSamples) {
+        return -1;
+    }
+    FillPcm(pcm, kOpusFrameSamples, decoder->channels, data[0]);
+    return kOpusFrameSamples;
+}
@@ -0,0 +1,46 @@
+#pragma once
+// Synthetic streams for the fake decoders in fake_codecs.cc
+// Every decoded sample of a frame holds the frame's number, so tests can tell
+// from the PCM alone which frames were played, skipped or repeated
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fake_media {
+
+// MPEG-1 layer III, 128 kbps, 44.1 kHz, stereo, no padding
+constexpr size_t kMp3FrameSize = 417;
+constexpr int kMp3FrameSamples = 1152;
+constexpr int kMp3SampleRate = 44100;
+constexpr int kMp3Bitrate = 128000;
+
+// ADTS AAC-LC, 44.1 kHz, stereo
+constexpr int kAacFrameSamples = 1024;
+constexpr int kAacSampleRate = 44100;
+
+// Opus packets decode to 20 ms at 48 kHz
+constexpr int kOpusFrameSamples = 960;
+
+std::vector<uint8_t> Mp3Frame(int number);
+std::vector<uint8_t> Mp3Stream(int frames, int first_number = 0);
+// Xing frame with a LAME tag for a stream of the given number of audio frames, decodes as frame 0
+std::vector<uint8_t> Mp3LameFrame(int frames, int delay, int padding);
+// ADTS with more channels decodes to more PCM than the AAC decoder's initial output buffer holds
+std::vector<uint8_t> AdtsFrame(int number, size_t size, int channels = 2);
+std::vector<uint8_t> AdtsStream(int frames, size_t frame_size, int first_number = 0, int channels = 2);
+
+// Makes the fake libopus decode real packets, as found in the bundled .ogg files: each
+// decodes to its duration from the TOC byte (RFC 6716 section 3.1), filled with the
+// packet's index in the stream instead of its first byte
+void SetOpusRealPackets(bool enable);
+int OpusPacketSamples(const uint8_t* packet, size_t size);
+
+// Frame numbers in the order they were played, one entry per run of samples
+struct Run {
+    int number;
+    int samples;
+    bool operator==(const Run& other) const = default;
+};
+std::vector<Run> Runs(const std::vector<int16_t>& samples);
+
+}  // namespace fake_media
@@ -0,0 +1,182 @@
+#include "fake_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+class FakeHttp : public Http {
+public:
+    explicit FakeHttp(FakeServer* server) : server_(server) {
+        std::lock_guard<std::mutex> lock(server_->mutex_);
+        server_->live_connections_++;
+    }
+
+    ~FakeHttp() override {
+        std::lock_guard<std::mutex> lock(server_->mutex_);
+        server_->live_connections_--;
+    }
+
+    void SetTimeout(int timeout_ms) override {}
+    void SetContent(std::string&& content) override {}
+    void SetKeepAlive(bool enable) override {}
+
+    void SetHeader(const std::string& key, const std::string& value) override {
+        headers_[key] = value;
+    }
+
+    bool Open(const std::string& method, const std::string& url) override {
+        FakeRequest request;
+        request.url = url;
+        if (headers_.count("Range")) {
+            request.offset = strtoul(headers_["Range"].c_str() + strlen("bytes="), nullptr, 10);
+        }
+        if (headers_.count("If-None-Match")) {
+            request.if_none_match = headers_["If-None-Match"];
+        }
+
+        std::lock_guard<std::mutex> lock(server_->mutex_);
+        if (server_->refuse_ > 0 && server_->requests_.size() >= server_->refuse_from_) {
+            server_->refuse_--;
+            server_->requests_.push_back(request);
+            return false;
+        }
+        auto it = server_->resources_.find(url);
+        if (it == server_->resources_.end()) {
+            request.status = 404;
+        } else if (!request.if_none_match.empty() && request.if_none_match == it->second.etag) {
+            request.status = 304;
+        } else {
+            const FakeResource& resource = it->second;
+            body_ = resource.body;
+            etag_ = resource.etag;
+            total_ = body_.size();
+            if (request.offset > 0 && resource.ranges) {
+                request.status = 206;
+                position_ = std::min(request.offset, body_.size());
+            } else {
+                request.status = 200;
+            }
+            if (!server_->drops_.empty()) {
+                drop_after_ = server_->drops_.front();
+                drop_closes_ = server_->drop_closes_;
+                server_->drops_.pop_front();
+            }
+        }
+        status_ = request.status;
+        server_->requests_.push_back(request);
+        return true;
+    }
+
+    // Like the fixed HttpClient::Close, the state changes under the lock that Read waits on
+    void Close() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+
+    int Read(char* buffer, size_t buffer_size) override {
+        int delay_us;
+        size_t max_read;
+        {
+            std::lock_guard<std::mutex> lock(server_->mutex_);
+            delay_us = server_->read_delay_us_;
+            max_read = server_->max_read_;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::microseconds(delay_us), [this] { return closed_; });
+        if (closed_) {
+            return -1;
+        }
+        if (sent_ >= drop_after_) {
+            return drop_closes_ ? 0 : -1;  // Connection closed or reset
+        }
+        size_t len = std::min({buffer_size, max_read, body_.size() - position_, drop_after_ - sent_});
+        memcpy(buffer, body_.data() + position_, len);
+        position_ += len;
+        sent_ += len;
+        return (int)len;
+    }
+
+    int Write(const char* buffer, size_t buffer_size) override { return -1; }
+    int GetStatusCode() override { return status_; }
+
+    std::string GetResponseHeader(const std::string& key) const override {
+        if (key == "ETag") {
+            return etag_;
+        }
+        if (key == "Content-Range" && status_ == 206) {
+            return "bytes " + std::to_string(position_) + "-" + std::to_string(total_ - 1) + "/" + std::to_string(total_);
+        }
+        return "";
+    }
+
+    size_t GetBodyLength() override { return body_.size() - position_; }
+    std::string ReadAll() override { return ""; }
+    int GetLastError() override { return 0; }
+
+private:
+    FakeServer* server_;
+    std::map<std::string, std::string> headers_;
+    std::vector<uint8_t> body_;
+    std::string etag_;
+    size_t total_ = 0;
+    size_t position_ = 0;
+    size_t sent_ = 0;
+    size_t drop_after_ = SIZE_MAX;
+    bool drop_closes_ = false;
+    int status_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool closed_ = false;
+};
+
+FakeServer::FakeServer() {
+    Board::GetInstance().set_network(this);
+}
+
+FakeServer::~FakeServer() {
+    Board::GetInstance().set_network(nullptr);
+}
+
+void FakeServer::Put(const std::string& url, FakeResource resource) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    resources_[url] = std::move(resource);
+}
+
+void FakeServer::DropConnectionsAfter(std::vector<size_t> bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drops_.assign(bytes.begin(), bytes.end());
+    drop_closes_ = false;
+}
+
+void FakeServer::CloseConnectionsAfter(std::vector<size_t> bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drops_.assign(bytes.begin(), bytes.end());
+    drop_closes_ = true;
+}
+
+void FakeServer::RefuseConnections(int count, size_t first_request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refuse_ = count;
+    refuse_from_ = first_request;
+}
+
+void FakeServer::SetReadPacing(int delay_us, size_t max_read) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_delay_us_ = delay_us;
+    max_read_ = max_read;
+}
+
+std::vector<FakeRequest> FakeServer::requests() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_;
+}
+
+int FakeServer::live_connections() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_connections_;
+}
+
+std::unique_ptr<Http> FakeServer::CreateHttp(int connect_id) {
+    return std::make_unique<FakeHttp>(this);
+}
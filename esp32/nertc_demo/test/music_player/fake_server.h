@@ -0,0 +1,62 @@
+#pragma once
+// An in-process HTTP server for the online player and the OTA and assets downloads,
+// reached through Board's network. It serves byte ranges and ETags, and can refuse
+// connections, reset them or close them early mid-stream.
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+struct FakeResource {
+    std::vector<uint8_t> body;
+    std::string etag;
+    bool ranges = true;     // Answers Range requests with 206
+};
+
+struct FakeRequest {
+    std::string url;
+    size_t offset = 0;          // From the Range header
+    std::string if_none_match;
+    int status = 0;             // 0 when the connection was refused
+};
+
+class FakeServer : public NetworkInterface {
+public:
+    FakeServer();
+    ~FakeServer() override;
+
+    void Put(const std::string& url, FakeResource resource);
+    // The next connections drop after sending these many body bytes, one entry per connection
+    void DropConnectionsAfter(std::vector<size_t> bytes);
+    // Same, but the body ends cleanly (Read returns 0) instead of with a reset
+    void CloseConnectionsAfter(std::vector<size_t> bytes);
+    // count connection attempts fail, starting with request number first_request
+    void RefuseConnections(int count, size_t first_request = 0);
+    // Time each Read waits before returning data, and the most it returns
+    void SetReadPacing(int delay_us, size_t max_read);
+
+    std::vector<FakeRequest> requests();
+    int live_connections();
+
+    std::unique_ptr<Http> CreateHttp(int connect_id) override;
+
+private:
+    friend class FakeHttp;
+
+    std::mutex mutex_;
+    std::map<std::string, FakeResource> resources_;
+    std::deque<size_t> drops_;
+    bool drop_closes_ = false;
+    int refuse_ = 0;
+    size_t refuse_from_ = 0;
+    int read_delay_us_ = 0;
+    size_t max_read_ = SIZE_MAX;
+    std::vector<FakeRequest> requests_;
+    int live_connections_ = 0;
+};
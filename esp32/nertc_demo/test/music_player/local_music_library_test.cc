@@ -0,0 +1,354 @@
+#include "music_player/local_music_library.h"
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fake_media.h"
+
+namespace {
+
+// ID3v2.3 tag holding UTF-8 text frames
+std::vector<uint8_t> Id3Tag(const std::vector<std::pair<std::string, std::string>>& frames) {
+    std::vector<uint8_t> body;
+    for (auto& [id, text] : frames) {
+        uint32_t size = text.size() + 1;
+        body.insert(body.end(), id.begin(), id.end());
+        body.push_back(size >> 24);
+        body.push_back(size >> 16);
+        body.push_back(size >> 8);
+        body.push_back(size);
+        body.push_back(0);
+        body.push_back(0);
+        body.push_back(3);
+        body.insert(body.end(), text.begin(), text.end());
+    }
+    body.resize(body.size() + 64, 0);   // Padding
+    uint32_t size = body.size();
+    std::vector<uint8_t> tag = {'I', 'D', '3', 3, 0, 0,
+                                (uint8_t)((size >> 21) & 0x7F), (uint8_t)((size >> 14) & 0x7F),
+                                (uint8_t)((size >> 7) & 0x7F), (uint8_t)(size & 0x7F)};
+    tag.insert(tag.end(), body.begin(), body.end());
+    return tag;
+}
+
+class LocalMusicLibraryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char path[] = "/tmp/music_library_XXXXXX";
+        ASSERT_NE(mkdtemp(path), nullptr);
+        dir_ = path;
+    }
+
+    void TearDown() override {
+        std::string command = "rm -rf '" + dir_ + "'";
+        ASSERT_EQ(system(command.c_str()), 0);
+    }
+
+    // Writes a file with a fixed mtime, so that rewriting it within the same second still counts as a change
+    void WriteFile(const std::string& name, const std::vector<uint8_t>& data, time_t mtime = 1700000000) {
+        std::string path = dir_ + "/" + name;
+        size_t slash = name.rfind('/');
+        if (slash != std::string::npos) {
+            mkdir((dir_ + "/" + name.substr(0, slash)).c_str(), 0755);
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), data.size());
+        file.close();
+        struct timeval times[2] = {{mtime, 0}, {mtime, 0}};
+        utimes(path.c_str(), times);
+    }
+
+    void WriteMp3(const std::string& name, int frames, const std::string& title = "",
+                  const std::string& artist = "", time_t mtime = 1700000000) {
+        std::vector<uint8_t> data;
+        if (!title.empty()) {
+            data = Id3Tag({{"TIT2", title}, {"TPE1", artist}, {"TALB", "Album"}});
+        }
+        auto stream = fake_media::Mp3Stream(frames);
+        data.insert(data.end(), stream.begin(), stream.end());
+        WriteFile(name, data, mtime);
+    }
+
+    std::string ReadIndex() {
+        std::ifstream file(dir_ + "/.music_index", std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteIndex(const std::string& text) {
+        std::ofstream file(dir_ + "/.music_index", std::ios::binary | std::ios::trunc);
+        file << text;
+    }
+
+    static std::vector<std::string> Files(LocalMusicLibrary& library) {
+        std::vector<std::string> files;
+        for (auto& entry : library.Entries()) {
+            files.push_back(entry.file);
+        }
+        return files;
+    }
+
+    std::string dir_;
+};
+
+}  // namespace
+
+TEST_F(LocalMusicLibraryTest, RescanProbesFilesAndWritesIndex) {
+    WriteMp3("b.mp3", 100, "晴天", "周杰伦");
+    WriteMp3("a.mp3", 200);
+    WriteFile("album/c.m4a", {0, 0, 0, 0});
+    WriteFile("notes.txt", {'x'});
+    WriteFile(".hidden.mp3", {0});
+
+    LocalMusicLibrary library;
+    EXPECT_FALSE(library.Load(dir_ + "/"));
+    EXPECT_EQ(library.directory(), dir_);
+    EXPECT_EQ(library.Size(), 0u);
+    EXPECT_TRUE(library.Rescan());
+
+    auto entries = library.Entries();
+    ASSERT_EQ(Files(library), (std::vector<std::string>{"a.mp3", "album/c.m4a", "b.mp3"}));
+    EXPECT_EQ(entries[0].title, "a");
+    EXPECT_NEAR(entries[0].bitrate, fake_media::kMp3Bitrate, 100);  // Average over the rounded duration
+    EXPECT_NEAR(entries[0].duration_ms, 200 * 1152 * 1000 / 44100, 30);
+    EXPECT_EQ(entries[1].title, "c");
+    EXPECT_EQ(entries[1].duration_ms, 0u);
+    EXPECT_EQ(entries[2].title, "晴天");
+    EXPECT_EQ(entries[2].artist, "周杰伦");
+    EXPECT_EQ(entries[2].album, "Album");
+    EXPECT_NEAR(entries[2].duration_ms, 100 * 1152 * 1000 / 44100, 30);
+    EXPECT_EQ(entries[2].mtime, 1700000000);
+    EXPECT_EQ(library.FullPath(entries[1]), dir_ + "/album/c.m4a");
+
+    EXPECT_EQ(ReadIndex().rfind("# music index v1\n", 0), 0u);
+    EXPECT_FALSE(library.Rescan());
+}
+
+TEST_F(LocalMusicLibraryTest, LoadRestoresSavedEntries) {
+    WriteMp3("one.mp3", 50, "Title\tWith Tab", "Artist");
+    WriteMp3("two.mp3", 80);
+    LocalMusicLibrary saved;
+    saved.Load(dir_);
+    ASSERT_TRUE(saved.Rescan());
+
+    LocalMusicLibrary loaded;
+    EXPECT_TRUE(loaded.Load(dir_));
+    auto expected = saved.Entries();
+    auto entries = loaded.Entries();
+    ASSERT_EQ(entries.size(), 2u);
+    // Tabs inside fields are stored as spaces
+    EXPECT_EQ(entries[0].title, "Title With Tab");
+    for (size_t i = 0; i < entries.size(); i++) {
+        EXPECT_EQ(entries[i].file, expected[i].file);
+        EXPECT_EQ(entries[i].mtime, expected[i].mtime);
+        EXPECT_EQ(entries[i].size, expected[i].size);
+        EXPECT_EQ(entries[i].duration_ms, expected[i].duration_ms);
+        EXPECT_EQ(entries[i].bitrate, expected[i].bitrate);
+        EXPECT_EQ(entries[i].artist, expected[i].artist);
+        EXPECT_EQ(entries[i].album, expected[i].album);
+    }
+    EXPECT_FALSE(loaded.Rescan());
+    LocalMusicEntry entry;
+    EXPECT_TRUE(loaded.Find("two", entry));
+    EXPECT_EQ(entry.file, "two.mp3");
+}
+
+TEST_F(LocalMusicLibraryTest, RescanProbesOnlyChangedFiles) {
+    WriteMp3("keep.mp3", 50);
+    WriteMp3("touch.mp3", 50);
+    WriteMp3("remove.mp3", 50);
+    LocalMusicLibrary library;
+    library.Load(dir_);
+    ASSERT_TRUE(library.Rescan());
+
+    // Mark every entry in the index, a probed file gets its title back from the file name
+    std::string index = ReadIndex();
+    for (size_t pos = 0; (pos = index.find(".mp3\t", pos)) != std::string::npos; pos++) {
+        size_t title = pos;
+        for (int tabs = 0; tabs < 5; tabs++) {
+            title = index.find('\t', title) + 1;
+        }
+        index.insert(title, "cached ");
+    }
+    WriteIndex(index);
+    ASSERT_TRUE(library.Load(dir_));
+
+    WriteMp3("touch.mp3", 50, "", "", 1700000100);
+    WriteMp3("new.mp3", 60);
+    ASSERT_EQ(unlink((dir_ + "/remove.mp3").c_str()), 0);
+    EXPECT_TRUE(library.Rescan());
+
+    auto entries = library.Entries();
+    ASSERT_EQ(Files(library), (std::vector<std::string>{"keep.mp3", "new.mp3", "touch.mp3"}));
+    EXPECT_EQ(entries[0].title, "cached keep");
+    EXPECT_EQ(entries[1].title, "new");
+    EXPECT_EQ(entries[2].title, "touch");
+    EXPECT_EQ(entries[2].mtime, 1700000100);
+
+    // A file whose size changed is probed again even with the same mtime
+    WriteMp3("keep.mp3", 70);
+    EXPECT_TRUE(library.Rescan());
+    EXPECT_EQ(library.Entries()[0].title, "keep");
+
+    LocalMusicLibrary reloaded;
+    EXPECT_TRUE(reloaded.Load(dir_));
+    EXPECT_EQ(Files(reloaded), Files(library));
+    EXPECT_FALSE(reloaded.Rescan());
+}
+
+TEST_F(LocalMusicLibraryTest, IgnoresIndexWithUnknownHeader) {
+    WriteIndex("# music index v0\nsong.mp3\t1\t2\t3\t4\tsong\t\t\n");
+    LocalMusicLibrary library;
+    EXPECT_FALSE(library.Load(dir_));
+    EXPECT_EQ(library.Size(), 0u);
+}
+
+TEST_F(LocalMusicLibraryTest, SkipsMalformedIndexLines) {
+    std::string index = "# music index v1\n";
+    index += "good.mp3\t1\t2\t3\t4\tGood\tArtist\tAlbum\n";
+    index += "short.mp3\t1\t2\n";
+    index += "\t1\t2\t3\t4\tNo file\t\t\n";
+    index += "long.mp3\t1\t2\t3\t4\t" + std::string(2000, 'x') + "\t\t\n";
+    index += "last.mp3\t5\t6\t7\t8\tLast\t\t\n";
+    WriteIndex(index);
+
+    LocalMusicLibrary library;
+    EXPECT_TRUE(library.Load(dir_));
+    auto entries = library.Entries();
+    ASSERT_EQ(Files(library), (std::vector<std::string>{"good.mp3", "last.mp3"}));
+    EXPECT_EQ(entries[0].mtime, 1);
+    EXPECT_EQ(entries[0].size, 2);
+    EXPECT_EQ(entries[0].duration_ms, 3u);
+    EXPECT_EQ(entries[0].bitrate, 4u);
+    EXPECT_EQ(entries[0].title, "Good");
+    EXPECT_EQ(entries[1].title, "Last");
+}
+
+TEST(LocalMusicLibraryNormalizeTest, FoldsCaseWidthAndPunctuation) {
+    EXPECT_EQ(LocalMusicLibrary::Normalize("Hello, World!"), "helloworld");
+    EXPECT_EQ(LocalMusicLibrary::Normalize("ＡＢＣ１２３"), "abc123");
+    EXPECT_EQ(LocalMusicLibrary::Normalize("《七里香》 —— 周杰伦"), "七里香周杰伦");
+    EXPECT_EQ(LocalMusicLibrary::Normalize("晴天（Live）"), "晴天live");
+    EXPECT_EQ(LocalMusicLibrary::Normalize(" .-_ "), "");
+}
+
+TEST_F(LocalMusicLibraryTest, FindAndSearch) {
+    WriteIndex("# music index v1\n"
+               "01 晴天.mp3\t1\t1\t0\t0\t晴天\t周杰伦\t\n"
+               "七里香.mp3\t1\t1\t0\t0\t七里香\t周杰伦\t\n"
+               "hello.mp3\t1\t1\t0\t0\tHello\tAdele\t\n"
+               "rolling.mp3\t1\t1\t0\t0\tRolling in the Deep\tAdele\t\n");
+    LocalMusicLibrary library;
+    ASSERT_TRUE(library.Load(dir_));
+
+    LocalMusicEntry entry;
+    EXPECT_TRUE(library.Find("晴天", entry));
+    EXPECT_EQ(entry.file, "01 晴天.mp3");
+    EXPECT_TRUE(library.Find("01晴天", entry));
+    EXPECT_TRUE(library.Find("HELLO!", entry));
+    EXPECT_EQ(entry.file, "hello.mp3");
+    EXPECT_FALSE(library.Find("晴", entry));
+
+    auto results = library.Search("七里想", 3);
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results[0].title, "七里香");
+
+    // Matching the artist ranks below matching the title
+    results = library.Search("adele", 5);
+    ASSERT_EQ(results.size(), 2u);
+    results = library.Search("rolling deep", 1);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].file, "rolling.mp3");
+    EXPECT_TRUE(library.Search("完全无关", 5).empty());
+    EXPECT_TRUE(library.Search("晴天", 0).empty());
+}
+
+TEST_F(LocalMusicLibraryTest, FiveThousandFiles) {
+    constexpr int kFiles = 5000;
+    for (int i = 0; i < kFiles; i++) {
+        WriteMp3("artist " + std::to_string(i % 50) + "/song " + std::to_string(i) + ".mp3", 4,
+                 "Song " + std::to_string(i), "Artist " + std::to_string(i % 50));
+    }
+    auto ms_since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    LocalMusicLibrary library;
+    library.Load(dir_);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(library.Rescan());
+    double full_scan_ms = ms_since(start);
+    ASSERT_EQ(library.Size(), (size_t)kFiles);
+
+    // Mark every title in the index, so that the titles of probed files show which ones were read again
+    std::istringstream lines(ReadIndex());
+    std::string index, line;
+    while (std::getline(lines, line)) {
+        size_t title = 0;
+        for (int tabs = 0; tabs < 5 && line[0] != '#'; tabs++) {
+            title = line.find('\t', title) + 1;
+        }
+        if (title > 0) {
+            line.insert(title, "cached ");
+        }
+        index += line + "\n";
+    }
+    WriteIndex(index);
+
+    LocalMusicLibrary loaded;
+    start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(loaded.Load(dir_));
+    double load_ms = ms_since(start);
+    ASSERT_EQ(loaded.Size(), (size_t)kFiles);
+
+    start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(loaded.Rescan());
+    double unchanged_ms = ms_since(start);
+
+    // Modify, add and remove a few files: only the modified and added ones are probed
+    for (int i = 0; i < 10; i++) {
+        WriteMp3("artist 0/song " + std::to_string(i * 50) + ".mp3", 4, "Modified " + std::to_string(i), "", 1700000100);
+        WriteMp3("new/new " + std::to_string(i) + ".mp3", 4, "New " + std::to_string(i));
+        ASSERT_EQ(unlink((dir_ + "/artist 1/song " + std::to_string(i * 50 + 1) + ".mp3").c_str()), 0);
+    }
+    start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(loaded.Rescan());
+    double changed_ms = ms_since(start);
+    ASSERT_EQ(loaded.Size(), (size_t)kFiles);
+    int probed = 0;
+    for (auto& entry : loaded.Entries()) {
+        if (entry.title.rfind("cached ", 0) != 0) {
+            probed++;
+            EXPECT_TRUE(entry.title.rfind("Modified ", 0) == 0 || entry.title.rfind("New ", 0) == 0) << entry.file;
+        }
+    }
+    EXPECT_EQ(probed, 20);
+
+    start = std::chrono::steady_clock::now();
+    LocalMusicEntry entry;
+    for (int i = 0; i < kFiles; i++) {
+        ASSERT_TRUE(loaded.Find("song " + std::to_string(i), entry) || i % 50 == 0 || i % 50 == 1) << i;
+    }
+    double find_us = ms_since(start) * 1000 / kFiles;
+    EXPECT_TRUE(loaded.Find("cached song 4999", entry));
+    EXPECT_EQ(entry.file, "artist 49/song 4999.mp3");
+
+    start = std::chrono::steady_clock::now();
+    auto results = loaded.Search("cached song 4321", 5);
+    double search_ms = ms_since(start);
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results[0].file, "artist 21/song 4321.mp3");
+
+    printf("%d files: full scan %.1f ms, load %.1f ms, unchanged rescan %.1f ms, rescan with 30 changes %.1f ms, "
+           "find %.2f us, search %.2f ms\n",
+           kFiles, full_scan_ms, load_ms, unchanged_ms, changed_ms, find_us, search_ms);
+}
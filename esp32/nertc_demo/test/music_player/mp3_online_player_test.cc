@@ -0,0 +1,401 @@
+#include "music_player/mp3_online_player.h"
+
+#include <dirent.h>
+#include <esp_timer.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include "fake_media.h"
+#include "fake_server.h"
+#include "pcm_sink.h"
+
+using namespace fake_media;
+
+namespace {
+
+const char* kUrl = "http://music.test/song.mp3";
+const char* kNextUrl = "http://music.test/next.mp3";
+const char* kClipUrl = "http://music.test/clip.mp3";
+
+// Plays eight times faster than real time, the server delivers 4 KB every 2 ms
+constexpr double kSpeed = 8;
+
+class Mp3OnlinePlayerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        server_.SetReadPacing(2000, 4096);
+        sink_.Attach(player_);
+    }
+
+    void TearDown() override {
+        player_.StopStreaming();
+        EXPECT_EQ(server_.live_connections(), 0);
+    }
+
+    void Play(const std::string& url) {
+        ASSERT_TRUE(player_.StartStreaming(url, player_.NewSession()));
+    }
+
+    // Plays url to the end into a sink of its own and returns what was played
+    std::vector<fake_media::Run> PlayToEnd(const std::string& url) {
+        PcmSink sink(kSpeed);
+        sink.Attach(player_);
+        bool finished = player_.StartStreaming(url, player_.NewSession()) &&
+                        sink.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000);
+        player_.StopStreaming();
+        sink_.Attach(player_);
+        EXPECT_TRUE(finished) << url;
+        return sink.runs();
+    }
+
+    std::vector<size_t> RequestOffsets() {
+        std::vector<size_t> offsets;
+        for (auto& request : server_.requests()) {
+            offsets.push_back(request.offset);
+        }
+        return offsets;
+    }
+
+    FakeServer server_;
+    PcmSink sink_{kSpeed};
+    Mp3OnlinePlayer player_;
+};
+
+int ThreadCount() {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    while (dirent* entry = readdir(dir)) {
+        count += entry->d_name[0] != '.';
+    }
+    closedir(dir);
+    return count;
+}
+
+// Every frame in [first, last) was played once, in order and in full
+void ExpectFrames(const std::vector<Run>& runs, int first, int last) {
+    ASSERT_EQ(runs.size(), (size_t)(last - first));
+    for (size_t i = 0; i < runs.size(); i++) {
+        ASSERT_EQ(runs[i], (Run{first + (int)i, kMp3FrameSamples})) << "run " << i;
+    }
+}
+
+}  // namespace
+
+TEST_F(Mp3OnlinePlayerTest, PlaysWholeStream) {
+    server_.Put(kUrl, {Mp3Stream(300), "", true});
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    ExpectFrames(sink_.runs(), 0, 300);
+    EXPECT_EQ(sink_.sample_rate(), kMp3SampleRate);
+    EXPECT_EQ(RequestOffsets(), (std::vector<size_t>{0}));
+}
+
+TEST_F(Mp3OnlinePlayerTest, ResumesDroppedConnectionsWithRange) {
+    server_.Put(kUrl, {Mp3Stream(300), "", true});
+    server_.DropConnectionsAfter({50000, 30001});
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    ExpectFrames(sink_.runs(), 0, 300);
+    EXPECT_EQ(RequestOffsets(), (std::vector<size_t>{0, 50000, 80001}));
+    printf("Two dropped connections: longest output stall %lld ms\n", (long long)sink_.longest_stall_ms());
+}
+
+TEST_F(Mp3OnlinePlayerTest, ResumesAfterNetworkOutage) {
+    server_.Put(kUrl, {Mp3Stream(300), "", true});
+    // The connection drops and the next two attempts fail, retried after 500 and 1000 ms
+    server_.DropConnectionsAfter({40000});
+    server_.RefuseConnections(2, 1);
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    ExpectFrames(sink_.runs(), 0, 300);
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 4u);
+    EXPECT_EQ(requests[1].status, 0);
+    EXPECT_EQ(requests[2].status, 0);
+    EXPECT_EQ(requests[3].status, 206);
+    EXPECT_EQ(requests[3].offset, 40000u);
+    int64_t stall = sink_.longest_stall_ms();
+    printf("Outage of two failed reconnects: longest output stall %lld ms\n", (long long)stall);
+    EXPECT_GE(stall, 500);
+}
+
+TEST_F(Mp3OnlinePlayerTest, ResumesFromServerWithoutRange) {
+    server_.Put(kUrl, {Mp3Stream(300), "", false});
+    server_.DropConnectionsAfter({50000});
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    ExpectFrames(sink_.runs(), 0, 300);
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[1].offset, 50000u);
+    EXPECT_EQ(requests[1].status, 200);
+}
+
+TEST_F(Mp3OnlinePlayerTest, SeekRequestsByteOffset) {
+    server_.Put(kUrl, {Mp3Stream(300), "", true});
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForSamples(1, 5000));
+    // 1000 ms at 128 kbps is byte 16000, inside frame 38; decoding resumes at frame 39
+    ASSERT_TRUE(player_.Seek(1000, player_.session()));
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    EXPECT_EQ(RequestOffsets(), (std::vector<size_t>{0, 16000}));
+
+    auto runs = sink_.runs();
+    size_t seek = 1;
+    while (seek < runs.size() && runs[seek].number == runs[seek - 1].number + 1) {
+        seek++;
+    }
+    ASSERT_LT(seek, runs.size());
+    EXPECT_EQ(runs[0].number, 0);
+    ExpectFrames(std::vector<fake_media::Run>(runs.begin() + seek, runs.end()), 39, 300);
+    EXPECT_GE(player_.GetPlayTimeMs(), 1000 + 261 * 26);
+}
+
+// After a gapless switch the seek goes to the track that is playing now
+TEST_F(Mp3OnlinePlayerTest, SeekAfterGaplessSwitch) {
+    server_.Put(kUrl, {Mp3Stream(20), "", true});
+    server_.Put(kNextUrl, {Mp3Stream(300, 1000), "", true});
+    int next_requests = 0;
+    player_.SetTrackCallbacks([&] { return next_requests++ == 0 ? std::string(kNextUrl) : std::string(); }, nullptr);
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForSamples(30 * kMp3FrameSamples, 5000));
+    ASSERT_TRUE(player_.Seek(1000, player_.session()));
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 3u);
+    EXPECT_EQ(requests[2].url, kNextUrl);
+    EXPECT_EQ(requests[2].offset, 16000u);
+    EXPECT_EQ(sink_.runs().back(), (fake_media::Run{1000 + 299, kMp3FrameSamples}));
+}
+
+TEST_F(Mp3OnlinePlayerTest, StopClosesBlockedConnection) {
+    server_.Put(kUrl, {Mp3Stream(300), "", true});
+    // A server that stalls for a long time on every read
+    server_.SetReadPacing(60 * 1000 * 1000, 4096);
+    Play(kUrl);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(player_.StopStreaming());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(ms, 1000);
+}
+
+// Start and stop the way MusicPlayer does: each start runs on a short-lived task, a
+// new request supersedes one that has not run yet, and some sessions seek first.
+// After every stop no thread, connection or output call may be left over
+TEST_F(Mp3OnlinePlayerTest, StartStopStress) {
+    // Too long for the clip cache, so that every session goes to the network
+    server_.Put(kUrl, {Mp3Stream(1000), "", true});
+    // Fast enough that most sessions get past buffering before they are stopped
+    server_.SetReadPacing(200, 4096);
+    const int base_threads = ThreadCount();
+    std::mt19937 rng(1);
+    std::vector<double> stop_ms;
+    int superseded = 0;
+    int played = 0;
+    size_t samples = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint32_t session = player_.NewSession();
+        bool started = false;
+        std::thread start([&, session] { started = player_.StartStreaming(kUrl, session); });
+        if (i % 3 == 0) {
+            start.join();
+        }
+        // Every fifth cycle stops right away, racing the start task
+        if (i % 5 != 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(rng() % 10000));
+        }
+        if (i % 7 == 0) {
+            player_.Seek(1000, player_.session());
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        ASSERT_TRUE(player_.StopStreaming()) << "cycle " << i;
+        stop_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        if (start.joinable()) {
+            start.join();
+        }
+        superseded += !started;
+        // A start that lost the race against the stop must not run afterwards
+        ASSERT_FALSE(player_.IsPlaying()) << "cycle " << i;
+        played += sink_.samples().size() > samples;
+        samples = sink_.samples().size();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_EQ(sink_.samples().size(), samples) << "output after stop in cycle " << i;
+        ASSERT_EQ(server_.live_connections(), 0) << "cycle " << i;
+        ASSERT_EQ(ThreadCount(), base_threads) << "cycle " << i;
+    }
+    std::sort(stop_ms.begin(), stop_ms.end());
+    printf("1000 start/stop cycles, %d played, %d starts superseded: stop p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           played, superseded, stop_ms[500], stop_ms[990], stop_ms.back());
+    EXPECT_LT(stop_ms.back(), 1000);
+}
+
+// The clip cache holds a quarter of its 1 MB budget per entry: a 1 s clip is kept as
+// decoded PCM (180 KB) after its first playback, a 7.8 s one only as the downloaded data
+TEST_F(Mp3OnlinePlayerTest, ReplaysCachedClipsWithoutNetwork) {
+    server_.Put(kClipUrl, {Mp3Stream(40), "\"v1\"", true});
+    server_.Put(kUrl, {Mp3Stream(300), "\"v1\"", true});
+    for (auto url : {kClipUrl, kUrl}) {
+        auto first = PlayToEnd(url);
+        ExpectFrames(first, 0, url == kClipUrl ? 40 : 300);
+        EXPECT_EQ(PlayToEnd(url), first) << url;
+        EXPECT_EQ(PlayToEnd(url), first) << url;
+    }
+    EXPECT_EQ(server_.requests().size(), 2u);
+}
+
+TEST_F(Mp3OnlinePlayerTest, RevalidatesStaleClipWithEtag) {
+    server_.Put(kClipUrl, {Mp3Stream(40), "\"v1\"", true});
+    auto first = PlayToEnd(kClipUrl);
+    // Past the ten minutes an entry is used without asking the server
+    esp_timer_stub_advance(601LL * 1000 * 1000);
+    EXPECT_EQ(PlayToEnd(kClipUrl), first);
+    EXPECT_EQ(PlayToEnd(kClipUrl), first);
+
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[0].if_none_match, "");
+    EXPECT_EQ(requests[0].status, 200);
+    EXPECT_EQ(requests[1].if_none_match, "\"v1\"");
+    EXPECT_EQ(requests[1].status, 304);
+}
+
+TEST_F(Mp3OnlinePlayerTest, RedownloadsChangedClip) {
+    server_.Put(kClipUrl, {Mp3Stream(40), "\"v1\"", true});
+    ExpectFrames(PlayToEnd(kClipUrl), 0, 40);
+    server_.Put(kClipUrl, {Mp3Stream(30, 500), "\"v2\"", true});
+    esp_timer_stub_advance(601LL * 1000 * 1000);
+    // The conditional request returns the new content, which replaces the cached clip
+    ExpectFrames(PlayToEnd(kClipUrl), 500, 530);
+    ExpectFrames(PlayToEnd(kClipUrl), 500, 530);
+
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[1].if_none_match, "\"v1\"");
+    EXPECT_EQ(requests[1].status, 200);
+}
+
+TEST_F(Mp3OnlinePlayerTest, PlaysStaleClipWhenOffline) {
+    server_.Put(kClipUrl, {Mp3Stream(40), "\"v1\"", true});
+    auto first = PlayToEnd(kClipUrl);
+    esp_timer_stub_advance(601LL * 1000 * 1000);
+    server_.RefuseConnections(1, 1);
+    EXPECT_EQ(PlayToEnd(kClipUrl), first);
+
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[1].status, 0);
+}
+
+// Two tracks back to back: the second is prefetched into the same buffer and the
+// player switches at the segment boundary without stopping
+TEST_F(Mp3OnlinePlayerTest, GaplessSwitchToPrefetchedTrack) {
+    // 100 audio frames after a LAME tag: 576 samples encoder delay, 1000 padding
+    auto first = Mp3LameFrame(100, 576, 1000);
+    auto audio = Mp3Stream(100, 1);
+    first.insert(first.end(), audio.begin(), audio.end());
+    server_.Put(kUrl, {first, "", true});
+    server_.Put(kNextUrl, {Mp3Stream(100, 1000), "", true});
+
+    int next_requests = 0;
+    int track_changes = 0;
+    player_.SetTrackCallbacks([&] { return next_requests++ == 0 ? std::string(kNextUrl) : std::string(); },
+                              [&] { track_changes++; });
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    EXPECT_EQ(track_changes, 1);
+    EXPECT_EQ(RequestOffsets(), (std::vector<size_t>{0, 0}));
+
+    // The info frame is dropped, then the encoder and decoder delay (576 + 529) and
+    // at the end the padding left over after the decoder delay (1000 - 529)
+    auto runs = sink_.runs();
+    ASSERT_EQ(runs.size(), 200u);
+    EXPECT_EQ(runs[0], (fake_media::Run{1, 1152 - (576 + 529)}));
+    for (int i = 1; i < 99; i++) {
+        ASSERT_EQ(runs[i], (fake_media::Run{1 + i, kMp3FrameSamples}));
+    }
+    EXPECT_EQ(runs[99], (fake_media::Run{100, 1152 - (1000 - 529)}));
+    size_t first_track_samples = 0;
+    for (int i = 0; i < 100; i++) {
+        first_track_samples += runs[i].samples;
+    }
+    EXPECT_EQ(first_track_samples, 100u * 1152 - 576 - 1000);
+    ExpectFrames(std::vector<fake_media::Run>(runs.begin() + 100, runs.end()), 1000, 1100);
+
+    // Nothing but the next track's samples between the two, and how long the switch took
+    int64_t gap_us = sink_.stall_before_us(first_track_samples);
+    ASSERT_GE(gap_us, 0);
+    printf("Gapless switch: 0 samples of silence, %lld us between tracks, longest stall %lld ms\n",
+           (long long)gap_us, (long long)sink_.longest_stall_ms());
+}
+
+// ADTS has no duration, so the next track is not requested until the buffer runs low
+TEST_F(Mp3OnlinePlayerTest, PrefetchWaitsForLowBufferWithoutDuration) {
+    const size_t frame_size = 300;
+    const int frames = 400;
+    server_.Put("http://music.test/first.aac", {AdtsStream(frames, frame_size, 1), "", true});
+    server_.Put("http://music.test/second.aac", {AdtsStream(60, frame_size, 1000), "", true});
+
+    size_t played_at_prefetch = 0;
+    int next_requests = 0;
+    player_.SetTrackCallbacks([&] {
+        if (next_requests++ > 0) {
+            return std::string();
+        }
+        played_at_prefetch = sink_.runs().size();
+        return std::string("http://music.test/second.aac");
+    }, nullptr);
+    Play("http://music.test/first.aac");
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    EXPECT_EQ(sink_.runs().size(), (size_t)frames + 60);
+    // At most 32 KB of the first track is left in the buffer when the next one is requested
+    EXPECT_GE(played_at_prefetch, (size_t)frames - (32 * 1024) / frame_size - 8);
+}
+
+// A track whose last frame was cut short: the partial frame is dropped at the segment
+// boundary instead of waiting for data that belongs to the next track
+TEST_F(Mp3OnlinePlayerTest, GaplessSwitchAfterTruncatedAdtsFrame) {
+    const size_t frame_size = 300;
+    auto first = AdtsStream(60, frame_size, 1);
+    first.resize(first.size() - frame_size / 2);
+    server_.Put("http://music.test/first.aac", {first, "", true});
+    server_.Put("http://music.test/second.aac", {AdtsStream(60, frame_size, 1000), "", true});
+
+    int next_requests = 0;
+    int track_changes = 0;
+    player_.SetTrackCallbacks([&] { return next_requests++ == 0 ? std::string("http://music.test/second.aac") : std::string(); },
+                              [&] { track_changes++; });
+    Play("http://music.test/first.aac");
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+    EXPECT_EQ(track_changes, 1);
+
+    auto runs = sink_.runs();
+    ASSERT_EQ(runs.size(), 59u + 60u);
+    for (int i = 0; i < 59; i++) {
+        ASSERT_EQ(runs[i], (fake_media::Run{1 + i, kAacFrameSamples}));
+    }
+    for (int i = 0; i < 60; i++) {
+        ASSERT_EQ(runs[59 + i], (fake_media::Run{1000 + i, kAacFrameSamples}));
+    }
+}
+
+TEST_F(Mp3OnlinePlayerTest, GaplessSwitchAfterTruncatedMp3Frame) {
+    auto first = Mp3Stream(60, 1);
+    first.resize(first.size() - kMp3FrameSize / 2);
+    server_.Put(kUrl, {first, "", true});
+    server_.Put(kNextUrl, {Mp3Stream(60, 1000), "", true});
+
+    int next_requests = 0;
+    player_.SetTrackCallbacks([&] { return next_requests++ == 0 ? std::string(kNextUrl) : std::string(); }, nullptr);
+    Play(kUrl);
+    ASSERT_TRUE(sink_.WaitForState(MUSIC_PLAYER_STATE_FINISHED, 10000));
+
+    auto runs = sink_.runs();
+    ASSERT_EQ(runs.size(), 59u + 60u);
+    ExpectFrames(std::vector<fake_media::Run>(runs.begin(), runs.begin() + 59), 1, 60);
+    ExpectFrames(std::vector<fake_media::Run>(runs.begin() + 59, runs.end()), 1000, 1060);
+}
@@ -0,0 +1,139 @@
+#include "music_player/mp3_stream_info.h"
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// MPEG-1 layer III, 128 kbps, 44.1 kHz, stereo: side information ends 36 bytes into the frame
+std::vector<uint8_t> EmptyFrame() {
+    std::vector<uint8_t> frame(417, 0);
+    frame[0] = 0xFF;
+    frame[1] = 0xFB;
+    frame[2] = 0x90;
+    frame[3] = 0x00;
+    return frame;
+}
+
+void PutBe(uint8_t* p, uint32_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        p[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+// Xing header with frame count, byte count, a TOC where toc[i] = 2 * i, and a LAME tag
+std::vector<uint8_t> XingFrame(uint32_t frames, uint32_t bytes, int delay, int padding) {
+    auto frame = EmptyFrame();
+    uint8_t* p = frame.data() + 36;
+    memcpy(p, "Xing", 4);
+    PutBe(p + 4, 0x0F, 4);
+    PutBe(p + 8, frames, 4);
+    PutBe(p + 12, bytes, 4);
+    for (int i = 0; i < 100; i++) {
+        p[16 + i] = 2 * i;
+    }
+    p += 16 + 100 + 4;
+    memcpy(p, "LAME3.100", 9);
+    PutBe(p + 21, (delay << 12) | padding, 3);
+    return frame;
+}
+
+std::vector<uint8_t> VbriFrame(uint32_t frames, uint32_t bytes, const std::vector<uint16_t>& table,
+                               uint16_t scale, uint16_t frames_per_entry) {
+    auto frame = EmptyFrame();
+    uint8_t* p = frame.data() + 36;
+    memcpy(p, "VBRI", 4);
+    PutBe(p + 10, bytes, 4);
+    PutBe(p + 14, frames, 4);
+    PutBe(p + 18, table.size(), 2);
+    PutBe(p + 20, scale, 2);
+    PutBe(p + 22, 2, 2);
+    PutBe(p + 24, frames_per_entry, 2);
+    for (size_t i = 0; i < table.size(); i++) {
+        PutBe(p + 26 + 2 * i, table[i], 2);
+    }
+    return frame;
+}
+
+}  // namespace
+
+TEST(Mp3StreamInfoTest, XingTocAndLameTag) {
+    auto frame = XingFrame(1000, 417000, 576, 1000);
+    Mp3StreamInfo info;
+    // The first frame follows a 10 byte ID3 tag
+    info.Parse(frame.data(), frame.size(), 10, 0, 128000, 44100);
+    ASSERT_TRUE(info.valid());
+    EXPECT_EQ(info.audio_start(), 10u);
+    EXPECT_TRUE(info.has_info_frame());
+    EXPECT_EQ(info.encoder_delay(), 576);
+    EXPECT_EQ(info.encoder_padding(), 1000);
+    EXPECT_EQ(info.StartTrimSamples(), 576 + 529);
+    EXPECT_EQ(info.ValidSamples(), 1000 * 1152 - 576 - 1000);
+    EXPECT_EQ(info.DurationMs(), 1000 * 1152 * 1000 / 44100);
+
+    EXPECT_EQ(info.OffsetForTime(0), 10u);
+    // Half way is toc[50] = 100/256 of the audio, a quarter past is between toc[75] and toc[76]
+    int64_t duration = info.DurationMs();
+    EXPECT_NEAR((double)info.OffsetForTime(duration / 2), 10 + 100.0 / 256 * 417000, 2000);
+    EXPECT_NEAR((double)info.OffsetForTime(duration * 3 / 4), 10 + 150.0 / 256 * 417000, 2000);
+    size_t end = info.OffsetForTime(duration * 2);
+    EXPECT_GT(end, 10u + 410000);
+    EXPECT_LT(end, 10u + 417000);
+}
+
+TEST(Mp3StreamInfoTest, InfoTagWithoutLameHasNoTrim) {
+    auto frame = XingFrame(100, 41700, 0, 0);
+    memcpy(frame.data() + 36, "Info", 4);
+    memset(frame.data() + 36 + 120, 0, 24);
+    Mp3StreamInfo info;
+    info.Parse(frame.data(), frame.size(), 0, 0, 128000, 44100);
+    EXPECT_TRUE(info.has_info_frame());
+    EXPECT_EQ(info.encoder_delay(), 0);
+    EXPECT_EQ(info.StartTrimSamples(), 0);
+    EXPECT_EQ(info.ValidSamples(), 100 * 1152);
+}
+
+TEST(Mp3StreamInfoTest, VbriTable) {
+    // Four entries of 100 frames each, stored halved with a scale of 2
+    auto frame = VbriFrame(400, 20000, {500, 1000, 1500, 2000}, 2, 100);
+    Mp3StreamInfo info;
+    info.Parse(frame.data(), frame.size(), 0, 0, 128000, 44100);
+    ASSERT_TRUE(info.valid());
+    EXPECT_FALSE(info.has_info_frame());
+    EXPECT_EQ(info.DurationMs(), 400 * 1152 * 1000 / 44100);
+
+    int64_t entry_ms = 100 * 1152 * 1000 / 44100;
+    EXPECT_EQ(info.OffsetForTime(entry_ms - 1), 0u);
+    EXPECT_EQ(info.OffsetForTime(entry_ms), 1000u);
+    EXPECT_EQ(info.OffsetForTime(2 * entry_ms + 10), 3000u);
+    EXPECT_EQ(info.OffsetForTime(10 * entry_ms), 10000u);
+}
+
+TEST(Mp3StreamInfoTest, CbrEstimatesFromBitrate) {
+    auto frame = EmptyFrame();
+    Mp3StreamInfo info;
+    info.Parse(frame.data(), frame.size(), 0, 100000, 128000, 44100);
+    ASSERT_TRUE(info.valid());
+    EXPECT_FALSE(info.has_info_frame());
+    EXPECT_EQ(info.StartTrimSamples(), 0);
+    EXPECT_EQ(info.ValidSamples(), 0);
+    EXPECT_EQ(info.DurationMs(), 100000 * 8000 / 128000);
+    EXPECT_EQ(info.OffsetForTime(1000), 16000u);
+    EXPECT_EQ(info.OffsetForTime(60000), 99999u);
+
+    // Without a known length the estimate is not clamped and the duration is unknown
+    info.Parse(frame.data(), frame.size(), 0, 0, 128000, 44100);
+    EXPECT_EQ(info.DurationMs(), 0);
+    EXPECT_EQ(info.OffsetForTime(60000), 960000u);
+}
+
+TEST(Mp3StreamInfoTest, RejectsDataThatIsNotAFrame) {
+    std::vector<uint8_t> data(417, 0x55);
+    Mp3StreamInfo info;
+    info.Parse(data.data(), data.size(), 0, 0, 128000, 44100);
+    EXPECT_FALSE(info.valid());
+    EXPECT_EQ(info.DurationMs(), 0);
+    EXPECT_EQ(info.OffsetForTime(1000), 0u);
+}
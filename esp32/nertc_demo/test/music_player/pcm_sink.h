@@ -0,0 +1,128 @@
+#pragma once
+// Collects what Mp3OnlinePlayer sends to its output callback, optionally at a
+// multiple of real time so that buffering and stalls behave like on the device
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fake_media.h"
+#include "music_player/mp3_online_player.h"
+
+class PcmSink {
+public:
+    // speed 0 returns from the output callback immediately
+    explicit PcmSink(double speed = 0) : speed_(speed) {}
+
+    void Attach(Mp3OnlinePlayer& player) {
+        player.Mp3OnlinePlayerInit(&PcmSink::Output, &PcmSink::Info, &PcmSink::Event, this);
+    }
+
+    bool WaitForState(music_player_state_t state, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            for (auto event : events_) {
+                if (event == state) {
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+
+    bool WaitForSamples(size_t count, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return samples_.size() >= count; });
+    }
+
+    // Channel 0 of everything played so far
+    std::vector<int16_t> samples() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return samples_;
+    }
+
+    std::vector<fake_media::Run> runs() { return fake_media::Runs(samples()); }
+
+    // Longest time between two output calls, not counting the time spent playing
+    int64_t longest_stall_ms() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return longest_stall_us_ / 1000;
+    }
+
+    // Time between the output call that starts at sample and the return of the one before it
+    int64_t stall_before_us(size_t sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 1; i < calls_.size(); i++) {
+            if (calls_[i].first_sample == sample) {
+                return std::chrono::duration_cast<std::chrono::microseconds>(calls_[i].start - calls_[i - 1].end).count();
+            }
+        }
+        return -1;
+    }
+
+    int sample_rate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sample_rate_;
+    }
+
+private:
+    static int Output(uint8_t* data, int size, void* arg) {
+        auto sink = static_cast<PcmSink*>(arg);
+        auto now = std::chrono::steady_clock::now();
+        int64_t play_us = 0;
+        {
+            std::lock_guard<std::mutex> lock(sink->mutex_);
+            if (!sink->calls_.empty()) {
+                int64_t stall = std::chrono::duration_cast<std::chrono::microseconds>(now - sink->calls_.back().end).count();
+                sink->longest_stall_us_ = std::max(sink->longest_stall_us_, stall);
+            }
+            sink->calls_.push_back({sink->samples_.size(), now, now});
+            const int16_t* pcm = reinterpret_cast<const int16_t*>(data);
+            int frames = size / 2 / sink->channels_;
+            for (int i = 0; i < frames; i++) {
+                sink->samples_.push_back(pcm[i * sink->channels_]);
+            }
+            if (sink->speed_ > 0 && sink->sample_rate_ > 0) {
+                play_us = (int64_t)(frames * 1e6 / sink->sample_rate_ / sink->speed_);
+            }
+        }
+        sink->cv_.notify_all();
+        std::this_thread::sleep_for(std::chrono::microseconds(play_us));
+        std::lock_guard<std::mutex> lock(sink->mutex_);
+        sink->calls_.back().end = std::chrono::steady_clock::now();
+        return size;
+    }
+
+    static void Info(int sample_rate, int channels, int bits, void* arg) {
+        auto sink = static_cast<PcmSink*>(arg);
+        std::lock_guard<std::mutex> lock(sink->mutex_);
+        sink->sample_rate_ = sample_rate;
+        sink->channels_ = channels;
+    }
+
+    static void Event(music_player_state_t state, void* arg) {
+        auto sink = static_cast<PcmSink*>(arg);
+        {
+            std::lock_guard<std::mutex> lock(sink->mutex_);
+            sink->events_.push_back(state);
+        }
+        sink->cv_.notify_all();
+    }
+
+    double speed_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<int16_t> samples_;
+    std::vector<music_player_state_t> events_;
+    int sample_rate_ = 0;
+    int channels_ = 1;
+    struct Call {
+        size_t first_sample;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+    std::vector<Call> calls_;
+    int64_t longest_stall_us_ = 0;
+};
@@ -0,0 +1,144 @@
+#include "music_player/stream_decoder.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fake_media.h"
+
+namespace {
+
+using fake_media::Run;
+
+struct Decoded {
+    std::vector<int16_t> samples;   // First channel only
+    int channels = 0;
+    int sample_rate = 0;
+    int skipped = 0;
+};
+
+// Decodes a stream that is already complete, the way the player drains its buffer at the end of a download
+Decoded DecodeAll(StreamFormat format, const std::vector<uint8_t>& data) {
+    Decoded decoded;
+    auto decoder = CreateStreamDecoder(format);
+    EXPECT_NE(decoder, nullptr);
+    if (decoder == nullptr) {
+        return decoded;
+    }
+    size_t offset = 0;
+    for (int calls = 0; calls < 100000; calls++) {
+        size_t consumed = 0;
+        DecodedFrame frame;
+        DecodeResult result = decoder->Decode(data.data() + offset, data.size() - offset, true, consumed, frame);
+        offset += consumed;
+        if (result == DecodeResult::kNeedMoreData || result == DecodeResult::kFatal) {
+            break;
+        }
+        if (result == DecodeResult::kSkipped) {
+            decoded.skipped++;
+        } else if (result == DecodeResult::kFrame) {
+            decoded.channels = frame.channels;
+            decoded.sample_rate = frame.sample_rate;
+            for (int i = 0; i < frame.samples; i++) {
+                decoded.samples.push_back(frame.pcm[i * frame.channels]);
+            }
+        }
+    }
+    return decoded;
+}
+
+std::vector<uint8_t> ReadAsset(const std::string& name) {
+    std::ifstream file(std::string(ASSETS_DIR) + "/" + name, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// What RFC 7845 says a decoder must output for an Ogg/Opus file, worked out with a
+// whole-file parser: the pre-skip samples are dropped from the start, and the stream
+// ends at the granule position of the last page
+struct OpusReference {
+    int pre_skip = 0;
+    int64_t end = 0;
+    std::vector<Run> runs;  // Samples kept from each packet, numbered in stream order
+};
+
+OpusReference ReferenceOpus(const std::vector<uint8_t>& data) {
+    OpusReference reference;
+    std::vector<std::vector<uint8_t>> packets;
+    std::vector<uint8_t> pending;
+    size_t offset = 0;
+    while (offset + 27 <= data.size()) {
+        const uint8_t* page = data.data() + offset;
+        reference.end = 0;
+        for (int i = 7; i >= 0; i--) {
+            reference.end = (reference.end << 8) | page[6 + i];
+        }
+        size_t segments = page[26];
+        const uint8_t* body = page + 27 + segments;
+        for (size_t i = 0; i < segments; i++) {
+            pending.insert(pending.end(), body, body + page[27 + i]);
+            body += page[27 + i];
+            if (page[27 + i] < 255) {
+                packets.push_back(pending);
+                pending.clear();
+            }
+        }
+        offset = body - data.data();
+    }
+    reference.pre_skip = packets[0][10] | (packets[0][11] << 8);
+
+    int64_t position = 0;
+    for (size_t i = 2; i < packets.size(); i++) {
+        int64_t start = position;
+        position += fake_media::OpusPacketSamples(packets[i].data(), packets[i].size());
+        int64_t kept = std::min(position, reference.end) - std::max(start, (int64_t)reference.pre_skip);
+        if (kept > 0) {
+            reference.runs.push_back({(int)(i - 2), (int)kept});
+        }
+    }
+    return reference;
+}
+
+class OpusRealPacketsTest : public ::testing::Test {
+protected:
+    void SetUp() override { fake_media::SetOpusRealPackets(true); }
+    void TearDown() override { fake_media::SetOpusRealPackets(false); }
+};
+
+}  // namespace
+
+// The output buffer starts at the size of a stereo HE-AAC frame, a 5.1 stream needs more
+TEST(StreamDecoderTest, AacGrowsItsOutputBufferWithoutSkippingTheFrame) {
+    auto stream = fake_media::AdtsStream(3, 300, 0, 6);
+    Decoded decoded = DecodeAll(StreamFormat::kAac, stream);
+    EXPECT_EQ(decoded.channels, 6);
+    EXPECT_EQ(decoded.skipped, 1);
+    EXPECT_EQ(fake_media::Runs(decoded.samples),
+              (std::vector<fake_media::Run>{{0, fake_media::kAacFrameSamples},
+                                            {1, fake_media::kAacFrameSamples},
+                                            {2, fake_media::kAacFrameSamples}}));
+}
+
+TEST_F(OpusRealPacketsTest, BundledSoundsMatchTheirGranulePositions) {
+    const char* sounds[] = {
+        "common/exclamation.ogg",
+        "common/low_battery.ogg",
+        "common/popup.ogg",
+        "common/success.ogg",
+        "common/vibration.ogg",
+        "locales/de-DE/welcome.ogg",
+    };
+    for (const char* sound : sounds) {
+        SCOPED_TRACE(sound);
+        auto data = ReadAsset(sound);
+        ASSERT_FALSE(data.empty());
+        OpusReference reference = ReferenceOpus(data);
+        Decoded decoded = DecodeAll(StreamFormat::kOpus, data);
+
+        EXPECT_EQ(decoded.sample_rate, 48000);
+        EXPECT_EQ((int64_t)decoded.samples.size(), reference.end - reference.pre_skip);
+        EXPECT_EQ(fake_media::Runs(decoded.samples), reference.runs);
+    }
+}
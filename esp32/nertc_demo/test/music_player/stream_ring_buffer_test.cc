@@ -0,0 +1,182 @@
+#include "music_player/stream_ring_buffer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void Write(StreamRingBuffer& buffer, const std::vector<uint8_t>& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        size_t len = 0;
+        uint8_t* dst = buffer.WaitWritable(1, len);
+        ASSERT_NE(dst, nullptr);
+        len = std::min(len, data.size() - offset);
+        memcpy(dst, data.data() + offset, len);
+        buffer.Commit(len);
+        offset += len;
+    }
+}
+
+std::vector<uint8_t> Pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)(seed + i * 13);
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST(StreamRingBufferTest, ViewAcrossTheEndIsContiguous) {
+    StreamRingBuffer buffer(16, 8);
+    ASSERT_TRUE(buffer.Allocate());
+    Write(buffer, Pattern(12, 0));
+    size_t len = 0;
+    ASSERT_NE(buffer.WaitReadable(12, len), nullptr);
+    buffer.Consume(10);
+
+    // 6 bytes up to the end, 6 after the wrap
+    auto old_data = Pattern(12, 0);
+    auto new_data = Pattern(10, 100);
+    Write(buffer, new_data);
+    std::vector<uint8_t> expected(old_data.begin() + 10, old_data.end());
+    expected.insert(expected.end(), new_data.begin(), new_data.end());
+
+    const uint8_t* view = buffer.WaitReadable(8, len);
+    ASSERT_NE(view, nullptr);
+    // The guard makes guard_size bytes readable in one piece across the end
+    EXPECT_EQ(len, 8u);
+    EXPECT_EQ(std::vector<uint8_t>(view, view + len), std::vector<uint8_t>(expected.begin(), expected.begin() + len));
+    buffer.Consume(7);
+    view = buffer.WaitReadable(5, len);
+    ASSERT_EQ(len, 5u);
+    EXPECT_EQ(std::vector<uint8_t>(view, view + len), std::vector<uint8_t>(expected.begin() + 7, expected.end()));
+    buffer.Consume(7);
+    EXPECT_EQ(buffer.Size(), 0u);
+}
+
+TEST(StreamRingBufferTest, ConcurrentTransferKeepsEveryByte) {
+    StreamRingBuffer buffer(4096, 1024);
+    ASSERT_TRUE(buffer.Allocate());
+    auto data = Pattern(1 << 20, 7);
+
+    std::thread writer([&] {
+        std::mt19937 rng(1);
+        size_t offset = 0;
+        while (offset < data.size()) {
+            size_t len = 0;
+            uint8_t* dst = buffer.WaitWritable(1 + rng() % 512, len);
+            ASSERT_NE(dst, nullptr);
+            len = std::min({len, data.size() - offset, (size_t)(1 + rng() % 1500)});
+            memcpy(dst, data.data() + offset, len);
+            buffer.Commit(len);
+            offset += len;
+        }
+        buffer.Finish();
+    });
+
+    std::mt19937 rng(2);
+    std::vector<uint8_t> received;
+    while (true) {
+        size_t len = 0;
+        const uint8_t* view = buffer.WaitReadable(1 + rng() % 1024, len);
+        ASSERT_NE(view, nullptr);
+        if (len == 0) {
+            break;
+        }
+        size_t take = std::min(len, (size_t)(1 + rng() % 700));
+        received.insert(received.end(), view, view + take);
+        buffer.Consume(take);
+    }
+    writer.join();
+    EXPECT_TRUE(buffer.finished());
+    EXPECT_EQ(received, data);
+}
+
+TEST(StreamRingBufferTest, ReaderStopsAtSegmentUntilNextSegment) {
+    StreamRingBuffer buffer(64, 16);
+    ASSERT_TRUE(buffer.Allocate());
+    auto first = Pattern(10, 1);
+    auto second = Pattern(20, 2);
+    Write(buffer, first);
+    buffer.MarkSegment(first.size());
+    size_t tag = 0;
+    EXPECT_TRUE(buffer.HasPendingSegment(tag));
+    EXPECT_EQ(tag, first.size());
+    Write(buffer, second);
+
+    size_t len = 0;
+    const uint8_t* view = buffer.WaitReadable(30, len);
+    ASSERT_NE(view, nullptr);
+    ASSERT_EQ(len, first.size());
+    EXPECT_EQ(std::vector<uint8_t>(view, view + len), first);
+    EXPECT_FALSE(buffer.NextSegment());
+    // Consuming more than the segment holds stops at the boundary
+    buffer.Consume(len + 5);
+
+    view = buffer.WaitReadable(1, len);
+    ASSERT_NE(view, nullptr);
+    EXPECT_EQ(len, 0u);
+    EXPECT_TRUE(buffer.NextSegment());
+    EXPECT_FALSE(buffer.HasPendingSegment());
+
+    view = buffer.WaitReadable(second.size(), len);
+    ASSERT_EQ(len, second.size());
+    EXPECT_EQ(std::vector<uint8_t>(view, view + len), second);
+}
+
+TEST(StreamRingBufferTest, FinishReturnsTheTailThenEmpty) {
+    StreamRingBuffer buffer(64, 16);
+    ASSERT_TRUE(buffer.Allocate());
+    Write(buffer, Pattern(5, 3));
+    buffer.Finish();
+
+    size_t len = 0;
+    // Asks for more than is left, returns the rest instead of waiting
+    const uint8_t* view = buffer.WaitReadable(32, len);
+    ASSERT_NE(view, nullptr);
+    EXPECT_EQ(len, 5u);
+    buffer.Consume(len);
+    view = buffer.WaitReadable(32, len);
+    ASSERT_NE(view, nullptr);
+    EXPECT_EQ(len, 0u);
+}
+
+TEST(StreamRingBufferTest, CloseWakesBlockedReaderAndWriter) {
+    StreamRingBuffer buffer(32, 8);
+    ASSERT_TRUE(buffer.Allocate());
+    Write(buffer, Pattern(32, 4));
+
+    const uint8_t* read_result = reinterpret_cast<const uint8_t*>(1);
+    uint8_t* write_result = reinterpret_cast<uint8_t*>(1);
+    std::thread writer([&] {
+        size_t len = 0;
+        write_result = buffer.WaitWritable(1, len);
+    });
+    StreamRingBuffer empty(32, 8);
+    ASSERT_TRUE(empty.Allocate());
+    std::thread reader([&] {
+        size_t len = 0;
+        read_result = empty.WaitReadable(1, len);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    buffer.Close();
+    empty.Close();
+    writer.join();
+    reader.join();
+    EXPECT_EQ(write_result, nullptr);
+    EXPECT_EQ(read_result, nullptr);
+
+    // Reset reopens the buffer empty
+    buffer.Reset();
+    EXPECT_EQ(buffer.Size(), 0u);
+    EXPECT_FALSE(buffer.finished());
+    size_t len = 0;
+    EXPECT_NE(buffer.WaitWritable(32, len), nullptr);
+    EXPECT_EQ(len, 32u);
+}
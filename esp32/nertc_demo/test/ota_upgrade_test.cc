@@ -0,0 +1,144 @@
+#include "ota_upgrade.h"
+
+#include <gtest/gtest.h>
+#include <spi_flash_mmap.h>
+#include <string>
+#include <vector>
+
+#include "fake_flash.h"
+#include "music_player/fake_server.h"
+#include "settings.h"
+
+namespace {
+
+const std::string kUrl = "http://ota.test/firmware.bin";
+constexpr size_t kImageSize = 300 * 1024 + 123;
+
+class OtaUpgradeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        fake_flash::Reset();
+        Settings("ota", true).EraseAll();
+        image_ = fake_flash::MakeFirmware(kImageSize, "2.0.0", 1);
+        server_.Put(kUrl, FakeResource{image_, "", true});
+        server_.SetReadPacing(0, 1460);
+    }
+
+    bool Upgrade() {
+        last_progress_ = -1;
+        return UpgradeFirmware(kUrl, fake_flash::Find("ota_1"), [this](int progress, size_t speed) {
+            last_progress_ = progress;
+        });
+    }
+
+    std::vector<uint8_t> Flashed() {
+        return fake_flash::Read(fake_flash::Find("ota_1"), 0, image_.size());
+    }
+
+    // The first attempt gets 200 KB before the link stays down for every retry
+    void FailFirstAttempt() {
+        server_.DropConnectionsAfter({200 * 1024});
+        server_.RefuseConnections(8, 1);
+        ASSERT_FALSE(Upgrade());
+        ASSERT_EQ(server_.requests().size(), 9u);
+    }
+
+    int32_t SavedOffset() {
+        Settings settings("ota", false);
+        return settings.GetInt("offset");
+    }
+
+    FakeServer server_;
+    std::vector<uint8_t> image_;
+    int last_progress_ = -1;
+};
+
+}  // namespace
+
+TEST_F(OtaUpgradeTest, FlashesImageAndSwitchesBootPartition) {
+    ASSERT_TRUE(Upgrade());
+    EXPECT_EQ(Flashed(), image_);
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_1"));
+    EXPECT_EQ(last_progress_, 100);
+    EXPECT_EQ(server_.requests().size(), 1u);
+    Settings settings("ota", false);
+    EXPECT_EQ(settings.GetString("url"), "");
+}
+
+TEST_F(OtaUpgradeTest, ContinuesWithRangeAfterResetAndTruncatedResponse) {
+    server_.DropConnectionsAfter({50000});
+    ASSERT_TRUE(Upgrade());
+    server_.CloseConnectionsAfter({70000});
+    fake_flash::Reset();
+    ASSERT_TRUE(Upgrade());
+    EXPECT_EQ(Flashed(), image_);
+
+    // Reset after 50000 bytes, then a body that ends cleanly after 70000
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 4u);
+    EXPECT_EQ(requests[1].offset, 50000u);
+    EXPECT_EQ(requests[1].status, 206);
+    EXPECT_EQ(requests[2].offset, 0u);
+    EXPECT_EQ(requests[3].offset, 70000u);
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_1"));
+}
+
+TEST_F(OtaUpgradeTest, ResumesFromSavedOffsetOnTheNextAttempt) {
+    FailFirstAttempt();
+    // Nothing is booted from a half written slot, and the flashed part is kept
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_0"));
+    int32_t offset = SavedOffset();
+    EXPECT_GT(offset, 0);
+    EXPECT_LE(offset, 200 * 1024);
+    EXPECT_EQ(offset % SPI_FLASH_SEC_SIZE, 0);
+
+    ASSERT_TRUE(Upgrade());
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 10u);
+    EXPECT_EQ(requests[9].offset, (size_t)offset);
+    EXPECT_EQ(requests[9].status, 206);
+    EXPECT_EQ(Flashed(), image_);
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_1"));
+}
+
+TEST_F(OtaUpgradeTest, RestartsWhenTheServerIgnoresRange) {
+    FailFirstAttempt();
+    server_.Put(kUrl, FakeResource{image_, "", false});
+    ASSERT_TRUE(Upgrade());
+    auto requests = server_.requests();
+    ASSERT_EQ(requests.size(), 11u);
+    EXPECT_GT(requests[9].offset, 0u);
+    EXPECT_EQ(requests[9].status, 200);
+    EXPECT_EQ(requests[10].offset, 0u);
+    EXPECT_EQ(Flashed(), image_);
+}
+
+TEST_F(OtaUpgradeTest, RejectsCorruptOrTruncatedImageBeforeSwitchingBoot) {
+    auto corrupt = image_;
+    corrupt[kImageSize / 2] ^= 0x01;
+    server_.Put(kUrl, FakeResource{corrupt, "", true});
+    EXPECT_FALSE(Upgrade());
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_0"));
+
+    auto truncated = image_;
+    truncated.resize(kImageSize - 1000);
+    server_.Put(kUrl, FakeResource{truncated, "", true});
+    EXPECT_FALSE(Upgrade());
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_0"));
+
+    // The resume state is dropped, so a good image starts over from the beginning
+    EXPECT_EQ(SavedOffset(), 0);
+    server_.Put(kUrl, FakeResource{image_, "", true});
+    ASSERT_TRUE(Upgrade());
+    EXPECT_EQ(server_.requests().back().offset, 0u);
+    EXPECT_EQ(Flashed(), image_);
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_1"));
+}
+
+TEST_F(OtaUpgradeTest, FlashWriteErrorAbortsAndForgetsResumeState) {
+    fake_flash::FailOtaWritesAfter(128 * 1024);
+    EXPECT_FALSE(Upgrade());
+    EXPECT_EQ(fake_flash::boot_partition(), fake_flash::Find("ota_0"));
+    Settings settings("ota", false);
+    EXPECT_EQ(settings.GetString("url"), "");
+}
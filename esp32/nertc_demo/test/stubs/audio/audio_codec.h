@@ -0,0 +1,2 @@
+#pragma once
+// Shadows main/audio/audio_codec.h, which needs the I2S drivers
@@ -0,0 +1,24 @@
+#pragma once
+// Only the network part of Board, tests install their own network
+#include <memory>
+
+#include "http.h"
+
+class NetworkInterface {
+public:
+    virtual ~NetworkInterface() = default;
+    virtual std::unique_ptr<Http> CreateHttp(int connect_id) = 0;
+};
+
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+    NetworkInterface* GetNetwork() { return network_; }
+    void set_network(NetworkInterface* network) { network_ = network; }
+
+private:
+    NetworkInterface* network_ = nullptr;
+};
@@ -0,0 +1,60 @@
+#pragma once
+// esp_audio_codec simple decoder API, implemented by test/music_player/fake_codecs.cc
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int esp_audio_err_t;
+#define ESP_AUDIO_ERR_OK               0
+#define ESP_AUDIO_ERR_FAIL             -1
+#define ESP_AUDIO_ERR_BUFF_NOT_ENOUGH  -6
+
+typedef enum {
+    ESP_AUDIO_SIMPLE_DEC_TYPE_NONE,
+    ESP_AUDIO_SIMPLE_DEC_TYPE_AAC,
+    ESP_AUDIO_SIMPLE_DEC_TYPE_M4A,
+} esp_audio_simple_dec_type_t;
+
+typedef struct {
+    esp_audio_simple_dec_type_t dec_type;
+    void* dec_cfg;
+    int cfg_size;
+    bool use_frame_dec;
+} esp_audio_simple_dec_cfg_t;
+
+typedef void* esp_audio_simple_dec_handle_t;
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t len;
+    bool eos;
+    uint32_t consumed;
+} esp_audio_simple_dec_raw_t;
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t len;
+    uint32_t needed_size;
+    uint32_t decoded_size;
+} esp_audio_simple_dec_out_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t bits_per_sample;
+    uint8_t channel;
+    int bitrate;
+    uint32_t frame_size;
+} esp_audio_simple_dec_info_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_audio_err_t esp_audio_simple_dec_open(esp_audio_simple_dec_cfg_t* cfg, esp_audio_simple_dec_handle_t* handle);
+esp_audio_err_t esp_audio_simple_dec_process(esp_audio_simple_dec_handle_t handle, esp_audio_simple_dec_raw_t* raw,
+                                             esp_audio_simple_dec_out_t* out);
+esp_audio_err_t esp_audio_simple_dec_get_info(esp_audio_simple_dec_handle_t handle, esp_audio_simple_dec_info_t* info);
+void esp_audio_simple_dec_close(esp_audio_simple_dec_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+#include "esp_audio_simple_dec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_audio_err_t esp_audio_simple_dec_register_default(void);
+
+#ifdef __cplusplus
+}
+#endif
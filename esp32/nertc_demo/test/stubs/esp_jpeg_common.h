@@ -0,0 +1,51 @@
+#pragma once
+// The parts of esp_new_jpeg's common header used by main/, see test/display/fake_jpeg_enc.cc
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    JPEG_ERR_OK = 0,
+    JPEG_ERR_FAIL = -1,
+    JPEG_ERR_NO_MEM = -2,
+    JPEG_ERR_NO_MORE_DATA = -3,
+    JPEG_ERR_INVALID_PARAM = -4,
+    JPEG_ERR_BAD_DATA = -5,
+    JPEG_ERR_UNSUPPORT_FMT = -6,
+    JPEG_ERR_UNSUPPORT_STD = -7,
+} jpeg_error_t;
+
+typedef enum {
+    JPEG_PIXEL_FORMAT_GRAY = 0,
+    JPEG_PIXEL_FORMAT_RGB888,
+    JPEG_PIXEL_FORMAT_RGBA,
+    JPEG_PIXEL_FORMAT_YCbYCr,
+} jpeg_pixel_format_t;
+
+typedef enum {
+    JPEG_SUBSAMPLE_GRAY = 0,
+    JPEG_SUBSAMPLE_444,
+    JPEG_SUBSAMPLE_422,
+    JPEG_SUBSAMPLE_420,
+} jpeg_subsampling_t;
+
+typedef enum {
+    JPEG_ROTATE_0D = 0,
+    JPEG_ROTATE_90D,
+    JPEG_ROTATE_180D,
+    JPEG_ROTATE_270D,
+} jpeg_rotate_t;
+
+// malloc is 16 byte aligned on the host
+static inline void* jpeg_calloc_align(size_t size, int aligned) {
+    (void)aligned;
+    void* p = malloc(size);
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+static inline void jpeg_free_align(void* p) {
+    free(p);
+}
@@ -0,0 +1,41 @@
+#pragma once
+// esp_new_jpeg's encoder API, implemented on libjpeg by test/display/fake_jpeg_enc.cc
+#include <stdbool.h>
+
+#include "esp_jpeg_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int width;
+    int height;
+    jpeg_pixel_format_t src_type;
+    jpeg_subsampling_t subsampling;
+    uint8_t quality;
+    jpeg_rotate_t rotate;
+    bool task_enable;
+    uint8_t hfm_task_priority;
+    uint8_t hfm_task_core;
+    uint32_t hfm_task_stack;
+} jpeg_enc_config_t;
+
+#define DEFAULT_JPEG_ENC_CONFIG() { \
+    .width = 320, .height = 240, .src_type = JPEG_PIXEL_FORMAT_YCbYCr, .subsampling = JPEG_SUBSAMPLE_420, \
+    .quality = 40, .rotate = JPEG_ROTATE_0D, .task_enable = false, .hfm_task_priority = 13, \
+    .hfm_task_core = 1, .hfm_task_stack = 4096, }
+
+typedef void* jpeg_enc_handle_t;
+
+jpeg_error_t jpeg_enc_open(jpeg_enc_config_t* info, jpeg_enc_handle_t* jpeg_enc);
+jpeg_error_t jpeg_enc_process(const jpeg_enc_handle_t jpeg_enc, const uint8_t* in_buf, int inbuf_size,
+                              uint8_t* out_buf, int outbuf_size, int* out_size);
+jpeg_error_t jpeg_enc_get_block_size(const jpeg_enc_handle_t jpeg_enc, int* block_size);
+jpeg_error_t jpeg_enc_process_with_block(const jpeg_enc_handle_t jpeg_enc, const uint8_t* in_buf, int inbuf_size,
+                                         uint8_t* out_buf, int outbuf_size, int* out_size);
+jpeg_error_t jpeg_enc_close(jpeg_enc_handle_t jpeg_enc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+// Host stub: the panel IO calls, dispatched through esp_lcd_panel_io_t as in esp_lcd
+#include "esp_lcd_panel_io_interface.h"
+
+static inline esp_err_t esp_lcd_panel_io_tx_param(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void* param, size_t param_size) {
+    return io->tx_param(io, lcd_cmd, param, param_size);
+}
+
+static inline esp_err_t esp_lcd_panel_io_tx_color(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void* color, size_t color_size) {
+    return io->tx_color(io, lcd_cmd, color, color_size);
+}
+
+static inline esp_err_t esp_lcd_panel_io_del(esp_lcd_panel_io_handle_t io) {
+    return io->del ? io->del(io) : ESP_OK;
+}
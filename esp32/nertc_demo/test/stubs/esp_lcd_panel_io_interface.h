@@ -0,0 +1,12 @@
+#pragma once
+// Host stub: the panel IO vtable, filled in by the mock IO of the tests
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_lcd_types.h"
+
+struct esp_lcd_panel_io_t {
+    esp_err_t (*rx_param)(esp_lcd_panel_io_t* io, int lcd_cmd, void* param, size_t param_size);
+    esp_err_t (*tx_param)(esp_lcd_panel_io_t* io, int lcd_cmd, const void* param, size_t param_size);
+    esp_err_t (*tx_color)(esp_lcd_panel_io_t* io, int lcd_cmd, const void* color, size_t color_size);
+    esp_err_t (*del)(esp_lcd_panel_io_t* io);
+};
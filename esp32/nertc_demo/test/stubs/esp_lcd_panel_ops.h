@@ -0,0 +1,19 @@
+#pragma once
+// Host stub: the panel calls, dispatched through esp_lcd_panel_t as in esp_lcd.
+// Calls the panel does not implement succeed, like the optional ones on the device.
+#include "esp_lcd_panel_interface.h"
+
+#define ESP_LCD_PANEL_CALL(panel, op, ...) ((panel)->op ? (panel)->op((panel), ##__VA_ARGS__) : ESP_OK)
+
+static inline esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t panel) { return ESP_LCD_PANEL_CALL(panel, reset); }
+static inline esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t panel) { return ESP_LCD_PANEL_CALL(panel, init); }
+static inline esp_err_t esp_lcd_panel_del(esp_lcd_panel_handle_t panel) { return ESP_LCD_PANEL_CALL(panel, del); }
+static inline esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end, int y_end, const void* color_data) {
+    return ESP_LCD_PANEL_CALL(panel, draw_bitmap, x_start, y_start, x_end, y_end, color_data);
+}
+static inline esp_err_t esp_lcd_panel_mirror(esp_lcd_panel_handle_t panel, bool mirror_x, bool mirror_y) { return ESP_LCD_PANEL_CALL(panel, mirror, mirror_x, mirror_y); }
+static inline esp_err_t esp_lcd_panel_swap_xy(esp_lcd_panel_handle_t panel, bool swap_axes) { return ESP_LCD_PANEL_CALL(panel, swap_xy, swap_axes); }
+static inline esp_err_t esp_lcd_panel_set_gap(esp_lcd_panel_handle_t panel, int x_gap, int y_gap) { return ESP_LCD_PANEL_CALL(panel, set_gap, x_gap, y_gap); }
+static inline esp_err_t esp_lcd_panel_invert_color(esp_lcd_panel_handle_t panel, bool invert) { return ESP_LCD_PANEL_CALL(panel, invert_color, invert); }
+static inline esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t panel, bool on_off) { return ESP_LCD_PANEL_CALL(panel, disp_on_off, on_off); }
+static inline esp_err_t esp_lcd_panel_disp_sleep(esp_lcd_panel_handle_t panel, bool sleep) { return ESP_LCD_PANEL_CALL(panel, disp_sleep, sleep); }
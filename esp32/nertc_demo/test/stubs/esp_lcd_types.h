@@ -0,0 +1,7 @@
+#pragma once
+// Host stub: the esp_lcd handle types
+
+typedef struct esp_lcd_panel_io_t esp_lcd_panel_io_t;
+typedef esp_lcd_panel_io_t* esp_lcd_panel_io_handle_t;
+typedef struct esp_lcd_panel_t esp_lcd_panel_t;
+typedef esp_lcd_panel_t* esp_lcd_panel_handle_t;
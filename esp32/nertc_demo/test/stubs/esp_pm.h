@@ -0,0 +1,2 @@
+#pragma once
+// Host stub: display.h includes this for the power management locks, which the tested code does not take
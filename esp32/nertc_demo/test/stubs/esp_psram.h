@@ -0,0 +1,12 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Host stub: PSRAM is plain heap, see esp_heap_caps.h
+static inline bool esp_psram_is_initialized(void) {
+    return true;
+}
+
+static inline size_t esp_psram_get_size(void) {
+    return 8 * 1024 * 1024;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+
+typedef struct {
+    size_t stack_size;
+    size_t prio;
+    bool inherit_cfg;
+    const char* thread_name;
+    int pin_to_core;
+    unsigned int stack_alloc_caps;
+} esp_pthread_cfg_t;
+
+static inline esp_pthread_cfg_t esp_pthread_get_default_config(void) {
+    esp_pthread_cfg_t cfg = {};
+    return cfg;
+}
+
+static inline int esp_pthread_set_cfg(const esp_pthread_cfg_t* cfg) {
+    (void)cfg;
+    return 0;
+}
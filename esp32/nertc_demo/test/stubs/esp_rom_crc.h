@@ -0,0 +1,8 @@
+#pragma once
+// The ROM's little-endian CRC32 is the zlib one
+#include <stdint.h>
+#include <zlib.h>
+
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    return crc32(crc, buf, len);
+}
@@ -0,0 +1,113 @@
+#include <esp_timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static std::atomic<int64_t> timer_offset_us{0};
+
+int64_t esp_timer_get_time(void) {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count() + timer_offset_us;
+}
+
+void esp_timer_stub_advance(int64_t us) {
+    timer_offset_us += us;
+}
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+    uint64_t generation = 0;  // Bumped by every start and stop, tells the thread it is stale
+    bool running = false;
+};
+
+static void TimerLoop(esp_timer_handle_t timer, uint64_t generation, uint64_t period_us, bool periodic) {
+    auto period = std::chrono::microseconds(period_us);
+    auto next = std::chrono::steady_clock::now() + period;
+    std::unique_lock<std::mutex> lock(timer->mutex);
+    while (true) {
+        timer->cv.wait_until(lock, next, [&] { return timer->generation != generation; });
+        if (timer->generation != generation) {
+            return;
+        }
+        lock.unlock();
+        timer->args.callback(timer->args.arg);
+        lock.lock();
+        if (!periodic || timer->generation != generation) {
+            timer->running = periodic && timer->running;
+            return;
+        }
+        next += period;
+        // Like esp_timer, a late periodic timer fires once and then skips the periods it missed
+        auto now = std::chrono::steady_clock::now();
+        if (timer->args.skip_unhandled_events && next < now) {
+            next = now + period;
+        }
+    }
+}
+
+static esp_err_t StartTimer(esp_timer_handle_t timer, uint64_t us, bool periodic) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (timer->thread.joinable()) {
+        timer->thread.detach();
+    }
+    timer->running = true;
+    timer->thread = std::thread(TimerLoop, timer, ++timer->generation, us, periodic);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_handle = new esp_timer{*create_args};
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return StartTimer(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return StartTimer(timer, period, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        if (!timer->running) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        timer->running = false;
+        timer->generation++;
+        timer->cv.notify_all();
+        thread = std::move(timer->thread);
+    }
+    // A callback stopping its own timer cannot wait for itself
+    if (thread.get_id() == std::this_thread::get_id()) {
+        thread.detach();
+    } else if (thread.joinable()) {
+        thread.join();
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (timer->thread.joinable()) {
+        timer->thread.join();
+    }
+    delete timer;
+    return ESP_OK;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+// Tasks run on detached threads, vTaskDelete(NULL) is expected as their last call
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    uint32_t priority, TaskHandle_t* created_task);
+void vTaskDelete(TaskHandle_t task);
+// Advances the esp_timer clock instead of sleeping, so retry back-offs cost no real time
+void vTaskDelay(TickType_t ticks);
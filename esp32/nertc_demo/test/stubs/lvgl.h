@@ -0,0 +1,69 @@
+#pragma once
+// Host stub: the LVGL types and calls used by the display code under test,
+// implemented by display/fake_display.cc
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int32_t x1;
+    int32_t y1;
+    int32_t x2;
+    int32_t y2;
+} lv_area_t;
+
+typedef struct {
+    uint32_t cf;
+    uint32_t w;
+    uint32_t h;
+    uint32_t stride;
+} lv_image_header_t;
+
+typedef struct {
+    lv_image_header_t header;
+    uint32_t data_size;
+    const uint8_t* data;
+} lv_image_dsc_t;
+typedef lv_image_dsc_t lv_img_dsc_t;
+
+typedef struct _lv_obj_t lv_obj_t;
+
+#define LV_COLOR_FORMAT_RGB565 0x12
+#define LV_OPA_TRANSP 0
+
+// The panel the fake display stands in for, see display/fake_display.h
+#define LV_HOR_RES 240
+#define LV_VER_RES 240
+
+lv_obj_t* lv_image_create(lv_obj_t* parent);
+void lv_image_set_src(lv_obj_t* obj, const void* src);
+void lv_obj_set_size(lv_obj_t* obj, int32_t w, int32_t h);
+void lv_obj_set_style_border_width(lv_obj_t* obj, int32_t value, uint32_t selector);
+void lv_obj_set_style_bg_opa(lv_obj_t* obj, uint8_t value, uint32_t selector);
+void lv_obj_center(lv_obj_t* obj);
+void lv_obj_del(lv_obj_t* obj);
+void lv_obj_get_coords(const lv_obj_t* obj, lv_area_t* coords);
+void lv_obj_invalidate(const lv_obj_t* obj);
+void lv_obj_invalidate_area(const lv_obj_t* obj, const lv_area_t* area);
+
+static inline int32_t lv_area_get_width(const lv_area_t* area) {
+    return area->x2 - area->x1 + 1;
+}
+
+static inline int32_t lv_area_get_height(const lv_area_t* area) {
+    return area->y2 - area->y1 + 1;
+}
+
+static inline void lv_area_move(lv_area_t* area, int32_t x_ofs, int32_t y_ofs) {
+    area->x1 += x_ofs;
+    area->y1 += y_ofs;
+    area->x2 += x_ofs;
+    area->y2 += y_ofs;
+}
+
+#ifdef __cplusplus
+}
+#endif
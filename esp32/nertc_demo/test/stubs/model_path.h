@@ -0,0 +1,4 @@
+#pragma once
+// Only the type Assets keeps a pointer to
+
+typedef struct srmodel_list_t srmodel_list_t;
@@ -0,0 +1,38 @@
+#pragma once
+// Helix MP3 decoder API, implemented by test/music_player/fake_codecs.cc
+#define MAX_NCHAN 2
+#define MAX_NGRAN 2
+#define MAX_NSAMP 576
+
+enum {
+    ERR_MP3_NONE = 0,
+    ERR_MP3_INDATA_UNDERFLOW = -1,
+    ERR_MP3_MAINDATA_UNDERFLOW = -2,
+    ERR_MP3_INVALID_FRAMEHEADER = -6,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* HMP3Decoder;
+
+typedef struct {
+    int bitrate;
+    int nChans;
+    int samprate;
+    int bitsPerSample;
+    int outputSamps;
+    int layer;
+    int version;
+} MP3FrameInfo;
+
+HMP3Decoder MP3InitDecoder(void);
+void MP3FreeDecoder(HMP3Decoder decoder);
+int MP3Decode(HMP3Decoder decoder, unsigned char** inbuf, int* bytes_left, short* outbuf, int use_size);
+void MP3GetLastFrameInfo(HMP3Decoder decoder, MP3FrameInfo* info);
+int MP3FindSyncWord(unsigned char* buf, int size);
+
+#ifdef __cplusplus
+}
+#endif
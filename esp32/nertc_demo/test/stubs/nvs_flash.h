@@ -0,0 +1,5 @@
+#pragma once
+// Only the handle type Settings keeps, stubs/settings.cc stores values in memory
+#include <stdint.h>
+
+typedef uint32_t nvs_handle_t;
@@ -0,0 +1,17 @@
+#pragma once
+// libopus decoder API, implemented by test/music_player/fake_codecs.cc
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OpusDecoder OpusDecoder;
+
+OpusDecoder* opus_decoder_create(int32_t sample_rate, int channels, int* error);
+void opus_decoder_destroy(OpusDecoder* decoder);
+int opus_decode(OpusDecoder* decoder, const unsigned char* data, int32_t len, int16_t* pcm, int frame_size, int decode_fec);
+
+#ifdef __cplusplus
+}
+#endif
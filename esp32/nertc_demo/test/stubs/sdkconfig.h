@@ -0,0 +1,2 @@
+#pragma once
+// The host build passes the CONFIG_ options it needs as compile definitions
@@ -0,0 +1,65 @@
+// In-memory stand-in for the NVS backed Settings, shared by every instance
+#include "settings.h"
+
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct Value {
+    std::string string_value;
+    int32_t int_value = 0;
+};
+
+std::mutex store_mutex;
+std::map<std::string, std::map<std::string, Value>> store;
+
+}  // namespace
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+Settings::~Settings() {
+}
+
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto& values = store[ns_];
+    auto it = values.find(key);
+    return it == values.end() ? default_value : it->second.string_value;
+}
+
+void Settings::SetString(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    store[ns_][key].string_value = value;
+}
+
+int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto& values = store[ns_];
+    auto it = values.find(key);
+    return it == values.end() ? default_value : it->second.int_value;
+}
+
+void Settings::SetInt(const std::string& key, int32_t value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    store[ns_][key].int_value = value;
+}
+
+bool Settings::GetBool(const std::string& key, bool default_value) {
+    return GetInt(key, default_value) != 0;
+}
+
+void Settings::SetBool(const std::string& key, bool value) {
+    SetInt(key, value);
+}
+
+void Settings::EraseKey(const std::string& key) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    store[ns_].erase(key);
+}
+
+void Settings::EraseAll() {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    store.erase(ns_);
+}
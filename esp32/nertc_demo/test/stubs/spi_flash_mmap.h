@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+#define SPI_FLASH_SEC_SIZE  4096
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+uint32_t spi_flash_mmap_get_free_pages(spi_flash_mmap_memory_t memory);